@@ -44,11 +44,13 @@ constexpr int kMaxRetries = 5;
 }  // namespace
 
 MapBuilderStub::MapBuilderStub(const std::string& server_address,
-                               const std::string& client_id)
+                               const std::string& client_id,
+                               const bool compress_point_clouds)
     : client_channel_(::grpc::CreateChannel(
           server_address, ::grpc::InsecureChannelCredentials())),
       pose_graph_stub_(make_unique<PoseGraphStub>(client_channel_, client_id)),
-      client_id_(client_id) {
+      client_id_(client_id),
+      compress_point_clouds_(compress_point_clouds) {
   LOG(INFO) << "Connecting to SLAM process at " << server_address
             << " with client_id " << client_id;
   std::chrono::system_clock::time_point deadline(
@@ -82,7 +84,7 @@ int MapBuilderStub::AddTrajectoryBuilder(
       std::forward_as_tuple(client.response().trajectory_id()),
       std::forward_as_tuple(make_unique<TrajectoryBuilderStub>(
           client_channel_, client.response().trajectory_id(), client_id_,
-          local_slam_result_callback)));
+          local_slam_result_callback, compress_point_clouds_)));
   return client.response().trajectory_id();
 }
 
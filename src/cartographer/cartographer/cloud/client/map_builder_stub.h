@@ -29,8 +29,11 @@ namespace cloud {
 
 class MapBuilderStub : public mapping::MapBuilderInterface {
  public:
+  // If 'compress_point_clouds' is true, rangefinder data is uploaded in a
+  // compact, lossy encoding with 1 mm resolution to save bandwidth.
   MapBuilderStub(const std::string& server_address,
-                 const std::string& client_id);
+                 const std::string& client_id,
+                 bool compress_point_clouds = false);
 
   MapBuilderStub(const MapBuilderStub&) = delete;
   MapBuilderStub& operator=(const MapBuilderStub&) = delete;
@@ -67,6 +70,7 @@ class MapBuilderStub : public mapping::MapBuilderInterface {
   std::map<int, std::unique_ptr<mapping::TrajectoryBuilderInterface>>
       trajectory_builder_stubs_;
   const std::string client_id_;
+  const bool compress_point_clouds_;
 };
 
 }  // namespace cloud
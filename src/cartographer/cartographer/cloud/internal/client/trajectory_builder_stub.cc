@@ -28,10 +28,12 @@ namespace cloud {
 TrajectoryBuilderStub::TrajectoryBuilderStub(
     std::shared_ptr<::grpc::Channel> client_channel, const int trajectory_id,
     const std::string& client_id,
-    LocalSlamResultCallback local_slam_result_callback)
+    LocalSlamResultCallback local_slam_result_callback,
+    const bool compress_point_clouds)
     : client_channel_(client_channel),
       trajectory_id_(trajectory_id),
       client_id_(client_id),
+      compress_point_clouds_(compress_point_clouds),
       receive_local_slam_results_client_(client_channel_) {
   if (local_slam_result_callback) {
     proto::ReceiveLocalSlamResultsRequest request;
@@ -82,9 +84,29 @@ void TrajectoryBuilderStub::AddSensorData(
         client_channel_);
   }
   proto::AddRangefinderDataRequest request;
-  CreateAddRangeFinderDataRequest(sensor_id, trajectory_id_, client_id_,
-                                  sensor::ToProto(timed_point_cloud_data),
-                                  &request);
+  if (compress_point_clouds_) {
+    const auto start_time = std::chrono::steady_clock::now();
+    CreateAddRangeFinderDataRequest(
+        sensor_id, trajectory_id_, client_id_,
+        CompressTimedPointCloudData(timed_point_cloud_data), &request);
+    const auto encode_duration = std::chrono::steady_clock::now() - start_time;
+    // Both requests share everything but the point cloud. Its uncompressed
+    // size is estimated, since serializing it just for the statistics would
+    // cost about as much as sending it uncompressed.
+    const int64 uncompressed_bytes =
+        request.ByteSizeLong() -
+        request.compressed_timed_point_cloud_data().ByteSizeLong() +
+        EstimateUncompressedByteSize(timed_point_cloud_data);
+    point_cloud_compression_statistics_
+        .emplace(sensor_id, PointCloudCompressionStatistics(sensor_id))
+        .first->second.Add(
+            uncompressed_bytes, request.ByteSizeLong(),
+            std::chrono::duration_cast<common::Duration>(encode_duration));
+  } else {
+    CreateAddRangeFinderDataRequest(sensor_id, trajectory_id_, client_id_,
+                                    sensor::ToProto(timed_point_cloud_data),
+                                    &request);
+  }
   add_rangefinder_client_->Write(request);
 }
 
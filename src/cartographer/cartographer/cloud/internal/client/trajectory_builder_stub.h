@@ -17,6 +17,8 @@
 #ifndef CARTOGRAPHER_CLOUD_INTERNAL_CLIENT_TRAJECTORY_BUILDER_STUB_H_
 #define CARTOGRAPHER_CLOUD_INTERNAL_CLIENT_TRAJECTORY_BUILDER_STUB_H_
 
+#include <map>
+#include <string>
 #include <thread>
 
 #include "async_grpc/client.h"
@@ -26,6 +28,7 @@
 #include "cartographer/cloud/internal/handlers/add_odometry_data_handler.h"
 #include "cartographer/cloud/internal/handlers/add_rangefinder_data_handler.h"
 #include "cartographer/cloud/internal/handlers/receive_local_slam_results_handler.h"
+#include "cartographer/cloud/internal/sensor/compressed_timed_point_cloud_data.h"
 #include "cartographer/mapping/internal/local_slam_result_data.h"
 #include "cartographer/mapping/trajectory_builder_interface.h"
 #include "grpc++/grpc++.h"
@@ -37,9 +40,12 @@ namespace cloud {
 
 class TrajectoryBuilderStub : public mapping::TrajectoryBuilderInterface {
  public:
+  // If 'compress_point_clouds' is true, rangefinder data is uploaded with the
+  // lossy 'CompressTimedPointCloudData()' encoding to save bandwidth.
   TrajectoryBuilderStub(std::shared_ptr<::grpc::Channel> client_channel,
                         const int trajectory_id, const std::string& client_id,
-                        LocalSlamResultCallback local_slam_result_callback);
+                        LocalSlamResultCallback local_slam_result_callback,
+                        bool compress_point_clouds);
   ~TrajectoryBuilderStub() override;
   TrajectoryBuilderStub(const TrajectoryBuilderStub&) = delete;
   TrajectoryBuilderStub& operator=(const TrajectoryBuilderStub&) = delete;
@@ -68,6 +74,9 @@ class TrajectoryBuilderStub : public mapping::TrajectoryBuilderInterface {
   std::shared_ptr<::grpc::Channel> client_channel_;
   const int trajectory_id_;
   const std::string client_id_;
+  const bool compress_point_clouds_;
+  std::map<std::string, PointCloudCompressionStatistics>
+      point_cloud_compression_statistics_;
   std::unique_ptr<async_grpc::Client<handlers::AddRangefinderDataSignature>>
       add_rangefinder_client_;
   std::unique_ptr<async_grpc::Client<handlers::AddImuDataSignature>>
@@ -31,9 +31,8 @@ namespace handlers {
 
 void AddFixedFramePoseDataHandler::OnSensorData(
     const proto::AddFixedFramePoseDataRequest& request) {
-  // The 'BlockingQueue' returned by 'sensor_data_queue()' is already
-  // thread-safe. Therefore it suffices to get an unsynchronized reference to
-  // the 'MapBuilderContext'.
+  // 'EnqueueSensorData()' is already thread-safe. Therefore it suffices to
+  // get an unsynchronized reference to the 'MapBuilderContext'.
   GetUnsynchronizedContext<MapBuilderContextInterface>()->EnqueueSensorData(
       request.sensor_metadata().trajectory_id(),
       sensor::MakeDispatchable(
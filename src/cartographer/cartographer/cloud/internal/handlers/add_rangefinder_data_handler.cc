@@ -19,6 +19,7 @@
 #include "absl/memory/memory.h"
 #include "async_grpc/rpc_handler.h"
 #include "cartographer/cloud/internal/map_builder_context_interface.h"
+#include "cartographer/cloud/internal/sensor/compressed_timed_point_cloud_data.h"
 #include "cartographer/cloud/proto/map_builder_service.pb.h"
 #include "cartographer/sensor/internal/dispatchable.h"
 #include "cartographer/sensor/timed_point_cloud_data.h"
@@ -30,14 +31,28 @@ namespace handlers {
 
 void AddRangefinderDataHandler::OnSensorData(
     const proto::AddRangefinderDataRequest& request) {
-  // The 'BlockingQueue' returned by 'sensor_data_queue()' is already
-  // thread-safe. Therefore it suffices to get an unsynchronized reference to
-  // the 'MapBuilderContext'.
+  // Clients may opt into uploading compressed point clouds.
+  sensor::TimedPointCloudData timed_point_cloud_data;
+  if (request.has_compressed_timed_point_cloud_data()) {
+    const ::grpc::Status status = DecompressTimedPointCloudData(
+        request.compressed_timed_point_cloud_data(), &timed_point_cloud_data);
+    if (!status.ok()) {
+      LOG(ERROR) << "Rejecting point cloud of trajectory "
+                 << request.sensor_metadata().trajectory_id() << ": "
+                 << status.error_message();
+      Finish(status);
+      return;
+    }
+  } else {
+    timed_point_cloud_data =
+        sensor::FromProto(request.timed_point_cloud_data());
+  }
+  // 'EnqueueSensorData()' is already thread-safe. Therefore it suffices to
+  // get an unsynchronized reference to the 'MapBuilderContext'.
   GetUnsynchronizedContext<MapBuilderContextInterface>()->EnqueueSensorData(
       request.sensor_metadata().trajectory_id(),
-      sensor::MakeDispatchable(
-          request.sensor_metadata().sensor_id(),
-          sensor::FromProto(request.timed_point_cloud_data())));
+      sensor::MakeDispatchable(request.sensor_metadata().sensor_id(),
+                               std::move(timed_point_cloud_data)));
 }
 
 }  // namespace handlers
@@ -16,6 +16,7 @@
 
 #include "cartographer/cloud/internal/handlers/add_rangefinder_data_handler.h"
 
+#include "cartographer/cloud/internal/sensor/compressed_timed_point_cloud_data.h"
 #include "cartographer/cloud/internal/testing/handler_test.h"
 #include "cartographer/cloud/internal/testing/test_helpers.h"
 #include "google/protobuf/text_format.h"
@@ -71,6 +72,28 @@ TEST_F(AddRangefinderDataHandlerTest, NoLocalSlamUploader) {
   test_server_->SendFinish();
 }
 
+TEST_F(AddRangefinderDataHandlerTest, CompressedTimedPointCloudData) {
+  proto::AddRangefinderDataRequest request;
+  EXPECT_TRUE(
+      google::protobuf::TextFormat::ParseFromString(kMessage, &request));
+  *request.mutable_compressed_timed_point_cloud_data() =
+      CompressTimedPointCloudData(
+          sensor::FromProto(request.timed_point_cloud_data()));
+  request.clear_timed_point_cloud_data();
+  EXPECT_CALL(
+      *mock_map_builder_context_,
+      CheckClientIdForTrajectory(Eq(request.sensor_metadata().client_id()),
+                                 Eq(request.sensor_metadata().trajectory_id())))
+      .WillOnce(::testing::Return(true));
+  EXPECT_CALL(*mock_map_builder_context_,
+              DoEnqueueSensorData(
+                  Eq(request.sensor_metadata().trajectory_id()),
+                  Pointee(Truly(testing::BuildDataPredicateEquals(request)))));
+  test_server_->SendWrite(request);
+  test_server_->SendWritesDone();
+  test_server_->SendFinish();
+}
+
 }  // namespace
 }  // namespace handlers
 }  // namespace cloud
@@ -19,6 +19,7 @@
 #include "absl/memory/memory.h"
 #include "async_grpc/rpc_handler.h"
 #include "cartographer/cloud/internal/map_builder_context_interface.h"
+#include "cartographer/cloud/internal/sensor/compressed_timed_point_cloud_data.h"
 #include "cartographer/cloud/proto/map_builder_service.pb.h"
 #include "cartographer/mapping/internal/local_slam_result_data.h"
 #include "cartographer/metrics/counter.h"
@@ -77,6 +78,27 @@ void AddSensorDataBatchHandler::OnRequest(
                     sensor::FromProto(sensor_data.timed_point_cloud_data())));
         metrics->timed_point_cloud_counter->Increment();
         break;
+      case proto::SensorData::kCompressedTimedPointCloudData: {
+        sensor::TimedPointCloudData timed_point_cloud_data;
+        const ::grpc::Status status = DecompressTimedPointCloudData(
+            sensor_data.compressed_timed_point_cloud_data(),
+            &timed_point_cloud_data);
+        if (!status.ok()) {
+          LOG(ERROR) << "Rejecting point cloud of trajectory "
+                     << sensor_data.sensor_metadata().trajectory_id() << ": "
+                     << status.error_message();
+          Finish(status);
+          return;
+        }
+        GetUnsynchronizedContext<MapBuilderContextInterface>()
+            ->EnqueueSensorData(
+                sensor_data.sensor_metadata().trajectory_id(),
+                sensor::MakeDispatchable(
+                    sensor_data.sensor_metadata().sensor_id(),
+                    std::move(timed_point_cloud_data)));
+        metrics->timed_point_cloud_counter->Increment();
+        break;
+      }
       case proto::SensorData::kFixedFramePoseData:
         GetUnsynchronizedContext<MapBuilderContextInterface>()
             ->EnqueueSensorData(
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/cloud/internal/handlers/subscribe_submap_updates_handler.h"
+
+#include <memory>
+#include <thread>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "async_grpc/rpc_handler.h"
+#include "cartographer/cloud/internal/map_builder_context_interface.h"
+#include "cartographer/cloud/internal/mapping/submap_update_tracker.h"
+#include "cartographer/cloud/proto/map_builder_service.pb.h"
+#include "cartographer/transform/transform.h"
+
+namespace cartographer {
+namespace cloud {
+namespace handlers {
+namespace {
+
+// Global pose changes below these thresholds are not sent to subscribers.
+constexpr double kMinTranslationChange = 1e-3;  // in meters.
+constexpr double kMinRotationChange = 1e-3;     // in radians.
+
+// Updates are split into several responses of about this size, so that the
+// textures of a large map are not sent in a single message.
+constexpr size_t kMaxResponseBytes = 1024 * 1024;
+
+}  // namespace
+
+// Generates and sends the submap updates of one subscriber on its own thread.
+// The global SLAM callbacks only wake it up, so that fetching textures never
+// blocks the optimization or other subscribers. Optimizations which finish
+// while an update is being sent are coalesced into the next one.
+class SubmapUpdateWriter {
+ public:
+  using Writer = SubscribeSubmapUpdatesHandler::Writer;
+
+  SubmapUpdateWriter(const Writer &writer,
+                     MapBuilderContextInterface *const context,
+                     const bool include_textures)
+      : writer_(writer),
+        context_(context),
+        include_textures_(include_textures),
+        tracker_(kMinTranslationChange, kMinRotationChange),
+        thread_([this]() { Run(); }) {}
+
+  ~SubmapUpdateWriter() {
+    {
+      absl::MutexLock locker(&mutex_);
+      shutting_down_ = true;
+    }
+    thread_.join();
+  }
+
+  // Requests sending the changes since the last update. Returns false once
+  // the client closed the connection.
+  bool RequestUpdate() LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock locker(&mutex_);
+    update_requested_ = true;
+    return !client_closed_;
+  }
+
+ private:
+  void Run() LOCKS_EXCLUDED(mutex_) {
+    const auto predicate = [this]() EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+      return update_requested_ || shutting_down_;
+    };
+    for (;;) {
+      {
+        absl::MutexLock locker(&mutex_);
+        mutex_.Await(absl::Condition(&predicate));
+        if (shutting_down_) {
+          return;
+        }
+        update_requested_ = false;
+      }
+      if (!SendChangedSubmaps()) {
+        LOG(INFO) << "Client closed connection.";
+        absl::MutexLock locker(&mutex_);
+        client_closed_ = true;
+        return;
+      }
+    }
+  }
+
+  bool SendChangedSubmaps() {
+    mapping::MapBuilderInterface &map_builder = context_->map_builder();
+    const SubmapUpdateTracker::SubmapPoses submap_poses =
+        map_builder.pose_graph()->GetAllSubmapPoses();
+    const SubmapUpdateTracker::Changes changes = tracker_.Update(submap_poses);
+    // Textures only change with the submap version, a submap which merely
+    // moved is sent without them.
+    auto new_version = changes.new_version_submap_ids.begin();
+    auto response = absl::make_unique<proto::SubscribeSubmapUpdatesResponse>();
+    size_t response_bytes = 0;
+    for (const mapping::SubmapId &submap_id : changes.updated_submap_ids) {
+      const mapping::PoseGraphInterface::SubmapPose &submap_pose =
+          submap_poses.at(submap_id);
+      proto::SubmapUpdate *const update = response->add_updated_submaps();
+      submap_id.ToProto(update->mutable_submap_pose()->mutable_submap_id());
+      update->mutable_submap_pose()->set_submap_version(submap_pose.version);
+      *update->mutable_submap_pose()->mutable_global_pose() =
+          transform::ToProto(submap_pose.pose);
+      if (new_version != changes.new_version_submap_ids.end() &&
+          *new_version == submap_id) {
+        ++new_version;
+        if (include_textures_) {
+          update->set_error_msg(map_builder.SubmapToProto(
+              submap_id, update->mutable_submap_query_response()));
+        }
+      }
+      response_bytes += update->ByteSizeLong();
+      if (response_bytes >= kMaxResponseBytes) {
+        if (!writer_.Write(std::move(response))) {
+          return false;
+        }
+        response = absl::make_unique<proto::SubscribeSubmapUpdatesResponse>();
+        response_bytes = 0;
+      }
+    }
+    for (const mapping::SubmapId &submap_id : changes.removed_submap_ids) {
+      submap_id.ToProto(response->add_removed_submap_ids());
+    }
+    if (response->updated_submaps().empty() &&
+        response->removed_submap_ids().empty()) {
+      return true;
+    }
+    return writer_.Write(std::move(response));
+  }
+
+  const Writer writer_;
+  // The map builder and pose graph are thread-safe.
+  MapBuilderContextInterface *const context_;
+  const bool include_textures_;
+  // Only used by 'thread_'.
+  SubmapUpdateTracker tracker_;
+
+  absl::Mutex mutex_;
+  bool update_requested_ GUARDED_BY(mutex_) = false;
+  bool shutting_down_ GUARDED_BY(mutex_) = false;
+  bool client_closed_ GUARDED_BY(mutex_) = false;
+
+  std::thread thread_;
+};
+
+void SubscribeSubmapUpdatesHandler::OnRequest(
+    const proto::SubscribeSubmapUpdatesRequest &request) {
+  MapBuilderContextInterface *const context =
+      GetUnsynchronizedContext<MapBuilderContextInterface>();
+  auto submap_update_writer = std::make_shared<SubmapUpdateWriter>(
+      GetWriter(), context, request.include_textures());
+  const int subscription_index = context->SubscribeGlobalSlamOptimizations(
+      [submap_update_writer](const std::map<int, mapping::SubmapId> &,
+                             const std::map<int, mapping::NodeId> &) {
+        // Returns false to end the subscription once the client closed the
+        // connection.
+        return submap_update_writer->RequestUpdate();
+      });
+  LOG(INFO) << "Added subscription: " << subscription_index;
+  subscription_index_ = subscription_index;
+  // The initial update sends the whole map. Requesting it after subscribing
+  // makes sure no optimization in between is missed.
+  submap_update_writer->RequestUpdate();
+  submap_update_writer_ = std::move(submap_update_writer);
+}
+
+void SubscribeSubmapUpdatesHandler::OnFinish() {
+  if (subscription_index_.has_value()) {
+    LOG(INFO) << "Removing subscription " << subscription_index_.value();
+    GetUnsynchronizedContext<MapBuilderContextInterface>()
+        ->UnsubscribeGlobalSlamOptimizations(subscription_index_.value());
+  }
+  // Stops the writer thread.
+  submap_update_writer_.reset();
+}
+
+}  // namespace handlers
+}  // namespace cloud
+}  // namespace cartographer
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_CLOUD_INTERNAL_HANDLERS_SUBSCRIBE_SUBMAP_UPDATES_HANDLER_H
+#define CARTOGRAPHER_CLOUD_INTERNAL_HANDLERS_SUBSCRIBE_SUBMAP_UPDATES_HANDLER_H
+
+#include <memory>
+
+#include "absl/types/optional.h"
+#include "async_grpc/rpc_handler.h"
+#include "cartographer/cloud/proto/map_builder_service.pb.h"
+
+namespace cartographer {
+namespace cloud {
+namespace handlers {
+
+DEFINE_HANDLER_SIGNATURE(
+    SubscribeSubmapUpdatesSignature, proto::SubscribeSubmapUpdatesRequest,
+    async_grpc::Stream<proto::SubscribeSubmapUpdatesResponse>,
+    "/cartographer.cloud.proto.MapBuilderService/SubscribeSubmapUpdates")
+
+class SubmapUpdateWriter;
+
+class SubscribeSubmapUpdatesHandler
+    : public async_grpc::RpcHandler<SubscribeSubmapUpdatesSignature> {
+ public:
+  void OnRequest(const proto::SubscribeSubmapUpdatesRequest &request) override;
+  void OnFinish() override;
+
+ private:
+  absl::optional<int> subscription_index_;
+  std::shared_ptr<SubmapUpdateWriter> submap_update_writer_;
+};
+
+}  // namespace handlers
+}  // namespace cloud
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_CLOUD_INTERNAL_HANDLERS_SUBSCRIBE_SUBMAP_UPDATES_HANDLER_H
@@ -16,6 +16,7 @@
 
 #include "cartographer/cloud/internal/local_trajectory_uploader.h"
 
+#include <algorithm>
 #include <map>
 #include <thread>
 
@@ -25,7 +26,10 @@
 #include "cartographer/cloud/internal/handlers/add_trajectory_handler.h"
 #include "cartographer/cloud/internal/handlers/finish_trajectory_handler.h"
 #include "cartographer/cloud/internal/sensor/serialization.h"
-#include "cartographer/common/internal/blocking_queue.h"
+#include "cartographer/cloud/internal/sensor_data_upload_queue.h"
+#include "cartographer/metrics/counter.h"
+#include "cartographer/metrics/gauge.h"
+#include "cartographer/metrics/histogram.h"
 #include "glog/logging.h"
 #include "grpc++/grpc++.h"
 
@@ -40,6 +44,12 @@ constexpr int kConnectionRecoveryTimeoutInSeconds = 60;
 constexpr int kTokenRefreshIntervalInSeconds = 60;
 const common::Duration kPopTimeout = common::FromMilliseconds(100);
 
+static auto* kQueueBytesMetric = metrics::Gauge::Null();
+static auto* kDroppedSensorDataMetric = metrics::Counter::Null();
+static auto* kBatchSizeMetric = metrics::Histogram::Null();
+static auto* kBatchBytesMetric = metrics::Histogram::Null();
+static auto* kUploadLatencyMetric = metrics::Histogram::Null();
+
 // This defines the '::grpc::StatusCode's that are considered unrecoverable
 // errors and hence no retries will be attempted by the client.
 const std::set<::grpc::StatusCode> kUnrecoverableStatusCodes = {
@@ -49,11 +59,6 @@ const std::set<::grpc::StatusCode> kUnrecoverableStatusCodes = {
     ::grpc::UNKNOWN,
 };
 
-bool IsNewSubmap(const mapping::proto::Submap& submap) {
-  return (submap.has_submap_2d() && submap.submap_2d().num_range_data() == 1) ||
-         (submap.has_submap_3d() && submap.submap_3d().num_range_data() == 1);
-}
-
 class LocalTrajectoryUploader : public LocalTrajectoryUploaderInterface {
  public:
   struct TrajectoryInfo {
@@ -66,7 +71,9 @@ class LocalTrajectoryUploader : public LocalTrajectoryUploaderInterface {
 
  public:
   LocalTrajectoryUploader(const std::string& uplink_server_address,
-                          int batch_size, bool enable_ssl_encryption,
+                          int batch_size, int max_batch_bytes,
+                          common::Duration max_batch_delay,
+                          int64 max_queue_bytes, bool enable_ssl_encryption,
                           bool enable_google_auth);
   ~LocalTrajectoryUploader();
 
@@ -93,22 +100,34 @@ class LocalTrajectoryUploader : public LocalTrajectoryUploaderInterface {
 
  private:
   void ProcessSendQueue();
+  // Returns 'false' if an unrecoverable error occurred.
+  bool UploadBatch(const proto::AddSensorDataBatchRequest& batch_request);
+  void UpdateQueueMetrics();
   // Returns 'false' for failure.
   bool TranslateTrajectoryId(proto::SensorMetadata* sensor_metadata);
   grpc::Status RegisterTrajectory(int local_trajectory_id);
 
   std::shared_ptr<::grpc::Channel> client_channel_;
-  int batch_size_;
+  const int batch_size_;
+  const int max_batch_bytes_;
+  const common::Duration max_batch_delay_;
   std::map<int, TrajectoryInfo> local_trajectory_id_to_trajectory_info_;
-  common::BlockingQueue<std::unique_ptr<proto::SensorData>> send_queue_;
+  SensorDataUploadQueue send_queue_;
+  int64 num_dropped_reported_ = 0;
   bool shutting_down_ = false;
   std::unique_ptr<std::thread> upload_thread_;
 };
 
 LocalTrajectoryUploader::LocalTrajectoryUploader(
-    const std::string& uplink_server_address, int batch_size,
-    bool enable_ssl_encryption, bool enable_google_auth)
-    : batch_size_(batch_size) {
+    const std::string& uplink_server_address, const int batch_size,
+    const int max_batch_bytes, const common::Duration max_batch_delay,
+    const int64 max_queue_bytes, bool enable_ssl_encryption,
+    bool enable_google_auth)
+    : batch_size_(batch_size),
+      max_batch_bytes_(max_batch_bytes),
+      max_batch_delay_(max_batch_delay),
+      send_queue_(max_queue_bytes) {
+  CHECK_GT(batch_size_, 0);
   auto channel_creds =
       enable_google_auth
           ? grpc::GoogleDefaultCredentials()
@@ -158,24 +177,10 @@ void LocalTrajectoryUploader::TryRecovery() {
 
   // Wind the sensor_data_queue forward to the next new submap.
   LOG(INFO) << "LocalTrajectoryUploader tries to recover with next submap.";
-  while (true) {
+  while (!send_queue_.DropUntil(StartsNewSubmap, kPopTimeout)) {
     if (shutting_down_) {
       return;
     }
-    proto::SensorData* sensor_data =
-        send_queue_.PeekWithTimeout<proto::SensorData>(kPopTimeout);
-    if (sensor_data) {
-      CHECK_GE(sensor_data->local_slam_result_data().submaps_size(), 0);
-      if (sensor_data->sensor_data_case() ==
-              proto::SensorData::kLocalSlamResultData &&
-          sensor_data->local_slam_result_data().submaps_size() > 0 &&
-          IsNewSubmap(sensor_data->local_slam_result_data().submaps(
-              sensor_data->local_slam_result_data().submaps_size() - 1))) {
-        break;
-      } else {
-        send_queue_.Pop();
-      }
-    }
   }
 
   // Because the trajectories may be interrupted on the uplink side, we can no
@@ -201,16 +206,32 @@ void LocalTrajectoryUploader::TryRecovery() {
 void LocalTrajectoryUploader::ProcessSendQueue() {
   LOG(INFO) << "Starting uploader thread.";
   proto::AddSensorDataBatchRequest batch_request;
+  int64 batch_bytes = 0;
+  // Time at which the first data of the current batch was taken from the queue.
+  std::chrono::steady_clock::time_point batch_start_time;
   while (!shutting_down_) {
-    auto sensor_data = send_queue_.PopWithTimeout(kPopTimeout);
+    const common::Duration pop_timeout =
+        batch_request.sensor_data_size() == 0
+            ? kPopTimeout
+            : std::max(common::Duration::zero(),
+                       std::min(kPopTimeout,
+                                std::chrono::duration_cast<common::Duration>(
+                                    batch_start_time + max_batch_delay_ -
+                                    std::chrono::steady_clock::now())));
+    auto sensor_data = send_queue_.PopWithTimeout(pop_timeout);
+    UpdateQueueMetrics();
     if (sensor_data) {
       if (!TranslateTrajectoryId(sensor_data->mutable_sensor_metadata())) {
         batch_request.clear_sensor_data();
+        batch_bytes = 0;
         TryRecovery();
         continue;
       }
+      if (batch_request.sensor_data_size() == 0) {
+        batch_start_time = std::chrono::steady_clock::now();
+      }
       proto::SensorData* added_sensor_data = batch_request.add_sensor_data();
-      *added_sensor_data = *sensor_data;
+      *added_sensor_data = std::move(*sensor_data);
 
       // A submap also holds a trajectory id that must be translated to uplink's
       // trajectory id.
@@ -222,26 +243,62 @@ void LocalTrajectoryUploader::ProcessSendQueue() {
               added_sensor_data->sensor_metadata().trajectory_id());
         }
       }
+      batch_bytes += added_sensor_data->ByteSizeLong();
+    }
 
-      if (batch_request.sensor_data_size() == batch_size_) {
-        async_grpc::Client<handlers::AddSensorDataBatchSignature> client(
-            client_channel_, common::FromSeconds(kConnectionTimeoutInSeconds),
-            async_grpc::CreateUnlimitedConstantDelayStrategy(
-                common::FromSeconds(1), kUnrecoverableStatusCodes));
-        if (client.Write(batch_request)) {
-          LOG(INFO) << "Uploaded " << batch_request.ByteSize()
-                    << " bytes of sensor data.";
-          batch_request.clear_sensor_data();
-          continue;
-        }
-        // Unrecoverable error occurred. Attempt recovery.
-        batch_request.clear_sensor_data();
-        TryRecovery();
-      }
+    // Batches are sent once they are large enough, so that the per-request
+    // overhead is amortized, or once their data waited long enough.
+    if (batch_request.sensor_data_size() == 0 ||
+        (batch_request.sensor_data_size() < batch_size_ &&
+         batch_bytes < max_batch_bytes_ &&
+         std::chrono::steady_clock::now() - batch_start_time <
+             max_batch_delay_)) {
+      continue;
+    }
+    const bool success = UploadBatch(batch_request);
+    batch_request.clear_sensor_data();
+    batch_bytes = 0;
+    if (!success) {
+      // Unrecoverable error occurred. Attempt recovery.
+      TryRecovery();
     }
   }
 }
 
+bool LocalTrajectoryUploader::UploadBatch(
+    const proto::AddSensorDataBatchRequest& batch_request) {
+  const auto start_time = std::chrono::steady_clock::now();
+  async_grpc::Client<handlers::AddSensorDataBatchSignature> client(
+      client_channel_, common::FromSeconds(kConnectionTimeoutInSeconds),
+      async_grpc::CreateUnlimitedConstantDelayStrategy(
+          common::FromSeconds(1), kUnrecoverableStatusCodes));
+  if (!client.Write(batch_request)) {
+    return false;
+  }
+  const double latency =
+      common::ToSeconds(std::chrono::steady_clock::now() - start_time);
+  const int64 num_bytes = batch_request.ByteSizeLong();
+  kBatchSizeMetric->Observe(batch_request.sensor_data_size());
+  kBatchBytesMetric->Observe(num_bytes);
+  kUploadLatencyMetric->Observe(latency);
+  VLOG(1) << "Uploaded " << batch_request.sensor_data_size()
+          << " sensor data messages with " << num_bytes << " bytes in "
+          << latency << " s.";
+  return true;
+}
+
+void LocalTrajectoryUploader::UpdateQueueMetrics() {
+  kQueueBytesMetric->Set(send_queue_.num_bytes());
+  const int64 num_dropped = send_queue_.num_dropped();
+  if (num_dropped > num_dropped_reported_) {
+    LOG_EVERY_N(WARNING, 100)
+        << "Upload queue exceeds its memory budget, dropped " << num_dropped
+        << " sensor data messages so far.";
+    kDroppedSensorDataMetric->Increment(num_dropped - num_dropped_reported_);
+    num_dropped_reported_ = num_dropped;
+  }
+}
+
 bool LocalTrajectoryUploader::TranslateTrajectoryId(
     proto::SensorMetadata* sensor_metadata) {
   auto it = local_trajectory_id_to_trajectory_info_.find(
@@ -335,10 +392,49 @@ void LocalTrajectoryUploader::EnqueueSensorData(
 
 std::unique_ptr<LocalTrajectoryUploaderInterface> CreateLocalTrajectoryUploader(
     const std::string& uplink_server_address, int batch_size,
-    bool enable_ssl_encryption, bool enable_google_auth) {
-  return make_unique<LocalTrajectoryUploader>(uplink_server_address, batch_size,
-                                              enable_ssl_encryption,
-                                              enable_google_auth);
+    int max_batch_bytes, common::Duration max_batch_delay,
+    int64 max_queue_bytes, bool enable_ssl_encryption,
+    bool enable_google_auth) {
+  return make_unique<LocalTrajectoryUploader>(
+      uplink_server_address, batch_size, max_batch_bytes, max_batch_delay,
+      max_queue_bytes, enable_ssl_encryption, enable_google_auth);
+}
+
+void RegisterLocalTrajectoryUploaderMetrics(
+    metrics::FamilyFactory* family_factory) {
+  kQueueBytesMetric =
+      family_factory
+          ->NewGaugeFamily(
+              "cloud_internal_local_trajectory_uploader_queue_bytes",
+              "Bytes of sensor data waiting for upload")
+          ->Add({});
+  kDroppedSensorDataMetric =
+      family_factory
+          ->NewCounterFamily(
+              "cloud_internal_local_trajectory_uploader_dropped_total",
+              "Sensor data dropped to stay within the memory budget")
+          ->Add({});
+  kBatchSizeMetric =
+      family_factory
+          ->NewHistogramFamily(
+              "cloud_internal_local_trajectory_uploader_batch_size",
+              "Sensor data messages per uploaded batch",
+              metrics::Histogram::ScaledPowersOf(2, 1, 1024))
+          ->Add({});
+  kBatchBytesMetric =
+      family_factory
+          ->NewHistogramFamily(
+              "cloud_internal_local_trajectory_uploader_batch_bytes",
+              "Bytes per uploaded batch",
+              metrics::Histogram::ScaledPowersOf(2, 1024, 128 * 1024 * 1024))
+          ->Add({});
+  kUploadLatencyMetric =
+      family_factory
+          ->NewHistogramFamily(
+              "cloud_internal_local_trajectory_uploader_latency",
+              "Time to upload a batch in seconds",
+              metrics::Histogram::ScaledPowersOf(2, 0.001, 100))
+          ->Add({});
 }
 
 }  // namespace cloud
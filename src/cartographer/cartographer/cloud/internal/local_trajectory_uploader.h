@@ -22,8 +22,11 @@
 #include <string>
 
 #include "cartographer/cloud/proto/map_builder_service.pb.h"
+#include "cartographer/common/port.h"
+#include "cartographer/common/time.h"
 #include "cartographer/mapping/proto/trajectory_builder_options.pb.h"
 #include "cartographer/mapping/trajectory_builder_interface.h"
+#include "cartographer/metrics/family_factory.h"
 #include "grpc++/support/status.h"
 
 namespace cartographer {
@@ -61,10 +64,19 @@ class LocalTrajectoryUploaderInterface {
       int local_trajectory_id) const = 0;
 };
 
-// Returns LocalTrajectoryUploader with the actual implementation.
+// Returns LocalTrajectoryUploader with the actual implementation. Data is
+// uploaded in batches of at most 'batch_size' messages, which are sent once
+// they hold 'max_batch_bytes' or their oldest data waited 'max_batch_delay'.
+// At most 'max_queue_bytes' of data are kept waiting for upload, 0 means
+// unbounded.
 std::unique_ptr<LocalTrajectoryUploaderInterface> CreateLocalTrajectoryUploader(
     const std::string& uplink_server_address, int batch_size,
-    bool enable_ssl_encryption, bool enable_google_auth);
+    int max_batch_bytes, common::Duration max_batch_delay,
+    int64 max_queue_bytes, bool enable_ssl_encryption,
+    bool enable_google_auth);
+
+void RegisterLocalTrajectoryUploaderMetrics(
+    metrics::FamilyFactory* family_factory);
 
 }  // namespace cloud
 }  // namespace cartographer
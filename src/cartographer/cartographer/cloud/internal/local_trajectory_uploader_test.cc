@@ -32,8 +32,10 @@ const SensorId kRangeSensorId{SensorId::SensorType::RANGE, "range"};
 const int kLocalTrajectoryId = 3;
 
 TEST(LocalTrajectoryUploaderTest, HandlesInvalidUplink) {
-  auto uploader = CreateLocalTrajectoryUploader("invalid-uplink-address:50051",
-                                                /*batch_size=*/1, false, false);
+  auto uploader = CreateLocalTrajectoryUploader(
+      "invalid-uplink-address:50051", /*batch_size=*/1,
+      /*max_batch_bytes=*/1024, common::FromSeconds(0.1),
+      /*max_queue_bytes=*/0, false, false);
   uploader->Start();
   mapping::proto::TrajectoryBuilderOptions options;
   auto status = uploader->AddTrajectory(
@@ -25,7 +25,7 @@ template <>
 void MapBuilderContext<mapping::Submap2D>::EnqueueLocalSlamResultData(
     int trajectory_id, const std::string& sensor_id,
     const mapping::proto::LocalSlamResultData& local_slam_result_data) {
-  map_builder_server_->incoming_data_queue_.Push(absl::make_unique<Data>(
+  map_builder_server_->EnqueueIncomingData(absl::make_unique<Data>(
       Data{trajectory_id,
            absl::make_unique<mapping::LocalSlamResult2D>(
                sensor_id, local_slam_result_data, &submap_controller_)}));
@@ -35,7 +35,7 @@ template <>
 void MapBuilderContext<mapping::Submap3D>::EnqueueLocalSlamResultData(
     int trajectory_id, const std::string& sensor_id,
     const mapping::proto::LocalSlamResultData& local_slam_result_data) {
-  map_builder_server_->incoming_data_queue_.Push(absl::make_unique<Data>(
+  map_builder_server_->EnqueueIncomingData(absl::make_unique<Data>(
       Data{trajectory_id,
            absl::make_unique<mapping::LocalSlamResult3D>(
                sensor_id, local_slam_result_data, &submap_controller_)}));
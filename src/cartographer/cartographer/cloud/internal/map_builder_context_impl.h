@@ -30,12 +30,6 @@ mapping::MapBuilderInterface& MapBuilderContext<SubmapType>::map_builder() {
   return *map_builder_server_->map_builder_;
 }
 
-template <class SubmapType>
-common::BlockingQueue<std::unique_ptr<MapBuilderContextInterface::Data>>&
-MapBuilderContext<SubmapType>::sensor_data_queue() {
-  return map_builder_server_->incoming_data_queue_;
-}
-
 template <class SubmapType>
 mapping::TrajectoryBuilderInterface::LocalSlamResultCallback
 MapBuilderContext<SubmapType>::GetLocalSlamResultCallbackForSubscriptions() {
@@ -44,12 +38,18 @@ MapBuilderContext<SubmapType>::GetLocalSlamResultCallbackForSubscriptions() {
                 std::unique_ptr<
                     const mapping::TrajectoryBuilderInterface::InsertionResult>
                     insertion_result) {
-    auto it = client_ids_.find(trajectory_id);
-    if (it == client_ids_.end()) {
-      LOG(ERROR) << "Unknown trajectory_id " << trajectory_id << ". Ignoring.";
-      return;
+    std::string client_id;
+    {
+      absl::MutexLock locker(&client_ids_mutex_);
+      auto it = client_ids_.find(trajectory_id);
+      if (it == client_ids_.end()) {
+        LOG(ERROR) << "Unknown trajectory_id " << trajectory_id
+                   << ". Ignoring.";
+        return;
+      }
+      client_id = it->second;
     }
-    map_builder_server_->OnLocalSlamResult(trajectory_id, it->second, time,
+    map_builder_server_->OnLocalSlamResult(trajectory_id, client_id, time,
                                            local_pose, std::move(range_data),
                                            std::move(insertion_result));
   };
@@ -57,10 +57,19 @@ MapBuilderContext<SubmapType>::GetLocalSlamResultCallbackForSubscriptions() {
 
 template <class SubmapType>
 void MapBuilderContext<SubmapType>::AddSensorDataToTrajectory(
-    const Data& sensor_data) {
-  sensor_data.data->AddToTrajectoryBuilder(
-      map_builder_server_->map_builder_->GetTrajectoryBuilder(
-          sensor_data.trajectory_id));
+    std::unique_ptr<Data> sensor_data) {
+  mapping::TrajectoryBuilderInterface* trajectory_builder;
+  {
+    absl::MutexLock locker(&client_ids_mutex_);
+    trajectory_builder = trajectory_builders_.at(sensor_data->trajectory_id);
+  }
+  if (trajectory_builder == nullptr) {
+    // Trajectories loaded from a serialized state have no builder.
+    LOG(ERROR) << "Trajectory " << sensor_data->trajectory_id
+               << " does not accept sensor data. Ignoring.";
+    return;
+  }
+  trajectory_builder->AddDispatchableData(std::move(sensor_data->data));
 }
 
 template <class SubmapType>
@@ -103,24 +112,30 @@ MapBuilderContext<SubmapType>::local_trajectory_uploader() {
 template <class SubmapType>
 void MapBuilderContext<SubmapType>::EnqueueSensorData(
     int trajectory_id, std::unique_ptr<sensor::Data> data) {
-  map_builder_server_->incoming_data_queue_.Push(
+  map_builder_server_->EnqueueIncomingData(
       absl::make_unique<Data>(Data{trajectory_id, std::move(data)}));
 }
 
 template <class SubmapType>
 void MapBuilderContext<SubmapType>::RegisterClientIdForTrajectory(
     const std::string& client_id, int trajectory_id) {
+  absl::MutexLock locker(&client_ids_mutex_);
   CHECK_EQ(client_ids_.count(trajectory_id), 0u);
   LOG(INFO) << "Registering trajectory_id " << trajectory_id << " to client_id "
             << client_id;
   client_ids_[trajectory_id] = client_id;
+  // Handlers register trajectories while holding the execution context lock,
+  // which also guards adding trajectories to the 'MapBuilder'.
+  trajectory_builders_[trajectory_id] =
+      map_builder_server_->map_builder_->GetTrajectoryBuilder(trajectory_id);
 }
 
 template <class SubmapType>
 bool MapBuilderContext<SubmapType>::CheckClientIdForTrajectory(
     const std::string& client_id, int trajectory_id) {
-  return (client_ids_.count(trajectory_id) > 0 &&
-          client_ids_[trajectory_id] == client_id);
+  absl::MutexLock locker(&client_ids_mutex_);
+  const auto it = client_ids_.find(trajectory_id);
+  return it != client_ids_.end() && it->second == client_id;
 }
 
 template <>
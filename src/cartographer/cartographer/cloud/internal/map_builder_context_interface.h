@@ -19,7 +19,6 @@
 
 #include "async_grpc/execution_context.h"
 #include "cartographer/cloud/internal/local_trajectory_uploader.h"
-#include "cartographer/common/internal/blocking_queue.h"
 #include "cartographer/mapping/map_builder_interface.h"
 #include "cartographer/mapping/pose_graph_interface.h"
 #include "cartographer/mapping/proto/serialization.pb.h"
@@ -74,10 +73,10 @@ class MapBuilderContextInterface : public async_grpc::ExecutionContext {
       delete;
 
   virtual mapping::MapBuilderInterface& map_builder() = 0;
-  virtual common::BlockingQueue<std::unique_ptr<Data>>& sensor_data_queue() = 0;
   virtual mapping::TrajectoryBuilderInterface::LocalSlamResultCallback
   GetLocalSlamResultCallbackForSubscriptions() = 0;
-  virtual void AddSensorDataToTrajectory(const Data& sensor_data) = 0;
+  // Takes ownership of 'sensor_data' so that it is passed on without copies.
+  virtual void AddSensorDataToTrajectory(std::unique_ptr<Data> sensor_data) = 0;
   virtual LocalSlamSubscriptionId SubscribeLocalSlamResults(
       int trajectory_id, LocalSlamSubscriptionCallback callback) = 0;
   virtual void UnsubscribeLocalSlamResults(
@@ -40,6 +40,7 @@
 #include "cartographer/cloud/internal/handlers/receive_local_slam_results_handler.h"
 #include "cartographer/cloud/internal/handlers/run_final_optimization_handler.h"
 #include "cartographer/cloud/internal/handlers/set_landmark_pose_handler.h"
+#include "cartographer/cloud/internal/handlers/subscribe_submap_updates_handler.h"
 #include "cartographer/cloud/internal/handlers/write_state_handler.h"
 #include "cartographer/cloud/internal/handlers/write_state_to_file_handler.h"
 #include "cartographer/cloud/internal/sensor/serialization.h"
@@ -49,7 +50,8 @@ namespace cartographer {
 namespace cloud {
 namespace {
 
-static auto* kIncomingDataQueueMetric = metrics::Gauge::Null();
+static auto* kIncomingDataQueueMetricFamily =
+    metrics::Family<metrics::Gauge>::Null();
 constexpr int kMaxMessageSize = 100 * 1024 * 1024;  // 100 MB
 const common::Duration kPopTimeout = common::FromMilliseconds(100);
 
@@ -58,7 +60,19 @@ const common::Duration kPopTimeout = common::FromMilliseconds(100);
 MapBuilderServer::MapBuilderServer(
     const proto::MapBuilderServerOptions& map_builder_server_options,
     std::unique_ptr<mapping::MapBuilderInterface> map_builder)
-    : map_builder_(std::move(map_builder)) {
+    : collate_by_trajectory_(map_builder_server_options.map_builder_options()
+                                 .collate_by_trajectory()),
+      map_builder_(std::move(map_builder)) {
+  CHECK_GT(map_builder_server_options.num_slam_threads(), 0);
+  for (int shard_index = 0;
+       shard_index < map_builder_server_options.num_slam_threads();
+       ++shard_index) {
+    incoming_data_queues_.push_back(
+        absl::make_unique<common::BlockingQueue<
+            std::unique_ptr<MapBuilderContextInterface::Data>>>());
+    incoming_data_queue_metrics_.push_back(kIncomingDataQueueMetricFamily->Add(
+        {{"shard", std::to_string(shard_index)}}));
+  }
   async_grpc::Server::Builder server_builder;
   server_builder.SetServerAddress(map_builder_server_options.server_address());
   server_builder.SetNumGrpcThreads(
@@ -71,6 +85,10 @@ MapBuilderServer::MapBuilderServer(
     local_trajectory_uploader_ = CreateLocalTrajectoryUploader(
         map_builder_server_options.uplink_server_address(),
         map_builder_server_options.upload_batch_size(),
+        map_builder_server_options.upload_max_batch_bytes(),
+        common::FromSeconds(
+            map_builder_server_options.upload_max_batch_delay_seconds()),
+        map_builder_server_options.upload_queue_max_bytes(),
         map_builder_server_options.enable_ssl_encryption(),
         map_builder_server_options.enable_google_auth());
   }
@@ -91,6 +109,7 @@ MapBuilderServer::MapBuilderServer(
   server_builder.RegisterHandler<handlers::GetTrajectoryStatesHandler>();
   server_builder.RegisterHandler<handlers::GetLandmarkPosesHandler>();
   server_builder.RegisterHandler<handlers::GetAllSubmapPosesHandler>();
+  server_builder.RegisterHandler<handlers::SubscribeSubmapUpdatesHandler>();
   server_builder.RegisterHandler<handlers::GetLocalToGlobalTransformHandler>();
   server_builder.RegisterHandler<handlers::GetConstraintsHandler>();
   server_builder.RegisterHandler<handlers::IsTrajectoryFinishedHandler>();
@@ -127,15 +146,16 @@ void MapBuilderServer::Start() {
   if (local_trajectory_uploader_) {
     local_trajectory_uploader_->Start();
   }
-  StartSlamThread();
+  StartSlamThreads();
   grpc_server_->Start();
 }
 
 void MapBuilderServer::WaitForShutdown() {
   grpc_server_->WaitForShutdown();
-  if (slam_thread_) {
-    slam_thread_->join();
+  for (std::thread& slam_thread : slam_threads_) {
+    slam_thread.join();
   }
+  slam_threads_.clear();
   if (local_trajectory_uploader_) {
     local_trajectory_uploader_->Shutdown();
   }
@@ -144,35 +164,58 @@ void MapBuilderServer::WaitForShutdown() {
 void MapBuilderServer::Shutdown() {
   shutting_down_ = true;
   grpc_server_->Shutdown();
-  if (slam_thread_) {
-    slam_thread_->join();
-    slam_thread_.reset();
+  for (std::thread& slam_thread : slam_threads_) {
+    slam_thread.join();
   }
+  slam_threads_.clear();
   if (local_trajectory_uploader_) {
     local_trajectory_uploader_->Shutdown();
     local_trajectory_uploader_.reset();
   }
 }
 
-void MapBuilderServer::ProcessSensorDataQueue() {
-  LOG(INFO) << "Starting SLAM thread.";
+void MapBuilderServer::EnqueueIncomingData(
+    std::unique_ptr<MapBuilderContextInterface::Data> data) {
+  const int shard_index =
+      data->trajectory_id % static_cast<int>(incoming_data_queues_.size());
+  incoming_data_queues_.at(shard_index)->Push(std::move(data));
+}
+
+void MapBuilderServer::ProcessSensorDataQueue(const int shard_index) {
+  LOG(INFO) << "Starting SLAM thread " << shard_index << ".";
+  auto& incoming_data_queue = *incoming_data_queues_.at(shard_index);
+  metrics::Gauge* const incoming_data_queue_metric =
+      incoming_data_queue_metrics_.at(shard_index);
   while (!shutting_down_) {
-    kIncomingDataQueueMetric->Set(incoming_data_queue_.Size());
+    incoming_data_queue_metric->Set(incoming_data_queue.Size());
     std::unique_ptr<MapBuilderContextInterface::Data> sensor_data =
-        incoming_data_queue_.PopWithTimeout(kPopTimeout);
-    if (sensor_data) {
+        incoming_data_queue.PopWithTimeout(kPopTimeout);
+    if (!sensor_data) {
+      continue;
+    }
+    if (collate_by_trajectory_) {
+      // Each trajectory is dispatched by a single SLAM thread and the
+      // 'TrajectoryCollator' synchronizes per trajectory, so the shards and
+      // the gRPC handlers do not wait for each other.
+      grpc_server_->GetUnsynchronizedContext<MapBuilderContextInterface>()
+          ->AddSensorDataToTrajectory(std::move(sensor_data));
+    } else {
+      // The 'Collator' merges all trajectories and is not thread-safe.
       grpc_server_->GetContext<MapBuilderContextInterface>()
-          ->AddSensorDataToTrajectory(*sensor_data);
+          ->AddSensorDataToTrajectory(std::move(sensor_data));
     }
   }
 }
 
-void MapBuilderServer::StartSlamThread() {
-  CHECK(!slam_thread_);
+void MapBuilderServer::StartSlamThreads() {
+  CHECK(slam_threads_.empty());
 
-  // Start the SLAM processing thread.
-  slam_thread_ = absl::make_unique<std::thread>(
-      [this]() { this->ProcessSensorDataQueue(); });
+  // Start one SLAM processing thread per shard.
+  for (size_t shard_index = 0; shard_index < incoming_data_queues_.size();
+       ++shard_index) {
+    slam_threads_.emplace_back(
+        [this, shard_index]() { this->ProcessSensorDataQueue(shard_index); });
+  }
 }
 
 void MapBuilderServer::OnLocalSlamResult(
@@ -193,12 +236,16 @@ void MapBuilderServer::OnLocalSlamResult(
         grpc_server_->GetUnsynchronizedContext<MapBuilderContextInterface>()
             ->local_trajectory_uploader()
             ->GetLocalSlamResultSensorId(trajectory_id);
-    CreateSensorDataForLocalSlamResult(sensor_id.id, trajectory_id, client_id,
-                                       time, starting_submap_index_,
-                                       *insertion_result, sensor_data.get());
-    // TODO(cschuet): Make this more robust.
-    if (insertion_result->insertion_submaps.front()->insertion_finished()) {
-      ++starting_submap_index_;
+    {
+      absl::MutexLock locker(&starting_submap_index_mutex_);
+      CreateSensorDataForLocalSlamResult(sensor_id.id, trajectory_id,
+                                         client_id, time,
+                                         starting_submap_index_,
+                                         *insertion_result, sensor_data.get());
+      // TODO(cschuet): Make this more robust.
+      if (insertion_result->insertion_submaps.front()->insertion_finished()) {
+        ++starting_submap_index_;
+      }
     }
     grpc_server_->GetUnsynchronizedContext<MapBuilderContextInterface>()
         ->local_trajectory_uploader()
@@ -282,15 +329,17 @@ void MapBuilderServer::NotifyFinishTrajectory(int trajectory_id) {
 }
 
 void MapBuilderServer::WaitUntilIdle() {
-  incoming_data_queue_.WaitUntilEmpty();
+  for (auto& incoming_data_queue : incoming_data_queues_) {
+    incoming_data_queue->WaitUntilEmpty();
+  }
   map_builder_->pose_graph()->RunFinalOptimization();
 }
 
 void MapBuilderServer::RegisterMetrics(metrics::FamilyFactory* factory) {
-  auto* queue_length = factory->NewGaugeFamily(
+  kIncomingDataQueueMetricFamily = factory->NewGaugeFamily(
       "cloud_internal_map_builder_server_incoming_data_queue_length",
-      "Incoming SLAM Data Queue length");
-  kIncomingDataQueueMetric = queue_length->Add({});
+      "Incoming SLAM Data Queue length per SLAM thread shard");
+  RegisterLocalTrajectoryUploaderMetrics(factory);
 }
 
 }  // namespace cloud
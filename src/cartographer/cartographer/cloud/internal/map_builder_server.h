@@ -17,6 +17,9 @@
 #ifndef CARTOGRAPHER_CLOUD_INTERNAL_MAP_BUILDER_SERVER_H
 #define CARTOGRAPHER_CLOUD_INTERNAL_MAP_BUILDER_SERVER_H
 
+#include <thread>
+#include <vector>
+
 #include "async_grpc/execution_context.h"
 #include "async_grpc/server.h"
 #include "cartographer/cloud/internal/local_trajectory_uploader.h"
@@ -43,11 +46,9 @@ class MapBuilderContext : public MapBuilderContextInterface {
  public:
   MapBuilderContext(MapBuilderServer* map_builder_server);
   mapping::MapBuilderInterface& map_builder() override;
-  common::BlockingQueue<std::unique_ptr<MapBuilderContextInterface::Data>>&
-  sensor_data_queue() override;
   mapping::TrajectoryBuilderInterface::LocalSlamResultCallback
   GetLocalSlamResultCallbackForSubscriptions() override;
-  void AddSensorDataToTrajectory(const Data& sensor_data) override;
+  void AddSensorDataToTrajectory(std::unique_ptr<Data> sensor_data) override;
   MapBuilderContextInterface::LocalSlamSubscriptionId SubscribeLocalSlamResults(
       int trajectory_id, LocalSlamSubscriptionCallback callback) override;
   void UnsubscribeLocalSlamResults(
@@ -71,7 +72,16 @@ class MapBuilderContext : public MapBuilderContextInterface {
  private:
   MapBuilderServer* map_builder_server_;
   mapping::SubmapController<SubmapType> submap_controller_;
-  std::map</*trajectory_id=*/int, /*client_id=*/std::string> client_ids_;
+  // Guards 'client_ids_', which is read from the local SLAM threads, and
+  // 'trajectory_builders_', which is read from the SLAM threads.
+  absl::Mutex client_ids_mutex_;
+  std::map</*trajectory_id=*/int, /*client_id=*/std::string> client_ids_
+      GUARDED_BY(client_ids_mutex_);
+  // Trajectory builders of the registered trajectories. The SLAM threads
+  // dispatch through these instead of 'MapBuilder::GetTrajectoryBuilder()',
+  // whose storage grows while handlers add trajectories.
+  std::map<int, mapping::TrajectoryBuilderInterface*> trajectory_builders_
+      GUARDED_BY(client_ids_mutex_);
 };
 
 class MapBuilderServer : public MapBuilderServerInterface {
@@ -84,7 +94,7 @@ class MapBuilderServer : public MapBuilderServerInterface {
       std::unique_ptr<mapping::MapBuilderInterface> map_builder);
   ~MapBuilderServer() {}
 
-  // Starts the gRPC server, the 'LocalTrajectoryUploader' and the SLAM thread.
+  // Starts the gRPC server, the 'LocalTrajectoryUploader' and the SLAM threads.
   void Start() final;
 
   // Waits for the 'MapBuilderServer' to shut down. Note: The server must be
@@ -96,7 +106,7 @@ class MapBuilderServer : public MapBuilderServerInterface {
   void WaitUntilIdle() final;
 
   // Shuts down the gRPC server, the 'LocalTrajectoryUploader' and the SLAM
-  // thread.
+  // threads.
   void Shutdown() final;
 
   static void RegisterMetrics(metrics::FamilyFactory* family_factory);
@@ -106,8 +116,12 @@ class MapBuilderServer : public MapBuilderServerInterface {
       std::map<int /* subscription_index */,
                MapBuilderContextInterface::LocalSlamSubscriptionCallback>;
 
-  void ProcessSensorDataQueue();
-  void StartSlamThread();
+  // Incoming data is sharded by trajectory ID, so that the data of each
+  // trajectory is dispatched in order by a single SLAM thread.
+  void EnqueueIncomingData(
+      std::unique_ptr<MapBuilderContextInterface::Data> data);
+  void ProcessSensorDataQueue(int shard_index);
+  void StartSlamThreads();
   void OnLocalSlamResult(
       int trajectory_id, const std::string client_id, common::Time time,
       transform::Rigid3d local_pose, sensor::RangeData range_data,
@@ -129,11 +143,17 @@ class MapBuilderServer : public MapBuilderServerInterface {
   void NotifyFinishTrajectory(int trajectory_id);
 
   bool shutting_down_ = false;
-  std::unique_ptr<std::thread> slam_thread_;
+  // Whether the SLAM threads may dispatch without holding the execution
+  // context lock, see 'ProcessSensorDataQueue()'.
+  const bool collate_by_trajectory_;
+  std::vector<std::thread> slam_threads_;
   std::unique_ptr<async_grpc::Server> grpc_server_;
   std::unique_ptr<mapping::MapBuilderInterface> map_builder_;
-  common::BlockingQueue<std::unique_ptr<MapBuilderContextInterface::Data>>
-      incoming_data_queue_;
+  // One queue per SLAM thread.
+  std::vector<std::unique_ptr<
+      common::BlockingQueue<std::unique_ptr<MapBuilderContextInterface::Data>>>>
+      incoming_data_queues_;
+  std::vector<metrics::Gauge*> incoming_data_queue_metrics_;
   absl::Mutex subscriptions_lock_;
   int current_subscription_index_ = 0;
   std::map<int /* trajectory ID */, LocalSlamResultHandlerSubscriptions>
@@ -142,7 +162,9 @@ class MapBuilderServer : public MapBuilderServerInterface {
            MapBuilderContextInterface::GlobalSlamOptimizationCallback>
       global_slam_subscriptions_ GUARDED_BY(subscriptions_lock_);
   std::unique_ptr<LocalTrajectoryUploaderInterface> local_trajectory_uploader_;
-  int starting_submap_index_ = 0;
+  // Local SLAM results of different trajectories may arrive concurrently.
+  absl::Mutex starting_submap_index_mutex_;
+  int starting_submap_index_ GUARDED_BY(starting_submap_index_mutex_) = 0;
 };
 
 }  // namespace cloud
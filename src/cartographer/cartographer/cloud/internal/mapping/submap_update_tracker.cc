@@ -0,0 +1,71 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/cloud/internal/mapping/submap_update_tracker.h"
+
+#include <cmath>
+
+#include "cartographer/transform/transform.h"
+
+namespace cartographer {
+namespace cloud {
+
+SubmapUpdateTracker::SubmapUpdateTracker(const double min_translation,
+                                         const double min_rotation)
+    : min_translation_(min_translation), min_rotation_(min_rotation) {}
+
+SubmapUpdateTracker::Changes SubmapUpdateTracker::Update(
+    const SubmapPoses& submap_poses) {
+  Changes changes;
+  // Both containers are sorted by submap ID, so they are merged in one pass.
+  auto reported = reported_submap_poses_.begin();
+  for (const auto& submap_id_pose : submap_poses) {
+    while (reported != reported_submap_poses_.end() &&
+           reported->first < submap_id_pose.id) {
+      changes.removed_submap_ids.push_back(reported->first);
+      reported = reported_submap_poses_.erase(reported);
+    }
+    if (reported == reported_submap_poses_.end() ||
+        submap_id_pose.id < reported->first) {
+      changes.updated_submap_ids.push_back(submap_id_pose.id);
+      changes.new_version_submap_ids.push_back(submap_id_pose.id);
+      reported = std::next(reported_submap_poses_.emplace_hint(
+          reported, submap_id_pose.id, submap_id_pose.data));
+      continue;
+    }
+    const transform::Rigid3d delta =
+        reported->second.pose.inverse() * submap_id_pose.data.pose;
+    const bool new_version =
+        reported->second.version != submap_id_pose.data.version;
+    if (new_version || delta.translation().norm() >= min_translation_ ||
+        std::abs(transform::GetAngle(delta)) >= min_rotation_) {
+      changes.updated_submap_ids.push_back(submap_id_pose.id);
+      if (new_version) {
+        changes.new_version_submap_ids.push_back(submap_id_pose.id);
+      }
+      reported->second = submap_id_pose.data;
+    }
+    ++reported;
+  }
+  while (reported != reported_submap_poses_.end()) {
+    changes.removed_submap_ids.push_back(reported->first);
+    reported = reported_submap_poses_.erase(reported);
+  }
+  return changes;
+}
+
+}  // namespace cloud
+}  // namespace cartographer
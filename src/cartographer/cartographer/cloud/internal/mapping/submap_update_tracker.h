@@ -0,0 +1,63 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_CLOUD_INTERNAL_MAPPING_SUBMAP_UPDATE_TRACKER_H
+#define CARTOGRAPHER_CLOUD_INTERNAL_MAPPING_SUBMAP_UPDATE_TRACKER_H
+
+#include <map>
+#include <vector>
+
+#include "cartographer/mapping/id.h"
+#include "cartographer/mapping/pose_graph_interface.h"
+
+namespace cartographer {
+namespace cloud {
+
+// Remembers the submap versions and global poses last sent to a subscriber,
+// so that only changed submaps have to be sent again.
+class SubmapUpdateTracker {
+ public:
+  using SubmapPoses =
+      mapping::MapById<mapping::SubmapId,
+                       mapping::PoseGraphInterface::SubmapPose>;
+
+  struct Changes {
+    std::vector<mapping::SubmapId> updated_submap_ids;
+    // The subset of 'updated_submap_ids' which are new or have a new version,
+    // i.e. whose textures changed. The others only moved.
+    std::vector<mapping::SubmapId> new_version_submap_ids;
+    std::vector<mapping::SubmapId> removed_submap_ids;
+  };
+
+  // Global pose changes below 'min_translation' and 'min_rotation' are not
+  // reported. Small changes accumulate until they are.
+  SubmapUpdateTracker(double min_translation, double min_rotation);
+
+  // Returns the submaps which are new, have a new version, moved or were
+  // removed compared to what was last reported, and marks them as reported.
+  Changes Update(const SubmapPoses& submap_poses);
+
+ private:
+  const double min_translation_;
+  const double min_rotation_;
+  std::map<mapping::SubmapId, mapping::PoseGraphInterface::SubmapPose>
+      reported_submap_poses_;
+};
+
+}  // namespace cloud
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_CLOUD_INTERNAL_MAPPING_SUBMAP_UPDATE_TRACKER_H
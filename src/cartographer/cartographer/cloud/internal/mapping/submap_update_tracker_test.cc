@@ -0,0 +1,102 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/cloud/internal/mapping/submap_update_tracker.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace cloud {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using SubmapId = mapping::SubmapId;
+using SubmapPose = mapping::PoseGraphInterface::SubmapPose;
+
+constexpr double kMinTranslation = 0.01;
+constexpr double kMinRotation = 0.01;
+
+SubmapPose CreateSubmapPose(const int version, const double x) {
+  return SubmapPose{version, transform::Rigid3d::Translation(
+                                 Eigen::Vector3d(x, 0., 0.))};
+}
+
+TEST(SubmapUpdateTrackerTest, ReportsAllSubmapsInitially) {
+  SubmapUpdateTracker tracker(kMinTranslation, kMinRotation);
+  SubmapUpdateTracker::SubmapPoses submap_poses;
+  submap_poses.Insert(SubmapId{0, 0}, CreateSubmapPose(1, 0.));
+  submap_poses.Insert(SubmapId{1, 0}, CreateSubmapPose(1, 0.));
+  const SubmapUpdateTracker::Changes changes = tracker.Update(submap_poses);
+  EXPECT_THAT(changes.updated_submap_ids,
+              ElementsAre(SubmapId{0, 0}, SubmapId{1, 0}));
+  EXPECT_THAT(changes.new_version_submap_ids,
+              ElementsAre(SubmapId{0, 0}, SubmapId{1, 0}));
+  EXPECT_THAT(changes.removed_submap_ids, IsEmpty());
+  EXPECT_THAT(tracker.Update(submap_poses).updated_submap_ids, IsEmpty());
+}
+
+TEST(SubmapUpdateTrackerTest, ReportsOnlyChangedSubmaps) {
+  SubmapUpdateTracker tracker(kMinTranslation, kMinRotation);
+  SubmapUpdateTracker::SubmapPoses submap_poses;
+  for (int i = 0; i < 4; ++i) {
+    submap_poses.Insert(SubmapId{0, i}, CreateSubmapPose(i, i));
+  }
+  tracker.Update(submap_poses);
+
+  SubmapUpdateTracker::SubmapPoses new_submap_poses;
+  new_submap_poses.Insert(SubmapId{0, 0}, CreateSubmapPose(0, 0.));
+  new_submap_poses.Insert(SubmapId{0, 1}, CreateSubmapPose(2, 1.));
+  new_submap_poses.Insert(SubmapId{0, 3}, CreateSubmapPose(3, 3.5));
+  new_submap_poses.Insert(SubmapId{0, 4}, CreateSubmapPose(1, 4.));
+  const SubmapUpdateTracker::Changes changes =
+      tracker.Update(new_submap_poses);
+  EXPECT_THAT(changes.updated_submap_ids,
+              ElementsAre(SubmapId{0, 1}, SubmapId{0, 3}, SubmapId{0, 4}));
+  // Submap 3 only moved, its texture is unchanged.
+  EXPECT_THAT(changes.new_version_submap_ids,
+              ElementsAre(SubmapId{0, 1}, SubmapId{0, 4}));
+  EXPECT_THAT(changes.removed_submap_ids, ElementsAre(SubmapId{0, 2}));
+}
+
+TEST(SubmapUpdateTrackerTest, AccumulatesSmallPoseChanges) {
+  SubmapUpdateTracker tracker(kMinTranslation, kMinRotation);
+  for (int i = 0; i < 5; ++i) {
+    SubmapUpdateTracker::SubmapPoses submap_poses;
+    submap_poses.Insert(SubmapId{0, 0}, CreateSubmapPose(1, 0.004 * i));
+    const SubmapUpdateTracker::Changes changes = tracker.Update(submap_poses);
+    // Only the initial pose and the one after moving 12 mm are reported.
+    EXPECT_EQ(i == 0 || i == 3, !changes.updated_submap_ids.empty()) << i;
+  }
+}
+
+TEST(SubmapUpdateTrackerTest, ReportsRemovedTrajectories) {
+  SubmapUpdateTracker tracker(kMinTranslation, kMinRotation);
+  SubmapUpdateTracker::SubmapPoses submap_poses;
+  submap_poses.Insert(SubmapId{0, 0}, CreateSubmapPose(1, 0.));
+  submap_poses.Insert(SubmapId{1, 0}, CreateSubmapPose(1, 0.));
+  tracker.Update(submap_poses);
+  const SubmapUpdateTracker::Changes changes =
+      tracker.Update(SubmapUpdateTracker::SubmapPoses());
+  EXPECT_THAT(changes.updated_submap_ids, IsEmpty());
+  EXPECT_THAT(changes.removed_submap_ids,
+              ElementsAre(SubmapId{0, 0}, SubmapId{1, 0}));
+}
+
+}  // namespace
+}  // namespace cloud
+}  // namespace cartographer
@@ -0,0 +1,267 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/cloud/internal/sensor/compressed_timed_point_cloud_data.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "boost/iostreams/device/array.hpp"
+#include "boost/iostreams/filter/gzip.hpp"
+#include "boost/iostreams/filtering_stream.hpp"
+#include "cartographer/transform/transform.h"
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace cloud {
+
+namespace {
+
+constexpr double kLoggingPeriodSeconds = 15.;
+
+// A varint holding a 64 bit value takes at most 10 bytes. Each point is
+// stored as 4 varints and possibly a float intensity.
+constexpr int kMaxVarintBytes = 10;
+constexpr int kMinBytesPerPoint = 4;
+constexpr int kMaxBytesPerPoint = 4 * kMaxVarintBytes + sizeof(float);
+
+// Far more points than any range finder produces in one message. Rejecting
+// larger counts bounds the memory a single request can make us allocate.
+constexpr int kMaxNumPoints = 1 << 24;
+
+// Size of a 'sensor::proto::TimedRangefinderPoint' inside the repeated field
+// of 'sensor::proto::TimedPointCloudData': 3 fixed32 fields in the position
+// message and one for the time, each with tag and length prefixes.
+constexpr int kProtoBytesPerPoint = 2 + (2 + 3 * 5) + 5;
+
+::grpc::Status InvalidPointData(const std::string& message) {
+  return ::grpc::Status(::grpc::INVALID_ARGUMENT,
+                        "Corrupted compressed point cloud: " + message);
+}
+
+int32 Quantize(const float value, const float resolution) {
+  const int64 quantized = common::RoundToInt64(value / resolution);
+  CHECK_GE(quantized, std::numeric_limits<int32>::min())
+      << value << " is out of range for resolution " << resolution;
+  CHECK_LE(quantized, std::numeric_limits<int32>::max())
+      << value << " is out of range for resolution " << resolution;
+  return static_cast<int32>(quantized);
+}
+
+// Deltas are small for consecutive points of a scan. ZigZag encoding maps them
+// to small unsigned integers which the varint encoding stores in few bytes.
+void AppendVarint(const int64 value, std::string* const buffer) {
+  uint64 zigzag = (static_cast<uint64>(value) << 1) ^
+                  static_cast<uint64>(value >> 63);
+  while (zigzag >= 0x80) {
+    buffer->push_back(static_cast<char>((zigzag & 0x7f) | 0x80));
+    zigzag >>= 7;
+  }
+  buffer->push_back(static_cast<char>(zigzag));
+}
+
+// Returns false if the data between '*cursor' and 'end' does not start with
+// a complete varint. '*cursor' never moves past 'end'.
+bool ConsumeVarint(const char** const cursor, const char* const end,
+                   int64* const value) {
+  uint64 zigzag = 0;
+  for (int shift = 0;; shift += 7) {
+    if (*cursor == end || shift >= 64) {
+      return false;
+    }
+    const uint8 byte = static_cast<uint8>(*(*cursor)++);
+    zigzag |= static_cast<uint64>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      break;
+    }
+  }
+  *value = static_cast<int64>(zigzag >> 1) ^ -static_cast<int64>(zigzag & 1);
+  return true;
+}
+
+// Like 'common::FastGunzipString()', but gives up on invalid gzip data and as
+// soon as the output grows beyond 'max_size' bytes, so that a small payload
+// cannot expand into an arbitrary amount of memory.
+bool GunzipAtMost(const std::string& compressed, const size_t max_size,
+                  std::string* const decompressed) {
+  boost::iostreams::filtering_istream in;
+  in.push(boost::iostreams::gzip_decompressor());
+  in.push(
+      boost::iostreams::array_source(compressed.data(), compressed.size()));
+  char buffer[4096];
+  try {
+    while (in) {
+      in.read(buffer, sizeof(buffer));
+      decompressed->append(buffer, in.gcount());
+      if (decompressed->size() > max_size) {
+        return false;
+      }
+    }
+  } catch (const std::exception&) {
+    return false;
+  }
+  return !in.bad();
+}
+
+}  // namespace
+
+proto::CompressedTimedPointCloudData CompressTimedPointCloudData(
+    const sensor::TimedPointCloudData& timed_point_cloud_data,
+    const float resolution, const float time_resolution) {
+  CHECK_GT(resolution, 0.f);
+  CHECK_GT(time_resolution, 0.f);
+  const sensor::TimedPointCloud& ranges = timed_point_cloud_data.ranges;
+  const std::vector<float>& intensities = timed_point_cloud_data.intensities;
+  CHECK(intensities.empty() || intensities.size() == ranges.size());
+
+  // Each coordinate is stored separately, which makes the deltas of
+  // neighboring points more similar and the stream compress better.
+  std::string uncompressed;
+  uncompressed.reserve(ranges.size() * (4 * 2 + sizeof(float)));
+  for (int i = 0; i < 4; ++i) {
+    int64 previous = 0;
+    for (const sensor::TimedRangefinderPoint& point : ranges) {
+      const int64 current = i < 3 ? Quantize(point.position[i], resolution)
+                                  : Quantize(point.time, time_resolution);
+      AppendVarint(current - previous, &uncompressed);
+      previous = current;
+    }
+  }
+  if (!intensities.empty()) {
+    const size_t offset = uncompressed.size();
+    uncompressed.resize(offset + intensities.size() * sizeof(float));
+    std::memcpy(&uncompressed[offset], intensities.data(),
+                intensities.size() * sizeof(float));
+  }
+
+  proto::CompressedTimedPointCloudData proto;
+  proto.set_timestamp(common::ToUniversal(timed_point_cloud_data.time));
+  *proto.mutable_origin() = transform::ToProto(timed_point_cloud_data.origin);
+  proto.set_resolution(resolution);
+  proto.set_time_resolution(time_resolution);
+  proto.set_num_points(ranges.size());
+  proto.set_has_intensities(!intensities.empty());
+  common::FastGzipString(uncompressed, proto.mutable_point_data());
+  return proto;
+}
+
+::grpc::Status DecompressTimedPointCloudData(
+    const proto::CompressedTimedPointCloudData& proto,
+    sensor::TimedPointCloudData* const timed_point_cloud_data) {
+  if (proto.num_points() < 0 || proto.num_points() > kMaxNumPoints) {
+    return InvalidPointData("bad number of points " +
+                            std::to_string(proto.num_points()));
+  }
+  if (!(proto.resolution() > 0.f) || !(proto.time_resolution() > 0.f)) {
+    return InvalidPointData("resolutions must be positive");
+  }
+  const size_t num_points = proto.num_points();
+  std::string uncompressed;
+  if (!GunzipAtMost(proto.point_data(), num_points * kMaxBytesPerPoint,
+                    &uncompressed)) {
+    return InvalidPointData("invalid or oversized gzip data");
+  }
+  // Checked before allocating the points, so that the client supplied count
+  // cannot make us allocate more than the payload accounts for.
+  const size_t intensities_size =
+      proto.has_intensities() ? num_points * sizeof(float) : 0;
+  if (uncompressed.size() < num_points * kMinBytesPerPoint + intensities_size) {
+    return InvalidPointData("payload too small for " +
+                            std::to_string(num_points) + " points");
+  }
+  const char* cursor = uncompressed.data();
+  const char* const end =
+      uncompressed.data() + uncompressed.size() - intensities_size;
+
+  *timed_point_cloud_data = sensor::TimedPointCloudData{
+      common::FromUniversal(proto.timestamp()),
+      transform::ToEigen(proto.origin()), sensor::TimedPointCloud(num_points),
+      {}};
+  for (int i = 0; i < 4; ++i) {
+    int64 current = 0;
+    for (sensor::TimedRangefinderPoint& point :
+         timed_point_cloud_data->ranges) {
+      int64 delta;
+      if (!ConsumeVarint(&cursor, end, &delta)) {
+        return InvalidPointData("truncated point data");
+      }
+      // Wraps around instead of overflowing on malicious data.
+      current = static_cast<int64>(static_cast<uint64>(current) +
+                                   static_cast<uint64>(delta));
+      if (i < 3) {
+        point.position[i] =
+            static_cast<double>(current) * proto.resolution();
+      } else {
+        point.time =
+            static_cast<double>(current) * proto.time_resolution();
+      }
+    }
+  }
+  if (cursor != end) {
+    return InvalidPointData("unexpected trailing point data");
+  }
+  if (proto.has_intensities()) {
+    timed_point_cloud_data->intensities.resize(num_points);
+    std::memcpy(timed_point_cloud_data->intensities.data(), end,
+                intensities_size);
+  }
+  return ::grpc::Status::OK;
+}
+
+int64 EstimateUncompressedByteSize(
+    const sensor::TimedPointCloudData& timed_point_cloud_data) {
+  return timed_point_cloud_data.ranges.size() * kProtoBytesPerPoint +
+         timed_point_cloud_data.intensities.size() * sizeof(float);
+}
+
+PointCloudCompressionStatistics::PointCloudCompressionStatistics(
+    const std::string& sensor_id)
+    : sensor_id_(sensor_id),
+      last_logging_time_(std::chrono::steady_clock::now()) {}
+
+void PointCloudCompressionStatistics::Add(
+    const int64 uncompressed_bytes, const int64 compressed_bytes,
+    const common::Duration encode_duration) {
+  VLOG(1) << "Compressed point cloud of '" << sensor_id_ << "' from "
+          << uncompressed_bytes << " to " << compressed_bytes << " bytes in "
+          << common::ToSeconds(encode_duration) * 1e3 << " ms.";
+  ++num_messages_;
+  uncompressed_bytes_ += uncompressed_bytes;
+  compressed_bytes_ += compressed_bytes;
+  encode_duration_ += encode_duration;
+  if (std::chrono::steady_clock::now() - last_logging_time_ >
+      common::FromSeconds(kLoggingPeriodSeconds)) {
+    Log();
+    last_logging_time_ = std::chrono::steady_clock::now();
+  }
+}
+
+void PointCloudCompressionStatistics::Log() const {
+  LOG(INFO) << "Point cloud compression of '" << sensor_id_ << "': "
+            << num_messages_ << " messages, " << uncompressed_bytes_
+            << " bytes compressed to " << compressed_bytes_ << " bytes ("
+            << 100. * compressed_bytes_ /
+                   std::max<int64>(uncompressed_bytes_, 1)
+            << "%), "
+            << common::ToSeconds(encode_duration_) * 1e3 /
+                   std::max<int64>(num_messages_, 1)
+            << " ms encode time per message.";
+}
+
+}  // namespace cloud
+}  // namespace cartographer
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_CLOUD_INTERNAL_SENSOR_COMPRESSED_TIMED_POINT_CLOUD_DATA_H_
+#define CARTOGRAPHER_CLOUD_INTERNAL_SENSOR_COMPRESSED_TIMED_POINT_CLOUD_DATA_H_
+
+#include <chrono>
+#include <string>
+
+#include "cartographer/cloud/proto/map_builder_service.pb.h"
+#include "cartographer/common/port.h"
+#include "cartographer/common/time.h"
+#include "cartographer/sensor/timed_point_cloud_data.h"
+#include "grpc++/grpc++.h"
+
+namespace cartographer {
+namespace cloud {
+
+// Quantization used when compressing point clouds for upload. The position
+// error is at most half the resolution, which matches the precision of
+// 'sensor::CompressedPointCloud'.
+constexpr float kCompressedPointCloudResolution = 0.001f;      // in meters.
+constexpr float kCompressedPointCloudTimeResolution = 1e-6f;  // in seconds.
+
+// Encodes 'timed_point_cloud_data' as quantized, delta encoded and gzip
+// compressed points. Quantized coordinates must fit into an int32.
+proto::CompressedTimedPointCloudData CompressTimedPointCloudData(
+    const sensor::TimedPointCloudData& timed_point_cloud_data,
+    float resolution = kCompressedPointCloudResolution,
+    float time_resolution = kCompressedPointCloudTimeResolution);
+
+// Decodes 'proto' into 'timed_point_cloud_data'. The data comes from clients,
+// so malformed or truncated data is reported as an INVALID_ARGUMENT status
+// instead of aborting, and nothing is allocated before 'num_points' has been
+// checked against the payload.
+::grpc::Status DecompressTimedPointCloudData(
+    const proto::CompressedTimedPointCloudData& proto,
+    sensor::TimedPointCloudData* timed_point_cloud_data);
+
+// Returns roughly the number of bytes 'sensor::ToProto(timed_point_cloud_data)'
+// serializes to, without building the proto.
+int64 EstimateUncompressedByteSize(
+    const sensor::TimedPointCloudData& timed_point_cloud_data);
+
+// Keeps track of how much bandwidth the compression saves and how long it
+// takes. The totals are logged periodically.
+class PointCloudCompressionStatistics {
+ public:
+  explicit PointCloudCompressionStatistics(const std::string& sensor_id);
+
+  // 'uncompressed_bytes' is the size of the message that would have been sent
+  // without compression.
+  void Add(int64 uncompressed_bytes, int64 compressed_bytes,
+           common::Duration encode_duration);
+
+ private:
+  void Log() const;
+
+  const std::string sensor_id_;
+  int64 num_messages_ = 0;
+  int64 uncompressed_bytes_ = 0;
+  int64 compressed_bytes_ = 0;
+  common::Duration encode_duration_ = common::Duration::zero();
+  std::chrono::steady_clock::time_point last_logging_time_;
+};
+
+}  // namespace cloud
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_CLOUD_INTERNAL_SENSOR_COMPRESSED_TIMED_POINT_CLOUD_DATA_H_
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/cloud/internal/sensor/compressed_timed_point_cloud_data.h"
+
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace cloud {
+namespace {
+
+sensor::TimedPointCloudData CreateTimedPointCloudData(
+    const bool with_intensities) {
+  sensor::TimedPointCloudData timed_point_cloud_data{
+      common::FromUniversal(123456789), Eigen::Vector3f(1.f, -2.f, 0.5f), {},
+      {}};
+  constexpr int kNumPoints = 1000;
+  for (int i = 0; i < kNumPoints; ++i) {
+    const float angle = 0.01f * i;
+    const float range = 5.f + std::sin(0.1f * i);
+    timed_point_cloud_data.ranges.push_back(
+        {Eigen::Vector3f(range * std::cos(angle), range * std::sin(angle),
+                         0.01f * (i % 16)),
+         -0.1f + 1e-4f * i});
+    if (with_intensities) {
+      timed_point_cloud_data.intensities.push_back(0.25f * (i % 100));
+    }
+  }
+  return timed_point_cloud_data;
+}
+
+sensor::TimedPointCloudData Decompress(
+    const proto::CompressedTimedPointCloudData& proto) {
+  sensor::TimedPointCloudData timed_point_cloud_data;
+  const ::grpc::Status status =
+      DecompressTimedPointCloudData(proto, &timed_point_cloud_data);
+  EXPECT_TRUE(status.ok()) << status.error_message();
+  return timed_point_cloud_data;
+}
+
+::grpc::StatusCode DecompressStatusCode(
+    const proto::CompressedTimedPointCloudData& proto) {
+  sensor::TimedPointCloudData timed_point_cloud_data;
+  return DecompressTimedPointCloudData(proto, &timed_point_cloud_data)
+      .error_code();
+}
+
+void ExpectNear(const sensor::TimedPointCloudData& expected,
+                const sensor::TimedPointCloudData& actual,
+                const float resolution, const float time_resolution) {
+  EXPECT_EQ(expected.time, actual.time);
+  EXPECT_EQ(expected.origin, actual.origin);
+  ASSERT_EQ(expected.ranges.size(), actual.ranges.size());
+  for (size_t i = 0; i < expected.ranges.size(); ++i) {
+    for (int j = 0; j < 3; ++j) {
+      EXPECT_NEAR(expected.ranges[i].position[j], actual.ranges[i].position[j],
+                  0.5f * resolution + 1e-6f);
+    }
+    EXPECT_NEAR(expected.ranges[i].time, actual.ranges[i].time,
+                0.5f * time_resolution + 1e-7f);
+  }
+  EXPECT_EQ(expected.intensities, actual.intensities);
+}
+
+TEST(CompressedTimedPointCloudDataTest, RoundTrip) {
+  const sensor::TimedPointCloudData expected =
+      CreateTimedPointCloudData(true /* with_intensities */);
+  const proto::CompressedTimedPointCloudData proto =
+      CompressTimedPointCloudData(expected);
+  EXPECT_EQ(expected.ranges.size(), proto.num_points());
+  EXPECT_TRUE(proto.has_intensities());
+  ExpectNear(expected, Decompress(proto),
+             kCompressedPointCloudResolution,
+             kCompressedPointCloudTimeResolution);
+}
+
+TEST(CompressedTimedPointCloudDataTest, RoundTripWithoutIntensities) {
+  const sensor::TimedPointCloudData expected =
+      CreateTimedPointCloudData(false /* with_intensities */);
+  const proto::CompressedTimedPointCloudData proto =
+      CompressTimedPointCloudData(expected, 0.01f, 1e-5f);
+  EXPECT_FALSE(proto.has_intensities());
+  ExpectNear(expected, Decompress(proto), 0.01f, 1e-5f);
+}
+
+TEST(CompressedTimedPointCloudDataTest, EmptyPointCloud) {
+  const sensor::TimedPointCloudData expected{
+      common::FromUniversal(42), Eigen::Vector3f::UnitX(), {}, {}};
+  ExpectNear(expected,
+             Decompress(CompressTimedPointCloudData(expected)),
+             kCompressedPointCloudResolution,
+             kCompressedPointCloudTimeResolution);
+}
+
+TEST(CompressedTimedPointCloudDataTest, IsSmallerThanProto) {
+  const sensor::TimedPointCloudData timed_point_cloud_data =
+      CreateTimedPointCloudData(true /* with_intensities */);
+  EXPECT_LT(
+      2 * CompressTimedPointCloudData(timed_point_cloud_data).ByteSizeLong(),
+      sensor::ToProto(timed_point_cloud_data).ByteSizeLong());
+}
+
+TEST(CompressedTimedPointCloudDataTest, EstimatesProtoSize) {
+  const sensor::TimedPointCloudData timed_point_cloud_data =
+      CreateTimedPointCloudData(true /* with_intensities */);
+  const double proto_size =
+      sensor::ToProto(timed_point_cloud_data).ByteSizeLong();
+  EXPECT_NEAR(EstimateUncompressedByteSize(timed_point_cloud_data),
+              proto_size, 0.05 * proto_size);
+}
+
+TEST(CompressedTimedPointCloudDataTest, RejectsTooManyPoints) {
+  proto::CompressedTimedPointCloudData proto = CompressTimedPointCloudData(
+      CreateTimedPointCloudData(true /* with_intensities */));
+  proto.set_num_points(proto.num_points() + 1);
+  EXPECT_EQ(::grpc::INVALID_ARGUMENT, DecompressStatusCode(proto));
+  proto.set_num_points(std::numeric_limits<int32>::max());
+  EXPECT_EQ(::grpc::INVALID_ARGUMENT, DecompressStatusCode(proto));
+  proto.set_num_points(-1);
+  EXPECT_EQ(::grpc::INVALID_ARGUMENT, DecompressStatusCode(proto));
+}
+
+TEST(CompressedTimedPointCloudDataTest, RejectsTooFewPoints) {
+  proto::CompressedTimedPointCloudData proto = CompressTimedPointCloudData(
+      CreateTimedPointCloudData(false /* with_intensities */));
+  proto.set_num_points(proto.num_points() - 1);
+  EXPECT_EQ(::grpc::INVALID_ARGUMENT, DecompressStatusCode(proto));
+}
+
+TEST(CompressedTimedPointCloudDataTest, RejectsMismatchedIntensities) {
+  proto::CompressedTimedPointCloudData proto = CompressTimedPointCloudData(
+      CreateTimedPointCloudData(false /* with_intensities */));
+  proto.set_has_intensities(true);
+  EXPECT_EQ(::grpc::INVALID_ARGUMENT, DecompressStatusCode(proto));
+}
+
+TEST(CompressedTimedPointCloudDataTest, RejectsCorruptedPointData) {
+  const proto::CompressedTimedPointCloudData valid_proto =
+      CompressTimedPointCloudData(
+          CreateTimedPointCloudData(true /* with_intensities */));
+  proto::CompressedTimedPointCloudData proto = valid_proto;
+  proto.mutable_point_data()->resize(proto.point_data().size() / 2);
+  EXPECT_EQ(::grpc::INVALID_ARGUMENT, DecompressStatusCode(proto));
+  proto.set_point_data("not gzip data");
+  EXPECT_EQ(::grpc::INVALID_ARGUMENT, DecompressStatusCode(proto));
+  proto = valid_proto;
+  proto.set_resolution(0.f);
+  EXPECT_EQ(::grpc::INVALID_ARGUMENT, DecompressStatusCode(proto));
+}
+
+TEST(CompressedTimedPointCloudDataTest, RejectsTruncatedVarint) {
+  // A single point whose last varint has its continuation bit set.
+  std::string uncompressed = {0x00, 0x00, 0x00, static_cast<char>(0x80)};
+  proto::CompressedTimedPointCloudData proto;
+  proto.set_resolution(kCompressedPointCloudResolution);
+  proto.set_time_resolution(kCompressedPointCloudTimeResolution);
+  proto.set_num_points(1);
+  common::FastGzipString(uncompressed, proto.mutable_point_data());
+  EXPECT_EQ(::grpc::INVALID_ARGUMENT, DecompressStatusCode(proto));
+
+  uncompressed.back() = 0x02;
+  proto.clear_point_data();
+  common::FastGzipString(uncompressed, proto.mutable_point_data());
+  EXPECT_EQ(1u, Decompress(proto).ranges.size());
+}
+
+}  // namespace
+}  // namespace cloud
+}  // namespace cartographer
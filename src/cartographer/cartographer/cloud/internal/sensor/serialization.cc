@@ -67,6 +67,18 @@ void CreateAddRangeFinderDataRequest(
   *proto->mutable_timed_point_cloud_data() = timed_point_cloud_data;
 }
 
+void CreateAddRangeFinderDataRequest(
+    const std::string& sensor_id, int trajectory_id,
+    const std::string& client_id,
+    const proto::CompressedTimedPointCloudData&
+        compressed_timed_point_cloud_data,
+    proto::AddRangefinderDataRequest* proto) {
+  CreateSensorMetadata(sensor_id, trajectory_id, client_id,
+                       proto->mutable_sensor_metadata());
+  *proto->mutable_compressed_timed_point_cloud_data() =
+      compressed_timed_point_cloud_data;
+}
+
 void CreateAddLandmarkDataRequest(
     const std::string& sensor_id, int trajectory_id,
     const std::string& client_id,
@@ -52,6 +52,12 @@ void CreateAddRangeFinderDataRequest(
     const std::string& client_id,
     const sensor::proto::TimedPointCloudData& timed_point_cloud_data,
     proto::AddRangefinderDataRequest* proto);
+void CreateAddRangeFinderDataRequest(
+    const std::string& sensor_id, int trajectory_id,
+    const std::string& client_id,
+    const proto::CompressedTimedPointCloudData&
+        compressed_timed_point_cloud_data,
+    proto::AddRangefinderDataRequest* proto);
 void CreateAddLandmarkDataRequest(
     const std::string& sensor_id, int trajectory_id,
     const std::string& client_id,
@@ -0,0 +1,153 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/cloud/internal/sensor_data_upload_queue.h"
+
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace cloud {
+
+namespace {
+
+bool IsNewSubmap(const mapping::proto::Submap& submap) {
+  return (submap.has_submap_2d() && submap.submap_2d().num_range_data() == 1) ||
+         (submap.has_submap_3d() && submap.submap_3d().num_range_data() == 1);
+}
+
+bool IsDroppable(const proto::SensorData& sensor_data) {
+  switch (sensor_data.sensor_data_case()) {
+    case proto::SensorData::kTimedPointCloudData:
+    case proto::SensorData::kCompressedTimedPointCloudData:
+      return true;
+    case proto::SensorData::kLocalSlamResultData:
+      return !StartsNewSubmap(sensor_data);
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+bool StartsNewSubmap(const proto::SensorData& sensor_data) {
+  const auto& submaps = sensor_data.local_slam_result_data().submaps();
+  return sensor_data.sensor_data_case() ==
+             proto::SensorData::kLocalSlamResultData &&
+         submaps.size() > 0 && IsNewSubmap(submaps.Get(submaps.size() - 1));
+}
+
+SensorDataUploadQueue::SensorDataUploadQueue(const int64 max_bytes)
+    : max_bytes_(max_bytes) {
+  CHECK_GE(max_bytes_, 0);
+}
+
+void SensorDataUploadQueue::Push(
+    std::unique_ptr<proto::SensorData> sensor_data) {
+  CHECK(sensor_data != nullptr);
+  const int64 num_bytes = sensor_data->ByteSizeLong();
+  const bool droppable = IsDroppable(*sensor_data);
+  absl::MutexLock locker(&mutex_);
+  while (max_bytes_ != 0 && num_bytes_ + num_bytes > max_bytes_) {
+    if (!droppable_.empty()) {
+      Drop(&droppable_);
+    } else if (droppable) {
+      // Range data never pushes out the data which is kept.
+      ++num_dropped_;
+      return;
+    } else if (!kept_.empty()) {
+      Drop(&kept_);
+    } else {
+      break;
+    }
+  }
+  (droppable ? droppable_ : kept_)
+      .push_back(
+          Entry{next_sequence_number_++, num_bytes, std::move(sensor_data)});
+  num_bytes_ += num_bytes;
+}
+
+std::unique_ptr<proto::SensorData> SensorDataUploadQueue::PopWithTimeout(
+    const common::Duration timeout) {
+  const auto predicate = [this]() EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return !droppable_.empty() || !kept_.empty();
+  };
+  absl::MutexLock locker(&mutex_);
+  if (!mutex_.AwaitWithTimeout(absl::Condition(&predicate),
+                               absl::FromChrono(timeout))) {
+    return nullptr;
+  }
+  return PopOldest();
+}
+
+bool SensorDataUploadQueue::DropUntil(
+    const std::function<bool(const proto::SensorData&)>& predicate,
+    const common::Duration timeout) {
+  const auto not_empty = [this]() EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return !droppable_.empty() || !kept_.empty();
+  };
+  const absl::Time deadline = absl::Now() + absl::FromChrono(timeout);
+  absl::MutexLock locker(&mutex_);
+  for (;;) {
+    if (!mutex_.AwaitWithDeadline(absl::Condition(&not_empty), deadline)) {
+      return false;
+    }
+    if (predicate(*OldestQueue()->front().sensor_data)) {
+      return true;
+    }
+    PopOldest();
+  }
+}
+
+int64 SensorDataUploadQueue::num_bytes() {
+  absl::MutexLock locker(&mutex_);
+  return num_bytes_;
+}
+
+int64 SensorDataUploadQueue::num_dropped() {
+  absl::MutexLock locker(&mutex_);
+  return num_dropped_;
+}
+
+std::deque<SensorDataUploadQueue::Entry>* SensorDataUploadQueue::OldestQueue() {
+  CHECK(!droppable_.empty() || !kept_.empty());
+  if (droppable_.empty()) {
+    return &kept_;
+  }
+  if (kept_.empty()) {
+    return &droppable_;
+  }
+  return droppable_.front().sequence_number < kept_.front().sequence_number
+             ? &droppable_
+             : &kept_;
+}
+
+std::unique_ptr<proto::SensorData> SensorDataUploadQueue::PopOldest() {
+  std::deque<Entry>* const queue = OldestQueue();
+  std::unique_ptr<proto::SensorData> sensor_data =
+      std::move(queue->front().sensor_data);
+  num_bytes_ -= queue->front().num_bytes;
+  queue->pop_front();
+  return sensor_data;
+}
+
+void SensorDataUploadQueue::Drop(std::deque<Entry>* const queue) {
+  num_bytes_ -= queue->front().num_bytes;
+  queue->pop_front();
+  ++num_dropped_;
+}
+
+}  // namespace cloud
+}  // namespace cartographer
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_CLOUD_INTERNAL_SENSOR_DATA_UPLOAD_QUEUE_H
+#define CARTOGRAPHER_CLOUD_INTERNAL_SENSOR_DATA_UPLOAD_QUEUE_H
+
+#include <deque>
+#include <functional>
+#include <memory>
+
+#include "absl/synchronization/mutex.h"
+#include "cartographer/cloud/proto/map_builder_service.pb.h"
+#include "cartographer/common/port.h"
+#include "cartographer/common/time.h"
+
+namespace cartographer {
+namespace cloud {
+
+// Returns true if 'sensor_data' is a local SLAM result which inserted the first
+// range data into a new submap. Uploading can resume at such data.
+bool StartsNewSubmap(const proto::SensorData& sensor_data);
+
+// Thread-safe FIFO queue of sensor data waiting for upload, whose memory use is
+// bounded by 'max_bytes'. Once it is exceeded, range data, i.e. point clouds
+// and local SLAM results not starting a new submap, is dropped first, oldest
+// first. If no queued range data is left, pushed range data is dropped itself,
+// while other pushed data makes room by dropping the oldest of the remaining
+// data.
+class SensorDataUploadQueue {
+ public:
+  // A 'max_bytes' of 0 means unbounded.
+  explicit SensorDataUploadQueue(int64 max_bytes);
+
+  SensorDataUploadQueue(const SensorDataUploadQueue&) = delete;
+  SensorDataUploadQueue& operator=(const SensorDataUploadQueue&) = delete;
+
+  void Push(std::unique_ptr<proto::SensorData> sensor_data)
+      LOCKS_EXCLUDED(mutex_);
+
+  // Returns nullptr if no data became available within 'timeout'.
+  std::unique_ptr<proto::SensorData> PopWithTimeout(common::Duration timeout)
+      LOCKS_EXCLUDED(mutex_);
+
+  // Drops data from the front of the queue until 'predicate' holds for the
+  // data at the front. Returns false if that did not happen within 'timeout'.
+  bool DropUntil(
+      const std::function<bool(const proto::SensorData&)>& predicate,
+      common::Duration timeout) LOCKS_EXCLUDED(mutex_);
+
+  // Serialized size of the queued data.
+  int64 num_bytes() LOCKS_EXCLUDED(mutex_);
+  // Number of items dropped to stay within the memory budget so far.
+  int64 num_dropped() LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct Entry {
+    int64 sequence_number;
+    int64 num_bytes;
+    std::unique_ptr<proto::SensorData> sensor_data;
+  };
+
+  // Returns the queue holding the oldest entry, which must exist.
+  std::deque<Entry>* OldestQueue() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  std::unique_ptr<proto::SensorData> PopOldest()
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void Drop(std::deque<Entry>* queue) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const int64 max_bytes_;
+  absl::Mutex mutex_;
+  // Entries are split by whether they may be dropped first. The sequence
+  // numbers restore the order in which they were pushed.
+  std::deque<Entry> droppable_ GUARDED_BY(mutex_);
+  std::deque<Entry> kept_ GUARDED_BY(mutex_);
+  int64 next_sequence_number_ GUARDED_BY(mutex_) = 0;
+  int64 num_bytes_ GUARDED_BY(mutex_) = 0;
+  int64 num_dropped_ GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace cloud
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_CLOUD_INTERNAL_SENSOR_DATA_UPLOAD_QUEUE_H
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/cloud/internal/sensor_data_upload_queue.h"
+
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace cloud {
+namespace {
+
+const common::Duration kTimeout = common::FromMilliseconds(10);
+
+std::unique_ptr<proto::SensorData> CreateImuData(const int64 timestamp) {
+  auto sensor_data = absl::make_unique<proto::SensorData>();
+  sensor_data->mutable_imu_data()->set_timestamp(timestamp);
+  return sensor_data;
+}
+
+std::unique_ptr<proto::SensorData> CreateLocalSlamResultData(
+    const int64 timestamp, const int num_range_data) {
+  auto sensor_data = absl::make_unique<proto::SensorData>();
+  auto* const local_slam_result_data =
+      sensor_data->mutable_local_slam_result_data();
+  local_slam_result_data->set_timestamp(timestamp);
+  local_slam_result_data->add_submaps()
+      ->mutable_submap_2d()
+      ->set_num_range_data(num_range_data);
+  return sensor_data;
+}
+
+int64 Timestamp(const proto::SensorData& sensor_data) {
+  return sensor_data.has_imu_data()
+             ? sensor_data.imu_data().timestamp()
+             : sensor_data.local_slam_result_data().timestamp();
+}
+
+std::vector<int64> PopAll(SensorDataUploadQueue* queue) {
+  std::vector<int64> timestamps;
+  while (auto sensor_data = queue->PopWithTimeout(kTimeout)) {
+    timestamps.push_back(Timestamp(*sensor_data));
+  }
+  return timestamps;
+}
+
+TEST(SensorDataUploadQueueTest, KeepsOrder) {
+  SensorDataUploadQueue queue(0 /* max_bytes */);
+  for (int i = 0; i < 10; ++i) {
+    if (i % 3 == 0) {
+      queue.Push(CreateLocalSlamResultData(i, 2));
+    } else {
+      queue.Push(CreateImuData(i));
+    }
+  }
+  EXPECT_GT(queue.num_bytes(), 0);
+  EXPECT_EQ(PopAll(&queue),
+            std::vector<int64>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+  EXPECT_EQ(queue.num_bytes(), 0);
+  EXPECT_EQ(queue.PopWithTimeout(kTimeout), nullptr);
+}
+
+TEST(SensorDataUploadQueueTest, DropsRangeDataFirst) {
+  const int64 local_slam_result_bytes =
+      CreateLocalSlamResultData(1, 2)->ByteSizeLong();
+  const int64 imu_bytes = CreateImuData(1)->ByteSizeLong();
+  SensorDataUploadQueue queue(3 * local_slam_result_bytes + 2 * imu_bytes);
+  queue.Push(CreateLocalSlamResultData(1, 1));
+  queue.Push(CreateImuData(2));
+  queue.Push(CreateLocalSlamResultData(3, 2));
+  queue.Push(CreateImuData(4));
+  queue.Push(CreateLocalSlamResultData(5, 3));
+  EXPECT_EQ(queue.num_dropped(), 0);
+  queue.Push(CreateLocalSlamResultData(6, 4));
+  EXPECT_EQ(queue.num_dropped(), 1);
+  EXPECT_LE(queue.num_bytes(),
+            3 * local_slam_result_bytes + 2 * imu_bytes);
+  // The result starting a new submap and the IMU data are kept.
+  EXPECT_EQ(PopAll(&queue), std::vector<int64>({1, 2, 4, 5, 6}));
+}
+
+TEST(SensorDataUploadQueueTest, DropsOldestDataIfNothingElseHelps) {
+  const int64 imu_bytes = CreateImuData(1)->ByteSizeLong();
+  SensorDataUploadQueue queue(2 * imu_bytes);
+  for (int i = 1; i <= 4; ++i) {
+    queue.Push(CreateImuData(i));
+  }
+  EXPECT_EQ(queue.num_dropped(), 2);
+  EXPECT_EQ(PopAll(&queue), std::vector<int64>({3, 4}));
+}
+
+TEST(SensorDataUploadQueueTest, DropsPushedRangeDataInsteadOfKeptData) {
+  SensorDataUploadQueue queue(CreateImuData(1)->ByteSizeLong() +
+                              CreateLocalSlamResultData(2, 1)->ByteSizeLong());
+  queue.Push(CreateImuData(1));
+  queue.Push(CreateLocalSlamResultData(2, 1));
+  // Neither the point cloud nor the local SLAM result not starting a new
+  // submap may push out the IMU data or the new submap.
+  auto point_cloud = absl::make_unique<proto::SensorData>();
+  point_cloud->mutable_timed_point_cloud_data()->set_timestamp(3);
+  point_cloud->mutable_timed_point_cloud_data()->add_point_data();
+  queue.Push(std::move(point_cloud));
+  queue.Push(CreateLocalSlamResultData(4, 2));
+  EXPECT_EQ(queue.num_dropped(), 2);
+  EXPECT_EQ(PopAll(&queue), std::vector<int64>({1, 2}));
+}
+
+TEST(SensorDataUploadQueueTest, DropUntil) {
+  SensorDataUploadQueue queue(0 /* max_bytes */);
+  queue.Push(CreateImuData(1));
+  queue.Push(CreateLocalSlamResultData(2, 2));
+  queue.Push(CreateLocalSlamResultData(3, 1));
+  queue.Push(CreateImuData(4));
+  EXPECT_TRUE(queue.DropUntil(StartsNewSubmap, kTimeout));
+  EXPECT_EQ(PopAll(&queue), std::vector<int64>({3, 4}));
+  EXPECT_FALSE(queue.DropUntil(StartsNewSubmap, kTimeout));
+}
+
+}  // namespace
+}  // namespace cloud
+}  // namespace cartographer
@@ -30,14 +30,14 @@ namespace testing {
 class MockMapBuilderContext : public MapBuilderContextInterface {
  public:
   MOCK_METHOD0(map_builder, mapping::MapBuilderInterface &());
-  MOCK_METHOD0(
-      sensor_data_queue,
-      common::BlockingQueue<std::unique_ptr<MapBuilderContextInterface::Data>>
-          &());
   MOCK_METHOD0(GetLocalSlamResultCallbackForSubscriptions,
                mapping::TrajectoryBuilderInterface::LocalSlamResultCallback());
-  MOCK_METHOD1(AddSensorDataToTrajectory,
+  MOCK_METHOD1(DoAddSensorDataToTrajectory,
                void(const MapBuilderContextInterface::Data &));
+  void AddSensorDataToTrajectory(
+      std::unique_ptr<MapBuilderContextInterface::Data> sensor_data) override {
+    DoAddSensorDataToTrajectory(*sensor_data);
+  }
   MOCK_METHOD2(SubscribeLocalSlamResults,
                MapBuilderContextInterface::LocalSlamSubscriptionId(
                    int,
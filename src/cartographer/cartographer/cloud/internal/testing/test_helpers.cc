@@ -16,6 +16,8 @@
 
 #include "cartographer/cloud/internal/testing/test_helpers.h"
 
+#include "cartographer/cloud/internal/sensor/compressed_timed_point_cloud_data.h"
+
 namespace cartographer {
 namespace cloud {
 namespace testing {
@@ -77,14 +79,21 @@ DataPredicateType BuildDataPredicateEquals<proto::AddLandmarkDataRequest>(
 template <>
 DataPredicateType BuildDataPredicateEquals<proto::AddRangefinderDataRequest>(
     const proto::AddRangefinderDataRequest &proto) {
-  return [proto](const sensor::Data &data) {
+  sensor::proto::TimedPointCloudData expected = proto.timed_point_cloud_data();
+  if (proto.has_compressed_timed_point_cloud_data()) {
+    sensor::TimedPointCloudData timed_point_cloud_data;
+    const ::grpc::Status status = DecompressTimedPointCloudData(
+        proto.compressed_timed_point_cloud_data(), &timed_point_cloud_data);
+    CHECK(status.ok()) << status.error_message();
+    expected = sensor::ToProto(timed_point_cloud_data);
+  }
+  return [proto, expected](const sensor::Data &data) {
     const auto *dispatchable =
         dynamic_cast<const sensor::Dispatchable<sensor::TimedPointCloudData> *>(
             &data);
     CHECK_NOTNULL(dispatchable);
     return google::protobuf::util::MessageDifferencer::Equals(
-               sensor::ToProto(dispatchable->data()),
-               proto.timed_point_cloud_data()) &&
+               sensor::ToProto(dispatchable->data()), expected) &&
            dispatchable->GetSensorId() == proto.sensor_metadata().sensor_id();
   };
 }
@@ -32,6 +32,8 @@ proto::MapBuilderServerOptions CreateMapBuilderServerOptions(
       lua_parameter_dictionary->GetInt("num_grpc_threads"));
   map_builder_server_options.set_num_event_threads(
       lua_parameter_dictionary->GetInt("num_event_threads"));
+  map_builder_server_options.set_num_slam_threads(
+      lua_parameter_dictionary->GetNonNegativeInt("num_slam_threads"));
   *map_builder_server_options.mutable_map_builder_options() =
       mapping::CreateMapBuilderOptions(
           lua_parameter_dictionary->GetDictionary("map_builder").get());
@@ -39,6 +41,12 @@ proto::MapBuilderServerOptions CreateMapBuilderServerOptions(
       lua_parameter_dictionary->GetString("uplink_server_address"));
   map_builder_server_options.set_upload_batch_size(
       lua_parameter_dictionary->GetInt("upload_batch_size"));
+  map_builder_server_options.set_upload_max_batch_bytes(
+      lua_parameter_dictionary->GetNonNegativeInt("upload_max_batch_bytes"));
+  map_builder_server_options.set_upload_max_batch_delay_seconds(
+      lua_parameter_dictionary->GetDouble("upload_max_batch_delay_seconds"));
+  map_builder_server_options.set_upload_queue_max_bytes(
+      lua_parameter_dictionary->GetNonNegativeInt("upload_queue_max_bytes"));
   map_builder_server_options.set_enable_ssl_encryption(
       lua_parameter_dictionary->GetBool("enable_ssl_encryption"));
   map_builder_server_options.set_enable_google_auth(
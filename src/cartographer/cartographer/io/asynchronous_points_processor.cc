@@ -0,0 +1,81 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/io/asynchronous_points_processor.h"
+
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace io {
+
+AsynchronousPointsProcessor::AsynchronousPointsProcessor(
+    const int queue_size, PointsProcessor* const next)
+    : next_(next), queue_(queue_size) {
+  CHECK_GT(queue_size, 0);
+  thread_ = std::thread([this]() { ProcessQueue(); });
+}
+
+AsynchronousPointsProcessor::~AsynchronousPointsProcessor() {
+  {
+    absl::MutexLock locker(&mutex_);
+    shutting_down_ = true;
+  }
+  // A nullptr batch stops the background thread.
+  queue_.Push(nullptr);
+  thread_.join();
+}
+
+void AsynchronousPointsProcessor::Process(std::unique_ptr<PointsBatch> batch) {
+  CHECK(batch != nullptr);
+  {
+    absl::MutexLock locker(&mutex_);
+    ++num_pending_batches_;
+  }
+  queue_.Push(std::move(batch));
+}
+
+PointsProcessor::FlushResult AsynchronousPointsProcessor::Flush() {
+  {
+    const auto predicate = [this]() EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+      return num_pending_batches_ == 0;
+    };
+    absl::MutexLock locker(&mutex_);
+    mutex_.Await(absl::Condition(&predicate));
+  }
+  return next_->Flush();
+}
+
+void AsynchronousPointsProcessor::ProcessQueue() {
+  for (;;) {
+    std::unique_ptr<PointsBatch> batch = queue_.Pop();
+    if (batch == nullptr) {
+      return;
+    }
+    bool shutting_down;
+    {
+      absl::MutexLock locker(&mutex_);
+      shutting_down = shutting_down_;
+    }
+    if (!shutting_down) {
+      next_->Process(std::move(batch));
+    }
+    absl::MutexLock locker(&mutex_);
+    --num_pending_batches_;
+  }
+}
+
+}  // namespace io
+}  // namespace cartographer
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_IO_ASYNCHRONOUS_POINTS_PROCESSOR_H_
+#define CARTOGRAPHER_IO_ASYNCHRONOUS_POINTS_PROCESSOR_H_
+
+#include <memory>
+#include <thread>
+
+#include "absl/synchronization/mutex.h"
+#include "cartographer/common/internal/blocking_queue.h"
+#include "cartographer/io/points_processor.h"
+
+namespace cartographer {
+namespace io {
+
+// Hands batches to 'next' on a background thread. At most 'queue_size' batches
+// are queued, 'Process' blocks once the queue is full. This decouples 'next'
+// from the stage in front of it, so that both run concurrently.
+class AsynchronousPointsProcessor : public PointsProcessor {
+ public:
+  AsynchronousPointsProcessor(int queue_size, PointsProcessor* next);
+
+  // Batches which have not been handed to 'next' yet are dropped.
+  ~AsynchronousPointsProcessor() override;
+
+  AsynchronousPointsProcessor(const AsynchronousPointsProcessor&) = delete;
+  AsynchronousPointsProcessor& operator=(const AsynchronousPointsProcessor&) =
+      delete;
+
+  void Process(std::unique_ptr<PointsBatch> batch) override;
+
+  // Waits until all queued batches have been processed by 'next', then
+  // flushes 'next' on the calling thread.
+  FlushResult Flush() override;
+
+ private:
+  void ProcessQueue();
+
+  PointsProcessor* const next_;
+  common::BlockingQueue<std::unique_ptr<PointsBatch>> queue_;
+
+  absl::Mutex mutex_;
+  // Number of batches which were queued but not yet processed by 'next_'.
+  int num_pending_batches_ GUARDED_BY(mutex_) = 0;
+  bool shutting_down_ GUARDED_BY(mutex_) = false;
+
+  std::thread thread_;
+};
+
+}  // namespace io
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_IO_ASYNCHRONOUS_POINTS_PROCESSOR_H_
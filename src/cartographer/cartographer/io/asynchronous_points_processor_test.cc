@@ -0,0 +1,64 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/io/asynchronous_points_processor.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace io {
+namespace {
+
+class SlowRecordingPointsProcessor : public PointsProcessor {
+ public:
+  void Process(std::unique_ptr<PointsBatch> batch) override {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+    indices.push_back(common::ToUniversal(batch->start_time));
+  }
+  FlushResult Flush() override {
+    return indices.size() < 100 ? FlushResult::kRestartStream
+                                : FlushResult::kFinished;
+  }
+
+  std::vector<int64> indices;
+};
+
+TEST(AsynchronousPointsProcessorTest, FlushWaitsForQueuedBatches) {
+  SlowRecordingPointsProcessor recorder;
+  AsynchronousPointsProcessor processor(4, &recorder);
+  std::vector<int64> expected_indices;
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int64 i = 0; i < 50; ++i) {
+      auto batch = absl::make_unique<PointsBatch>();
+      batch->start_time = common::FromUniversal(i);
+      processor.Process(std::move(batch));
+      expected_indices.push_back(i);
+    }
+    EXPECT_EQ(pass == 0 ? PointsProcessor::FlushResult::kRestartStream
+                        : PointsProcessor::FlushResult::kFinished,
+              processor.Flush());
+    EXPECT_EQ(expected_indices, recorder.indices);
+  }
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace cartographer
@@ -0,0 +1,209 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/io/chunked_point_cloud.h"
+
+#include <cstring>
+
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace io {
+
+namespace {
+
+constexpr size_t kMagicSize = 8;
+constexpr size_t kIndexEntrySize = 6 * sizeof(float) + sizeof(uint32) +
+                                   2 * sizeof(uint64);
+
+template <typename T>
+void Append(const T& value, std::string* const buffer) {
+  buffer->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T Consume(const char** const cursor) {
+  T value;
+  std::memcpy(&value, *cursor, sizeof(T));
+  *cursor += sizeof(T);
+  return value;
+}
+
+void AppendBox(const Eigen::AlignedBox3f& box, std::string* const buffer) {
+  for (int i = 0; i < 3; ++i) {
+    Append<float>(box.min()[i], buffer);
+  }
+  for (int i = 0; i < 3; ++i) {
+    Append<float>(box.max()[i], buffer);
+  }
+}
+
+Eigen::AlignedBox3f ConsumeBox(const char** const cursor) {
+  Eigen::AlignedBox3f box;
+  for (int i = 0; i < 3; ++i) {
+    box.min()[i] = Consume<float>(cursor);
+  }
+  for (int i = 0; i < 3; ++i) {
+    box.max()[i] = Consume<float>(cursor);
+  }
+  return box;
+}
+
+std::string ReadBytes(const uint64 offset, const uint64 size,
+                      std::istream* const stream) {
+  std::string bytes(size, '\0');
+  stream->seekg(offset);
+  CHECK(stream->read(&bytes[0], size))
+      << "Could not read " << size << " bytes at offset " << offset << ".";
+  return bytes;
+}
+
+}  // namespace
+
+std::string EncodePointCloudChunk(const PointCloudChunk& chunk) {
+  const size_t num_points = chunk.positions.size();
+  CHECK(chunk.colors.empty() || chunk.colors.size() == num_points);
+  CHECK(chunk.intensities.empty() || chunk.intensities.size() == num_points);
+  // Storing each coordinate separately makes the data compress better.
+  std::string uncompressed;
+  uncompressed.reserve(num_points * (3 * sizeof(float) + 3 + sizeof(float)));
+  for (int i = 0; i < 3; ++i) {
+    for (const Eigen::Vector3f& position : chunk.positions) {
+      Append<float>(position[i], &uncompressed);
+    }
+  }
+  for (int i = 0; i < 3 && !chunk.colors.empty(); ++i) {
+    for (const Uint8Color& color : chunk.colors) {
+      Append<uint8>(color[i], &uncompressed);
+    }
+  }
+  for (const float intensity : chunk.intensities) {
+    Append<float>(intensity, &uncompressed);
+  }
+  std::string compressed;
+  common::FastGzipString(uncompressed, &compressed);
+  return compressed;
+}
+
+PointCloudChunk DecodePointCloudChunk(const std::string& encoded_chunk,
+                                      const uint32 num_points,
+                                      const uint32 flags) {
+  std::string uncompressed;
+  common::FastGunzipString(encoded_chunk, &uncompressed);
+  const bool has_colors = flags & kChunkedPointCloudHasColors;
+  const bool has_intensities = flags & kChunkedPointCloudHasIntensities;
+  CHECK_EQ(uncompressed.size(),
+           num_points * (3 * sizeof(float) + (has_colors ? 3 : 0) +
+                         (has_intensities ? sizeof(float) : 0)));
+  const char* cursor = uncompressed.data();
+  PointCloudChunk chunk;
+  chunk.positions.resize(num_points);
+  for (int i = 0; i < 3; ++i) {
+    for (Eigen::Vector3f& position : chunk.positions) {
+      position[i] = Consume<float>(&cursor);
+    }
+  }
+  if (has_colors) {
+    chunk.colors.resize(num_points);
+    for (int i = 0; i < 3; ++i) {
+      for (Uint8Color& color : chunk.colors) {
+        color[i] = Consume<uint8>(&cursor);
+      }
+    }
+  }
+  if (has_intensities) {
+    chunk.intensities.resize(num_points);
+    for (float& intensity : chunk.intensities) {
+      intensity = Consume<float>(&cursor);
+    }
+  }
+  return chunk;
+}
+
+std::string SerializeChunkedPointCloudHeader(
+    const ChunkedPointCloudHeader& header) {
+  std::string buffer(kChunkedPointCloudMagic, kMagicSize);
+  Append<uint32>(kChunkedPointCloudVersion, &buffer);
+  Append<uint32>(header.flags, &buffer);
+  Append<uint64>(header.num_points, &buffer);
+  Append<uint64>(header.num_chunks, &buffer);
+  Append<uint64>(header.index_offset, &buffer);
+  AppendBox(header.bounding_box, &buffer);
+  CHECK_EQ(buffer.size(), kChunkedPointCloudHeaderSize);
+  return buffer;
+}
+
+std::string SerializeChunkIndex(const std::vector<ChunkIndexEntry>& index) {
+  std::string buffer;
+  buffer.reserve(index.size() * kIndexEntrySize);
+  for (const ChunkIndexEntry& entry : index) {
+    AppendBox(entry.bounding_box, &buffer);
+    Append<uint32>(entry.num_points, &buffer);
+    Append<uint64>(entry.offset, &buffer);
+    Append<uint64>(entry.size, &buffer);
+  }
+  return buffer;
+}
+
+ChunkedPointCloudReader::ChunkedPointCloudReader(std::istream* const stream)
+    : stream_(stream) {
+  const std::string header =
+      ReadBytes(0, kChunkedPointCloudHeaderSize, stream_);
+  CHECK_EQ(header.substr(0, kMagicSize),
+           std::string(kChunkedPointCloudMagic, kMagicSize))
+      << "Not a chunked point cloud.";
+  const char* cursor = header.data() + kMagicSize;
+  const uint32 version = Consume<uint32>(&cursor);
+  CHECK_EQ(version, kChunkedPointCloudVersion)
+      << "Unsupported chunked point cloud version.";
+  header_.flags = Consume<uint32>(&cursor);
+  header_.num_points = Consume<uint64>(&cursor);
+  header_.num_chunks = Consume<uint64>(&cursor);
+  header_.index_offset = Consume<uint64>(&cursor);
+  header_.bounding_box = ConsumeBox(&cursor);
+
+  const std::string index = ReadBytes(
+      header_.index_offset, header_.num_chunks * kIndexEntrySize, stream_);
+  cursor = index.data();
+  for (uint64 i = 0; i < header_.num_chunks; ++i) {
+    ChunkIndexEntry entry;
+    entry.bounding_box = ConsumeBox(&cursor);
+    entry.num_points = Consume<uint32>(&cursor);
+    entry.offset = Consume<uint64>(&cursor);
+    entry.size = Consume<uint64>(&cursor);
+    index_.push_back(entry);
+  }
+}
+
+PointCloudChunk ChunkedPointCloudReader::ReadChunk(const int chunk_index) {
+  const ChunkIndexEntry& entry = index_.at(chunk_index);
+  return DecodePointCloudChunk(ReadBytes(entry.offset, entry.size, stream_),
+                               entry.num_points, header_.flags);
+}
+
+std::vector<int> ChunkedPointCloudReader::FindChunks(
+    const Eigen::AlignedBox3f& region) const {
+  std::vector<int> chunk_indices;
+  for (size_t i = 0; i < index_.size(); ++i) {
+    if (index_[i].bounding_box.intersects(region)) {
+      chunk_indices.push_back(i);
+    }
+  }
+  return chunk_indices;
+}
+
+}  // namespace io
+}  // namespace cartographer
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_IO_CHUNKED_POINT_CLOUD_H_
+#define CARTOGRAPHER_IO_CHUNKED_POINT_CLOUD_H_
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "Eigen/Core"
+#include "Eigen/Geometry"
+#include "cartographer/common/port.h"
+#include "cartographer/io/color.h"
+
+namespace cartographer {
+namespace io {
+
+// Binary point cloud format made of independently compressed chunks of
+// spatially close points. The file starts with a fixed size header, followed
+// by the chunks and an index which stores the bounding box, the number of
+// points and the location of every chunk. Readers can therefore decompress only
+// the chunks intersecting a region of interest. All values are stored in the
+// byte order of the writing machine.
+//
+// Header (kChunkedPointCloudHeaderSize bytes):
+//   char[8] magic, uint32 version, uint32 flags (see below), uint64 num_points,
+//   uint64 num_chunks, uint64 index_offset, float[3] min, float[3] max
+// Index entry (one per chunk):
+//   float[3] min, float[3] max, uint32 num_points, uint64 offset, uint64 size
+// Chunk: gzip compressed x[], y[], z[], then optionally red[], green[],
+//   blue[] as uint8 and intensity[] as float.
+constexpr char kChunkedPointCloudMagic[] = "CARTOCPC";
+constexpr uint32 kChunkedPointCloudVersion = 1;
+constexpr size_t kChunkedPointCloudHeaderSize = 64;
+constexpr uint32 kChunkedPointCloudHasColors = 1 << 0;
+constexpr uint32 kChunkedPointCloudHasIntensities = 1 << 1;
+
+// The points of one chunk. 'colors' and 'intensities' are either empty or of
+// the same size as 'positions'.
+struct PointCloudChunk {
+  std::vector<Eigen::Vector3f> positions;
+  std::vector<Uint8Color> colors;
+  std::vector<float> intensities;
+};
+
+struct ChunkedPointCloudHeader {
+  uint32 flags = 0;
+  uint64 num_points = 0;
+  uint64 num_chunks = 0;
+  uint64 index_offset = 0;
+  Eigen::AlignedBox3f bounding_box;
+};
+
+struct ChunkIndexEntry {
+  Eigen::AlignedBox3f bounding_box;
+  uint32 num_points = 0;
+  uint64 offset = 0;
+  uint64 size = 0;
+};
+
+// Compresses 'chunk' into its on-disk representation. This is safe to call
+// from several threads at the same time.
+std::string EncodePointCloudChunk(const PointCloudChunk& chunk);
+PointCloudChunk DecodePointCloudChunk(const std::string& encoded_chunk,
+                                      uint32 num_points, uint32 flags);
+
+std::string SerializeChunkedPointCloudHeader(
+    const ChunkedPointCloudHeader& header);
+std::string SerializeChunkIndex(const std::vector<ChunkIndexEntry>& index);
+
+// Reads a chunked point cloud written by
+// 'ChunkedPointCloudWritingPointsProcessor'.
+class ChunkedPointCloudReader {
+ public:
+  // 'stream' must outlive the reader.
+  explicit ChunkedPointCloudReader(std::istream* stream);
+
+  ChunkedPointCloudReader(const ChunkedPointCloudReader&) = delete;
+  ChunkedPointCloudReader& operator=(const ChunkedPointCloudReader&) = delete;
+
+  const ChunkedPointCloudHeader& header() const { return header_; }
+  const std::vector<ChunkIndexEntry>& index() const { return index_; }
+
+  PointCloudChunk ReadChunk(int chunk_index);
+
+  // Returns the indices of all chunks whose bounding box intersects 'region'.
+  std::vector<int> FindChunks(const Eigen::AlignedBox3f& region) const;
+
+ private:
+  std::istream* const stream_;
+  ChunkedPointCloudHeader header_;
+  std::vector<ChunkIndexEntry> index_;
+};
+
+}  // namespace io
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_IO_CHUNKED_POINT_CLOUD_H_
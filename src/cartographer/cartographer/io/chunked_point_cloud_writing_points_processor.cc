@@ -0,0 +1,216 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/io/chunked_point_cloud_writing_points_processor.h"
+
+#include <cmath>
+
+#include "absl/memory/memory.h"
+#include "cartographer/common/task.h"
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace io {
+
+namespace {
+
+void WriteHeader(const ChunkedPointCloudHeader& header,
+                 FileWriter* const file_writer) {
+  const std::string serialized_header =
+      SerializeChunkedPointCloudHeader(header);
+  CHECK(file_writer->WriteHeader(serialized_header.data(),
+                                 serialized_header.size()));
+}
+
+}  // namespace
+
+std::unique_ptr<ChunkedPointCloudWritingPointsProcessor>
+ChunkedPointCloudWritingPointsProcessor::FromDictionary(
+    const FileWriterFactory& file_writer_factory,
+    common::LuaParameterDictionary* const dictionary,
+    PointsProcessor* const next) {
+  return absl::make_unique<ChunkedPointCloudWritingPointsProcessor>(
+      file_writer_factory(dictionary->GetString("filename")),
+      dictionary->GetDouble("chunk_size"),
+      dictionary->GetNonNegativeInt("max_points_per_chunk"),
+      dictionary->GetNonNegativeInt("num_threads"), next);
+}
+
+ChunkedPointCloudWritingPointsProcessor::
+    ChunkedPointCloudWritingPointsProcessor(
+        std::unique_ptr<FileWriter> file_writer, const double chunk_size,
+        const int max_points_per_chunk, const int num_threads,
+        PointsProcessor* const next)
+    : next_(next),
+      chunk_size_(chunk_size),
+      max_points_per_chunk_(max_points_per_chunk),
+      max_chunks_in_flight_(4 * num_threads),
+      file_(std::move(file_writer)),
+      thread_pool_(num_threads) {
+  CHECK_GT(chunk_size_, 0.);
+  CHECK_GT(max_points_per_chunk_, 0);
+  CHECK_GT(num_threads, 0);
+  // Reserves the space for the header which is written in 'Flush'.
+  WriteHeader(header_, file_.get());
+}
+
+ChunkedPointCloudWritingPointsProcessor::
+    ~ChunkedPointCloudWritingPointsProcessor() {
+  // The thread pool must not have queued work when it is destroyed.
+  const auto predicate = [this]() EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return static_cast<int64>(encoded_chunks_.size()) ==
+           num_sealed_chunks_ - num_written_chunks_;
+  };
+  absl::MutexLock locker(&mutex_);
+  mutex_.Await(absl::Condition(&predicate));
+}
+
+void ChunkedPointCloudWritingPointsProcessor::Process(
+    std::unique_ptr<PointsBatch> batch) {
+  if (batch->points.empty()) {
+    next_->Process(std::move(batch));
+    return;
+  }
+
+  if (header_.num_points == 0) {
+    header_.flags =
+        (batch->colors.empty() ? 0 : kChunkedPointCloudHasColors) |
+        (batch->intensities.empty() ? 0 : kChunkedPointCloudHasIntensities);
+  }
+  const bool has_colors = header_.flags & kChunkedPointCloudHasColors;
+  const bool has_intensities =
+      header_.flags & kChunkedPointCloudHasIntensities;
+  if (has_colors) {
+    CHECK_EQ(batch->points.size(), batch->colors.size())
+        << "First PointsBatch had colors, but encountered one without. "
+           "frame_id: "
+        << batch->frame_id;
+  }
+  if (has_intensities) {
+    CHECK_EQ(batch->points.size(), batch->intensities.size())
+        << "First PointsBatch had intensities, but encountered one without. "
+           "frame_id: "
+        << batch->frame_id;
+  }
+
+  for (size_t i = 0; i < batch->points.size(); ++i) {
+    const Eigen::Vector3f& position = batch->points[i].position;
+    PointCloudChunk& chunk = open_chunks_[CellIndex(
+        std::floor(position.x() / chunk_size_),
+        std::floor(position.y() / chunk_size_),
+        std::floor(position.z() / chunk_size_))];
+    chunk.positions.push_back(position);
+    if (has_colors) {
+      chunk.colors.push_back(ToUint8Color(batch->colors[i]));
+    }
+    if (has_intensities) {
+      chunk.intensities.push_back(batch->intensities[i]);
+    }
+    header_.bounding_box.extend(position);
+    if (static_cast<int>(chunk.positions.size()) >= max_points_per_chunk_) {
+      SealChunk(&chunk);
+    }
+  }
+  header_.num_points += batch->points.size();
+  WriteEncodedChunks(max_chunks_in_flight_);
+  next_->Process(std::move(batch));
+}
+
+PointsProcessor::FlushResult ChunkedPointCloudWritingPointsProcessor::Flush() {
+  for (auto& entry : open_chunks_) {
+    if (!entry.second.positions.empty()) {
+      SealChunk(&entry.second);
+    }
+  }
+  open_chunks_.clear();
+  WriteEncodedChunks(0);
+
+  header_.num_chunks = index_.size();
+  header_.index_offset = offset_;
+  const std::string serialized_index = SerializeChunkIndex(index_);
+  CHECK(file_->Write(serialized_index.data(), serialized_index.size()));
+  WriteHeader(header_, file_.get());
+  CHECK(file_->Close()) << "Closing chunked point cloud file_writer failed.";
+
+  switch (next_->Flush()) {
+    case FlushResult::kFinished:
+      return FlushResult::kFinished;
+
+    case FlushResult::kRestartStream:
+      LOG(FATAL) << "Chunked point cloud generation must be configured to "
+                    "occur after any stages that require multiple passes.";
+  }
+  LOG(FATAL);
+}
+
+void ChunkedPointCloudWritingPointsProcessor::SealChunk(
+    PointCloudChunk* const chunk) {
+  ChunkIndexEntry entry;
+  for (const Eigen::Vector3f& position : chunk->positions) {
+    entry.bounding_box.extend(position);
+  }
+  entry.num_points = chunk->positions.size();
+  index_.push_back(entry);
+
+  int64 chunk_index;
+  {
+    absl::MutexLock locker(&mutex_);
+    chunk_index = num_sealed_chunks_++;
+  }
+  auto points = std::make_shared<PointCloudChunk>(std::move(*chunk));
+  *chunk = PointCloudChunk();
+  auto task = absl::make_unique<common::Task>();
+  task->SetWorkItem([this, chunk_index, points]() {
+    std::string encoded_chunk = EncodePointCloudChunk(*points);
+    absl::MutexLock locker(&mutex_);
+    encoded_chunks_[chunk_index] = std::move(encoded_chunk);
+  });
+  thread_pool_.Schedule(std::move(task));
+}
+
+void ChunkedPointCloudWritingPointsProcessor::WriteEncodedChunks(
+    const int64 max_chunks_in_flight) {
+  for (;;) {
+    int64 chunk_index;
+    std::string encoded_chunk;
+    {
+      const auto predicate = [this, max_chunks_in_flight]()
+                                 EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+        return encoded_chunks_.count(num_written_chunks_) != 0 ||
+               num_sealed_chunks_ - num_written_chunks_ <=
+                   max_chunks_in_flight;
+      };
+      absl::MutexLock locker(&mutex_);
+      mutex_.Await(absl::Condition(&predicate));
+      const auto it = encoded_chunks_.find(num_written_chunks_);
+      if (it == encoded_chunks_.end()) {
+        return;
+      }
+      chunk_index = it->first;
+      encoded_chunk = std::move(it->second);
+      encoded_chunks_.erase(it);
+    }
+    CHECK(file_->Write(encoded_chunk.data(), encoded_chunk.size()));
+    index_.at(chunk_index).offset = offset_;
+    index_.at(chunk_index).size = encoded_chunk.size();
+    offset_ += encoded_chunk.size();
+    absl::MutexLock locker(&mutex_);
+    ++num_written_chunks_;
+  }
+}
+
+}  // namespace io
+}  // namespace cartographer
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_IO_CHUNKED_POINT_CLOUD_WRITING_POINTS_PROCESSOR_H_
+#define CARTOGRAPHER_IO_CHUNKED_POINT_CLOUD_WRITING_POINTS_PROCESSOR_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "cartographer/common/lua_parameter_dictionary.h"
+#include "cartographer/common/thread_pool.h"
+#include "cartographer/io/chunked_point_cloud.h"
+#include "cartographer/io/file_writer.h"
+#include "cartographer/io/points_processor.h"
+
+namespace cartographer {
+namespace io {
+
+// Streams a chunked, compressed binary point cloud to disk (see
+// 'chunked_point_cloud.h'). Points are grouped into cubes of 'chunk_size'
+// meters and every 'max_points_per_chunk' points of a cube form a chunk, which
+// is compressed on one of 'num_threads' background threads. The header and
+// the spatial index are written in 'Flush'.
+class ChunkedPointCloudWritingPointsProcessor : public PointsProcessor {
+ public:
+  constexpr static const char* kConfigurationFileActionName =
+      "write_chunked_points";
+
+  ChunkedPointCloudWritingPointsProcessor(
+      std::unique_ptr<FileWriter> file_writer, double chunk_size,
+      int max_points_per_chunk, int num_threads, PointsProcessor* next);
+
+  static std::unique_ptr<ChunkedPointCloudWritingPointsProcessor>
+  FromDictionary(const FileWriterFactory& file_writer_factory,
+                 common::LuaParameterDictionary* dictionary,
+                 PointsProcessor* next);
+
+  ~ChunkedPointCloudWritingPointsProcessor() override;
+
+  ChunkedPointCloudWritingPointsProcessor(
+      const ChunkedPointCloudWritingPointsProcessor&) = delete;
+  ChunkedPointCloudWritingPointsProcessor& operator=(
+      const ChunkedPointCloudWritingPointsProcessor&) = delete;
+
+  void Process(std::unique_ptr<PointsBatch> batch) override;
+  FlushResult Flush() override;
+
+ private:
+  using CellIndex = std::tuple<int, int, int>;
+
+  // Hands the points of 'chunk' to the thread pool for compression.
+  void SealChunk(PointCloudChunk* chunk);
+
+  // Writes compressed chunks in the order they were sealed. Blocks until at
+  // most 'max_chunks_in_flight' chunks are waiting to be written.
+  void WriteEncodedChunks(int64 max_chunks_in_flight) LOCKS_EXCLUDED(mutex_);
+
+  PointsProcessor* const next_;
+  const double chunk_size_;
+  const int max_points_per_chunk_;
+  const int max_chunks_in_flight_;
+
+  std::unique_ptr<FileWriter> file_;
+  ChunkedPointCloudHeader header_;
+  std::vector<ChunkIndexEntry> index_;
+  // Write position in 'file_'.
+  uint64 offset_ = kChunkedPointCloudHeaderSize;
+  // Points which have not been sealed into a chunk yet.
+  std::map<CellIndex, PointCloudChunk> open_chunks_;
+
+  absl::Mutex mutex_;
+  int64 num_sealed_chunks_ GUARDED_BY(mutex_) = 0;
+  int64 num_written_chunks_ GUARDED_BY(mutex_) = 0;
+  std::map<int64, std::string> encoded_chunks_ GUARDED_BY(mutex_);
+
+  // Declared last, so that its threads are joined first on destruction.
+  common::ThreadPool thread_pool_;
+};
+
+}  // namespace io
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_IO_CHUNKED_POINT_CLOUD_WRITING_POINTS_PROCESSOR_H_
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/io/chunked_point_cloud_writing_points_processor.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "absl/memory/memory.h"
+#include "cartographer/io/fake_file_writer.h"
+#include "cartographer/io/null_points_processor.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace io {
+namespace {
+
+constexpr int kNumPoints = 1000;
+
+std::unique_ptr<PointsBatch> CreatePointsBatch(const int begin,
+                                               const int end) {
+  auto batch = absl::make_unique<PointsBatch>();
+  for (int i = begin; i < end; ++i) {
+    batch->points.push_back(
+        {Eigen::Vector3f(0.1f * i, -0.05f * i, 0.01f * (i % 7))});
+    batch->colors.push_back({{i % 3 / 2.f, 0.f, 1.f}});
+    batch->intensities.push_back(i);
+  }
+  return batch;
+}
+
+std::string WritePointCloud(const int max_points_per_chunk,
+                            const int num_threads) {
+  auto output = std::make_shared<std::vector<char>>();
+  NullPointsProcessor null_points_processor;
+  ChunkedPointCloudWritingPointsProcessor processor(
+      absl::make_unique<FakeFileWriter>("test.cpc", output),
+      10. /* chunk_size */, max_points_per_chunk, num_threads,
+      &null_points_processor);
+  for (int begin = 0; begin < kNumPoints; begin += 100) {
+    processor.Process(CreatePointsBatch(begin, begin + 100));
+  }
+  EXPECT_EQ(PointsProcessor::FlushResult::kFinished, processor.Flush());
+  return std::string(output->begin(), output->end());
+}
+
+TEST(ChunkedPointCloudWritingPointsProcessorTest, RoundTrip) {
+  std::istringstream stream(WritePointCloud(64, 4));
+  ChunkedPointCloudReader reader(&stream);
+  EXPECT_EQ(kNumPoints, reader.header().num_points);
+  EXPECT_EQ(kChunkedPointCloudHasColors | kChunkedPointCloudHasIntensities,
+            reader.header().flags);
+  EXPECT_EQ(reader.header().num_chunks, reader.index().size());
+
+  const auto expected = CreatePointsBatch(0, kNumPoints);
+  std::vector<bool> seen(kNumPoints, false);
+  for (size_t i = 0; i < reader.index().size(); ++i) {
+    const PointCloudChunk chunk = reader.ReadChunk(i);
+    EXPECT_LE(chunk.positions.size(), 64);
+    ASSERT_EQ(reader.index()[i].num_points, chunk.positions.size());
+    for (size_t j = 0; j < chunk.positions.size(); ++j) {
+      EXPECT_TRUE(
+          reader.index()[i].bounding_box.contains(chunk.positions[j]));
+      const int point_index = static_cast<int>(chunk.intensities[j]);
+      ASSERT_LT(point_index, kNumPoints);
+      EXPECT_FALSE(seen[point_index]);
+      seen[point_index] = true;
+      EXPECT_EQ(expected->points[point_index].position, chunk.positions[j]);
+      EXPECT_EQ(ToUint8Color(expected->colors[point_index]), chunk.colors[j]);
+    }
+  }
+  EXPECT_TRUE(std::all_of(seen.begin(), seen.end(),
+                          [](const bool value) { return value; }));
+}
+
+TEST(ChunkedPointCloudWritingPointsProcessorTest, OutputIsDeterministic) {
+  EXPECT_EQ(WritePointCloud(32, 1), WritePointCloud(32, 8));
+}
+
+TEST(ChunkedPointCloudWritingPointsProcessorTest, FindChunks) {
+  std::istringstream stream(WritePointCloud(1000, 2));
+  ChunkedPointCloudReader reader(&stream);
+  // The points lie on a line, so a small box near its start only touches the
+  // chunk of a single cube.
+  const Eigen::AlignedBox3f region(Eigen::Vector3f(0.5f, -1.f, 0.f),
+                                   Eigen::Vector3f(1.5f, 0.f, 1.f));
+  const std::vector<int> chunk_indices = reader.FindChunks(region);
+  ASSERT_EQ(1, chunk_indices.size());
+  const PointCloudChunk chunk = reader.ReadChunk(chunk_indices.front());
+  EXPECT_LT(chunk.positions.size(), kNumPoints);
+  EXPECT_TRUE(std::any_of(chunk.positions.begin(), chunk.positions.end(),
+                          [&region](const Eigen::Vector3f& position) {
+                            return region.contains(position);
+                          }));
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace cartographer
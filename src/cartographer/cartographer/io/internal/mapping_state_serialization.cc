@@ -82,41 +82,45 @@ SerializedData SerializeTrajectoryBuilderOptions(
   return proto;
 }
 
-void SerializeSubmaps(
-    const MapById<SubmapId, PoseGraphInterface::SubmapData>& submap_data,
-    bool include_unfinished_submaps, ProtoStreamWriterInterface* const writer) {
+// Submaps and nodes are visited one at a time, so that data the pose graph
+// evicted to disk is not loaded all at once.
+void SerializeSubmaps(const mapping::PoseGraph& pose_graph,
+                      bool include_unfinished_submaps,
+                      ProtoStreamWriterInterface* const writer) {
   // Next serialize all submaps.
-  for (const auto& submap_id_data : submap_data) {
-    if (!include_unfinished_submaps &&
-        !submap_id_data.data.submap->insertion_finished()) {
-      continue;
-    }
-    SerializedData proto;
-    auto* const submap_proto = proto.mutable_submap();
-    *submap_proto = submap_id_data.data.submap->ToProto(
-        /*include_probability_grid_data=*/true);
-    submap_proto->mutable_submap_id()->set_trajectory_id(
-        submap_id_data.id.trajectory_id);
-    submap_proto->mutable_submap_id()->set_submap_index(
-        submap_id_data.id.submap_index);
-    writer->WriteProto(proto);
-  }
+  pose_graph.ForEachSubmapData(
+      [include_unfinished_submaps, writer](
+          const SubmapId& submap_id,
+          const PoseGraphInterface::SubmapData& submap_data) {
+        if (!include_unfinished_submaps &&
+            !submap_data.submap->insertion_finished()) {
+          return;
+        }
+        SerializedData proto;
+        auto* const submap_proto = proto.mutable_submap();
+        *submap_proto = submap_data.submap->ToProto(
+            /*include_probability_grid_data=*/true);
+        submap_proto->mutable_submap_id()->set_trajectory_id(
+            submap_id.trajectory_id);
+        submap_proto->mutable_submap_id()->set_submap_index(
+            submap_id.submap_index);
+        writer->WriteProto(proto);
+      });
 }
 
 // 序列化TrajectoryNodes并写入到pbstream文件里
-void SerializeTrajectoryNodes(
-    const MapById<NodeId, TrajectoryNode>& trajectory_nodes,
-    ProtoStreamWriterInterface* const writer) {
-  for (const auto& node_id_data : trajectory_nodes) {
-    SerializedData proto;
-    auto* const node_proto = proto.mutable_node();
-    node_proto->mutable_node_id()->set_trajectory_id(
-        node_id_data.id.trajectory_id);
-    node_proto->mutable_node_id()->set_node_index(node_id_data.id.node_index);
-    *node_proto->mutable_node_data() =
-        ToProto(*node_id_data.data.constant_data);
-    writer->WriteProto(proto);
-  }
+void SerializeTrajectoryNodes(const mapping::PoseGraph& pose_graph,
+                              ProtoStreamWriterInterface* const writer) {
+  pose_graph.ForEachTrajectoryNode(
+      [writer](const NodeId& node_id, const TrajectoryNode& node) {
+        SerializedData proto;
+        auto* const node_proto = proto.mutable_node();
+        node_proto->mutable_node_id()->set_trajectory_id(
+            node_id.trajectory_id);
+        node_proto->mutable_node_id()->set_node_index(node_id.node_index);
+        *node_proto->mutable_node_data() = ToProto(*node.constant_data);
+        writer->WriteProto(proto);
+      });
 }
 
 void SerializeTrajectoryData(
@@ -236,10 +240,9 @@ void WritePbStream(
       GetValidTrajectoryIds(pose_graph.GetTrajectoryStates())));
 
   // 所有的submap
-  SerializeSubmaps(pose_graph.GetAllSubmapData(), include_unfinished_submaps,
-                   writer);
+  SerializeSubmaps(pose_graph, include_unfinished_submaps, writer);
   // 雷达数据, 前端后端的位姿, 时间戳
-  SerializeTrajectoryNodes(pose_graph.GetTrajectoryNodes(), writer);
+  SerializeTrajectoryNodes(pose_graph, writer);
   // fixed_frame_origin_in_map
   SerializeTrajectoryData(pose_graph.GetTrajectoryData(), writer);
 
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/io/parallel_points_processor.h"
+
+#include "absl/memory/memory.h"
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace io {
+
+ParallelPointsProcessor::ParallelPointsProcessor(
+    const int num_threads, const int queue_size,
+    const StageFactory& stage_factory, PointsProcessor* const next)
+    : next_(next),
+      ordering_processor_(this),
+      stage_(stage_factory(&ordering_processor_)),
+      queue_(queue_size) {
+  CHECK_GT(num_threads, 0);
+  CHECK_GT(queue_size, 0);
+  for (int i = 0; i != num_threads; ++i) {
+    threads_.emplace_back([this]() { ProcessQueue(); });
+  }
+}
+
+ParallelPointsProcessor::~ParallelPointsProcessor() {
+  {
+    absl::MutexLock locker(&mutex_);
+    shutting_down_ = true;
+  }
+  // Every nullptr work item stops one background thread.
+  for (size_t i = 0; i != threads_.size(); ++i) {
+    queue_.Push(nullptr);
+  }
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ParallelPointsProcessor::Process(std::unique_ptr<PointsBatch> batch) {
+  auto work_item = absl::make_unique<WorkItem>();
+  {
+    absl::MutexLock locker(&mutex_);
+    work_item->sequence_number = next_sequence_number_++;
+  }
+  work_item->batch = std::move(batch);
+  queue_.Push(std::move(work_item));
+}
+
+PointsProcessor::FlushResult ParallelPointsProcessor::Flush() {
+  {
+    const auto predicate = [this]() EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+      return next_sequence_number_to_pass_on_ == next_sequence_number_;
+    };
+    absl::MutexLock locker(&mutex_);
+    mutex_.Await(absl::Condition(&predicate));
+  }
+  return stage_->Flush();
+}
+
+void ParallelPointsProcessor::ProcessQueue() {
+  for (;;) {
+    std::unique_ptr<WorkItem> work_item = queue_.Pop();
+    if (work_item == nullptr) {
+      return;
+    }
+    bool shutting_down;
+    {
+      absl::MutexLock locker(&mutex_);
+      shutting_down = shutting_down_;
+      sequence_number_by_thread_[std::this_thread::get_id()] =
+          work_item->sequence_number;
+    }
+    if (!shutting_down) {
+      stage_->Process(std::move(work_item->batch));
+    }
+    absl::MutexLock locker(&mutex_);
+    sequence_number_by_thread_.erase(std::this_thread::get_id());
+    finished_sequence_numbers_.insert(work_item->sequence_number);
+    PassOnFinishedOutputs();
+  }
+}
+
+void ParallelPointsProcessor::AddOutput(std::unique_ptr<PointsBatch> batch) {
+  absl::MutexLock locker(&mutex_);
+  const auto it = sequence_number_by_thread_.find(std::this_thread::get_id());
+  CHECK(it != sequence_number_by_thread_.end())
+      << "The stage passed on a batch outside of 'Process'.";
+  outputs_[it->second].push_back(std::move(batch));
+}
+
+void ParallelPointsProcessor::PassOnFinishedOutputs() {
+  // 'next_' is called while holding 'mutex_', which serializes the calls and
+  // keeps them in order.
+  while (finished_sequence_numbers_.count(next_sequence_number_to_pass_on_)) {
+    finished_sequence_numbers_.erase(next_sequence_number_to_pass_on_);
+    const auto it = outputs_.find(next_sequence_number_to_pass_on_);
+    if (it != outputs_.end()) {
+      if (!shutting_down_) {
+        for (std::unique_ptr<PointsBatch>& batch : it->second) {
+          next_->Process(std::move(batch));
+        }
+      }
+      outputs_.erase(it);
+    }
+    ++next_sequence_number_to_pass_on_;
+  }
+}
+
+}  // namespace io
+}  // namespace cartographer
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_IO_PARALLEL_POINTS_PROCESSOR_H_
+#define CARTOGRAPHER_IO_PARALLEL_POINTS_PROCESSOR_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "cartographer/common/internal/blocking_queue.h"
+#include "cartographer/common/port.h"
+#include "cartographer/io/points_processor.h"
+
+namespace cartographer {
+namespace io {
+
+// Runs a stateless stage, i.e. one whose 'Process' may be called concurrently
+// for different batches, on 'num_threads' background threads. The batches the
+// stage passes on are handed to 'next' in the order in which the corresponding
+// input batches were received. At most 'queue_size' input batches are queued,
+// 'Process' blocks once the queue is full.
+class ParallelPointsProcessor : public PointsProcessor {
+ public:
+  // Creates the stage given the processor it has to pass its batches to.
+  using StageFactory =
+      std::function<std::unique_ptr<PointsProcessor>(PointsProcessor* next)>;
+
+  ParallelPointsProcessor(int num_threads, int queue_size,
+                          const StageFactory& stage_factory,
+                          PointsProcessor* next);
+
+  // Batches which have not been handed to the stage yet are dropped.
+  ~ParallelPointsProcessor() override;
+
+  ParallelPointsProcessor(const ParallelPointsProcessor&) = delete;
+  ParallelPointsProcessor& operator=(const ParallelPointsProcessor&) = delete;
+
+  void Process(std::unique_ptr<PointsBatch> batch) override;
+
+  // Waits until all queued batches went through the stage, then flushes the
+  // stage on the calling thread.
+  FlushResult Flush() override;
+
+ private:
+  struct WorkItem {
+    int64 sequence_number;
+    std::unique_ptr<PointsBatch> batch;
+  };
+
+  // Receives the output of the stage and passes it on in order.
+  class OrderingPointsProcessor : public PointsProcessor {
+   public:
+    explicit OrderingPointsProcessor(ParallelPointsProcessor* parent)
+        : parent_(parent) {}
+
+    void Process(std::unique_ptr<PointsBatch> batch) override {
+      parent_->AddOutput(std::move(batch));
+    }
+    FlushResult Flush() override { return parent_->next_->Flush(); }
+
+   private:
+    ParallelPointsProcessor* const parent_;
+  };
+
+  void ProcessQueue();
+  void AddOutput(std::unique_ptr<PointsBatch> batch) LOCKS_EXCLUDED(mutex_);
+
+  // Hands all outputs of finished work items to 'next_' in order.
+  void PassOnFinishedOutputs() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  PointsProcessor* const next_;
+  OrderingPointsProcessor ordering_processor_;
+  std::unique_ptr<PointsProcessor> stage_;
+  common::BlockingQueue<std::unique_ptr<WorkItem>> queue_;
+
+  absl::Mutex mutex_;
+  int64 next_sequence_number_ GUARDED_BY(mutex_) = 0;
+  int64 next_sequence_number_to_pass_on_ GUARDED_BY(mutex_) = 0;
+  // Work item currently processed by each background thread.
+  std::map<std::thread::id, int64> sequence_number_by_thread_
+      GUARDED_BY(mutex_);
+  // Outputs of work items which cannot be passed on yet, because earlier work
+  // items are still being processed.
+  std::map<int64, std::vector<std::unique_ptr<PointsBatch>>> outputs_
+      GUARDED_BY(mutex_);
+  std::set<int64> finished_sequence_numbers_ GUARDED_BY(mutex_);
+  bool shutting_down_ GUARDED_BY(mutex_) = false;
+
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace io
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_IO_PARALLEL_POINTS_PROCESSOR_H_
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/io/parallel_points_processor.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace io {
+namespace {
+
+// Stateless stage which takes a while for some batches, drops batches with
+// a start time divisible by 5 and duplicates those divisible by 3.
+class SlowStatelessPointsProcessor : public PointsProcessor {
+ public:
+  explicit SlowStatelessPointsProcessor(PointsProcessor* next) : next_(next) {}
+
+  void Process(std::unique_ptr<PointsBatch> batch) override {
+    const int64 index = common::ToUniversal(batch->start_time);
+    std::this_thread::sleep_for(std::chrono::microseconds((index * 37) % 200));
+    if (index % 5 == 0) {
+      return;
+    }
+    if (index % 3 == 0) {
+      next_->Process(absl::make_unique<PointsBatch>(*batch));
+    }
+    next_->Process(std::move(batch));
+  }
+
+  FlushResult Flush() override { return next_->Flush(); }
+
+ private:
+  PointsProcessor* const next_;
+};
+
+class RecordingPointsProcessor : public PointsProcessor {
+ public:
+  void Process(std::unique_ptr<PointsBatch> batch) override {
+    indices.push_back(common::ToUniversal(batch->start_time));
+  }
+  FlushResult Flush() override {
+    ++num_flushes;
+    return FlushResult::kFinished;
+  }
+
+  std::vector<int64> indices;
+  int num_flushes = 0;
+};
+
+TEST(ParallelPointsProcessorTest, KeepsOrderOfBatches) {
+  RecordingPointsProcessor recorder;
+  ParallelPointsProcessor processor(
+      4, 8,
+      [](PointsProcessor* const next) {
+        return absl::make_unique<SlowStatelessPointsProcessor>(next);
+      },
+      &recorder);
+  std::vector<int64> expected_indices;
+  for (int64 i = 0; i < 200; ++i) {
+    auto batch = absl::make_unique<PointsBatch>();
+    batch->start_time = common::FromUniversal(i);
+    processor.Process(std::move(batch));
+    if (i % 5 == 0) {
+      continue;
+    }
+    if (i % 3 == 0) {
+      expected_indices.push_back(i);
+    }
+    expected_indices.push_back(i);
+  }
+  EXPECT_EQ(PointsProcessor::FlushResult::kFinished, processor.Flush());
+  EXPECT_EQ(1, recorder.num_flushes);
+  EXPECT_EQ(expected_indices, recorder.indices);
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace cartographer
@@ -17,6 +17,8 @@
 #include "cartographer/io/points_processor_pipeline_builder.h"
 
 #include "absl/memory/memory.h"
+#include "cartographer/io/asynchronous_points_processor.h"
+#include "cartographer/io/chunked_point_cloud_writing_points_processor.h"
 #include "cartographer/io/coloring_points_processor.h"
 #include "cartographer/io/counting_points_processor.h"
 #include "cartographer/io/fixed_ratio_sampling_points_processor.h"
@@ -26,9 +28,11 @@
 #include "cartographer/io/min_max_range_filtering_points_processor.h"
 #include "cartographer/io/null_points_processor.h"
 #include "cartographer/io/outlier_removing_points_processor.h"
+#include "cartographer/io/parallel_points_processor.h"
 #include "cartographer/io/pcd_writing_points_processor.h"
 #include "cartographer/io/ply_writing_points_processor.h"
 #include "cartographer/io/probability_grid_points_processor.h"
+#include "cartographer/io/tile_spilling_points_processor.h"
 #include "cartographer/io/vertical_range_filtering_points_processor.h"
 #include "cartographer/io/xray_points_processor.h"
 #include "cartographer/io/xyz_writing_points_processor.h"
@@ -48,6 +52,17 @@ void RegisterPlainPointsProcessor(
       });
 }
 
+template <typename PointsProcessorType>
+void RegisterStatelessPointsProcessor(
+    PointsProcessorPipelineBuilder* const builder) {
+  builder->RegisterStateless(
+      PointsProcessorType::kConfigurationFileActionName,
+      [](common::LuaParameterDictionary* const dictionary,
+         PointsProcessor* const next) -> std::unique_ptr<PointsProcessor> {
+        return PointsProcessorType::FromDictionary(dictionary, next);
+      });
+}
+
 template <typename PointsProcessorType>
 void RegisterFileWritingPointsProcessor(
     const FileWriterFactory& file_writer_factory,
@@ -77,24 +92,54 @@ void RegisterFileWritingPointsProcessorWithTrajectories(
       });
 }
 
+// Every tile runs through a pipeline of built-in PointsProcessors which write
+// their files through the tile specific 'FileWriterFactory'.
+void RegisterTileSpillingPointsProcessor(
+    const std::vector<mapping::proto::Trajectory>& trajectories,
+    const FileWriterFactory& file_writer_factory,
+    PointsProcessorPipelineBuilder* const builder) {
+  const auto create_tile_pipeline =
+      [&trajectories](common::LuaParameterDictionary* const dictionary,
+                      const FileWriterFactory& tile_file_writer_factory) {
+        PointsProcessorPipelineBuilder tile_builder;
+        RegisterBuiltInPointsProcessors(trajectories, tile_file_writer_factory,
+                                        &tile_builder);
+        return tile_builder.CreatePipeline(dictionary);
+      };
+  builder->Register(
+      TileSpillingPointsProcessor::kConfigurationFileActionName,
+      [create_tile_pipeline, file_writer_factory](
+          common::LuaParameterDictionary* const dictionary,
+          PointsProcessor* const next) -> std::unique_ptr<PointsProcessor> {
+        return TileSpillingPointsProcessor::FromDictionary(
+            create_tile_pipeline, file_writer_factory, dictionary, next);
+      });
+}
+
 void RegisterBuiltInPointsProcessors(
     const std::vector<mapping::proto::Trajectory>& trajectories,
     const FileWriterFactory& file_writer_factory,
     PointsProcessorPipelineBuilder* builder) {
   RegisterPlainPointsProcessor<CountingPointsProcessor>(builder);
   RegisterPlainPointsProcessor<FixedRatioSamplingPointsProcessor>(builder);
-  RegisterPlainPointsProcessor<FrameIdFilteringPointsProcessor>(builder);
-  RegisterPlainPointsProcessor<MinMaxRangeFilteringPointsProcessor>(builder);
-  RegisterPlainPointsProcessor<VerticalRangeFilteringPointsProcessor>(builder);
+  RegisterStatelessPointsProcessor<FrameIdFilteringPointsProcessor>(builder);
+  RegisterStatelessPointsProcessor<MinMaxRangeFilteringPointsProcessor>(
+      builder);
+  RegisterStatelessPointsProcessor<VerticalRangeFilteringPointsProcessor>(
+      builder);
   RegisterPlainPointsProcessor<OutlierRemovingPointsProcessor>(builder);
-  RegisterPlainPointsProcessor<ColoringPointsProcessor>(builder);
-  RegisterPlainPointsProcessor<IntensityToColorPointsProcessor>(builder);
+  RegisterStatelessPointsProcessor<ColoringPointsProcessor>(builder);
+  RegisterStatelessPointsProcessor<IntensityToColorPointsProcessor>(builder);
+  RegisterTileSpillingPointsProcessor(trajectories, file_writer_factory,
+                                      builder);
   RegisterFileWritingPointsProcessor<PcdWritingPointsProcessor>(
       file_writer_factory, builder);
   RegisterFileWritingPointsProcessor<PlyWritingPointsProcessor>(
       file_writer_factory, builder);
   RegisterFileWritingPointsProcessor<XyzWriterPointsProcessor>(
       file_writer_factory, builder);
+  RegisterFileWritingPointsProcessor<ChunkedPointCloudWritingPointsProcessor>(
+      file_writer_factory, builder);
   RegisterFileWritingPointsProcessor<HybridGridPointsProcessor>(
       file_writer_factory, builder);
   RegisterFileWritingPointsProcessorWithTrajectories<XRayPointsProcessor>(
@@ -111,11 +156,25 @@ void PointsProcessorPipelineBuilder::Register(const std::string& name,
   factories_[name] = std::move(factory);
 }
 
+void PointsProcessorPipelineBuilder::RegisterStateless(
+    const std::string& name, FactoryFunction factory) {
+  Register(name, std::move(factory));
+  stateless_processors_.insert(name);
+}
+
 PointsProcessorPipelineBuilder::PointsProcessorPipelineBuilder() {}
 
 std::vector<std::unique_ptr<PointsProcessor>>
 PointsProcessorPipelineBuilder::CreatePipeline(
     common::LuaParameterDictionary* const dictionary) const {
+  return CreatePipeline(dictionary, ExecutionOptions());
+}
+
+std::vector<std::unique_ptr<PointsProcessor>>
+PointsProcessorPipelineBuilder::CreatePipeline(
+    common::LuaParameterDictionary* const dictionary,
+    const ExecutionOptions& execution_options) const {
+  const bool pipelined = execution_options.queue_size > 0;
   std::vector<std::unique_ptr<PointsProcessor>> pipeline;
   // The last consumer in the pipeline must exist, so that the one created after
   // it (and being before it in the pipeline) has a valid 'next' to point to.
@@ -132,7 +191,28 @@ PointsProcessorPipelineBuilder::CreatePipeline(
     CHECK(factory_it != factories_.end())
         << "Unknown action '" << action
         << "'. Did you register the correspoinding PointsProcessor?";
-    pipeline.push_back(factory_it->second(it->get(), pipeline.back().get()));
+    if (!pipelined) {
+      pipeline.push_back(factory_it->second(it->get(), pipeline.back().get()));
+      continue;
+    }
+    // Every stage gets its own thread(s) and an input queue, so that all
+    // stages work on different batches at the same time.
+    if (stateless_processors_.count(action) &&
+        execution_options.num_threads_per_stateless_stage > 1) {
+      common::LuaParameterDictionary* const stage_dictionary = it->get();
+      const FactoryFunction& factory = factory_it->second;
+      pipeline.push_back(absl::make_unique<ParallelPointsProcessor>(
+          execution_options.num_threads_per_stateless_stage,
+          execution_options.queue_size,
+          [stage_dictionary, &factory](PointsProcessor* const next) {
+            return factory(stage_dictionary, next);
+          },
+          pipeline.back().get()));
+    } else {
+      pipeline.push_back(factory_it->second(it->get(), pipeline.back().get()));
+      pipeline.push_back(absl::make_unique<AsynchronousPointsProcessor>(
+          execution_options.queue_size, pipeline.back().get()));
+    }
   }
   return pipeline;
 }
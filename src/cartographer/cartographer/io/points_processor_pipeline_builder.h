@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "cartographer/common/lua_parameter_dictionary.h"
 #include "cartographer/io/file_writer.h"
 #include "cartographer/io/points_processor.h"
@@ -47,15 +48,36 @@ class PointsProcessorPipelineBuilder {
   PointsProcessorPipelineBuilder& operator=(
       const PointsProcessorPipelineBuilder&) = delete;
 
+  // Controls how batches travel through a pipeline. The default runs all
+  // stages synchronously on the thread calling 'Process'.
+  struct ExecutionOptions {
+    // If positive, every stage runs on its own thread and is fed through a
+    // queue holding at most 'queue_size' batches.
+    int queue_size = 0;
+    // Number of threads each stateless stage runs on. Only used if
+    // 'queue_size' is positive.
+    int num_threads_per_stateless_stage = 1;
+  };
+
   // Register a new PointsProcessor type uniquly identified by 'name' which will
   // be created using 'factory'.
   void Register(const std::string& name, FactoryFunction factory);
 
+  // Like 'Register', but for PointsProcessors which keep no state while
+  // processing, so that 'Process' may be called concurrently for different
+  // batches.
+  void RegisterStateless(const std::string& name, FactoryFunction factory);
+
   std::vector<std::unique_ptr<PointsProcessor>> CreatePipeline(
       common::LuaParameterDictionary* dictionary) const;
 
+  std::vector<std::unique_ptr<PointsProcessor>> CreatePipeline(
+      common::LuaParameterDictionary* dictionary,
+      const ExecutionOptions& execution_options) const;
+
  private:
   absl::flat_hash_map<std::string, FactoryFunction> factories_;
+  absl::flat_hash_set<std::string> stateless_processors_;
 };
 
 // Register all 'PointsProcessor' that ship with Cartographer with this
@@ -16,6 +16,9 @@
 
 #include "cartographer/io/submap_painter.h"
 
+#include "absl/memory/memory.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "cartographer/common/task.h"
 #include "cartographer/mapping/2d/submap_2d.h"
 #include "cartographer/mapping/3d/submap_3d.h"
 
@@ -23,6 +26,10 @@ namespace cartographer {
 namespace io {
 namespace {
 
+constexpr int kPaddingPixel = 5;
+// 判断submap_slice与tile是否重叠时, 为双线性插值在边界外多采样的像素留出的余量
+constexpr float kTileOverlapMarginPixel = 2.f;
+
 Eigen::Affine3d ToEigen(const ::cartographer::transform::Rigid3d& rigid3) {
   return Eigen::Translation3d(rigid3.translation()) * rigid3.rotation();
 }
@@ -83,6 +90,102 @@ bool Has3DGrids(const mapping::proto::Submap& submap) {
          submap.submap_3d().has_high_resolution_hybrid_grid();
 }
 
+/**
+ * @brief 计算每个submap_slice在画布坐标系下的bounding_box
+ * 
+ * @param[in] submaps 地图图片
+ * @param[in] resolution 地图分辨率
+ * @return std::vector<Eigen::AlignedBox2f> 按submaps的顺序排列的bounding_box
+ */
+std::vector<Eigen::AlignedBox2f> ComputeSubmapSliceBoundingBoxes(
+    const std::map<::cartographer::mapping::SubmapId, SubmapSlice>& submaps,
+    const double resolution) {
+  std::vector<Eigen::AlignedBox2f> bounding_boxes;
+  // 创建指向contexts的指针
+  auto surface = MakeUniqueCairoSurfacePtr(
+      cairo_image_surface_create(kCairoFormat, 1, 1));
+  // 将上下文与绘制表面绑定
+  auto cr = MakeUniqueCairoPtr(cairo_create(surface.get()));
+
+  const auto update_bounding_box = [&bounding_boxes, &cr](double x, double y) {
+    cairo_user_to_device(cr.get(), &x, &y);
+    bounding_boxes.back().extend(Eigen::Vector2f(x, y));
+  };
+
+  CairoPaintSubmapSlices(
+      1. / resolution, submaps, cr.get(),
+      [&bounding_boxes, &update_bounding_box](const SubmapSlice& submap_slice) {
+        bounding_boxes.emplace_back();
+        update_bounding_box(0, 0);
+        update_bounding_box(submap_slice.width, 0);
+        update_bounding_box(0, submap_slice.height);
+        update_bounding_box(submap_slice.width, submap_slice.height);
+      });
+  return bounding_boxes;
+}
+
+// 为submap_slice的像素数据创建一个新的surface, 使各个线程之间不共享任何cairo对象
+UniqueCairoSurfacePtr MakeSourceSurface(const SubmapSlice& submap_slice) {
+  cairo_surface_t* const source = submap_slice.surface.get();
+  return MakeUniqueCairoSurfacePtr(cairo_image_surface_create_for_data(
+      cairo_image_surface_get_data(source),
+      cairo_image_surface_get_format(source),
+      cairo_image_surface_get_width(source),
+      cairo_image_surface_get_height(source),
+      cairo_image_surface_get_stride(source)));
+}
+
+/**
+ * @brief 在一个tile上绘制与其重叠的submap_slice
+ * 
+ * @param[in] submaps 地图图片
+ * @param[in] bounding_boxes 每个submap_slice的bounding_box
+ * @param[in] resolution 地图分辨率
+ * @param[in] origin 画布左上角在bounding_box坐标系下的位置
+ * @param[in] tile_min tile左上角的像素坐标
+ * @param[in] tile_size tile的宽与高
+ * @param[in] tile_data tile左上角像素在输出画布中的地址
+ * @param[in] stride 输出画布每行的字节数
+ */
+void PaintTile(
+    const std::map<::cartographer::mapping::SubmapId, SubmapSlice>& submaps,
+    const std::vector<Eigen::AlignedBox2f>& bounding_boxes,
+    const double resolution, const Eigen::Array2f& origin,
+    const Eigen::Array2i& tile_min, const Eigen::Array2i& tile_size,
+    unsigned char* const tile_data, const int stride) {
+  // tile直接引用输出画布的内存, 不同的tile之间互不重叠, 因此无需拼接
+  auto surface = MakeUniqueCairoSurfacePtr(cairo_image_surface_create_for_data(
+      tile_data, kCairoFormat, tile_size.x(), tile_size.y(), stride));
+  auto cr = MakeUniqueCairoPtr(cairo_create(surface.get()));
+  cairo_set_source_rgba(cr.get(), 0.5, 0.0, 0.0, 1.);
+  cairo_paint(cr.get());
+  cairo_translate(cr.get(), origin.x() - tile_min.x(),
+                  origin.y() - tile_min.y());
+
+  // tile在bounding_box坐标系下的范围
+  const Eigen::Vector2f tile_box_min =
+      (tile_min.cast<float>() - origin).matrix() -
+      Eigen::Vector2f::Constant(kTileOverlapMarginPixel);
+  const Eigen::Vector2f tile_box_max =
+      ((tile_min + tile_size).cast<float>() - origin).matrix() +
+      Eigen::Vector2f::Constant(kTileOverlapMarginPixel);
+  const Eigen::AlignedBox2f tile_box(tile_box_min, tile_box_max);
+
+  size_t index = 0;
+  CairoPaintSubmapSlices(
+      1. / resolution, submaps, cr.get(),
+      [&](const SubmapSlice& submap_slice) {
+        // 跳过与当前tile不重叠的submap_slice
+        if (!tile_box.intersects(bounding_boxes.at(index++))) {
+          return;
+        }
+        auto source = MakeSourceSurface(submap_slice);
+        cairo_set_source_surface(cr.get(), source.get(), 0., 0.);
+        cairo_paint(cr.get());
+      });
+  cairo_surface_flush(surface.get());
+}
+
 }  // namespace
 
 /**
@@ -95,32 +198,13 @@ bool Has3DGrids(const mapping::proto::Submap& submap) {
 PaintSubmapSlicesResult PaintSubmapSlices(
     const std::map<::cartographer::mapping::SubmapId, SubmapSlice>& submaps,
     const double resolution) {
+  // 确定bounding_box
   Eigen::AlignedBox2f bounding_box;
-
-  {
-    // 创建指向contexts的指针
-    auto surface = MakeUniqueCairoSurfacePtr(
-        cairo_image_surface_create(kCairoFormat, 1, 1));
-    // 将上下文与绘制表面绑定
-    auto cr = MakeUniqueCairoPtr(cairo_create(surface.get()));
-
-    const auto update_bounding_box = [&bounding_box, &cr](double x, double y) {
-      cairo_user_to_device(cr.get(), &x, &y);
-      bounding_box.extend(Eigen::Vector2f(x, y));
-    };
-
-    // 确定bounding_box
-    CairoPaintSubmapSlices(
-        1. / resolution, submaps, cr.get(),
-        [&update_bounding_box](const SubmapSlice& submap_slice) {
-          update_bounding_box(0, 0);
-          update_bounding_box(submap_slice.width, 0);
-          update_bounding_box(0, submap_slice.height);
-          update_bounding_box(submap_slice.width, submap_slice.height);
-        });
+  for (const Eigen::AlignedBox2f& submap_bounding_box :
+       ComputeSubmapSliceBoundingBoxes(submaps, resolution)) {
+    bounding_box.extend(submap_bounding_box);
   }
 
-  const int kPaddingPixel = 5;
   const Eigen::Array2i size(
       std::ceil(bounding_box.sizes().x()) + 2 * kPaddingPixel,
       std::ceil(bounding_box.sizes().y()) + 2 * kPaddingPixel);
@@ -155,6 +239,71 @@ PaintSubmapSlicesResult PaintSubmapSlices(
   return PaintSubmapSlicesResult(std::move(surface), origin);
 }
 
+/**
+ * @brief 将画布分成多个tile, 在线程池中并行地绘制栅格地图的cairo图像
+ * 
+ * @param[in] submaps 地图图片
+ * @param[in] resolution 地图分辨率
+ * @param[in] tile_size tile的边长(像素)
+ * @param[in] thread_pool 用于绘制tile的线程池
+ * @return PaintSubmapSlicesResult 与单线程版本完全相同的结果
+ */
+PaintSubmapSlicesResult PaintSubmapSlices(
+    const std::map<::cartographer::mapping::SubmapId, SubmapSlice>& submaps,
+    const double resolution, const int tile_size,
+    common::ThreadPoolInterface* const thread_pool) {
+  CHECK_GT(tile_size, 0);
+  CHECK(thread_pool != nullptr);
+
+  const std::vector<Eigen::AlignedBox2f> bounding_boxes =
+      ComputeSubmapSliceBoundingBoxes(submaps, resolution);
+  Eigen::AlignedBox2f bounding_box;
+  for (const Eigen::AlignedBox2f& submap_bounding_box : bounding_boxes) {
+    bounding_box.extend(submap_bounding_box);
+  }
+
+  const Eigen::Array2i size(
+      std::ceil(bounding_box.sizes().x()) + 2 * kPaddingPixel,
+      std::ceil(bounding_box.sizes().y()) + 2 * kPaddingPixel);
+  const Eigen::Array2f origin(-bounding_box.min().x() + kPaddingPixel,
+                              -bounding_box.min().y() + kPaddingPixel);
+
+  auto surface = MakeUniqueCairoSurfacePtr(
+      cairo_image_surface_create(kCairoFormat, size.x(), size.y()));
+  CHECK_EQ(cairo_surface_status(surface.get()), CAIRO_STATUS_SUCCESS)
+      << cairo_status_to_string(cairo_surface_status(surface.get()));
+  cairo_surface_flush(surface.get());
+  unsigned char* const data = cairo_image_surface_get_data(surface.get());
+  const int stride = cairo_image_surface_get_stride(surface.get());
+  constexpr int kBytesPerPixel = 4;
+
+  const int num_tiles_x = (size.x() + tile_size - 1) / tile_size;
+  const int num_tiles_y = (size.y() + tile_size - 1) / tile_size;
+  absl::BlockingCounter tiles_remaining(num_tiles_x * num_tiles_y);
+  for (int tile_y = 0; tile_y < num_tiles_y; ++tile_y) {
+    for (int tile_x = 0; tile_x < num_tiles_x; ++tile_x) {
+      const Eigen::Array2i tile_min(tile_x * tile_size, tile_y * tile_size);
+      const Eigen::Array2i tile_max = (tile_min + tile_size).min(size);
+      unsigned char* const tile_data =
+          data + tile_min.y() * stride + tile_min.x() * kBytesPerPixel;
+      auto task = absl::make_unique<common::Task>();
+      task->SetWorkItem([&submaps, &bounding_boxes, resolution, origin,
+                         tile_min, tile_max, tile_data, stride,
+                         &tiles_remaining]() {
+        PaintTile(submaps, bounding_boxes, resolution, origin, tile_min,
+                  tile_max - tile_min, tile_data, stride);
+        tiles_remaining.DecrementCount();
+      });
+      thread_pool->Schedule(std::move(task));
+    }
+  }
+  // 等待所有的tile绘制完成
+  tiles_remaining.Wait();
+  cairo_surface_mark_dirty(surface.get());
+
+  return PaintSubmapSlicesResult(std::move(surface), origin);
+}
+
 void FillSubmapSlice(
     const ::cartographer::transform::Rigid3d& global_submap_pose,
     const ::cartographer::mapping::proto::Submap& proto,
@@ -19,6 +19,7 @@
 
 #include "Eigen/Geometry"
 #include "cairo/cairo.h"
+#include "cartographer/common/thread_pool.h"
 #include "cartographer/io/image.h"
 #include "cartographer/io/proto_stream_deserializer.h"
 #include "cartographer/mapping/id.h"
@@ -83,6 +84,14 @@ PaintSubmapSlicesResult PaintSubmapSlices(
     const std::map<::cartographer::mapping::SubmapId, SubmapSlice>& submaps,
     double resolution);
 
+// Same as above, but splits the output into square tiles of 'tile_size' pixels
+// which are painted in parallel on 'thread_pool'. Every tile only composites
+// the slices overlapping it and writes directly into its part of the output
+// surface. The result is identical to the sequential version.
+PaintSubmapSlicesResult PaintSubmapSlices(
+    const std::map<::cartographer::mapping::SubmapId, SubmapSlice>& submaps,
+    double resolution, int tile_size, common::ThreadPoolInterface* thread_pool);
+
 void FillSubmapSlice(
     const ::cartographer::transform::Rigid3d& global_submap_pose,
     const ::cartographer::mapping::proto::Submap& proto,
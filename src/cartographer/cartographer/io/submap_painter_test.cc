@@ -0,0 +1,87 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/io/submap_painter.h"
+
+#include <cstring>
+
+#include "cartographer/common/thread_pool.h"
+#include "cartographer/transform/transform.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace io {
+namespace {
+
+void FillTestSubmapSlice(const transform::Rigid3d& pose, const int width,
+                         const int height, const int seed,
+                         SubmapSlice* const submap_slice) {
+  std::vector<char> intensity;
+  std::vector<char> alpha;
+  for (int i = 0; i < width * height; ++i) {
+    intensity.push_back(static_cast<char>((i * 7 + seed) % 256));
+    alpha.push_back(static_cast<char>((i * 13 + seed) % 256));
+  }
+  submap_slice->width = width;
+  submap_slice->height = height;
+  submap_slice->version = 1;
+  submap_slice->resolution = 0.05;
+  submap_slice->slice_pose = transform::Rigid3d::Identity();
+  submap_slice->pose = pose;
+  submap_slice->surface = DrawTexture(intensity, alpha, width, height,
+                                      &submap_slice->cairo_data);
+}
+
+std::vector<unsigned char> GetPixelData(cairo_surface_t* const surface) {
+  cairo_surface_flush(surface);
+  const unsigned char* const data = cairo_image_surface_get_data(surface);
+  const int size = cairo_image_surface_get_stride(surface) *
+                   cairo_image_surface_get_height(surface);
+  return std::vector<unsigned char>(data, data + size);
+}
+
+TEST(SubmapPainterTest, TiledPaintingMatchesSequentialPainting) {
+  std::map<mapping::SubmapId, SubmapSlice> submap_slices;
+  FillTestSubmapSlice(transform::Rigid3d::Identity(), 40, 30, 1,
+                      &submap_slices[mapping::SubmapId{0, 0}]);
+  FillTestSubmapSlice(
+      transform::Rigid3d(Eigen::Vector3d(1.2, -0.3, 0.),
+                         transform::RollPitchYaw(0., 0., 0.4)),
+      50, 20, 2, &submap_slices[mapping::SubmapId{0, 1}]);
+  FillTestSubmapSlice(
+      transform::Rigid3d(Eigen::Vector3d(-0.7, 2.1, 0.),
+                         transform::RollPitchYaw(0., 0., -1.3)),
+      25, 45, 3, &submap_slices[mapping::SubmapId{1, 0}]);
+
+  const double resolution = 0.03;
+  const auto expected = PaintSubmapSlices(submap_slices, resolution);
+  common::ThreadPool thread_pool(3);
+  for (const int tile_size : {1, 7, 16, 1000}) {
+    const auto actual =
+        PaintSubmapSlices(submap_slices, resolution, tile_size, &thread_pool);
+    EXPECT_TRUE(expected.origin.isApprox(actual.origin));
+    EXPECT_EQ(cairo_image_surface_get_width(expected.surface.get()),
+              cairo_image_surface_get_width(actual.surface.get()));
+    EXPECT_EQ(cairo_image_surface_get_height(expected.surface.get()),
+              cairo_image_surface_get_height(actual.surface.get()));
+    EXPECT_EQ(GetPixelData(expected.surface.get()),
+              GetPixelData(actual.surface.get()));
+  }
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace cartographer
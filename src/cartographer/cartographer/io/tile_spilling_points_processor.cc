@@ -0,0 +1,343 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/io/tile_spilling_points_processor.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace io {
+
+namespace {
+
+// Every fragment of a tile is stored as its size in bytes followed by:
+// start_time, origin, trajectory_id, frame_id, number of points, flags for the
+// presence of intensities and colors, positions, intensities and colors.
+template <typename T>
+void Append(const T& value, std::string* const buffer) {
+  buffer->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T Consume(const char** const cursor) {
+  T value;
+  std::memcpy(&value, *cursor, sizeof(T));
+  *cursor += sizeof(T);
+  return value;
+}
+
+void AppendFragment(const PointsBatch& fragment, std::string* const buffer) {
+  const size_t size_offset = buffer->size();
+  Append<uint32>(0, buffer);
+  Append<int64>(common::ToUniversal(fragment.start_time), buffer);
+  for (int i = 0; i < 3; ++i) {
+    Append<float>(fragment.origin[i], buffer);
+  }
+  Append<int32>(fragment.trajectory_id, buffer);
+  Append<uint32>(fragment.frame_id.size(), buffer);
+  buffer->append(fragment.frame_id);
+  Append<uint32>(fragment.points.size(), buffer);
+  Append<uint8>(!fragment.intensities.empty(), buffer);
+  Append<uint8>(!fragment.colors.empty(), buffer);
+  for (const sensor::RangefinderPoint& point : fragment.points) {
+    for (int i = 0; i < 3; ++i) {
+      Append<float>(point.position[i], buffer);
+    }
+  }
+  for (const float intensity : fragment.intensities) {
+    Append<float>(intensity, buffer);
+  }
+  for (const FloatColor& color : fragment.colors) {
+    for (const float channel : color) {
+      Append<float>(channel, buffer);
+    }
+  }
+  const uint32 size = buffer->size() - size_offset - sizeof(uint32);
+  std::memcpy(&(*buffer)[size_offset], &size, sizeof(uint32));
+}
+
+// Parses the fragment payload starting at 'cursor', i.e. without its size.
+std::unique_ptr<PointsBatch> ParseFragment(const char* cursor) {
+  auto fragment = absl::make_unique<PointsBatch>();
+  fragment->start_time = common::FromUniversal(Consume<int64>(&cursor));
+  for (int i = 0; i < 3; ++i) {
+    fragment->origin[i] = Consume<float>(&cursor);
+  }
+  fragment->trajectory_id = Consume<int32>(&cursor);
+  const uint32 frame_id_size = Consume<uint32>(&cursor);
+  fragment->frame_id.assign(cursor, frame_id_size);
+  cursor += frame_id_size;
+  const uint32 num_points = Consume<uint32>(&cursor);
+  const bool has_intensities = Consume<uint8>(&cursor);
+  const bool has_colors = Consume<uint8>(&cursor);
+  fragment->points.reserve(num_points);
+  for (uint32 i = 0; i < num_points; ++i) {
+    sensor::RangefinderPoint point;
+    for (int j = 0; j < 3; ++j) {
+      point.position[j] = Consume<float>(&cursor);
+    }
+    fragment->points.push_back(point);
+  }
+  if (has_intensities) {
+    fragment->intensities.reserve(num_points);
+    for (uint32 i = 0; i < num_points; ++i) {
+      fragment->intensities.push_back(Consume<float>(&cursor));
+    }
+  }
+  if (has_colors) {
+    fragment->colors.reserve(num_points);
+    for (uint32 i = 0; i < num_points; ++i) {
+      FloatColor color;
+      for (float& channel : color) {
+        channel = Consume<float>(&cursor);
+      }
+      fragment->colors.push_back(color);
+    }
+  }
+  return fragment;
+}
+
+// Inserts 'suffix' before the extension of the last component of 'filename'.
+std::string InsertBeforeExtension(const std::string& filename,
+                                  const std::string& suffix) {
+  const size_t basename_start = filename.find_last_of('/') == std::string::npos
+                                    ? 0
+                                    : filename.find_last_of('/') + 1;
+  const size_t extension_start = filename.find_last_of('.');
+  if (extension_start == std::string::npos ||
+      extension_start <= basename_start) {
+    return filename + suffix;
+  }
+  std::string result = filename;
+  result.insert(extension_start, suffix);
+  return result;
+}
+
+}  // namespace
+
+std::unique_ptr<TileSpillingPointsProcessor>
+TileSpillingPointsProcessor::FromDictionary(
+    const std::function<std::vector<std::unique_ptr<PointsProcessor>>(
+        common::LuaParameterDictionary* dictionary,
+        const FileWriterFactory& file_writer_factory)>& create_pipeline,
+    const FileWriterFactory& file_writer_factory,
+    common::LuaParameterDictionary* const dictionary,
+    PointsProcessor* const next) {
+  const double tile_size = dictionary->GetDouble("tile_size");
+  CHECK_GT(tile_size, 0.);
+  const int64 max_memory_bytes =
+      static_cast<int64>(dictionary->GetNonNegativeInt("max_memory_mb")) *
+      1024 * 1024;
+  // The tile pipeline is created again for every tile, so its configuration
+  // has to outlive this call.
+  const std::shared_ptr<common::LuaParameterDictionary> tile_pipeline =
+      dictionary->GetDictionary("tile_pipeline");
+  return absl::make_unique<TileSpillingPointsProcessor>(
+      tile_size, max_memory_bytes, dictionary->GetString("spill_directory"),
+      [create_pipeline, tile_pipeline](
+          const FileWriterFactory& tile_file_writer_factory) {
+        return create_pipeline(tile_pipeline.get(), tile_file_writer_factory);
+      },
+      file_writer_factory, next);
+}
+
+TileSpillingPointsProcessor::TileSpillingPointsProcessor(
+    const double tile_size, const int64 max_memory_bytes,
+    const std::string& spill_directory,
+    TilePipelineFactory tile_pipeline_factory,
+    FileWriterFactory file_writer_factory, PointsProcessor* const next)
+    : tile_size_(tile_size),
+      max_memory_bytes_(max_memory_bytes),
+      spill_directory_(spill_directory),
+      tile_pipeline_factory_(std::move(tile_pipeline_factory)),
+      file_writer_factory_(std::move(file_writer_factory)),
+      next_(next) {}
+
+TileSpillingPointsProcessor::~TileSpillingPointsProcessor() {
+  RemoveSpillFiles();
+}
+
+void TileSpillingPointsProcessor::Process(std::unique_ptr<PointsBatch> batch) {
+  // Split the batch into one fragment per tile, keeping the order of points.
+  std::map<TileIndex, std::unique_ptr<PointsBatch>> fragments;
+  for (size_t i = 0; i < batch->points.size(); ++i) {
+    std::unique_ptr<PointsBatch>& fragment =
+        fragments[GetTileIndex(batch->points[i].position)];
+    if (fragment == nullptr) {
+      fragment = absl::make_unique<PointsBatch>();
+      fragment->start_time = batch->start_time;
+      fragment->origin = batch->origin;
+      fragment->frame_id = batch->frame_id;
+      fragment->trajectory_id = batch->trajectory_id;
+    }
+    fragment->points.push_back(batch->points[i]);
+    if (!batch->intensities.empty()) {
+      fragment->intensities.push_back(batch->intensities[i]);
+    }
+    if (!batch->colors.empty()) {
+      fragment->colors.push_back(batch->colors[i]);
+    }
+  }
+
+  for (const auto& entry : fragments) {
+    std::string* const buffer = &buffers_[entry.first];
+    const size_t size_before = buffer->size();
+    AppendFragment(*entry.second, buffer);
+    num_buffered_bytes_ += buffer->size() - size_before;
+  }
+  if (num_buffered_bytes_ > max_memory_bytes_) {
+    // Spill down to half the budget so that we do not spill on every batch.
+    SpillLargestTiles(max_memory_bytes_ / 2);
+  }
+}
+
+PointsProcessor::FlushResult TileSpillingPointsProcessor::Flush() {
+  std::set<TileIndex> tiles = spilled_tiles_;
+  for (const auto& entry : buffers_) {
+    tiles.insert(entry.first);
+  }
+  LOG(INFO) << "Processing " << tiles.size() << " tiles, "
+            << spilled_tiles_.size() << " of which were spilled to disk.";
+  for (const TileIndex& tile_index : tiles) {
+    ProcessTile(tile_index);
+  }
+  RemoveSpillFiles();
+  buffers_.clear();
+  num_buffered_bytes_ = 0;
+
+  switch (next_->Flush()) {
+    case FlushResult::kRestartStream:
+      LOG(FATAL) << "Processors after '" << kConfigurationFileActionName
+                 << "' receive no points and must not ask for more passes. "
+                    "Move them into 'tile_pipeline'.";
+      break;
+
+    case FlushResult::kFinished:
+      return FlushResult::kFinished;
+  }
+  LOG(FATAL) << "Failed to receive FlushResult::kFinished";
+  // The following unreachable return statement is needed to avoid a GCC bug
+  // described at https://gcc.gnu.org/bugzilla/show_bug.cgi?id=81508
+  return FlushResult::kFinished;
+}
+
+TileSpillingPointsProcessor::TileIndex
+TileSpillingPointsProcessor::GetTileIndex(
+    const Eigen::Vector3f& position) const {
+  return TileIndex(std::floor(position.x() / tile_size_),
+                   std::floor(position.y() / tile_size_));
+}
+
+std::string TileSpillingPointsProcessor::GetTileFilename(
+    const TileIndex& tile_index) const {
+  return absl::StrCat(spill_directory_, "/tile_", tile_index.first, "_",
+                      tile_index.second, ".points");
+}
+
+void TileSpillingPointsProcessor::SpillTile(const TileIndex& tile_index) {
+  auto it = buffers_.find(tile_index);
+  if (it == buffers_.end() || it->second.empty()) {
+    return;
+  }
+  const std::string filename = GetTileFilename(tile_index);
+  // The first spill of a tile truncates leftovers of earlier runs.
+  const auto mode = spilled_tiles_.count(tile_index) != 0
+                        ? std::ios::out | std::ios::binary | std::ios::app
+                        : std::ios::out | std::ios::binary | std::ios::trunc;
+  std::ofstream stream(filename, mode);
+  stream.write(it->second.data(), it->second.size());
+  stream.close();
+  CHECK(stream) << "Could not spill tile to '" << filename << "'.";
+  spilled_tiles_.insert(tile_index);
+  num_buffered_bytes_ -= it->second.size();
+  buffers_.erase(it);
+}
+
+void TileSpillingPointsProcessor::SpillLargestTiles(
+    const int64 max_num_bytes) {
+  std::multimap<size_t, TileIndex, std::greater<size_t>> tiles_by_size;
+  for (const auto& entry : buffers_) {
+    tiles_by_size.emplace(entry.second.size(), entry.first);
+  }
+  for (const auto& entry : tiles_by_size) {
+    if (num_buffered_bytes_ <= max_num_bytes) {
+      break;
+    }
+    SpillTile(entry.second);
+  }
+}
+
+void TileSpillingPointsProcessor::ProcessTile(const TileIndex& tile_index) {
+  const std::string suffix =
+      absl::StrCat("_tile_", tile_index.first, "_", tile_index.second);
+  const FileWriterFactory& file_writer_factory = file_writer_factory_;
+  const std::vector<std::unique_ptr<PointsProcessor>> pipeline =
+      tile_pipeline_factory_(
+          [&file_writer_factory, &suffix](const std::string& filename) {
+            return file_writer_factory(InsertBeforeExtension(filename, suffix));
+          });
+  CHECK(!pipeline.empty());
+  // Passes requested by the tile pipeline only replay this tile.
+  do {
+    ReplayTile(tile_index, pipeline.back().get());
+  } while (pipeline.back()->Flush() == FlushResult::kRestartStream);
+}
+
+void TileSpillingPointsProcessor::ReplayTile(
+    const TileIndex& tile_index, PointsProcessor* const processor) {
+  // Points on disk were received before the ones still in memory.
+  if (spilled_tiles_.count(tile_index) != 0) {
+    const std::string filename = GetTileFilename(tile_index);
+    std::ifstream stream(filename, std::ios::in | std::ios::binary);
+    CHECK(stream) << "Could not open spilled tile '" << filename << "'.";
+    std::string payload;
+    uint32 size;
+    while (stream.read(reinterpret_cast<char*>(&size), sizeof(size))) {
+      payload.resize(size);
+      CHECK(stream.read(&payload[0], size))
+          << "Spilled tile '" << filename << "' is truncated.";
+      processor->Process(ParseFragment(payload.data()));
+    }
+  }
+  const auto it = buffers_.find(tile_index);
+  if (it != buffers_.end()) {
+    const char* cursor = it->second.data();
+    const char* const end = cursor + it->second.size();
+    while (cursor < end) {
+      const uint32 size = Consume<uint32>(&cursor);
+      processor->Process(ParseFragment(cursor));
+      cursor += size;
+    }
+  }
+}
+
+void TileSpillingPointsProcessor::RemoveSpillFiles() {
+  for (const TileIndex& tile_index : spilled_tiles_) {
+    std::remove(GetTileFilename(tile_index).c_str());
+  }
+  spilled_tiles_.clear();
+}
+
+}  // namespace io
+}  // namespace cartographer
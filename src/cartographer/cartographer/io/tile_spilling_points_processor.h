@@ -0,0 +1,126 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_IO_TILE_SPILLING_POINTS_PROCESSOR_H_
+#define CARTOGRAPHER_IO_TILE_SPILLING_POINTS_PROCESSOR_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cartographer/common/lua_parameter_dictionary.h"
+#include "cartographer/common/port.h"
+#include "cartographer/io/file_writer.h"
+#include "cartographer/io/points_processor.h"
+
+namespace cartographer {
+namespace io {
+
+// Out-of-core stage for exports which do not fit into memory. Points are
+// bucketed into square tiles of 'tile_size' meters in the x-y plane. At most
+// 'max_memory_mb' of points are kept in memory, the largest tiles are spilled
+// to files in 'spill_directory' once this budget is exceeded.
+//
+// On 'Flush' every tile runs through its own instance of the processors in
+// 'tile_pipeline', one tile at a time: the pipeline is created, fed the points
+// of the tile in the order they were received, flushed and destroyed before
+// the next tile starts. Aggregating processors like 'write_probability_grid'
+// thus only ever hold one tile and write one file per tile, with '_tile_X_Y'
+// inserted before the extension of every filename. Passes requested by these
+// processors are served from the tile instead of restarting the stream.
+// Processors which look at neighboring points, e.g. outlier removal, do not
+// see points across tile borders.
+//
+// Processors after this one in the main pipeline receive no points.
+class TileSpillingPointsProcessor : public PointsProcessor {
+ public:
+  constexpr static const char* kConfigurationFileActionName = "spill_to_tiles";
+
+  // Creates the processors of a tile pipeline writing through
+  // 'file_writer_factory'. The last processor is the head of the pipeline.
+  using TilePipelineFactory =
+      std::function<std::vector<std::unique_ptr<PointsProcessor>>(
+          const FileWriterFactory& file_writer_factory)>;
+
+  TileSpillingPointsProcessor(double tile_size, int64 max_memory_bytes,
+                              const std::string& spill_directory,
+                              TilePipelineFactory tile_pipeline_factory,
+                              FileWriterFactory file_writer_factory,
+                              PointsProcessor* next);
+
+  // 'create_pipeline' builds a pipeline from the 'tile_pipeline' dictionary.
+  static std::unique_ptr<TileSpillingPointsProcessor> FromDictionary(
+      const std::function<std::vector<std::unique_ptr<PointsProcessor>>(
+          common::LuaParameterDictionary* dictionary,
+          const FileWriterFactory& file_writer_factory)>& create_pipeline,
+      const FileWriterFactory& file_writer_factory,
+      common::LuaParameterDictionary* dictionary, PointsProcessor* next);
+
+  ~TileSpillingPointsProcessor() override;
+
+  TileSpillingPointsProcessor(const TileSpillingPointsProcessor&) = delete;
+  TileSpillingPointsProcessor& operator=(const TileSpillingPointsProcessor&) =
+      delete;
+
+  void Process(std::unique_ptr<PointsBatch> batch) override;
+  FlushResult Flush() override;
+
+  // Number of bytes of points currently held in memory.
+  int64 num_buffered_bytes() const { return num_buffered_bytes_; }
+
+ private:
+  using TileIndex = std::pair<int, int>;
+
+  TileIndex GetTileIndex(const Eigen::Vector3f& position) const;
+  std::string GetTileFilename(const TileIndex& tile_index) const;
+
+  // Appends the in-memory points of 'tile_index' to its file on disk.
+  void SpillTile(const TileIndex& tile_index);
+
+  // Spills the largest tiles until at most 'max_num_bytes' remain in memory.
+  void SpillLargestTiles(int64 max_num_bytes);
+
+  // Hands all points of 'tile_index' to 'processor' in the order they were
+  // received.
+  void ReplayTile(const TileIndex& tile_index, PointsProcessor* processor);
+
+  // Runs all points of 'tile_index' through a new tile pipeline.
+  void ProcessTile(const TileIndex& tile_index);
+
+  void RemoveSpillFiles();
+
+  const double tile_size_;
+  const int64 max_memory_bytes_;
+  const std::string spill_directory_;
+  const TilePipelineFactory tile_pipeline_factory_;
+  const FileWriterFactory file_writer_factory_;
+  PointsProcessor* const next_;
+
+  // Serialized points of each tile which have not been spilled yet.
+  std::map<TileIndex, std::string> buffers_;
+  // Tiles which have a file in 'spill_directory_'.
+  std::set<TileIndex> spilled_tiles_;
+  int64 num_buffered_bytes_ = 0;
+};
+
+}  // namespace io
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_IO_TILE_SPILLING_POINTS_PROCESSOR_H_
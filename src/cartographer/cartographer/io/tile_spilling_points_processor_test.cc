@@ -0,0 +1,178 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/io/tile_spilling_points_processor.h"
+
+#include <cmath>
+#include <deque>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "cartographer/io/fake_file_writer.h"
+#include "cartographer/io/null_points_processor.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace io {
+namespace {
+
+// Points and passes one tile pipeline has seen.
+struct TileRecord {
+  std::string filename;
+  std::vector<std::vector<std::unique_ptr<PointsBatch>>> passes =
+      std::vector<std::vector<std::unique_ptr<PointsBatch>>>(1);
+};
+
+// Records all points it receives into 'record' and asks for 'num_passes'
+// passes. At most one instance may exist at a time.
+class RecordingPointsProcessor : public PointsProcessor {
+ public:
+  RecordingPointsProcessor(const int num_passes,
+                           const FileWriterFactory& file_writer_factory,
+                           TileRecord* const record, int* const num_instances)
+      : num_passes_(num_passes),
+        record_(record),
+        num_instances_(num_instances) {
+    ++*num_instances_;
+    EXPECT_EQ(1, *num_instances_);
+    record_->filename = file_writer_factory("out/points.ply")->GetFilename();
+  }
+
+  ~RecordingPointsProcessor() override { --*num_instances_; }
+
+  void Process(std::unique_ptr<PointsBatch> batch) override {
+    record_->passes.back().push_back(std::move(batch));
+  }
+
+  FlushResult Flush() override {
+    if (static_cast<int>(record_->passes.size()) < num_passes_) {
+      record_->passes.emplace_back();
+      return FlushResult::kRestartStream;
+    }
+    return FlushResult::kFinished;
+  }
+
+ private:
+  const int num_passes_;
+  TileRecord* const record_;
+  int* const num_instances_;
+};
+
+std::unique_ptr<PointsBatch> CreatePointsBatch(const int index) {
+  auto batch = absl::make_unique<PointsBatch>();
+  batch->start_time = common::FromUniversal(index);
+  batch->origin = Eigen::Vector3f(index, 0.f, 1.f);
+  batch->frame_id = "frame";
+  batch->trajectory_id = index % 2;
+  for (int i = 0; i < 10; ++i) {
+    batch->points.push_back({Eigen::Vector3f(i * 3.f, index * 2.f, i)});
+    batch->intensities.push_back(index * 100 + i);
+  }
+  return batch;
+}
+
+std::pair<int, int> GetTile(const Eigen::Vector3f& position) {
+  return std::pair<int, int>(std::floor(position.x() / 10.),
+                             std::floor(position.y() / 10.));
+}
+
+class TileSpillingPointsProcessorTest : public ::testing::Test {
+ protected:
+  void RunPipeline(const int64 max_memory_bytes, const int num_passes) {
+    NullPointsProcessor null_points_processor;
+    TileSpillingPointsProcessor processor(
+        10., max_memory_bytes, ::testing::TempDir(),
+        [this, num_passes](const FileWriterFactory& file_writer_factory) {
+          records_.emplace_back();
+          std::vector<std::unique_ptr<PointsProcessor>> pipeline;
+          pipeline.push_back(absl::make_unique<RecordingPointsProcessor>(
+              num_passes, file_writer_factory, &records_.back(),
+              &num_instances_));
+          return pipeline;
+        },
+        [](const std::string& filename) {
+          return absl::make_unique<FakeFileWriter>(
+              filename, std::make_shared<std::vector<char>>());
+        },
+        &null_points_processor);
+    for (int i = 0; i < kNumBatches; ++i) {
+      processor.Process(CreatePointsBatch(i));
+      EXPECT_LE(processor.num_buffered_bytes(), max_memory_bytes);
+    }
+    EXPECT_EQ(PointsProcessor::FlushResult::kFinished, processor.Flush());
+    EXPECT_EQ(0, num_instances_);
+  }
+
+  // Checks that every tile pipeline saw all points of exactly one tile in
+  // every pass, in the order they were received, and wrote its own file.
+  void ExpectEveryTileProcessedSeparately(const int num_passes) {
+    std::set<std::pair<int, int>> tiles;
+    int num_points = 0;
+    for (const TileRecord& record : records_) {
+      ASSERT_EQ(num_passes, record.passes.size());
+      ASSERT_FALSE(record.passes.front().empty());
+      const std::pair<int, int> tile =
+          GetTile(record.passes.front().front()->points.front().position);
+      EXPECT_TRUE(tiles.insert(tile).second);
+      EXPECT_EQ(absl::StrCat("out/points_tile_", tile.first, "_", tile.second,
+                             ".ply"),
+                record.filename);
+      for (const auto& batches : record.passes) {
+        EXPECT_EQ(record.passes.front().size(), batches.size());
+        int last_index = -1;
+        for (const auto& batch : batches) {
+          ASSERT_EQ(batch->points.size(), batch->intensities.size());
+          EXPECT_EQ("frame", batch->frame_id);
+          const int index = common::ToUniversal(batch->start_time);
+          EXPECT_LT(last_index, index);
+          last_index = index;
+          EXPECT_EQ(index % 2, batch->trajectory_id);
+          EXPECT_EQ(Eigen::Vector3f(index, 0.f, 1.f), batch->origin);
+          for (size_t i = 0; i < batch->points.size(); ++i) {
+            const Eigen::Vector3f& position = batch->points[i].position;
+            EXPECT_EQ(tile, GetTile(position));
+            EXPECT_EQ(index * 100 + position.z(), batch->intensities[i]);
+          }
+          if (&batches == &record.passes.front()) {
+            num_points += batch->points.size();
+          }
+        }
+      }
+    }
+    EXPECT_EQ(kNumBatches * 10, num_points);
+  }
+
+  static constexpr int kNumBatches = 50;
+  std::deque<TileRecord> records_;
+  int num_instances_ = 0;
+};
+
+TEST_F(TileSpillingPointsProcessorTest, ProcessesTilesFromMemory) {
+  RunPipeline(1 << 30, 1);
+  ExpectEveryTileProcessedSeparately(1);
+}
+
+TEST_F(TileSpillingPointsProcessorTest, ReplaysSpilledTileForEveryPass) {
+  RunPipeline(1000, 3);
+  ExpectEveryTileProcessedSeparately(3);
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace cartographer
@@ -15,9 +15,11 @@
  */
 #include "cartographer/mapping/2d/probability_grid.h"
 
+#include <algorithm>
 #include <limits>
 
 #include "absl/memory/memory.h"
+#include "cartographer/common/math.h"
 #include "cartographer/mapping/probability_values.h"
 #include "cartographer/mapping/submaps.h"
 
@@ -102,6 +104,31 @@ float ProbabilityGrid::GetProbability(const Eigen::Array2i& cell_index) const {
       correspondence_cost_cells()[ToFlatIndex(cell_index)]));
 }
 
+void ProbabilityGrid::GetProbabilitiesOfRow(const Eigen::Array2i& cell_index,
+                                            const int num_cells,
+                                            float* const probabilities) const {
+  const CellLimits& cell_limits = limits().cell_limits();
+  // Cells outside of the grid have the minimum probability.
+  int begin = num_cells;
+  int end = num_cells;
+  if (cell_index.y() >= 0 && cell_index.y() < cell_limits.num_y_cells) {
+    begin = common::Clamp(-cell_index.x(), 0, num_cells);
+    end = common::Clamp(cell_limits.num_x_cells - cell_index.x(), begin,
+                        num_cells);
+  }
+  std::fill(probabilities, probabilities + begin, kMinProbability);
+  if (begin < end) {
+    const uint16* const cells =
+        correspondence_cost_cells().data() +
+        cell_limits.num_x_cells * cell_index.y() + cell_index.x();
+    for (int i = begin; i < end; ++i) {
+      probabilities[i] =
+          CorrespondenceCostToProbability(ValueToCorrespondenceCost(cells[i]));
+    }
+  }
+  std::fill(probabilities + end, probabilities + num_cells, kMinProbability);
+}
+
 proto::Grid2D ProbabilityGrid::ToProto() const {
   proto::Grid2D result;
   result = Grid2D::ToProto();
@@ -55,6 +55,12 @@ class ProbabilityGrid : public Grid2D {
   // Returns the probability of the cell with 'cell_index'.
   float GetProbability(const Eigen::Array2i& cell_index) const;
 
+  // Writes the probabilities of the 'num_cells' cells starting at 'cell_index'
+  // in x direction to 'probabilities'. This gives the same result as calling
+  // GetProbability() for each cell, but reads the row of cells at once.
+  void GetProbabilitiesOfRow(const Eigen::Array2i& cell_index, int num_cells,
+                             float* probabilities) const;
+
   proto::Grid2D ToProto() const override;
   std::unique_ptr<Grid2D> ComputeCroppedGrid() const override;
   bool DrawToSubmapTexture(
@@ -148,6 +148,29 @@ TEST(ProbabilityGridTest, GetProbability) {
   }
 }
 
+TEST(ProbabilityGridTest, GetProbabilitiesOfRow) {
+  ValueConversionTables conversion_tables;
+  ProbabilityGrid probability_grid(
+      MapLimits(1., Eigen::Vector2d(1., 2.), CellLimits(3, 3)),
+      &conversion_tables);
+  probability_grid.SetProbability(Array2i(0, 1), 0.3f);
+  probability_grid.SetProbability(Array2i(2, 1), kMaxProbability);
+  probability_grid.SetProbability(Array2i(1, 2), 0.6f);
+
+  constexpr int kNumCells = 7;
+  for (int y = -1; y <= 3; ++y) {
+    for (int x = -5; x <= 3; ++x) {
+      std::vector<float> probabilities(kNumCells, -1.f);
+      probability_grid.GetProbabilitiesOfRow(Array2i(x, y), kNumCells,
+                                             probabilities.data());
+      for (int i = 0; i < kNumCells; ++i) {
+        EXPECT_EQ(probability_grid.GetProbability(Array2i(x + i, y)),
+                  probabilities[i]);
+      }
+    }
+  }
+}
+
 TEST(ProbabilityGridTest, GetCellIndex) {
   ValueConversionTables conversion_tables;
   ProbabilityGrid probability_grid(
@@ -33,6 +33,7 @@
 #include "cartographer/sensor/range_data.h"
 #include "cartographer/transform/rigid_transform.h"
 #include "cartographer/transform/transform.h"
+#include "glog/logging.h"
 
 namespace cartographer {
 namespace mapping {
@@ -54,10 +55,18 @@ class Submap3D : public Submap {
   void ToResponseProto(const transform::Rigid3d& global_submap_pose,
                        proto::SubmapQuery::Response* response) const override;
 
+  // False for submaps built from a proto without grid data, e.g. those the
+  // pose graph moved out of memory. Their grids must not be accessed.
+  bool has_hybrid_grids() const {
+    return high_resolution_hybrid_grid_ != nullptr &&
+           low_resolution_hybrid_grid_ != nullptr;
+  }
   const HybridGrid& high_resolution_hybrid_grid() const {
+    CHECK(high_resolution_hybrid_grid_ != nullptr);
     return *high_resolution_hybrid_grid_;
   }
   const HybridGrid& low_resolution_hybrid_grid() const {
+    CHECK(low_resolution_hybrid_grid_ != nullptr);
     return *low_resolution_hybrid_grid_;
   }
   const IntensityHybridGrid& high_resolution_intensity_hybrid_grid() const {
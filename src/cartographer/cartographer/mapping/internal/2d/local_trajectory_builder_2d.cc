@@ -21,6 +21,7 @@
 
 #include "absl/memory/memory.h"
 #include "cartographer/metrics/family_factory.h"
+#include "cartographer/metrics/stage_timer.h"
 #include "cartographer/sensor/range_data.h"
 
 namespace cartographer {
@@ -65,6 +66,7 @@ sensor::RangeData
 LocalTrajectoryBuilder2D::TransformToGravityAlignedFrameAndFilter(
     const transform::Rigid3f& transform_to_gravity_aligned_frame,
     const sensor::RangeData& range_data) const {
+  metrics::ScopedStageTimer timer(metrics::Stage::kVoxelFilter);
   // Step: 5 将原点位于机器人当前位姿处的点云 转成 原点位于local坐标系原点处的点云, 再进行z轴上的过滤
   const sensor::RangeData cropped =
       sensor::CropRangeData(sensor::TransformRangeData(
@@ -100,6 +102,8 @@ std::unique_ptr<transform::Rigid2d> LocalTrajectoryBuilder2D::ScanMatch(
 
   // 根据参数决定是否 使用correlative_scan_matching对先验位姿进行校准
   if (options_.use_online_correlative_scan_matching()) {
+    metrics::ScopedStageTimer timer(
+        metrics::Stage::kRealTimeCorrelativeScanMatcher);
     const double score = real_time_correlative_scan_matcher_.Match(
         pose_prediction, filtered_gravity_aligned_point_cloud,
         *matching_submap->grid(), &initial_ceres_pose);
@@ -109,10 +113,13 @@ std::unique_ptr<transform::Rigid2d> LocalTrajectoryBuilder2D::ScanMatch(
   auto pose_observation = absl::make_unique<transform::Rigid2d>();
   ceres::Solver::Summary summary;
   // 使用ceres进行扫描匹配
-  ceres_scan_matcher_.Match(pose_prediction.translation(), initial_ceres_pose,
-                            filtered_gravity_aligned_point_cloud,
-                            *matching_submap->grid(), pose_observation.get(),
-                            &summary);
+  {
+    metrics::ScopedStageTimer timer(metrics::Stage::kCeresScanMatcher);
+    ceres_scan_matcher_.Match(pose_prediction.translation(), initial_ceres_pose,
+                              filtered_gravity_aligned_point_cloud,
+                              *matching_submap->grid(), pose_observation.get(),
+                              &summary);
+  }
   // 一些度量
   if (pose_observation) {
     kCeresScanMatcherCostMetric->Observe(summary.final_cost);
@@ -242,6 +249,8 @@ LocalTrajectoryBuilder2D::AddRangeData(
       }
     }
   } // end for
+  // Only 'synchronized_data.time' is used from here on.
+  range_data_collator_.RecycleRanges(std::move(synchronized_data.ranges));
 
   // 有一帧有效的数据了
   ++num_accumulated_;
@@ -310,9 +319,12 @@ LocalTrajectoryBuilder2D::AddAccumulatedRangeData(
       non_gravity_aligned_pose_prediction * gravity_alignment.inverse());
 
   // Step: 7 对 returns点云 进行自适应体素滤波，返回的点云的数据类型是PointCloud
-  const sensor::PointCloud& filtered_gravity_aligned_point_cloud =
-      sensor::AdaptiveVoxelFilter(gravity_aligned_range_data.returns,
-                                  options_.adaptive_voxel_filter_options());
+  const sensor::PointCloud filtered_gravity_aligned_point_cloud = [&]() {
+    metrics::ScopedStageTimer timer(metrics::Stage::kVoxelFilter);
+    return sensor::AdaptiveVoxelFilter(
+        gravity_aligned_range_data.returns,
+        options_.adaptive_voxel_filter_options());
+  }();
   if (filtered_gravity_aligned_point_cloud.empty()) {
     return nullptr;
   }
@@ -394,8 +406,11 @@ LocalTrajectoryBuilder2D::InsertIntoSubmap(
     return nullptr;
   }
   // 将点云数据写入到submap中
-  std::vector<std::shared_ptr<const Submap2D>> insertion_submaps =
-      active_submaps_.InsertRangeData(range_data_in_local);
+  std::vector<std::shared_ptr<const Submap2D>> insertion_submaps;
+  {
+    metrics::ScopedStageTimer timer(metrics::Stage::kInsertIntoSubmap);
+    insertion_submaps = active_submaps_.InsertRangeData(range_data_in_local);
+  }
 
   // 生成InsertionResult格式的数据进行返回
   return absl::make_unique<InsertionResult>(InsertionResult{
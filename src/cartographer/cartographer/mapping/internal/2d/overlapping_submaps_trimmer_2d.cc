@@ -18,87 +18,17 @@
 
 #include <algorithm>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
 #include "cartographer/mapping/2d/submap_2d.h"
 
 namespace cartographer {
 namespace mapping {
 namespace {
 
-class SubmapCoverageGrid2D {
- public:
-  // Aliases for documentation only (no type-safety).
-  using CellId = std::pair<int64 /* x cells */, int64 /* y cells */>;
-  using StoredType = std::vector<std::pair<SubmapId, common::Time>>;
-
-  SubmapCoverageGrid2D(const MapLimits& map_limits)
-      : offset_(map_limits.max()), resolution_(map_limits.resolution()) {}
-
-  void AddPoint(const Eigen::Vector2d& point, const SubmapId& submap_id,
-                const common::Time& time) {
-    CellId cell_id{common::RoundToInt64((offset_(0) - point(0)) / resolution_),
-                   common::RoundToInt64((offset_(1) - point(1)) / resolution_)};
-    cells_[cell_id].emplace_back(submap_id, time);
-  }
-
-  const std::map<CellId, StoredType>& cells() const { return cells_; }
-  double resolution() const { return resolution_; }
-
- private:
-  Eigen::Vector2d offset_;
-  double resolution_;
-  std::map<CellId, StoredType> cells_;
-};
-
-// Iterates over every cell in a submap, transforms the center of the cell to
-// the global frame and then adds the submap id and the timestamp of the most
-// recent range data insertion into the global grid.
-std::set<SubmapId> AddSubmapsToSubmapCoverageGrid2D(
-    const std::map<SubmapId, common::Time>& submap_freshness,
-    const MapById<SubmapId, PoseGraphInterface::SubmapData>& submap_data,
-    SubmapCoverageGrid2D* coverage_grid) {
-  std::set<SubmapId> all_submap_ids;
-
-  for (const auto& submap : submap_data) {
-    auto freshness = submap_freshness.find(submap.id);
-    if (freshness == submap_freshness.end()) continue;
-    if (!submap.data.submap->insertion_finished()) continue;
-    all_submap_ids.insert(submap.id);
-    const Grid2D& grid =
-        *std::static_pointer_cast<const Submap2D>(submap.data.submap)->grid();
-    // Iterate over every cell in a submap.
-    Eigen::Array2i offset;
-    CellLimits cell_limits;
-    grid.ComputeCroppedLimits(&offset, &cell_limits);
-    if (cell_limits.num_x_cells == 0 || cell_limits.num_y_cells == 0) {
-      LOG(WARNING) << "Empty grid found in submap ID = " << submap.id;
-      continue;
-    }
-
-    const transform::Rigid3d& global_frame_from_submap_frame = submap.data.pose;
-    const transform::Rigid3d submap_frame_from_local_frame =
-        submap.data.submap->local_pose().inverse();
-    for (const Eigen::Array2i& xy_index : XYIndexRangeIterator(cell_limits)) {
-      const Eigen::Array2i index = xy_index + offset;
-      if (!grid.IsKnown(index)) continue;
-
-      const transform::Rigid3d center_of_cell_in_local_frame =
-          transform::Rigid3d::Translation(Eigen::Vector3d(
-              grid.limits().max().x() -
-                  grid.limits().resolution() * (index.y() + 0.5),
-              grid.limits().max().y() -
-                  grid.limits().resolution() * (index.x() + 0.5),
-              0));
-
-      const transform::Rigid2d center_of_cell_in_global_frame =
-          transform::Project2D(global_frame_from_submap_frame *
-                               submap_frame_from_local_frame *
-                               center_of_cell_in_local_frame);
-      coverage_grid->AddPoint(center_of_cell_in_global_frame.translation(),
-                              submap.id, freshness->second);
-    }
-  }
-  return all_submap_ids;
-}
+// A moved submap is only inserted into the coverage grid again once one of its
+// cells might have moved by more than this fraction of the grid resolution.
+constexpr double kMaxCellDisplacementInResolutions = 0.25;
 
 // Uses intra-submap constraints and trajectory node timestamps to identify time
 // of the last range data insertion to the submap.
@@ -140,70 +70,333 @@ std::map<SubmapId, common::Time> ComputeSubmapFreshness(
   return submap_freshness;
 }
 
-// Returns IDs of submaps that have less than 'min_covered_cells_count' cells
-// not overlapped by at least 'fresh_submaps_count' submaps.
-std::vector<SubmapId> FindSubmapIdsToTrim(
-    const SubmapCoverageGrid2D& coverage_grid,
-    const std::set<SubmapId>& all_submap_ids, uint16 fresh_submaps_count,
-    uint16 min_covered_cells_count) {
-  std::map<SubmapId, uint16> submap_to_covered_cells_count;
-  for (const auto& cell : coverage_grid.cells()) {
-    std::vector<std::pair<SubmapId, common::Time>> submaps_per_cell(
-        cell.second);
-
-    // In case there are several submaps covering the cell, only the freshest
-    // submaps are kept.
-    if (submaps_per_cell.size() > fresh_submaps_count) {
-      // Sort by time in descending order.
-      std::sort(submaps_per_cell.begin(), submaps_per_cell.end(),
-                [](const std::pair<SubmapId, common::Time>& left,
-                   const std::pair<SubmapId, common::Time>& right) {
-                  return left.second > right.second;
-                });
-      submaps_per_cell.erase(submaps_per_cell.begin() + fresh_submaps_count,
-                             submaps_per_cell.end());
-    }
-    for (const std::pair<SubmapId, common::Time>& submap : submaps_per_cell) {
-      ++submap_to_covered_cells_count[submap.first];
-    }
-  }
-  std::vector<SubmapId> submap_ids_to_keep;
-  for (const auto& id_to_cells_count : submap_to_covered_cells_count) {
-    if (id_to_cells_count.second < min_covered_cells_count) continue;
-    submap_ids_to_keep.push_back(id_to_cells_count.first);
-  }
-
-  DCHECK(std::is_sorted(submap_ids_to_keep.begin(), submap_ids_to_keep.end()));
-  std::vector<SubmapId> result;
-  std::set_difference(all_submap_ids.begin(), all_submap_ids.end(),
-                      submap_ids_to_keep.begin(), submap_ids_to_keep.end(),
-                      std::back_inserter(result));
-  return result;
-}
-
 }  // namespace
 
+// Global grid which stores for each cell the finished submaps with a known
+// cell there. For every submap, it keeps count of the cells in which the
+// submap is among the 'fresh_submaps_count' freshest submaps, and updates the
+// counts only for cells of submaps which are added, moved or removed.
+class OverlappingSubmapsTrimmer2D::SubmapCoverageGrid2D {
+ public:
+  SubmapCoverageGrid2D(const MapLimits& map_limits,
+                       const uint16 fresh_submaps_count)
+      : offset_(map_limits.max()),
+        resolution_(map_limits.resolution()),
+        fresh_submaps_count_(fresh_submaps_count) {}
+
+  bool Contains(const SubmapId& submap_id) const {
+    return submaps_.count(submap_id) != 0;
+  }
+
+  std::vector<SubmapId> GetSubmapIds() const {
+    std::vector<SubmapId> submap_ids;
+    for (const auto& submap : submaps_) {
+      submap_ids.push_back(submap.first);
+    }
+    return submap_ids;
+  }
+
+  // Adds a finished submap at 'global_pose'. 'time' is the time of the most
+  // recent range data insertion into the submap. Only the known cells of its
+  // grid are kept.
+  void AddSubmap(const SubmapId& submap_id, const Submap2D& submap,
+                 const transform::Rigid3d& global_pose,
+                 const common::Time time) {
+    CHECK(submaps_.count(submap_id) == 0);
+    TrackedSubmap& tracked_submap = submaps_[submap_id];
+    tracked_submap.id = submap_id;
+    tracked_submap.local_pose = submap.local_pose();
+    tracked_submap.time = time;
+    tracked_submap.global_pose = global_pose;
+
+    const Grid2D& grid = *submap.grid();
+    KnownCells& known_cells = tracked_submap.known_cells;
+    known_cells.max = grid.limits().max();
+    known_cells.resolution = grid.limits().resolution();
+    grid.ComputeCroppedLimits(&known_cells.offset, &known_cells.cell_limits);
+    if (known_cells.cell_limits.num_x_cells == 0 ||
+        known_cells.cell_limits.num_y_cells == 0) {
+      LOG(WARNING) << "Empty grid found in submap ID = " << submap_id;
+    } else {
+      for (const Eigen::Array2i& xy_index :
+           XYIndexRangeIterator(known_cells.cell_limits)) {
+        known_cells.is_known.push_back(
+            grid.IsKnown(xy_index + known_cells.offset));
+      }
+    }
+
+    const transform::Rigid3d submap_frame_from_local_frame =
+        tracked_submap.local_pose.inverse();
+    ForEachKnownCell(tracked_submap,
+                     [&](const transform::Rigid3d& center_of_cell_in_local) {
+                       tracked_submap.max_cell_distance = std::max(
+                           tracked_submap.max_cell_distance,
+                           (submap_frame_from_local_frame *
+                            center_of_cell_in_local.translation())
+                               .norm());
+                     });
+    UpdateCells(&tracked_submap, &SubmapCoverageGrid2D::AddToCell);
+  }
+
+  // Returns true if some cell of the submap might have moved notably at
+  // 'global_pose'.
+  bool HasMoved(const SubmapId& submap_id,
+                const transform::Rigid3d& global_pose) const {
+    const TrackedSubmap& tracked_submap = submaps_.at(submap_id);
+    const double max_cell_displacement =
+        (global_pose.translation() - tracked_submap.global_pose.translation())
+            .norm() +
+        global_pose.rotation().angularDistance(
+            tracked_submap.global_pose.rotation()) *
+            tracked_submap.max_cell_distance;
+    return max_cell_displacement >
+           kMaxCellDisplacementInResolutions * resolution_;
+  }
+
+  // Moves submaps to new global poses. If most submaps moved, e.g. after a
+  // loop closure, rebuilding the grid is cheaper than moving them one by one.
+  void MoveSubmaps(
+      const std::vector<std::pair<SubmapId, transform::Rigid3d>>& poses) {
+    if (2 * poses.size() <= submaps_.size()) {
+      for (const auto& pose : poses) {
+        TrackedSubmap& tracked_submap = submaps_.at(pose.first);
+        UpdateCells(&tracked_submap, &SubmapCoverageGrid2D::RemoveFromCell);
+        tracked_submap.global_pose = pose.second;
+        UpdateCells(&tracked_submap, &SubmapCoverageGrid2D::AddToCell);
+      }
+      return;
+    }
+    cells_.clear();
+    for (const auto& pose : poses) {
+      submaps_.at(pose.first).global_pose = pose.second;
+    }
+    for (auto& submap : submaps_) {
+      submap.second.covered_cells_count = 0;
+      UpdateCells(&submap.second, &SubmapCoverageGrid2D::AddToCell);
+    }
+  }
+
+  void RemoveSubmap(const SubmapId& submap_id) {
+    auto it = submaps_.find(submap_id);
+    CHECK(it != submaps_.end());
+    UpdateCells(&it->second, &SubmapCoverageGrid2D::RemoveFromCell);
+    CHECK_EQ(it->second.covered_cells_count, 0);
+    submaps_.erase(it);
+  }
+
+  // Returns IDs of submaps that have less than 'min_covered_cells_count' cells
+  // not overlapped by at least 'fresh_submaps_count' submaps. Submaps without
+  // any such cell are always returned.
+  std::vector<SubmapId> FindSubmapIdsToTrim(
+      const uint16 min_covered_cells_count) const {
+    std::vector<SubmapId> result;
+    for (const auto& submap : submaps_) {
+      const int covered_cells_count = submap.second.covered_cells_count;
+      if (covered_cells_count == 0 ||
+          covered_cells_count < min_covered_cells_count) {
+        result.push_back(submap.first);
+      }
+    }
+    return result;
+  }
+
+  double resolution() const { return resolution_; }
+
+ private:
+  // Aliases for documentation only (no type-safety).
+  using CellId = std::pair<int64 /* x cells */, int64 /* y cells */>;
+
+  // The known cells of a submap grid within its cropped limits. Much smaller
+  // than the grid, which the pose graph may move out of memory.
+  struct KnownCells {
+    Eigen::Vector2d max;
+    double resolution = 0.;
+    Eigen::Array2i offset;
+    CellLimits cell_limits;
+    // One entry per cell in the order of 'XYIndexRangeIterator'.
+    std::vector<bool> is_known;
+  };
+
+  struct TrackedSubmap {
+    SubmapId id{0, 0};
+    transform::Rigid3d local_pose;
+    KnownCells known_cells;
+    common::Time time;
+    // Pose at which the cells of the submap were added to 'cells_'.
+    transform::Rigid3d global_pose;
+    // Largest distance of a cell center from the submap origin.
+    double max_cell_distance = 0.;
+    // Number of cells in which this submap is among the freshest submaps.
+    int covered_cells_count = 0;
+  };
+
+  // Submaps covering a cell, freshest first. A submap is contained once for
+  // each of its cells which falls into the cell.
+  using StoredType = std::vector<TrackedSubmap*>;
+
+  static bool IsFresher(const TrackedSubmap* left,
+                        const TrackedSubmap* right) {
+    if (left->time != right->time) {
+      return left->time > right->time;
+    }
+    return right->id < left->id;
+  }
+
+  // Calls 'callback' with the center of every known cell of the submap in the
+  // local frame.
+  template <typename Callback>
+  static void ForEachKnownCell(const TrackedSubmap& tracked_submap,
+                               Callback callback) {
+    const KnownCells& known_cells = tracked_submap.known_cells;
+    if (known_cells.is_known.empty()) {
+      return;
+    }
+    size_t i = 0;
+    for (const Eigen::Array2i& xy_index :
+         XYIndexRangeIterator(known_cells.cell_limits)) {
+      if (!known_cells.is_known[i++]) continue;
+      const Eigen::Array2i index = xy_index + known_cells.offset;
+      callback(transform::Rigid3d::Translation(Eigen::Vector3d(
+          known_cells.max.x() - known_cells.resolution * (index.y() + 0.5),
+          known_cells.max.y() - known_cells.resolution * (index.x() + 0.5),
+          0)));
+    }
+  }
+
+  // Transforms the center of every known cell of the submap to the global
+  // frame and calls 'update' for the cell of the coverage grid it falls into.
+  void UpdateCells(TrackedSubmap* const tracked_submap,
+                   void (SubmapCoverageGrid2D::*update)(const CellId&,
+                                                        TrackedSubmap*)) {
+    const transform::Rigid3d global_frame_from_local_frame =
+        tracked_submap->global_pose * tracked_submap->local_pose.inverse();
+    ForEachKnownCell(
+        *tracked_submap,
+        [&](const transform::Rigid3d& center_of_cell_in_local_frame) {
+          const transform::Rigid2d center_of_cell_in_global_frame =
+              transform::Project2D(global_frame_from_local_frame *
+                                   center_of_cell_in_local_frame);
+          (this->*update)(GetCellId(center_of_cell_in_global_frame.translation()),
+                          tracked_submap);
+        });
+  }
+
+  CellId GetCellId(const Eigen::Vector2d& point) const {
+    return CellId{
+        common::RoundToInt64((offset_(0) - point(0)) / resolution_),
+        common::RoundToInt64((offset_(1) - point(1)) / resolution_)};
+  }
+
+  void AddToCell(const CellId& cell_id, TrackedSubmap* const tracked_submap) {
+    StoredType& cell = cells_[cell_id];
+    const auto it =
+        std::upper_bound(cell.begin(), cell.end(), tracked_submap, IsFresher);
+    const size_t index = it - cell.begin();
+    cell.insert(it, tracked_submap);
+    if (index < fresh_submaps_count_) {
+      ++tracked_submap->covered_cells_count;
+      // The submap pushed out of the freshest submaps loses this cell.
+      if (cell.size() > fresh_submaps_count_) {
+        --cell[fresh_submaps_count_]->covered_cells_count;
+      }
+    }
+  }
+
+  void RemoveFromCell(const CellId& cell_id,
+                      TrackedSubmap* const tracked_submap) {
+    const auto cell_it = cells_.find(cell_id);
+    CHECK(cell_it != cells_.end());
+    StoredType& cell = cell_it->second;
+    const auto it = std::find(cell.begin(), cell.end(), tracked_submap);
+    CHECK(it != cell.end());
+    const size_t index = it - cell.begin();
+    if (index < fresh_submaps_count_) {
+      --tracked_submap->covered_cells_count;
+      // The next fresher submap takes over this cell.
+      if (cell.size() > fresh_submaps_count_) {
+        ++cell[fresh_submaps_count_]->covered_cells_count;
+      }
+    }
+    cell.erase(it);
+    if (cell.empty()) {
+      cells_.erase(cell_it);
+    }
+  }
+
+  const Eigen::Vector2d offset_;
+  const double resolution_;
+  const size_t fresh_submaps_count_;
+  // Node-based, so that pointers to the tracked submaps stay valid.
+  std::map<SubmapId, TrackedSubmap> submaps_;
+  absl::flat_hash_map<CellId, StoredType> cells_;
+};
+
+OverlappingSubmapsTrimmer2D::OverlappingSubmapsTrimmer2D(
+    const uint16 fresh_submaps_count, const double min_covered_area,
+    const uint16 min_added_submaps_count)
+    : fresh_submaps_count_(fresh_submaps_count),
+      min_covered_area_(min_covered_area),
+      min_added_submaps_count_(min_added_submaps_count) {}
+
+OverlappingSubmapsTrimmer2D::~OverlappingSubmapsTrimmer2D() {}
+
 void OverlappingSubmapsTrimmer2D::Trim(Trimmable* pose_graph) {
   const auto submap_data = pose_graph->GetOptimizedSubmapData();
   if (submap_data.size() - current_submap_count_ <= min_added_submaps_count_) {
     return;
   }
 
-  const MapLimits first_submap_map_limits =
-      std::static_pointer_cast<const Submap2D>(submap_data.begin()->data.submap)
-          ->grid()
-          ->limits();
-  SubmapCoverageGrid2D coverage_grid(first_submap_map_limits);
-  const std::map<SubmapId, common::Time> submap_freshness =
-      ComputeSubmapFreshness(submap_data, pose_graph->GetTrajectoryNodes(),
-                             pose_graph->GetConstraints());
-  const std::set<SubmapId> all_submap_ids = AddSubmapsToSubmapCoverageGrid2D(
-      submap_freshness, submap_data, &coverage_grid);
-  const std::vector<SubmapId> submap_ids_to_remove = FindSubmapIdsToTrim(
-      coverage_grid, all_submap_ids, fresh_submaps_count_,
-      min_covered_area_ / common::Pow2(coverage_grid.resolution()));
+  if (coverage_grid_ == nullptr) {
+    const MapLimits first_submap_map_limits =
+        std::static_pointer_cast<const Submap2D>(
+            pose_graph->GetFullSubmap(submap_data.begin()->id))
+            ->grid()
+            ->limits();
+    coverage_grid_ = absl::make_unique<SubmapCoverageGrid2D>(
+        first_submap_map_limits, fresh_submaps_count_);
+  }
+
+  for (const SubmapId& submap_id : coverage_grid_->GetSubmapIds()) {
+    if (!submap_data.Contains(submap_id)) {
+      coverage_grid_->RemoveSubmap(submap_id);
+    }
+  }
+  // Finished submaps do not change, so only newly finished submaps are added
+  // and the freshness is only needed for them.
+  std::map<SubmapId, common::Time> submap_freshness;
+  bool submap_freshness_computed = false;
+  std::vector<std::pair<SubmapId, transform::Rigid3d>> moved_submap_poses;
+  for (const auto& submap : submap_data) {
+    if (!submap.data.submap->insertion_finished()) continue;
+    if (coverage_grid_->Contains(submap.id)) {
+      if (coverage_grid_->HasMoved(submap.id, submap.data.pose)) {
+        moved_submap_poses.emplace_back(submap.id, submap.data.pose);
+      }
+      continue;
+    }
+    if (!submap_freshness_computed) {
+      submap_freshness =
+          ComputeSubmapFreshness(submap_data, pose_graph->GetTrajectoryNodes(),
+                                 pose_graph->GetConstraints());
+      submap_freshness_computed = true;
+    }
+    const auto freshness = submap_freshness.find(submap.id);
+    if (freshness == submap_freshness.end()) continue;
+    // Submaps the pose graph moved out of memory are loaded for this once.
+    coverage_grid_->AddSubmap(
+        submap.id,
+        *std::static_pointer_cast<const Submap2D>(
+            pose_graph->GetFullSubmap(submap.id)),
+        submap.data.pose, freshness->second);
+  }
+  coverage_grid_->MoveSubmaps(moved_submap_poses);
+
+  const std::vector<SubmapId> submap_ids_to_remove =
+      coverage_grid_->FindSubmapIdsToTrim(
+          min_covered_area_ / common::Pow2(coverage_grid_->resolution()));
   current_submap_count_ = submap_data.size() - submap_ids_to_remove.size();
   for (const SubmapId& id : submap_ids_to_remove) {
+    coverage_grid_->RemoveSubmap(id);
     pose_graph->TrimSubmap(id);
   }
 }
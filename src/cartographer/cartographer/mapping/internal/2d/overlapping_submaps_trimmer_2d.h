@@ -17,6 +17,8 @@
 #ifndef CARTOGRAPHER_MAPPING_INTERNAL_2D_OVERLAPPING_SUBMAPS_TRIMMER_H_
 #define CARTOGRAPHER_MAPPING_INTERNAL_2D_OVERLAPPING_SUBMAPS_TRIMMER_H_
 
+#include <memory>
+
 #include "cartographer/common/port.h"
 #include "cartographer/mapping/pose_graph_trimmer.h"
 
@@ -25,15 +27,16 @@ namespace mapping {
 
 // Trims submaps that have less than 'min_covered_cells_count' cells not
 // overlapped by at least 'fresh_submaps_count` submaps.
+//
+// The coverage of finished submaps is kept between calls to 'Trim()', so that
+// only submaps which were added, moved or removed since the last call have to
+// be processed.
 class OverlappingSubmapsTrimmer2D : public PoseGraphTrimmer {
  public:
   OverlappingSubmapsTrimmer2D(uint16 fresh_submaps_count,
                               double min_covered_area,
-                              uint16 min_added_submaps_count)
-      : fresh_submaps_count_(fresh_submaps_count),
-        min_covered_area_(min_covered_area),
-        min_added_submaps_count_(min_added_submaps_count) {}
-  ~OverlappingSubmapsTrimmer2D() override = default;
+                              uint16 min_added_submaps_count);
+  ~OverlappingSubmapsTrimmer2D() override;
 
   void Trim(Trimmable* pose_graph) override;
   bool IsFinished() override { return finished_; }
@@ -49,6 +52,9 @@ class OverlappingSubmapsTrimmer2D : public PoseGraphTrimmer {
   uint16 current_submap_count_ = 0;
 
   bool finished_ = false;
+
+  class SubmapCoverageGrid2D;
+  std::unique_ptr<SubmapCoverageGrid2D> coverage_grid_;
 };
 
 }  // namespace mapping
@@ -274,6 +274,45 @@ TEST_F(OverlappingSubmapsTrimmer2DTest, TestTransformations) {
               ElementsAre(EqualsSubmapId({0, 0})));
 }
 
+TEST_F(OverlappingSubmapsTrimmer2DTest, UpdateCoverageOfMovedSubmaps) {
+  AddSquareSubmap(Rigid2d::Identity() /* global_from_submap_frame */,
+                  Rigid2d::Identity() /* local_from_submap_frame */,
+                  Eigen::Vector2d(1., 1.) /* submap corner */,
+                  0 /* submap_index */, 2 /* num_cells */,
+                  true /* is_finished */);
+  AddSquareSubmap(Rigid2d::Translation(
+                      Eigen::Vector2d(5., 0.)) /* global_from_submap_frame */,
+                  Rigid2d::Identity() /* local_from_submap_frame */,
+                  Eigen::Vector2d(1., 1.) /* submap corner */,
+                  1 /* submap_index */, 2 /* num_cells */,
+                  true /* is_finished */);
+  AddTrajectoryNode(0 /* node_index */, 1000 /* timestamp */);
+  AddTrajectoryNode(1 /* node_index */, 2000 /* timestamp */);
+  AddConstraint(0 /*submap_index*/, 0 /*node_index*/, true);
+  AddConstraint(1 /*submap_index*/, 1 /*node_index*/, true);
+
+  OverlappingSubmapsTrimmer2D trimmer(1 /* fresh_submaps_count */,
+                                      0 /* min_covered_area */,
+                                      0 /* min_added_submaps_count */);
+  trimmer.Trim(&fake_pose_graph_);
+  EXPECT_THAT(fake_pose_graph_.trimmed_submaps(), IsEmpty());
+
+  // Optimization moves the second submap onto the first one.
+  fake_pose_graph_.mutable_submap_data()->at({0, 1}).pose =
+      Rigid3d::Identity();
+  AddSquareSubmap(Rigid2d::Translation(
+                      Eigen::Vector2d(10., 0.)) /* global_from_submap_frame */,
+                  Rigid2d::Identity() /* local_from_submap_frame */,
+                  Eigen::Vector2d(1., 1.) /* submap corner */,
+                  2 /* submap_index */, 2 /* num_cells */,
+                  true /* is_finished */);
+  AddTrajectoryNode(2 /* node_index */, 3000 /* timestamp */);
+  AddConstraint(2 /*submap_index*/, 2 /*node_index*/, true);
+  trimmer.Trim(&fake_pose_graph_);
+  EXPECT_THAT(fake_pose_graph_.trimmed_submaps(),
+              ElementsAre(EqualsSubmapId({0, 0})));
+}
+
 }  // namespace
 }  // namespace mapping
 }  // namespace cartographer
@@ -19,6 +19,7 @@
 #include <cmath>
 #include <memory>
 #include <random>
+#include <string>
 
 #include "absl/memory/memory.h"
 #include "cartographer/common/internal/testing/lua_parameter_dictionary_test_helpers.h"
@@ -82,8 +83,14 @@ class PoseGraph2DTest : public ::testing::Test {
           mapping::CreateSubmapsOptions2D(parameter_dictionary.get()));
     }
 
-    {
-      auto parameter_dictionary = common::MakeDictionary(R"text(
+    CreatePoseGraph("");
+    current_pose_ = transform::Rigid2d::Identity();
+  }
+
+  // Replaces the pose graph by one whose options additionally contain the Lua
+  // table entries in 'additional_options'.
+  void CreatePoseGraph(const std::string& additional_options) {
+    auto parameter_dictionary = common::MakeDictionary(R"text(
           return {
             optimize_every_n_nodes = 1000,
             constraint_builder = {
@@ -103,6 +110,7 @@ class PoseGraph2DTest : public ::testing::Test {
                 occupied_space_weight = 20.,
                 translation_weight = 10.,
                 rotation_weight = 1.,
+                use_analytical_derivatives = true,
                 ceres_solver_options = {
                   use_nonmonotonic_steps = true,
                   max_num_iterations = 50,
@@ -123,6 +131,7 @@ class PoseGraph2DTest : public ::testing::Test {
                 translation_weight = 10.,
                 rotation_weight = 1.,
                 only_optimize_yaw = true,
+                cache_interpolation_voxels = true,
                 ceres_solver_options = {
                   use_nonmonotonic_steps = true,
                   max_num_iterations = 50,
@@ -158,16 +167,13 @@ class PoseGraph2DTest : public ::testing::Test {
             global_sampling_ratio = 0.01,
             log_residual_histograms = true,
             global_constraint_search_after_n_seconds = 10.0,
-          })text");
-      auto options = CreatePoseGraphOptions(parameter_dictionary.get());
-      pose_graph_ = absl::make_unique<PoseGraph2D>(
-          options,
-          absl::make_unique<optimization::OptimizationProblem2D>(
-              options.optimization_problem_options()),
-          &thread_pool_);
-    }
-
-    current_pose_ = transform::Rigid2d::Identity();
+          )text" + additional_options + "}");
+    auto options = CreatePoseGraphOptions(parameter_dictionary.get());
+    pose_graph_ = absl::make_unique<PoseGraph2D>(
+        options,
+        absl::make_unique<optimization::OptimizationProblem2D>(
+            options.optimization_problem_options()),
+        &thread_pool_);
   }
 
   void MoveRelativeWithNoise(const transform::Rigid2d& movement,
@@ -313,6 +319,73 @@ TEST_F(PoseGraph2DTest, OverlappingNodes) {
               ::testing::Lt(error_before.translation().norm()));
 }
 
+TEST_F(PoseGraph2DTest, EvictsQueriesAndTrimsUnderMemoryBudget) {
+  CreatePoseGraph(R"text(
+      memory_budget = {
+        memory_budget_in_mb = 1e-6,
+        directory = ")text" + ::testing::TempDir() + R"text(",
+      },
+      overlapping_submaps_trimmer_2d = {
+        fresh_submaps_count = 1,
+        min_covered_area = 1.,
+        min_added_submaps_count = 5,
+      },
+  )text");
+  // Too few submaps for the trimmer, but the finished ones no longer fit into
+  // the budget.
+  for (int i = 0; i != 3; ++i) {
+    MoveRelative(transform::Rigid2d::Identity());
+  }
+  pose_graph_->RunFinalOptimization();
+  const SubmapId first_submap_id{0, 0};
+  const auto all_submap_data = pose_graph_->GetAllSubmapData();
+  ASSERT_TRUE(all_submap_data.Contains(first_submap_id));
+  EXPECT_EQ(std::static_pointer_cast<const Submap2D>(
+                all_submap_data.at(first_submap_id).submap)
+                ->grid(),
+            nullptr);
+  EXPECT_EQ(pose_graph_->GetTrajectoryNodes()
+                .at(NodeId{0, 0})
+                .constant_data->filtered_gravity_aligned_point_cloud.size(),
+            0u);
+
+  // Queries load the evicted data again.
+  EXPECT_NE(std::static_pointer_cast<const Submap2D>(
+                pose_graph_->GetSubmapData(first_submap_id).submap)
+                ->grid(),
+            nullptr);
+  size_t num_visited_submaps = 0;
+  pose_graph_->ForEachSubmapData(
+      [&num_visited_submaps](const SubmapId& submap_id,
+                             const PoseGraphInterface::SubmapData& data) {
+        EXPECT_NE(
+            std::static_pointer_cast<const Submap2D>(data.submap)->grid(),
+            nullptr)
+            << submap_id;
+        ++num_visited_submaps;
+      });
+  EXPECT_EQ(num_visited_submaps, all_submap_data.size());
+  int num_visited_nodes = 0;
+  pose_graph_->ForEachTrajectoryNode(
+      [this, &num_visited_nodes](const NodeId& node_id,
+                                 const TrajectoryNode& node) {
+        EXPECT_EQ(
+            node.constant_data->filtered_gravity_aligned_point_cloud.size(),
+            point_cloud_.size())
+            << node_id;
+        ++num_visited_nodes;
+      });
+  EXPECT_EQ(num_visited_nodes, 3);
+
+  // All submaps cover the same area, so the trimmer removes the older ones,
+  // including those only on disk.
+  for (int i = 0; i != 6; ++i) {
+    MoveRelative(transform::Rigid2d::Identity());
+  }
+  pose_graph_->RunFinalOptimization();
+  EXPECT_FALSE(pose_graph_->GetAllSubmapData().Contains(first_submap_id));
+}
+
 }  // namespace
 }  // namespace mapping
 }  // namespace cartographer
@@ -44,6 +44,8 @@ proto::CeresScanMatcherOptions2D CreateCeresScanMatcherOptions2D(
       parameter_dictionary->GetDouble("translation_weight"));
   options.set_rotation_weight(
       parameter_dictionary->GetDouble("rotation_weight"));
+  options.set_use_analytical_derivatives(
+      parameter_dictionary->GetBool("use_analytical_derivatives"));
   *options.mutable_ceres_solver_options() =
       common::CreateCeresSolverOptionsProto(
           parameter_dictionary->GetDictionary("ceres_solver_options").get());
@@ -84,14 +86,19 @@ void CeresScanMatcher2D::Match(const Eigen::Vector2d& target_translation,
   // 地图部分的残差
   CHECK_GT(options_.occupied_space_weight(), 0.);
   switch (grid.GetGridType()) {
-    case GridType::PROBABILITY_GRID:
+    case GridType::PROBABILITY_GRID: {
+      const double scaling_factor =
+          options_.occupied_space_weight() /
+          std::sqrt(static_cast<double>(point_cloud.size()));
       problem.AddResidualBlock(
-          CreateOccupiedSpaceCostFunction2D(
-              options_.occupied_space_weight() /
-                  std::sqrt(static_cast<double>(point_cloud.size())),
-              point_cloud, grid),
+          options_.use_analytical_derivatives()
+              ? CreateAnalyticalOccupiedSpaceCostFunction2D(scaling_factor,
+                                                            point_cloud, grid)
+              : CreateOccupiedSpaceCostFunction2D(scaling_factor, point_cloud,
+                                                  grid),
           nullptr /* loss function */, ceres_pose_estimate);
       break;
+    }
     case GridType::TSDF:
       problem.AddResidualBlock(
           CreateTSDFMatchCostFunction2D(
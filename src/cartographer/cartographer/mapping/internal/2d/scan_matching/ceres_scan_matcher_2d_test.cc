@@ -49,15 +49,20 @@ class CeresScanMatcherTest : public ::testing::Test {
           occupied_space_weight = 1.,
           translation_weight = 0.1,
           rotation_weight = 1.5,
+          use_analytical_derivatives = false,
           ceres_solver_options = {
             use_nonmonotonic_steps = true,
             max_num_iterations = 50,
             num_threads = 1,
           },
         })text");
-    const proto::CeresScanMatcherOptions2D options =
-        CreateCeresScanMatcherOptions2D(parameter_dictionary.get());
-    ceres_scan_matcher_ = absl::make_unique<CeresScanMatcher2D>(options);
+    options_ = CreateCeresScanMatcherOptions2D(parameter_dictionary.get());
+    ceres_scan_matcher_ = absl::make_unique<CeresScanMatcher2D>(options_);
+  }
+
+  void UseAnalyticalDerivatives() {
+    options_.set_use_analytical_derivatives(true);
+    ceres_scan_matcher_ = absl::make_unique<CeresScanMatcher2D>(options_);
   }
 
   void TestFromInitialPose(const transform::Rigid2d& initial_pose) {
@@ -77,6 +82,7 @@ class CeresScanMatcherTest : public ::testing::Test {
   ValueConversionTables conversion_tables_;
   ProbabilityGrid probability_grid_;
   sensor::PointCloud point_cloud_;
+  proto::CeresScanMatcherOptions2D options_;
   std::unique_ptr<CeresScanMatcher2D> ceres_scan_matcher_;
 };
 
@@ -96,6 +102,11 @@ TEST_F(CeresScanMatcherTest, testOptimizeAlongXY) {
   TestFromInitialPose(transform::Rigid2d::Translation({-0.3, 0.3}));
 }
 
+TEST_F(CeresScanMatcherTest, testOptimizeAlongXYWithAnalyticalDerivatives) {
+  UseAnalyticalDerivatives();
+  TestFromInitialPose(transform::Rigid2d::Translation({-0.3, 0.3}));
+}
+
 }  // namespace
 }  // namespace scan_matching
 }  // namespace mapping
@@ -16,6 +16,8 @@
 
 #include "cartographer/mapping/internal/2d/scan_matching/occupied_space_cost_function_2d.h"
 
+#include <cmath>
+
 #include "cartographer/mapping/probability_values.h"
 #include "ceres/cubic_interpolation.h"
 
@@ -24,6 +26,43 @@ namespace mapping {
 namespace scan_matching {
 namespace {
 
+constexpr int kPadding = INT_MAX / 4;
+
+// 自定义网格
+class GridArrayAdapter {
+ public:
+  // 枚举 DATA_DIMENSION 表示被插值的向量或者函数的维度
+  enum { DATA_DIMENSION = 1 };
+
+  explicit GridArrayAdapter(const Grid2D& grid) : grid_(grid) {}
+
+  // 获取栅格free值
+  void GetValue(const int row, const int column, double* const value) const {
+    // 处于地图外部时, 赋予最大free值
+    if (row < kPadding || column < kPadding || row >= NumRows() - kPadding ||
+        column >= NumCols() - kPadding) {
+      *value = kMaxCorrespondenceCost;
+    } 
+    // 根据索引获取free值
+    else {
+      *value = static_cast<double>(grid_.GetCorrespondenceCost(
+          Eigen::Array2i(column - kPadding, row - kPadding)));
+    }
+  }
+
+  // map上下左右各增加 kPadding
+  int NumRows() const {
+    return grid_.limits().cell_limits().num_y_cells + 2 * kPadding;
+  }
+
+  int NumCols() const {
+    return grid_.limits().cell_limits().num_x_cells + 2 * kPadding;
+  }
+
+ private:
+  const Grid2D& grid_;
+};
+
 // Computes a cost for matching the 'point_cloud' to the 'grid' with
 // a 'pose'. The cost increases with poorer correspondence of the grid and the
 // point observation (e.g. points falling into less occupied space).
@@ -69,47 +108,79 @@ class OccupiedSpaceCostFunction2D {
   }
 
  private:
-  static constexpr int kPadding = INT_MAX / 4;
-  
-  // 自定义网格
-  class GridArrayAdapter {
-   public:
-    // 枚举 DATA_DIMENSION 表示被插值的向量或者函数的维度
-    enum { DATA_DIMENSION = 1 };
-
-    explicit GridArrayAdapter(const Grid2D& grid) : grid_(grid) {}
-
-    // 获取栅格free值
-    void GetValue(const int row, const int column, double* const value) const {
-      // 处于地图外部时, 赋予最大free值
-      if (row < kPadding || column < kPadding || row >= NumRows() - kPadding ||
-          column >= NumCols() - kPadding) {
-        *value = kMaxCorrespondenceCost;
-      } 
-      // 根据索引获取free值
-      else {
-        *value = static_cast<double>(grid_.GetCorrespondenceCost(
-            Eigen::Array2i(column - kPadding, row - kPadding)));
-      }
-    }
+  OccupiedSpaceCostFunction2D(const OccupiedSpaceCostFunction2D&) = delete;
+  OccupiedSpaceCostFunction2D& operator=(const OccupiedSpaceCostFunction2D&) =
+      delete;
 
-    // map上下左右各增加 kPadding
-    int NumRows() const {
-      return grid_.limits().cell_limits().num_y_cells + 2 * kPadding;
-    }
+  const double scaling_factor_;
+  const sensor::PointCloud& point_cloud_;
+  const Grid2D& grid_;
+};
 
-    int NumCols() const {
-      return grid_.limits().cell_limits().num_x_cells + 2 * kPadding;
-    }
+// Same cost as 'OccupiedSpaceCostFunction2D', but with analytical derivatives.
+// Residuals and Jacobians of all points are computed in a single pass over
+// the point cloud on plain doubles, which avoids propagating 'ceres::Jet's
+// through the rigid transform and the bicubic interpolation.
+class AnalyticalOccupiedSpaceCostFunction2D
+    : public ceres::SizedCostFunction<ceres::DYNAMIC /* residuals */,
+                                      3 /* pose variables */> {
+ public:
+  AnalyticalOccupiedSpaceCostFunction2D(const double scaling_factor,
+                                        const sensor::PointCloud& point_cloud,
+                                        const Grid2D& grid)
+      : scaling_factor_(scaling_factor),
+        point_cloud_(point_cloud),
+        grid_(grid) {
+    set_num_residuals(point_cloud_.size());
+  }
 
-   private:
-    const Grid2D& grid_;
-  };
+  bool Evaluate(double const* const* parameters, double* residuals,
+                double** jacobians) const override {
+    const double* const pose = parameters[0];
+    const double cos_theta = std::cos(pose[2]);
+    const double sin_theta = std::sin(pose[2]);
+    double* const jacobian = jacobians != nullptr ? jacobians[0] : nullptr;
 
-  OccupiedSpaceCostFunction2D(const OccupiedSpaceCostFunction2D&) = delete;
-  OccupiedSpaceCostFunction2D& operator=(const OccupiedSpaceCostFunction2D&) =
-      delete;
+    const GridArrayAdapter adapter(grid_);
+    const ceres::BiCubicInterpolator<GridArrayAdapter> interpolator(adapter);
+    const MapLimits& limits = grid_.limits();
+    // The interpolator coordinates decrease with increasing world
+    // coordinates, hence the negative sign.
+    const double scaled_inverse_resolution =
+        -scaling_factor_ / limits.resolution();
 
+    for (size_t i = 0; i < point_cloud_.size(); ++i) {
+      const double x = point_cloud_[i].position.x();
+      const double y = point_cloud_[i].position.y();
+      const double rotated_x = cos_theta * x - sin_theta * y;
+      const double rotated_y = sin_theta * x + cos_theta * y;
+      double value;
+      double dvalue_drow;
+      double dvalue_dcolumn;
+      interpolator.Evaluate(
+          (limits.max().x() - (rotated_x + pose[0])) / limits.resolution() -
+              0.5 + static_cast<double>(kPadding),
+          (limits.max().y() - (rotated_y + pose[1])) / limits.resolution() -
+              0.5 + static_cast<double>(kPadding),
+          &value, &dvalue_drow, &dvalue_dcolumn);
+      residuals[i] = scaling_factor_ * value;
+      if (jacobian != nullptr) {
+        // Row-major: the i-th row holds the derivatives with respect to
+        // x, y and theta. The derivative of the rotated point with respect
+        // to theta is (-rotated_y, rotated_x).
+        const double dresidual_dx = scaled_inverse_resolution * dvalue_drow;
+        const double dresidual_dy =
+            scaled_inverse_resolution * dvalue_dcolumn;
+        jacobian[3 * i] = dresidual_dx;
+        jacobian[3 * i + 1] = dresidual_dy;
+        jacobian[3 * i + 2] =
+            -dresidual_dx * rotated_y + dresidual_dy * rotated_x;
+      }
+    }
+    return true;
+  }
+
+ private:
   const double scaling_factor_;
   const sensor::PointCloud& point_cloud_;
   const Grid2D& grid_;
@@ -128,6 +199,13 @@ ceres::CostFunction* CreateOccupiedSpaceCostFunction2D(
       point_cloud.size()); // 比固定残差维度的 多了一个参数
 }
 
+ceres::CostFunction* CreateAnalyticalOccupiedSpaceCostFunction2D(
+    const double scaling_factor, const sensor::PointCloud& point_cloud,
+    const Grid2D& grid) {
+  return new AnalyticalOccupiedSpaceCostFunction2D(scaling_factor, point_cloud,
+                                                   grid);
+}
+
 }  // namespace scan_matching
 }  // namespace mapping
 }  // namespace cartographer
@@ -32,6 +32,12 @@ ceres::CostFunction* CreateOccupiedSpaceCostFunction2D(
     const double scaling_factor, const sensor::PointCloud& point_cloud,
     const Grid2D& grid);
 
+// Same as above, but computes the Jacobians analytically instead of using
+// automatic differentiation, which is several times faster.
+ceres::CostFunction* CreateAnalyticalOccupiedSpaceCostFunction2D(
+    double scaling_factor, const sensor::PointCloud& point_cloud,
+    const Grid2D& grid);
+
 }  // namespace scan_matching
 }  // namespace mapping
 }  // namespace cartographer
@@ -16,8 +16,14 @@
 
 #include "cartographer/mapping/internal/2d/scan_matching/occupied_space_cost_function_2d.h"
 
+#include <array>
+#include <cmath>
+#include <memory>
+#include <vector>
+
 #include "cartographer/mapping/2d/probability_grid.h"
 #include "cartographer/mapping/probability_values.h"
+#include "cartographer/sensor/point_cloud.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -27,6 +33,7 @@ namespace scan_matching {
 namespace {
 
 using ::testing::DoubleEq;
+using ::testing::DoubleNear;
 using ::testing::ElementsAre;
 
 TEST(OccupiedSpaceCostFunction2DTest, SmokeTest) {
@@ -51,6 +58,67 @@ TEST(OccupiedSpaceCostFunction2DTest, SmokeTest) {
   EXPECT_THAT(residuals, ElementsAre(DoubleEq(kMaxProbability)));
 }
 
+TEST(OccupiedSpaceCostFunction2DTest, AnalyticalMatchesAutoDiff) {
+  ValueConversionTables conversion_tables;
+  ProbabilityGrid grid(
+      MapLimits(0.1, Eigen::Vector2d(1., 1.), CellLimits(20, 20)),
+      &conversion_tables);
+  for (int y = 0; y < 20; ++y) {
+    for (int x = 0; x < 20; ++x) {
+      grid.SetProbability(
+          Eigen::Array2i(x, y),
+          0.1f + 0.8f * std::abs(std::sin(0.7f * x + 1.3f * y)));
+    }
+  }
+  sensor::PointCloud point_cloud;
+  for (int i = 0; i < 30; ++i) {
+    // Some of the points fall outside of the grid.
+    point_cloud.push_back({Eigen::Vector3f(1.3f * std::cos(0.5f * i),
+                                           1.1f * std::sin(0.3f * i), 0.f)});
+  }
+  std::unique_ptr<ceres::CostFunction> auto_diff_cost_function(
+      CreateOccupiedSpaceCostFunction2D(2.f, point_cloud, grid));
+  std::unique_ptr<ceres::CostFunction> analytical_cost_function(
+      CreateAnalyticalOccupiedSpaceCostFunction2D(2.f, point_cloud, grid));
+  ASSERT_EQ(auto_diff_cost_function->num_residuals(),
+            analytical_cost_function->num_residuals());
+
+  for (const std::array<double, 3>& pose :
+       {std::array<double, 3>{{0., 0., 0.}},
+        std::array<double, 3>{{0.13, -0.07, 0.3}},
+        std::array<double, 3>{{-0.21, 0.04, -2.1}}}) {
+    const std::array<const double*, 1> parameter_blocks{{pose.data()}};
+    std::vector<double> auto_diff_residuals(point_cloud.size());
+    std::vector<double> auto_diff_jacobian(3 * point_cloud.size());
+    double* auto_diff_jacobians[] = {auto_diff_jacobian.data()};
+    ASSERT_TRUE(auto_diff_cost_function->Evaluate(parameter_blocks.data(),
+                                                  auto_diff_residuals.data(),
+                                                  auto_diff_jacobians));
+    std::vector<double> analytical_residuals(point_cloud.size());
+    std::vector<double> analytical_jacobian(3 * point_cloud.size());
+    double* analytical_jacobians[] = {analytical_jacobian.data()};
+    ASSERT_TRUE(analytical_cost_function->Evaluate(parameter_blocks.data(),
+                                                   analytical_residuals.data(),
+                                                   analytical_jacobians));
+    for (size_t i = 0; i < point_cloud.size(); ++i) {
+      EXPECT_THAT(analytical_residuals[i],
+                  DoubleNear(auto_diff_residuals[i], 1e-9));
+    }
+    for (size_t i = 0; i < auto_diff_jacobian.size(); ++i) {
+      EXPECT_THAT(analytical_jacobian[i],
+                  DoubleNear(auto_diff_jacobian[i], 1e-9));
+    }
+
+    // Residuals only, without Jacobians.
+    ASSERT_TRUE(analytical_cost_function->Evaluate(
+        parameter_blocks.data(), analytical_residuals.data(), nullptr));
+    for (size_t i = 0; i < point_cloud.size(); ++i) {
+      EXPECT_THAT(analytical_residuals[i],
+                  DoubleNear(auto_diff_residuals[i], 1e-9));
+    }
+  }
+}
+
 }  // namespace
 }  // namespace scan_matching
 }  // namespace mapping
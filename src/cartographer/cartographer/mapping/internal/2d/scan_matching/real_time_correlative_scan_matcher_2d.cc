@@ -20,6 +20,7 @@
 #include <cmath>
 #include <functional>
 #include <limits>
+#include <vector>
 
 #include "Eigen/Geometry"
 #include "cartographer/common/lua_parameter_dictionary.h"
@@ -59,25 +60,128 @@ float ComputeCandidateScore(const TSDF2D& tsdf,
   return candidate_score;
 }
 
-// 计算点云在指定像素坐标位置下与ProbabilityGrid地图匹配的得分
-float ComputeCandidateScore(const ProbabilityGrid& probability_grid,
-                            const DiscreteScan2D& discrete_scan,
-                            int x_index_offset, int y_index_offset) {
-  float candidate_score = 0.f;
+// The probabilities of a rectangle of cells, converted from the grid once so
+// that scoring only adds up floats.
+struct ProbabilityPatch {
+  Eigen::Array2i min_index;
+  int num_x_cells;
+  int num_y_cells;
+  // Indexed by (y - min_index.y()) * num_x_cells + (x - min_index.x()).
+  std::vector<float> probabilities;
+};
+
+// Returns the probabilities of all cells which the points of 'discrete_scans'
+// reach at the offsets within 'bounds'. Only scans with candidates, i.e. with
+// non-empty bounds, are considered.
+ProbabilityPatch ComputeProbabilityPatch(
+    const ProbabilityGrid& probability_grid,
+    const std::vector<DiscreteScan2D>& discrete_scans,
+    const std::vector<SearchParameters::LinearBounds>& bounds) {
+  Eigen::Array2i min_index(std::numeric_limits<int>::max(),
+                           std::numeric_limits<int>::max());
+  Eigen::Array2i max_index(std::numeric_limits<int>::min(),
+                           std::numeric_limits<int>::min());
+  for (size_t scan_index = 0; scan_index != discrete_scans.size();
+       ++scan_index) {
+    const SearchParameters::LinearBounds& scan_bounds = bounds[scan_index];
+    if (scan_bounds.min_x > scan_bounds.max_x) continue;
+    for (const Eigen::Array2i& xy_index : discrete_scans[scan_index]) {
+      min_index = min_index.min(
+          xy_index + Eigen::Array2i(scan_bounds.min_x, scan_bounds.min_y));
+      max_index = max_index.max(
+          xy_index + Eigen::Array2i(scan_bounds.max_x, scan_bounds.max_y));
+    }
+  }
+  ProbabilityPatch patch{min_index, 0, 0, {}};
+  if ((min_index > max_index).any()) return patch;
+  patch.num_x_cells = max_index.x() - min_index.x() + 1;
+  patch.num_y_cells = max_index.y() - min_index.y() + 1;
+  patch.probabilities.resize(patch.num_x_cells * patch.num_y_cells);
+  for (int y = 0; y != patch.num_y_cells; ++y) {
+    probability_grid.GetProbabilitiesOfRow(
+        Eigen::Array2i(min_index.x(), min_index.y() + y), patch.num_x_cells,
+        &patch.probabilities[y * patch.num_x_cells]);
+  }
+  return patch;
+}
+
+// Computes the scores of all offsets within 'bounds' of one rotated scan at
+// once. The score of an offset is the average probability of the translated
+// points. Instead of looking up each point for each offset, the rows of cells
+// around each point are added up at once. Since every score is still summed up
+// point by point, the scores are identical to scoring candidates one by one.
+// The result is indexed by
+// (y_index_offset - min_y) * num_x_offsets + (x_index_offset - min_x).
+std::vector<float> ComputeCandidateScores(
+    const ProbabilityPatch& patch, const DiscreteScan2D& discrete_scan,
+    const SearchParameters::LinearBounds& bounds) {
+  const int num_x_offsets = bounds.max_x - bounds.min_x + 1;
+  const int num_y_offsets = bounds.max_y - bounds.min_y + 1;
+  std::vector<float> candidate_scores(num_x_offsets * num_y_offsets, 0.f);
   for (const Eigen::Array2i& xy_index : discrete_scan) {
-    // 对每个点都加上像素坐标的offset, 相当于对点云进行平移
-    const Eigen::Array2i proposed_xy_index(xy_index.x() + x_index_offset,
-                                           xy_index.y() + y_index_offset);
-    // 获取占用的概率
-    const float probability =
-        probability_grid.GetProbability(proposed_xy_index);
-    // 以概率为得分
-    candidate_score += probability;
+    const float* row =
+        patch.probabilities.data() +
+        (xy_index.y() + bounds.min_y - patch.min_index.y()) *
+            patch.num_x_cells +
+        (xy_index.x() + bounds.min_x - patch.min_index.x());
+    float* scores = candidate_scores.data();
+    for (int y = 0; y != num_y_offsets; ++y) {
+      // Plain float additions over contiguous memory, which the compiler can
+      // vectorize.
+      for (int x = 0; x != num_x_offsets; ++x) {
+        scores[x] += row[x];
+      }
+      row += patch.num_x_cells;
+      scores += num_x_offsets;
+    }
   }
   // 计算平均得分
-  candidate_score /= static_cast<float>(discrete_scan.size());
-  CHECK_GT(candidate_score, 0.f);
-  return candidate_score;
+  for (float& candidate_score : candidate_scores) {
+    candidate_score /= static_cast<float>(discrete_scan.size());
+    CHECK_GT(candidate_score, 0.f);
+  }
+  return candidate_scores;
+}
+
+// 计算所有候选解与ProbabilityGrid地图匹配的得分
+void ComputeCandidateScores(const ProbabilityGrid& probability_grid,
+                            const std::vector<DiscreteScan2D>& discrete_scans,
+                            std::vector<Candidate2D>* const candidates) {
+  // The offsets of the candidates of each rotated scan.
+  std::vector<SearchParameters::LinearBounds> bounds(
+      discrete_scans.size(),
+      SearchParameters::LinearBounds{std::numeric_limits<int>::max(),
+                                     std::numeric_limits<int>::min(),
+                                     std::numeric_limits<int>::max(),
+                                     std::numeric_limits<int>::min()});
+  for (const Candidate2D& candidate : *candidates) {
+    SearchParameters::LinearBounds& scan_bounds =
+        bounds.at(candidate.scan_index);
+    scan_bounds.min_x = std::min(scan_bounds.min_x, candidate.x_index_offset);
+    scan_bounds.max_x = std::max(scan_bounds.max_x, candidate.x_index_offset);
+    scan_bounds.min_y = std::min(scan_bounds.min_y, candidate.y_index_offset);
+    scan_bounds.max_y = std::max(scan_bounds.max_y, candidate.y_index_offset);
+  }
+  // Each cell of the search window is converted to a probability only once,
+  // instead of once per candidate which reaches it.
+  const ProbabilityPatch patch =
+      ComputeProbabilityPatch(probability_grid, discrete_scans, bounds);
+  std::vector<std::vector<float>> candidate_scores(discrete_scans.size());
+  for (size_t scan_index = 0; scan_index != discrete_scans.size();
+       ++scan_index) {
+    if (bounds[scan_index].min_x <= bounds[scan_index].max_x) {
+      candidate_scores[scan_index] = ComputeCandidateScores(
+          patch, discrete_scans[scan_index], bounds[scan_index]);
+    }
+  }
+  for (Candidate2D& candidate : *candidates) {
+    const SearchParameters::LinearBounds& scan_bounds =
+        bounds[candidate.scan_index];
+    const int num_x_offsets = scan_bounds.max_x - scan_bounds.min_x + 1;
+    candidate.score = candidate_scores[candidate.scan_index].at(
+        (candidate.y_index_offset - scan_bounds.min_y) * num_x_offsets +
+        candidate.x_index_offset - scan_bounds.min_x);
+  }
 }
 
 }  // namespace
@@ -186,21 +290,21 @@ void RealTimeCorrelativeScanMatcher2D::ScoreCandidates(
     const Grid2D& grid, const std::vector<DiscreteScan2D>& discrete_scans,
     const SearchParameters& search_parameters,
     std::vector<Candidate2D>* const candidates) const {
-  for (Candidate2D& candidate : *candidates) {
-    switch (grid.GetGridType()) {
-      case GridType::PROBABILITY_GRID:
-        candidate.score = ComputeCandidateScore(
-            static_cast<const ProbabilityGrid&>(grid),
-            discrete_scans[candidate.scan_index], candidate.x_index_offset,
-            candidate.y_index_offset);
-        break;
-      case GridType::TSDF:
+  switch (grid.GetGridType()) {
+    case GridType::PROBABILITY_GRID:
+      ComputeCandidateScores(static_cast<const ProbabilityGrid&>(grid),
+                             discrete_scans, candidates);
+      break;
+    case GridType::TSDF:
+      for (Candidate2D& candidate : *candidates) {
         candidate.score = ComputeCandidateScore(
             static_cast<const TSDF2D&>(grid),
             discrete_scans[candidate.scan_index], candidate.x_index_offset,
             candidate.y_index_offset);
-        break;
-    }
+      }
+      break;
+  }
+  for (Candidate2D& candidate : *candidates) {
     // 对得分进行加权
     candidate.score *=
         std::exp(-common::Pow2(std::hypot(candidate.x, candidate.y) *
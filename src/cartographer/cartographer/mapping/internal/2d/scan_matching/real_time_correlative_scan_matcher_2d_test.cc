@@ -197,6 +197,41 @@ TEST_F(RealTimeCorrelativeScanMatcherTest,
   EXPECT_GT(1.0, candidates[0].score);
 }
 
+TEST_F(RealTimeCorrelativeScanMatcherTest,
+       ScoresMatchPerPointProbabilitiesProbabilityGrid) {
+  SetUpProbabilityGrid();
+  const SearchParameters search_parameters(4, 2, 0.1, 0.05);
+  const std::vector<sensor::PointCloud> scans =
+      GenerateRotatedScans(point_cloud_, search_parameters);
+  const std::vector<DiscreteScan2D> discrete_scans =
+      DiscretizeScans(grid_->limits(), scans, Eigen::Translation2f::Identity());
+  std::vector<Candidate2D> candidates;
+  for (int scan_index = 0; scan_index != search_parameters.num_scans;
+       ++scan_index) {
+    // Some of the offsets move points off the grid.
+    for (int x_index_offset = -4; x_index_offset <= 4; ++x_index_offset) {
+      for (int y_index_offset = -4; y_index_offset <= 4; ++y_index_offset) {
+        candidates.emplace_back(scan_index, x_index_offset, y_index_offset,
+                                search_parameters);
+      }
+    }
+  }
+  real_time_correlative_scan_matcher_->ScoreCandidates(
+      *grid_, discrete_scans, search_parameters, &candidates);
+  const auto& probability_grid = static_cast<const ProbabilityGrid&>(*grid_);
+  for (const Candidate2D& candidate : candidates) {
+    float expected_score = 0.f;
+    for (const Eigen::Array2i& xy_index :
+         discrete_scans[candidate.scan_index]) {
+      expected_score += probability_grid.GetProbability(
+          xy_index + Eigen::Array2i(candidate.x_index_offset,
+                                    candidate.y_index_offset));
+    }
+    expected_score /= static_cast<float>(point_cloud_.size());
+    EXPECT_EQ(expected_score, candidate.score);
+  }
+}
+
 }  // namespace
 }  // namespace scan_matching
 }  // namespace mapping
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2016 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping/internal/3d/deskew.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "Eigen/Core"
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace mapping {
+
+namespace {
+
+using Column = sensor::ColumnarPointCloud::Column;
+
+Eigen::Map<const Eigen::ArrayXf> Slice(const Column& column,
+                                       const size_t begin, const size_t end) {
+  return Eigen::Map<const Eigen::ArrayXf>(column.data() + begin, end - begin);
+}
+
+Eigen::Map<Eigen::ArrayXf> Slice(Column* const column, const size_t begin,
+                                 const size_t end) {
+  return Eigen::Map<Eigen::ArrayXf>(column->data() + begin, end - begin);
+}
+
+// Transforms the points in [begin, end) whose times lie between 'start_pose'
+// at 'start_time' and 'end_pose' at 'start_time + knot_interval'. All points
+// are processed at once by Eigen's vectorized array expressions.
+void DeskewSegment(const sensor::ColumnarPointCloud& point_cloud,
+                   const size_t begin, const size_t end,
+                   const transform::Rigid3f& start_pose,
+                   const transform::Rigid3f& end_pose, const float start_time,
+                   const float knot_interval, Column* const x,
+                   Column* const y, Column* const z) {
+  const Eigen::Quaternionf& q0 = start_pose.rotation();
+  Eigen::Quaternionf q1 = end_pose.rotation();
+  // Interpolate along the shorter arc.
+  if (q0.dot(q1) < 0.f) q1.coeffs() = -q1.coeffs();
+  const Eigen::Vector3f& t0 = start_pose.translation();
+  const Eigen::Vector3f& t1 = end_pose.translation();
+
+  const Eigen::ArrayXf alpha =
+      (Slice(point_cloud.time(), begin, end) - start_time) / knot_interval;
+  Eigen::ArrayXf qw = q0.w() + alpha * (q1.w() - q0.w());
+  Eigen::ArrayXf qx = q0.x() + alpha * (q1.x() - q0.x());
+  Eigen::ArrayXf qy = q0.y() + alpha * (q1.y() - q0.y());
+  Eigen::ArrayXf qz = q0.z() + alpha * (q1.z() - q0.z());
+  const Eigen::ArrayXf inverse_norm =
+      (qw.square() + qx.square() + qy.square() + qz.square()).rsqrt();
+  qw *= inverse_norm;
+  qx *= inverse_norm;
+  qy *= inverse_norm;
+  qz *= inverse_norm;
+
+  // Rotates v by q as v + w * t + q_vec x t with t = 2 * q_vec x v.
+  const auto px = Slice(point_cloud.x(), begin, end);
+  const auto py = Slice(point_cloud.y(), begin, end);
+  const auto pz = Slice(point_cloud.z(), begin, end);
+  const Eigen::ArrayXf tx = 2.f * (qy * pz - qz * py);
+  const Eigen::ArrayXf ty = 2.f * (qz * px - qx * pz);
+  const Eigen::ArrayXf tz = 2.f * (qx * py - qy * px);
+  Slice(x, begin, end) = px + qw * tx + (qy * tz - qz * ty) + t0.x() +
+                         alpha * (t1.x() - t0.x());
+  Slice(y, begin, end) = py + qw * ty + (qz * tx - qx * tz) + t0.y() +
+                         alpha * (t1.y() - t0.y());
+  Slice(z, begin, end) = pz + qw * tz + (qx * ty - qy * tx) + t0.z() +
+                         alpha * (t1.z() - t0.z());
+}
+
+}  // namespace
+
+std::vector<common::Time> GetDeskewKnotTimes(const common::Time first_time,
+                                             const common::Time last_time,
+                                             const int num_knots) {
+  CHECK_GE(num_knots, 2);
+  CHECK_LE(first_time, last_time);
+  std::vector<common::Time> knot_times;
+  knot_times.reserve(num_knots);
+  for (int i = 0; i + 1 < num_knots; ++i) {
+    knot_times.push_back(first_time +
+                         (last_time - first_time) * i / (num_knots - 1));
+  }
+  // Exactly 'last_time', so that the last pose is the current one.
+  knot_times.push_back(last_time);
+  return knot_times;
+}
+
+sensor::ColumnarPointCloud DeskewPointCloud(
+    const sensor::ColumnarPointCloud& point_cloud,
+    const std::vector<transform::Rigid3f>& knot_poses,
+    const float knot_interval) {
+  CHECK_GE(knot_poses.size(), 2);
+  CHECK(point_cloud.has_time() || point_cloud.empty());
+  if (!(knot_interval > 0.f)) {
+    // All knots are at the same time.
+    return sensor::TransformPointCloud(point_cloud, knot_poses.front());
+  }
+
+  const size_t size = point_cloud.size();
+  const Column& time = point_cloud.time();
+  Column x(size);
+  Column y(size);
+  Column z(size);
+  const size_t num_segments = knot_poses.size() - 1;
+  size_t begin = 0;
+  for (size_t i = 0; i < num_segments && begin < size; ++i) {
+    const float start_time = i * knot_interval;
+    // The last segment also takes points slightly after the last knot due to
+    // rounding.
+    const size_t end =
+        i + 1 == num_segments
+            ? size
+            : std::upper_bound(time.begin() + begin, time.end(),
+                               start_time + knot_interval) -
+                  time.begin();
+    if (end == begin) continue;
+    DeskewSegment(point_cloud, begin, end, knot_poses[i], knot_poses[i + 1],
+                  start_time, knot_interval, &x, &y, &z);
+    begin = end;
+  }
+  return sensor::ColumnarPointCloud(std::move(x), std::move(y), std::move(z),
+                                    point_cloud.time(),
+                                    point_cloud.intensity());
+}
+
+}  // namespace mapping
+}  // namespace cartographer
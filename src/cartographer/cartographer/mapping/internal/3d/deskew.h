@@ -0,0 +1,48 @@
+/*
+ * Copyright 2016 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_MAPPING_INTERNAL_3D_DESKEW_H_
+#define CARTOGRAPHER_MAPPING_INTERNAL_3D_DESKEW_H_
+
+#include <vector>
+
+#include "cartographer/common/time.h"
+#include "cartographer/sensor/columnar_point_cloud.h"
+#include "cartographer/transform/rigid_transform.h"
+
+namespace cartographer {
+namespace mapping {
+
+// Returns 'num_knots' evenly spaced times from 'first_time' to 'last_time',
+// at which to extrapolate the poses for 'DeskewPointCloud'.
+std::vector<common::Time> GetDeskewKnotTimes(common::Time first_time,
+                                             common::Time last_time,
+                                             int num_knots);
+
+// Transforms each point of 'point_cloud' by the pose at its time, which is
+// interpolated between the two surrounding 'knot_poses'. The knots are
+// 'knot_interval' seconds apart and the times of 'point_cloud' are in seconds
+// since the first knot and must not decrease. Translations are interpolated
+// linearly and rotations by normalized linear interpolation, which is close to
+// slerp for the small rotations between neighbouring knots.
+sensor::ColumnarPointCloud DeskewPointCloud(
+    const sensor::ColumnarPointCloud& point_cloud,
+    const std::vector<transform::Rigid3f>& knot_poses, float knot_interval);
+
+}  // namespace mapping
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_MAPPING_INTERNAL_3D_DESKEW_H_
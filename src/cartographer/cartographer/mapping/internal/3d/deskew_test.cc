@@ -0,0 +1,85 @@
+/*
+ * Copyright 2016 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping/internal/3d/deskew.h"
+
+#include <cmath>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace mapping {
+namespace {
+
+using ::testing::ElementsAre;
+
+// Pose of a sensor turning and moving at constant rates 't' seconds in.
+transform::Rigid3f PoseAt(const float t) {
+  const Eigen::Quaternionf rotation(
+      Eigen::AngleAxisf(3.f * t, Eigen::Vector3f::UnitZ()) *
+      Eigen::AngleAxisf(0.5f * t, Eigen::Vector3f::UnitX()));
+  return transform::Rigid3f(
+      Eigen::Vector3f(1.f + 2.f * t, -0.5f * t, 0.1f * t), rotation);
+}
+
+TEST(DeskewTest, KnotTimesAreEvenlySpaced) {
+  const common::Time first_time = common::FromUniversal(1000);
+  const common::Time last_time = first_time + common::FromSeconds(0.1);
+  EXPECT_THAT(GetDeskewKnotTimes(first_time, last_time, 3),
+              ElementsAre(first_time, first_time + common::FromSeconds(0.05),
+                          last_time));
+  EXPECT_THAT(GetDeskewKnotTimes(first_time, first_time, 2),
+              ElementsAre(first_time, first_time));
+}
+
+TEST(DeskewTest, InterpolatesPosesBetweenKnots) {
+  constexpr int kNumKnots = 9;
+  constexpr float kScanDuration = 0.1f;
+  constexpr float kKnotInterval = kScanDuration / (kNumKnots - 1);
+  std::vector<transform::Rigid3f> knot_poses;
+  for (int i = 0; i < kNumKnots; ++i) {
+    knot_poses.push_back(PoseAt(i * kKnotInterval));
+  }
+  sensor::TimedPointCloud timed_point_cloud;
+  for (int i = 0; i <= 1000; ++i) {
+    const float t = kScanDuration * i / 1000.f;
+    timed_point_cloud.push_back(
+        {Eigen::Vector3f(10.f * std::cos(100.f * t), 10.f * std::sin(100.f * t),
+                         -1.f + t),
+         t});
+  }
+  const sensor::TimedPointCloud result =
+      DeskewPointCloud(sensor::ColumnarPointCloud(timed_point_cloud),
+                       knot_poses, kKnotInterval)
+          .ToTimedPointCloud();
+  ASSERT_EQ(result.size(), timed_point_cloud.size());
+  for (size_t i = 0; i < result.size(); ++i) {
+    const sensor::TimedRangefinderPoint& point = timed_point_cloud[i];
+    const Eigen::Vector3f expected = PoseAt(point.time) * point.position;
+    EXPECT_NEAR((result[i].position - expected).norm(), 0.f, 1e-3f) << i;
+    EXPECT_EQ(result[i].time, point.time);
+  }
+  // Points at the knots get the knot poses.
+  EXPECT_TRUE(result.back().position.isApprox(
+      knot_poses.back() * timed_point_cloud.back().position, 1e-6f));
+  EXPECT_TRUE(result.front().position.isApprox(
+      knot_poses.front() * timed_point_cloud.front().position, 1e-6f));
+}
+
+}  // namespace
+}  // namespace mapping
+}  // namespace cartographer
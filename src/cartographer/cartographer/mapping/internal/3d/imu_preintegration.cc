@@ -0,0 +1,137 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping/internal/3d/imu_preintegration.h"
+
+#include <cmath>
+
+#include "cartographer/transform/transform.h"
+
+namespace cartographer {
+namespace mapping {
+
+namespace {
+
+Eigen::Matrix3d SkewSymmetric(const Eigen::Vector3d& v) {
+  Eigen::Matrix3d result;
+  result << 0., -v.z(), v.y(), v.z(), 0., -v.x(), -v.y(), v.x(), 0.;
+  return result;
+}
+
+// Right Jacobian of the exponential map of SO(3), i.e.
+// Exp(phi + delta) ~= Exp(phi) * Exp(RightJacobian(phi) * delta).
+Eigen::Matrix3d RightJacobian(const Eigen::Vector3d& phi) {
+  const Eigen::Matrix3d skew = SkewSymmetric(phi);
+  const double angle = phi.norm();
+  if (angle < 1e-6) {
+    return Eigen::Matrix3d::Identity() - 0.5 * skew + skew * skew / 6.;
+  }
+  const double angle_squared = angle * angle;
+  return Eigen::Matrix3d::Identity() -
+         (1. - std::cos(angle)) / angle_squared * skew +
+         (angle - std::sin(angle)) / (angle_squared * angle) * skew * skew;
+}
+
+}  // namespace
+
+ImuPreintegration::ImuPreintegration()
+    : delta_rotation_(Eigen::Quaterniond::Identity()),
+      delta_velocity_(Eigen::Vector3d::Zero()),
+      delta_translation_(Eigen::Vector3d::Zero()),
+      duration_(0.),
+      d_rotation_d_bg_(Eigen::Matrix3d::Zero()),
+      d_velocity_d_bg_(Eigen::Matrix3d::Zero()),
+      d_velocity_d_ba_(Eigen::Matrix3d::Zero()),
+      d_translation_d_bg_(Eigen::Matrix3d::Zero()),
+      d_translation_d_ba_(Eigen::Matrix3d::Zero()) {}
+
+void ImuPreintegration::Integrate(const Eigen::Vector3d& angular_velocity,
+                                  const Eigen::Vector3d& linear_acceleration,
+                                  const double delta_t) {
+  const Eigen::Vector3d delta_angle = angular_velocity * delta_t;
+  const Eigen::Quaterniond step_rotation =
+      transform::AngleAxisVectorToRotationQuaternion(delta_angle);
+  d_rotation_d_bg_ =
+      step_rotation.conjugate().toRotationMatrix() * d_rotation_d_bg_ -
+      RightJacobian(delta_angle) * delta_t;
+  delta_rotation_ *= step_rotation;
+
+  // As in 'IntegrateImu()', the acceleration is rotated by the orientation at
+  // the end of the step.
+  const Eigen::Matrix3d rotation = delta_rotation_.toRotationMatrix();
+  d_velocity_d_bg_ -= rotation * SkewSymmetric(linear_acceleration) *
+                      d_rotation_d_bg_ * delta_t;
+  d_velocity_d_ba_ -= rotation * delta_t;
+  delta_velocity_ += rotation * (linear_acceleration * delta_t);
+
+  d_translation_d_bg_ += delta_t * d_velocity_d_bg_;
+  d_translation_d_ba_ += delta_t * d_velocity_d_ba_;
+  delta_translation_ += delta_t * delta_velocity_;
+  duration_ += delta_t;
+}
+
+void ImuPreintegration::Append(const ImuPreintegration& next) {
+  const Eigen::Matrix3d rotation = delta_rotation_.toRotationMatrix();
+  // Translation and velocity depend on the values of this interval, so they
+  // are updated before the velocity and rotation.
+  d_translation_d_bg_ +=
+      next.duration_ * d_velocity_d_bg_ + rotation * next.d_translation_d_bg_ -
+      rotation * SkewSymmetric(next.delta_translation_) * d_rotation_d_bg_;
+  d_translation_d_ba_ +=
+      next.duration_ * d_velocity_d_ba_ + rotation * next.d_translation_d_ba_;
+  delta_translation_ +=
+      next.duration_ * delta_velocity_ + rotation * next.delta_translation_;
+
+  d_velocity_d_bg_ +=
+      rotation * next.d_velocity_d_bg_ -
+      rotation * SkewSymmetric(next.delta_velocity_) * d_rotation_d_bg_;
+  d_velocity_d_ba_ += rotation * next.d_velocity_d_ba_;
+  delta_velocity_ += rotation * next.delta_velocity_;
+
+  d_rotation_d_bg_ =
+      next.delta_rotation_.conjugate().toRotationMatrix() * d_rotation_d_bg_ +
+      next.d_rotation_d_bg_;
+  delta_rotation_ *= next.delta_rotation_;
+  duration_ += next.duration_;
+}
+
+IntegrateImuResult<double> ImuPreintegration::Corrected(
+    const Eigen::Vector3d& angular_velocity_bias,
+    const Eigen::Vector3d& linear_acceleration_bias) const {
+  const Eigen::Vector3d rotation_correction =
+      d_rotation_d_bg_ * angular_velocity_bias;
+  return IntegrateImuResult<double>{
+      delta_velocity_ + d_velocity_d_bg_ * angular_velocity_bias +
+          d_velocity_d_ba_ * linear_acceleration_bias,
+      delta_translation_ + d_translation_d_bg_ * angular_velocity_bias +
+          d_translation_d_ba_ * linear_acceleration_bias,
+      delta_rotation_ *
+          transform::AngleAxisVectorToRotationQuaternion(rotation_correction)};
+}
+
+Eigen::Vector3d ComputeDeltaVelocityBetweenCenters(
+    const ImuPreintegrationBetweenNodes& first,
+    const ImuPreintegrationBetweenNodes& second) {
+  // Integrating from the first center to the second center gives
+  // v = v_first + R_first * v_second in the IMU frame at the first center.
+  // Rotating it into the frame at the node between both intervals leaves:
+  return first.from_center.delta_rotation().conjugate() *
+             first.from_center.delta_velocity() +
+         second.to_center.delta_velocity();
+}
+
+}  // namespace mapping
+}  // namespace cartographer
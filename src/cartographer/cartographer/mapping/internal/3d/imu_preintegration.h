@@ -0,0 +1,155 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_MAPPING_INTERNAL_3D_IMU_PREINTEGRATION_H_
+#define CARTOGRAPHER_MAPPING_INTERNAL_3D_IMU_PREINTEGRATION_H_
+
+#include <algorithm>
+
+#include "Eigen/Core"
+#include "Eigen/Geometry"
+#include "cartographer/common/time.h"
+#include "cartographer/mapping/internal/3d/imu_integration.h"
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace mapping {
+
+// IMU measurements integrated over an interval, expressed in the IMU frame at
+// the start of the interval. Integration follows 'IntegrateImu()'. In addition,
+// the Jacobians of the deltas with respect to constant biases of the angular
+// velocity and linear acceleration are tracked, so that the result can be
+// corrected for small bias changes without integrating again.
+class ImuPreintegration {
+ public:
+  // An empty interval.
+  ImuPreintegration();
+
+  // Integrates constant 'angular_velocity' and 'linear_acceleration' over
+  // 'delta_t' seconds at the end of the interval.
+  void Integrate(const Eigen::Vector3d& angular_velocity,
+                 const Eigen::Vector3d& linear_acceleration, double delta_t);
+
+  // Extends the interval by 'next', which must start where this interval ends.
+  void Append(const ImuPreintegration& next);
+
+  // Returns the deltas as if 'angular_velocity_bias' and
+  // 'linear_acceleration_bias' had been subtracted from the IMU data, to first
+  // order.
+  IntegrateImuResult<double> Corrected(
+      const Eigen::Vector3d& angular_velocity_bias,
+      const Eigen::Vector3d& linear_acceleration_bias) const;
+
+  const Eigen::Quaterniond& delta_rotation() const { return delta_rotation_; }
+  const Eigen::Vector3d& delta_velocity() const { return delta_velocity_; }
+  const Eigen::Vector3d& delta_translation() const {
+    return delta_translation_;
+  }
+  double duration() const { return duration_; }
+
+  // Jacobians with respect to the angular velocity bias 'b_g' and linear
+  // acceleration bias 'b_a'. The rotation is perturbed on the right, i.e.
+  // delta_rotation(b_g) = delta_rotation * Exp(d_rotation_d_bg * b_g).
+  const Eigen::Matrix3d& d_rotation_d_bg() const { return d_rotation_d_bg_; }
+  const Eigen::Matrix3d& d_velocity_d_bg() const { return d_velocity_d_bg_; }
+  const Eigen::Matrix3d& d_velocity_d_ba() const { return d_velocity_d_ba_; }
+  const Eigen::Matrix3d& d_translation_d_bg() const {
+    return d_translation_d_bg_;
+  }
+  const Eigen::Matrix3d& d_translation_d_ba() const {
+    return d_translation_d_ba_;
+  }
+
+ private:
+  Eigen::Quaterniond delta_rotation_;
+  Eigen::Vector3d delta_velocity_;
+  Eigen::Vector3d delta_translation_;
+  double duration_;
+  Eigen::Matrix3d d_rotation_d_bg_;
+  Eigen::Matrix3d d_velocity_d_bg_;
+  Eigen::Matrix3d d_velocity_d_ba_;
+  Eigen::Matrix3d d_translation_d_bg_;
+  Eigen::Matrix3d d_translation_d_ba_;
+};
+
+// Same as 'IntegrateImu()', but returns an 'ImuPreintegration'.
+template <typename RangeType, typename IteratorType>
+ImuPreintegration PreintegrateImu(const RangeType& imu_data,
+                                  const common::Time start_time,
+                                  const common::Time end_time,
+                                  IteratorType* const it) {
+  CHECK_LE(start_time, end_time);
+  CHECK(*it != imu_data.end());
+  CHECK_LE((*it)->time, start_time);
+  if (std::next(*it) != imu_data.end()) {
+    CHECK_GT(std::next(*it)->time, start_time);
+  }
+
+  ImuPreintegration result;
+  common::Time current_time = start_time;
+  while (current_time < end_time) {
+    common::Time next_imu_data = common::Time::max();
+    if (std::next(*it) != imu_data.end()) {
+      next_imu_data = std::next(*it)->time;
+    }
+    const common::Time next_time = std::min(next_imu_data, end_time);
+    result.Integrate((*it)->angular_velocity, (*it)->linear_acceleration,
+                     common::ToSeconds(next_time - current_time));
+    current_time = next_time;
+    if (current_time == next_imu_data) {
+      ++(*it);
+    }
+  }
+  return result;
+}
+
+// IMU data between two consecutive nodes, split at the center of the interval.
+// This is what the IMU residuals of the 3D optimization need, and it only
+// depends on the two nodes, so it can be computed once per node pair.
+struct ImuPreintegrationBetweenNodes {
+  ImuPreintegration to_center;
+  ImuPreintegration from_center;
+
+  Eigen::Quaterniond delta_rotation() const {
+    return to_center.delta_rotation() * from_center.delta_rotation();
+  }
+};
+
+// Preintegrates the IMU data between nodes at 'first_time' and 'second_time'.
+// Leaves 'it' where 'IntegrateImu()' would.
+template <typename RangeType, typename IteratorType>
+ImuPreintegrationBetweenNodes PreintegrateImuBetweenNodes(
+    const RangeType& imu_data, const common::Time first_time,
+    const common::Time second_time, IteratorType* const it) {
+  const common::Time center = first_time + (second_time - first_time) / 2;
+  ImuPreintegrationBetweenNodes result;
+  result.to_center = PreintegrateImu(imu_data, first_time, center, it);
+  result.from_center = PreintegrateImu(imu_data, center, second_time, it);
+  return result;
+}
+
+// Returns the change in velocity from the center of 'first' to the center of
+// 'second', which must be consecutive. It still contains a delta due to
+// gravity and is expressed in the IMU frame at the node between the intervals,
+// as needed by 'AccelerationCostFunction3D'.
+Eigen::Vector3d ComputeDeltaVelocityBetweenCenters(
+    const ImuPreintegrationBetweenNodes& first,
+    const ImuPreintegrationBetweenNodes& second);
+
+}  // namespace mapping
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_MAPPING_INTERNAL_3D_IMU_PREINTEGRATION_H_
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping/internal/3d/imu_preintegration.h"
+
+#include <deque>
+
+#include "cartographer/mapping/internal/3d/imu_integration.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace mapping {
+namespace {
+
+constexpr double kPrecision = 1e-9;
+
+// 100 Hz of rotating and accelerating IMU data starting at 'start_time'.
+std::deque<sensor::ImuData> CreateImuData(const common::Time start_time,
+                                          const Eigen::Vector3d& gyro_bias,
+                                          const Eigen::Vector3d& accel_bias) {
+  std::deque<sensor::ImuData> imu_data;
+  for (int i = 0; i < 200; ++i) {
+    const double t = 0.01 * i;
+    imu_data.push_back(sensor::ImuData{
+        start_time + common::FromSeconds(t),
+        Eigen::Vector3d(0.3 + std::sin(t), -2. * t, 9.81 + 0.5 * std::cos(t)) +
+            accel_bias,
+        Eigen::Vector3d(0.2 * std::cos(3. * t), 0.5, -0.4 * t) + gyro_bias});
+  }
+  return imu_data;
+}
+
+void ExpectNear(const IntegrateImuResult<double>& expected,
+                const IntegrateImuResult<double>& actual,
+                const double precision) {
+  EXPECT_NEAR(expected.delta_rotation.angularDistance(actual.delta_rotation),
+              0., precision);
+  EXPECT_TRUE(
+      expected.delta_velocity.isApprox(actual.delta_velocity, precision))
+      << expected.delta_velocity.transpose() << " vs "
+      << actual.delta_velocity.transpose();
+  EXPECT_TRUE(
+      expected.delta_translation.isApprox(actual.delta_translation, precision))
+      << expected.delta_translation.transpose() << " vs "
+      << actual.delta_translation.transpose();
+}
+
+TEST(ImuPreintegrationTest, MatchesIntegrateImu) {
+  const common::Time start = common::FromUniversal(1000);
+  const auto imu_data =
+      CreateImuData(start, Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero());
+  const common::Time first_time = start + common::FromSeconds(0.123);
+  const common::Time second_time = start + common::FromSeconds(1.456);
+
+  auto it = imu_data.begin() + 12;
+  const IntegrateImuResult<double> expected =
+      IntegrateImu(imu_data, first_time, second_time, &it);
+  auto preintegration_it = imu_data.begin() + 12;
+  const ImuPreintegration preintegration =
+      PreintegrateImu(imu_data, first_time, second_time, &preintegration_it);
+  EXPECT_TRUE(it == preintegration_it);
+  EXPECT_NEAR(preintegration.duration(), 1.333, kPrecision);
+  ExpectNear(expected,
+             preintegration.Corrected(Eigen::Vector3d::Zero(),
+                                      Eigen::Vector3d::Zero()),
+             kPrecision);
+}
+
+TEST(ImuPreintegrationTest, AppendMatchesIntegratingAtOnce) {
+  const common::Time start = common::FromUniversal(1000);
+  const auto imu_data =
+      CreateImuData(start, Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero());
+  const common::Time first_time = start;
+  // Split at an IMU sample, so that both integrate the same steps.
+  const common::Time split_time = start + common::FromSeconds(0.7);
+  const common::Time second_time = start + common::FromSeconds(1.5);
+
+  auto it = imu_data.begin();
+  const ImuPreintegration expected =
+      PreintegrateImu(imu_data, first_time, second_time, &it);
+  it = imu_data.begin();
+  ImuPreintegration actual =
+      PreintegrateImu(imu_data, first_time, split_time, &it);
+  actual.Append(PreintegrateImu(imu_data, split_time, second_time, &it));
+
+  EXPECT_NEAR(expected.duration(), actual.duration(), kPrecision);
+  ExpectNear(
+      expected.Corrected(Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero()),
+      actual.Corrected(Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero()),
+      kPrecision);
+  EXPECT_TRUE(expected.d_rotation_d_bg().isApprox(actual.d_rotation_d_bg()));
+  EXPECT_TRUE(expected.d_velocity_d_bg().isApprox(actual.d_velocity_d_bg()));
+  EXPECT_TRUE(expected.d_velocity_d_ba().isApprox(actual.d_velocity_d_ba()));
+  EXPECT_TRUE(
+      expected.d_translation_d_bg().isApprox(actual.d_translation_d_bg()));
+  EXPECT_TRUE(
+      expected.d_translation_d_ba().isApprox(actual.d_translation_d_ba()));
+}
+
+TEST(ImuPreintegrationTest, CorrectsForBiasWithoutIntegratingAgain) {
+  const common::Time start = common::FromUniversal(1000);
+  const Eigen::Vector3d gyro_bias(0.002, -0.003, 0.001);
+  const Eigen::Vector3d accel_bias(0.05, 0.02, -0.04);
+  const auto biased_imu_data = CreateImuData(start, gyro_bias, accel_bias);
+  const auto imu_data =
+      CreateImuData(start, Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero());
+  const common::Time end = start + common::FromSeconds(1.);
+
+  auto it = imu_data.begin();
+  const IntegrateImuResult<double> expected =
+      IntegrateImu(imu_data, start, end, &it);
+  auto biased_it = biased_imu_data.begin();
+  const ImuPreintegration biased =
+      PreintegrateImu(biased_imu_data, start, end, &biased_it);
+  ExpectNear(expected, biased.Corrected(gyro_bias, accel_bias), 1e-4);
+
+  // Without the correction, the bias is clearly visible.
+  EXPECT_GT((expected.delta_velocity - biased.delta_velocity()).norm(), 1e-2);
+}
+
+TEST(ImuPreintegrationTest, DeltaVelocityBetweenCentersMatchesIntegrateImu) {
+  const common::Time start = common::FromUniversal(1000);
+  const auto imu_data =
+      CreateImuData(start, Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero());
+  const common::Time first_time = start + common::FromSeconds(0.1);
+  const common::Time second_time = start + common::FromSeconds(0.6);
+  const common::Time third_time = start + common::FromSeconds(1.3);
+  const common::Time first_center = first_time + (second_time - first_time) / 2;
+  const common::Time second_center =
+      second_time + (third_time - second_time) / 2;
+
+  auto it = imu_data.begin() + 10;
+  auto it2 = it;
+  const IntegrateImuResult<double> result =
+      IntegrateImu(imu_data, first_time, second_time, &it);
+  const IntegrateImuResult<double> result_to_first_center =
+      IntegrateImu(imu_data, first_time, first_center, &it2);
+  const IntegrateImuResult<double> result_center_to_center =
+      IntegrateImu(imu_data, first_center, second_center, &it2);
+  const Eigen::Vector3d expected =
+      (result.delta_rotation.inverse() *
+       result_to_first_center.delta_rotation) *
+      result_center_to_center.delta_velocity;
+
+  it = imu_data.begin() + 10;
+  const ImuPreintegrationBetweenNodes first =
+      PreintegrateImuBetweenNodes(imu_data, first_time, second_time, &it);
+  const ImuPreintegrationBetweenNodes second =
+      PreintegrateImuBetweenNodes(imu_data, second_time, third_time, &it);
+  EXPECT_NEAR(first.delta_rotation().angularDistance(result.delta_rotation),
+              0., kPrecision);
+  // Node times are IMU sample times here, so splitting the integration at the
+  // second node does not change the result.
+  EXPECT_TRUE(expected.isApprox(
+      ComputeDeltaVelocityBetweenCenters(first, second), kPrecision));
+}
+
+}  // namespace
+}  // namespace mapping
+}  // namespace cartographer
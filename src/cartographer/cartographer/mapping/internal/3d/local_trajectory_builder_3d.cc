@@ -20,11 +20,13 @@
 
 #include "absl/memory/memory.h"
 #include "cartographer/common/time.h"
+#include "cartographer/mapping/internal/3d/deskew.h"
 #include "cartographer/mapping/internal/3d/scan_matching/rotational_scan_matcher.h"
 #include "cartographer/mapping/proto/local_trajectory_builder_options_3d.pb.h"
 #include "cartographer/mapping/proto/scan_matching/ceres_scan_matcher_options_3d.pb.h"
 #include "cartographer/mapping/proto/scan_matching/real_time_correlative_scan_matcher_options.pb.h"
 #include "cartographer/mapping/proto/submaps_options_3d.pb.h"
+#include "cartographer/metrics/stage_timer.h"
 #include "cartographer/transform/timestamped_transform.h"
 #include "glog/logging.h"
 
@@ -45,6 +47,53 @@ static auto* kCeresScanMatcherCostMetric = metrics::Histogram::Null();
 static auto* kScanMatcherResidualDistanceMetric = metrics::Histogram::Null();
 static auto* kScanMatcherResidualAngleMetric = metrics::Histogram::Null();
 
+namespace {
+
+// Collects the hits of 'range_data' and their origins in the tracking frame,
+// both with the time of the hit in seconds since the first hit.
+void CollectHitsAndOrigins(
+    const std::vector<sensor::TimedPointCloudOriginData>& range_data,
+    const std::vector<common::Time>& hit_times,
+    sensor::ColumnarPointCloud* const hits,
+    sensor::ColumnarPointCloud* const origins) {
+  const size_t num_hits = hit_times.size() - 1;
+  sensor::ColumnarPointCloud::Column hits_x, hits_y, hits_z;
+  sensor::ColumnarPointCloud::Column origins_x, origins_y, origins_z;
+  sensor::ColumnarPointCloud::Column time;
+  for (auto* column : {&hits_x, &hits_y, &hits_z, &origins_x, &origins_y,
+                       &origins_z, &time}) {
+    column->reserve(num_hits);
+  }
+  for (const auto& point_cloud_origin_data : range_data) {
+    for (const auto& hit : point_cloud_origin_data.ranges) {
+      const Eigen::Vector3f& origin =
+          point_cloud_origin_data.origins.at(hit.origin_index);
+      hits_x.push_back(hit.point_time.position.x());
+      hits_y.push_back(hit.point_time.position.y());
+      hits_z.push_back(hit.point_time.position.z());
+      origins_x.push_back(origin.x());
+      origins_y.push_back(origin.y());
+      origins_z.push_back(origin.z());
+      time.push_back(
+          common::ToSeconds(hit_times[time.size()] - hit_times.front()));
+    }
+  }
+  CHECK_EQ(time.size(), num_hits);
+  *hits = sensor::ColumnarPointCloud(std::move(hits_x), std::move(hits_y),
+                                     std::move(hits_z), time, {});
+  *origins = sensor::ColumnarPointCloud(std::move(origins_x),
+                                        std::move(origins_y),
+                                        std::move(origins_z), time, {});
+}
+
+Eigen::Vector3f GetPoint(const sensor::ColumnarPointCloud& point_cloud,
+                         const size_t index) {
+  return Eigen::Vector3f(point_cloud.x()[index], point_cloud.y()[index],
+                         point_cloud.z()[index]);
+}
+
+}  // namespace
+
 LocalTrajectoryBuilder3D::LocalTrajectoryBuilder3D(
     const mapping::proto::LocalTrajectoryBuilderOptions3D& options,
     const std::vector<std::string>& expected_range_sensor_ids)
@@ -75,9 +124,13 @@ std::unique_ptr<transform::Rigid3d> LocalTrajectoryBuilder3D::ScanMatch(
   if (options_.use_online_correlative_scan_matching()) {
     // We take a copy since we use 'initial_ceres_pose' as an output argument.
     const transform::Rigid3d initial_pose = initial_ceres_pose;
+    metrics::ScopedStageTimer timer(
+        metrics::Stage::kRealTimeCorrelativeScanMatcher);
     const double score = real_time_correlative_scan_matcher_->Match(
         initial_pose, high_resolution_point_cloud_in_tracking,
-        matching_submap->high_resolution_hybrid_grid(), &initial_ceres_pose);
+        matching_submap->high_resolution_hybrid_grid(),
+        low_resolution_point_cloud_in_tracking,
+        matching_submap->low_resolution_hybrid_grid(), &initial_ceres_pose);
     kRealTimeCorrelativeScanMatcherScoreMetric->Observe(score);
   }
 
@@ -87,15 +140,19 @@ std::unique_ptr<transform::Rigid3d> LocalTrajectoryBuilder3D::ScanMatch(
       options_.use_intensities()
           ? &matching_submap->high_resolution_intensity_hybrid_grid()
           : nullptr;
-  ceres_scan_matcher_->Match(
-      (matching_submap->local_pose().inverse() * pose_prediction).translation(),
-      initial_ceres_pose, {{&high_resolution_point_cloud_in_tracking,
-                            &matching_submap->high_resolution_hybrid_grid(),
-                            high_resolution_intensity_hybrid_grid},
-                           {&low_resolution_point_cloud_in_tracking,
-                            &matching_submap->low_resolution_hybrid_grid(),
-                            /*intensity_hybrid_grid=*/nullptr}},
-      &pose_observation_in_submap, &summary);
+  {
+    metrics::ScopedStageTimer timer(metrics::Stage::kCeresScanMatcher);
+    ceres_scan_matcher_->Match(
+        (matching_submap->local_pose().inverse() * pose_prediction)
+            .translation(),
+        initial_ceres_pose, {{&high_resolution_point_cloud_in_tracking,
+                              &matching_submap->high_resolution_hybrid_grid(),
+                              high_resolution_intensity_hybrid_grid},
+                             {&low_resolution_point_cloud_in_tracking,
+                              &matching_submap->low_resolution_hybrid_grid(),
+                              /*intensity_hybrid_grid=*/nullptr}},
+        &pose_observation_in_submap, &summary);
+  }
   
   kCeresScanMatcherCostMetric->Observe(summary.final_cost);
   const double residual_distance = (pose_observation_in_submap.translation() -
@@ -168,8 +225,11 @@ LocalTrajectoryBuilder3D::AddRangeData(
   }
 
   // Step: 2 对点云进行第一次体素滤波
-  synchronized_data.ranges = sensor::VoxelFilter(
-      synchronized_data.ranges, 0.5f * options_.voxel_filter_size());
+  std::vector<sensor::TimedPointCloudOriginData::RangeMeasurement>
+      filtered_ranges = sensor::VoxelFilter(
+          synchronized_data.ranges, 0.5f * options_.voxel_filter_size());
+  synchronized_data.ranges.swap(filtered_ranges);
+  range_data_collator_.RecycleRanges(std::move(filtered_ranges));
   // 将体素滤波之后的点存起来
   accumulated_point_cloud_origin_data_.emplace_back(
       std::move(synchronized_data));
@@ -206,12 +266,37 @@ LocalTrajectoryBuilder3D::AddRangeData(
   hit_times.push_back(accumulated_point_cloud_origin_data_.back().time);
 
   // Step: 3 预测出 每个点的时间戳时刻, tracking frame 在 local slam 坐标系下的位姿
-  const PoseExtrapolatorInterface::ExtrapolationResult extrapolation_result =
-      extrapolator_->ExtrapolatePosesWithGravity(hit_times);
-  std::vector<transform::Rigid3f> hits_poses(
-      std::move(extrapolation_result.previous_poses));
-  hits_poses.push_back(extrapolation_result.current_pose.cast<float>());
-  CHECK_EQ(hits_poses.size(), hit_times.size());
+  const bool deskew_with_knots = options_.num_deskew_knots() > 0;
+  PoseExtrapolatorInterface::ExtrapolationResult extrapolation_result;
+  std::vector<transform::Rigid3f> hits_poses;
+  sensor::ColumnarPointCloud hits_in_local;
+  sensor::ColumnarPointCloud origins_in_local;
+  if (deskew_with_knots) {
+    // Only extrapolate at a few knots and interpolate the poses in between.
+    sensor::ColumnarPointCloud hits;
+    sensor::ColumnarPointCloud origins;
+    CollectHitsAndOrigins(accumulated_point_cloud_origin_data_, hit_times,
+                          &hits, &origins);
+    const std::vector<common::Time> knot_times =
+        GetDeskewKnotTimes(hit_times.front(), hit_times.back(),
+                           options_.num_deskew_knots());
+    extrapolation_result =
+        extrapolator_->ExtrapolatePosesWithGravity(knot_times);
+    std::vector<transform::Rigid3f> knot_poses(
+        std::move(extrapolation_result.previous_poses));
+    knot_poses.push_back(extrapolation_result.current_pose.cast<float>());
+    const float knot_interval =
+        common::ToSeconds(hit_times.back() - hit_times.front()) /
+        (options_.num_deskew_knots() - 1);
+    hits_in_local = DeskewPointCloud(hits, knot_poses, knot_interval);
+    origins_in_local = DeskewPointCloud(origins, knot_poses, knot_interval);
+  } else {
+    extrapolation_result =
+        extrapolator_->ExtrapolatePosesWithGravity(hit_times);
+    hits_poses = std::move(extrapolation_result.previous_poses);
+    hits_poses.push_back(extrapolation_result.current_pose.cast<float>());
+    CHECK_EQ(hits_poses.size(), hit_times.size());
+  }
 
   const size_t max_possible_number_of_accumulated_points = hit_times.size();
   std::vector<sensor::RangefinderPoint> accumulated_points;
@@ -221,16 +306,22 @@ LocalTrajectoryBuilder3D::AddRangeData(
     accumulated_intensities.reserve(max_possible_number_of_accumulated_points);
   }
   sensor::PointCloud misses;
-  std::vector<transform::Rigid3f>::const_iterator hits_poses_it =
-      hits_poses.begin();
+  size_t hit_index = 0;
   // Step: 4 计算 returns 与 misses 点的坐标
   for (const auto& point_cloud_origin_data :
        accumulated_point_cloud_origin_data_) {
     for (const auto& hit : point_cloud_origin_data.ranges) {
-      const Eigen::Vector3f hit_in_local =
-          *hits_poses_it * hit.point_time.position;
-      const Eigen::Vector3f origin_in_local =
-          *hits_poses_it * point_cloud_origin_data.origins.at(hit.origin_index);
+      Eigen::Vector3f hit_in_local;
+      Eigen::Vector3f origin_in_local;
+      if (deskew_with_knots) {
+        hit_in_local = GetPoint(hits_in_local, hit_index);
+        origin_in_local = GetPoint(origins_in_local, hit_index);
+      } else {
+        const transform::Rigid3f& hit_pose = hits_poses[hit_index];
+        hit_in_local = hit_pose * hit.point_time.position;
+        origin_in_local =
+            hit_pose * point_cloud_origin_data.origins.at(hit.origin_index);
+      }
       const Eigen::Vector3f delta = hit_in_local - origin_in_local;
       const float range = delta.norm();
       if (range >= options_.min_range()) {
@@ -251,10 +342,10 @@ LocalTrajectoryBuilder3D::AddRangeData(
               origin_in_local + options_.max_range() / range * delta});
         }
       }
-      ++hits_poses_it;
+      ++hit_index;
     }
   }
-  CHECK(std::next(hits_poses_it) == hits_poses.end());
+  CHECK_EQ(hit_index + 1, hit_times.size());
   const sensor::PointCloud returns(std::move(accumulated_points),
                                    std::move(accumulated_intensities));
 
@@ -268,10 +359,13 @@ LocalTrajectoryBuilder3D::AddRangeData(
   // Step: 5 分别对 returns 与 misses 进行体素滤波
   const common::Time current_time = hit_times.back();
   const auto voxel_filter_start = std::chrono::steady_clock::now();
-  const sensor::RangeData filtered_range_data = {
-      extrapolation_result.current_pose.translation().cast<float>(),
-      sensor::VoxelFilter(returns, options_.voxel_filter_size()),
-      sensor::VoxelFilter(misses, options_.voxel_filter_size())};
+  const sensor::RangeData filtered_range_data = [&]() {
+    metrics::ScopedStageTimer timer(metrics::Stage::kVoxelFilter);
+    return sensor::RangeData{
+        extrapolation_result.current_pose.translation().cast<float>(),
+        sensor::VoxelFilter(returns, options_.voxel_filter_size()),
+        sensor::VoxelFilter(misses, options_.voxel_filter_size())};
+  }();
   const auto voxel_filter_stop = std::chrono::steady_clock::now();
   const auto voxel_filter_duration = voxel_filter_stop - voxel_filter_start;
 
@@ -317,20 +411,24 @@ LocalTrajectoryBuilder3D::AddAccumulatedRangeData(
   const auto scan_matcher_start = std::chrono::steady_clock::now();
 
   // Step: 7 使用高分辨率进行自适应体素滤波 生成高分辨率点云
-  const sensor::PointCloud high_resolution_point_cloud_in_tracking =
-      sensor::AdaptiveVoxelFilter(
-          filtered_range_data_in_tracking.returns,
-          options_.high_resolution_adaptive_voxel_filter_options());
+  const sensor::PointCloud high_resolution_point_cloud_in_tracking = [&]() {
+    metrics::ScopedStageTimer timer(metrics::Stage::kVoxelFilter);
+    return sensor::AdaptiveVoxelFilter(
+        filtered_range_data_in_tracking.returns,
+        options_.high_resolution_adaptive_voxel_filter_options());
+  }();
   if (high_resolution_point_cloud_in_tracking.empty()) {
     LOG(WARNING) << "Dropped empty high resolution point cloud data.";
     return nullptr;
   }
 
   // Step: 8 使用低分辨率进行自适应体素滤波 生成低分辨率点云
-  const sensor::PointCloud low_resolution_point_cloud_in_tracking =
-      sensor::AdaptiveVoxelFilter(
-          filtered_range_data_in_tracking.returns,
-          options_.low_resolution_adaptive_voxel_filter_options());
+  const sensor::PointCloud low_resolution_point_cloud_in_tracking = [&]() {
+    metrics::ScopedStageTimer timer(metrics::Stage::kVoxelFilter);
+    return sensor::AdaptiveVoxelFilter(
+        filtered_range_data_in_tracking.returns,
+        options_.low_resolution_adaptive_voxel_filter_options());
+  }();
   if (low_resolution_point_cloud_in_tracking.empty()) {
     LOG(WARNING) << "Dropped empty low resolution point cloud data.";
     return nullptr;
@@ -437,10 +535,13 @@ LocalTrajectoryBuilder3D::InsertIntoSubmap(
 
   const Eigen::Quaterniond local_from_gravity_aligned =
       pose_estimate.rotation() * gravity_alignment.inverse();
-  std::vector<std::shared_ptr<const mapping::Submap3D>> insertion_submaps =
-      active_submaps_.InsertData(filtered_range_data_in_local,
-                                 local_from_gravity_aligned,
-                                 rotational_scan_matcher_histogram_in_gravity);
+  std::vector<std::shared_ptr<const mapping::Submap3D>> insertion_submaps;
+  {
+    metrics::ScopedStageTimer timer(metrics::Stage::kInsertIntoSubmap);
+    insertion_submaps = active_submaps_.InsertData(
+        filtered_range_data_in_local, local_from_gravity_aligned,
+        rotational_scan_matcher_histogram_in_gravity);
+  }
   
   return absl::make_unique<InsertionResult>(
       InsertionResult{std::make_shared<const mapping::TrajectoryNode::Data>(
@@ -81,6 +81,7 @@ class LocalTrajectoryBuilderTest : public ::testing::Test {
             translation_weight = 0.1,
             rotation_weight = 0.3,
             only_optimize_yaw = false,
+            cache_interpolation_voxels = true,
             ceres_solver_options = {
               use_nonmonotonic_steps = true,
               max_num_iterations = 20,
@@ -304,6 +305,17 @@ TEST_F(LocalTrajectoryBuilderTest, MoveInsideCubeUsingOnlyCeresScanMatcher) {
   VerifyAccuracy(GenerateCorkscrewTrajectory(), 1e-1);
 }
 
+TEST_F(LocalTrajectoryBuilderTest, MoveInsideCubeDeskewingWithKnots) {
+  auto options = CreateTrajectoryBuilderOptions3D();
+  // Accumulating two range data spreads the hits over 0.3 s, so that their
+  // poses are interpolated between the knots.
+  options.set_num_accumulated_range_data(2);
+  options.set_num_deskew_knots(4);
+  local_trajectory_builder_.reset(
+      new LocalTrajectoryBuilder3D(options, {kSensorId}));
+  VerifyAccuracy(GenerateCorkscrewTrajectory(), 1e-1);
+}
+
 }  // namespace
 }  // namespace mapping
 }  // namespace cartographer
@@ -67,6 +67,11 @@ proto::LocalTrajectoryBuilderOptions3D CreateLocalTrajectoryBuilderOptions3D(
   *options.mutable_submaps_options() = CreateSubmapsOptions3D(
       parameter_dictionary->GetDictionary("submaps").get());
   options.set_use_intensities(parameter_dictionary->GetBool("use_intensities"));
+  if (parameter_dictionary->HasKey("num_deskew_knots")) {
+    options.set_num_deskew_knots(
+        parameter_dictionary->GetNonNegativeInt("num_deskew_knots"));
+    CHECK_NE(options.num_deskew_knots(), 1);
+  }
   return options;
 }
 
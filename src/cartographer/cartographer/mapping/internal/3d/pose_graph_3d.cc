@@ -28,9 +28,11 @@
 #include <string>
 
 #include "Eigen/Eigenvalues"
+#include "absl/container/flat_hash_set.h"
 #include "absl/memory/memory.h"
 #include "cartographer/common/math.h"
 #include "cartographer/mapping/proto/pose_graph/constraint_builder_options.pb.h"
+#include "cartographer/metrics/stage_timer.h"
 #include "cartographer/sensor/compressed_point_cloud.h"
 #include "cartographer/sensor/internal/voxel_filter.h"
 #include "cartographer/transform/transform.h"
@@ -41,6 +43,7 @@ namespace mapping {
 
 static auto* kWorkQueueDelayMetric = metrics::Gauge::Null();
 static auto* kWorkQueueSizeMetric = metrics::Gauge::Null();
+static auto* kShedConstraintSearchesMetric = metrics::Counter::Null();
 static auto* kConstraintsSameTrajectoryMetric = metrics::Gauge::Null();
 static auto* kConstraintsDifferentTrajectoryMetric = metrics::Gauge::Null();
 static auto* kActiveSubmapsMetric = metrics::Gauge::Null();
@@ -54,7 +57,16 @@ PoseGraph3D::PoseGraph3D(
     : options_(options),
       optimization_problem_(std::move(optimization_problem)),
       constraint_builder_(options_.constraint_builder_options(), thread_pool),
-      thread_pool_(thread_pool) {}
+      thread_pool_(thread_pool),
+      submap_index_(std::max(
+          1., options_.constraint_builder_options().max_constraint_distance())) {
+  if (options.has_memory_budget()) {
+    cold_storage_ = absl::make_unique<ColdStorage>(
+        options.memory_budget().directory(),
+        static_cast<int64>(options.memory_budget().memory_budget_in_mb() *
+                           1024. * 1024.));
+  }
+}
 
 PoseGraph3D::~PoseGraph3D() {
   WaitForAllComputations();
@@ -152,28 +164,43 @@ NodeId PoseGraph3D::AddNode(
   // execute the lambda.
   const bool newly_finished_submap =
       insertion_submaps.front()->insertion_finished();
-  AddWorkItem([=]() LOCKS_EXCLUDED(mutex_) {
-    return ComputeConstraintsForNode(node_id, insertion_submaps,
-                                     newly_finished_submap);
-  });
+  // Only the constraint search may be shed, the node is always added.
+  AddWorkItem(
+      [=]() LOCKS_EXCLUDED(mutex_) {
+        return ComputeConstraintsForNode(node_id, insertion_submaps,
+                                         newly_finished_submap,
+                                         true /* search_for_constraints */);
+      },
+      [=]() LOCKS_EXCLUDED(mutex_) {
+        return ComputeConstraintsForNode(node_id, insertion_submaps,
+                                         newly_finished_submap,
+                                         false /* search_for_constraints */);
+      });
   return node_id;
 }
 
 void PoseGraph3D::AddWorkItem(
-    const std::function<WorkItem::Result()>& work_item) {
+    const std::function<WorkItem::Result()>& work_item,
+    const std::function<WorkItem::Result()>& shed_work_item) {
   absl::MutexLock locker(&work_queue_mutex_);
   if (work_queue_ == nullptr) {
-    work_queue_ = absl::make_unique<WorkQueue>();
+    work_queue_ = absl::make_unique<WorkQueue>(
+        options_.work_queue().capacity(), options_.work_queue().shed_ratio());
     auto task = absl::make_unique<common::Task>();
     task->SetWorkItem([this]() { DrainWorkQueue(); });
     thread_pool_->Schedule(std::move(task));
   }
   const auto now = std::chrono::steady_clock::now();
-  work_queue_->push_back({now, work_item});
+  work_queue_->Push({now, work_item, shed_work_item});
+  UpdateWorkQueueMetrics(now);
+}
+
+void PoseGraph3D::UpdateWorkQueueMetrics(
+    const std::chrono::steady_clock::time_point now) {
   kWorkQueueSizeMetric->Set(work_queue_->size());
   kWorkQueueDelayMetric->Set(
       std::chrono::duration_cast<std::chrono::duration<double>>(
-          now - work_queue_->front().time)
+          work_queue_->GetOldestAge(now))
           .count());
 }
 
@@ -256,6 +283,7 @@ void PoseGraph3D::ComputeConstraint(const NodeId& node_id,
 
   bool maybe_add_local_constraint = false;
   bool maybe_add_global_constraint = false;
+  bool load_cold_data = false;
   const TrajectoryNode::Data* constant_data;
   const Submap3D* submap;
   {
@@ -289,6 +317,27 @@ void PoseGraph3D::ComputeConstraint(const NodeId& node_id,
       // is essentially ignored.
       maybe_add_global_constraint = true;
     }
+    if (cold_storage_ != nullptr &&
+        (maybe_add_local_constraint || maybe_add_global_constraint)) {
+      // The constraint builder drops local constraints beyond this distance,
+      // so there is no need to load evicted data for them.
+      if (maybe_add_local_constraint &&
+          (global_node_pose.translation() - global_submap_pose.translation())
+                  .norm() > options_.constraint_builder_options()
+                                .max_constraint_distance()) {
+        return;
+      }
+      load_cold_data = cold_storage_->IsEvicted(node_id) ||
+                       cold_storage_->IsEvicted(submap_id);
+    }
+    constant_data = data_.trajectory_nodes.at(node_id).constant_data.get();
+    submap = static_cast<const Submap3D*>(
+        data_.submap_data.at(submap_id).submap.get());
+  }
+
+  if (load_cold_data) {
+    LoadColdData(node_id, submap_id);
+    absl::MutexLock locker(&mutex_);
     constant_data = data_.trajectory_nodes.at(node_id).constant_data.get();
     submap = static_cast<const Submap3D*>(
         data_.submap_data.at(submap_id).submap.get());
@@ -305,10 +354,100 @@ void PoseGraph3D::ComputeConstraint(const NodeId& node_id,
   }
 }
 
+std::vector<SubmapId> PoseGraph3D::GetSubmapsForConstraintSearch(
+    const NodeId& node_id) {
+  const common::Time node_time =
+      data_.trajectory_nodes.at(node_id).constant_data->time;
+  std::vector<SubmapId> submap_ids;
+  absl::flat_hash_set<int> local_search_trajectory_ids;
+  for (const int trajectory_id : data_.submap_data.trajectory_ids()) {
+    // 'ComputeConstraint()' only uses a local search window for the node's own
+    // trajectory, and for trajectories connected to it recently enough
+    // compared to the latest node time of the pair. Nodes are added in time
+    // order, so the last node of a trajectory is its latest.
+    bool local_search_only = trajectory_id == node_id.trajectory_id;
+    if (!local_search_only) {
+      common::Time latest_node_time = node_time;
+      const auto end = data_.trajectory_nodes.EndOfTrajectory(trajectory_id);
+      if (data_.trajectory_nodes.BeginOfTrajectory(trajectory_id) != end) {
+        latest_node_time = std::max(
+            latest_node_time, std::prev(end)->data.constant_data->time);
+      }
+      local_search_only =
+          latest_node_time <
+          data_.trajectory_connectivity_state.LastConnectionTime(
+              node_id.trajectory_id, trajectory_id) +
+              common::FromSeconds(
+                  options_.global_constraint_search_after_n_seconds());
+    }
+    if (local_search_only) {
+      local_search_trajectory_ids.insert(trajectory_id);
+      continue;
+    }
+    // Submaps which may be matched globally all need to be visited, since
+    // that pulses the global localization sampler.
+    for (const auto& submap_id_data :
+         data_.submap_data.trajectory(trajectory_id)) {
+      if (submap_id_data.data.state == SubmapState::kFinished) {
+        CHECK_EQ(submap_id_data.data.node_ids.count(node_id), 0);
+        submap_ids.push_back(submap_id_data.id);
+      }
+    }
+  }
+
+  // The constraint builder drops local constraints with submaps farther than
+  // 'max_constraint_distance', so those are not even looked at. The padding
+  // keeps rounding from dropping submaps the constraint builder would accept.
+  constexpr double kSearchRadiusPadding = 1e-3;
+  UpdateSubmapIndex();
+  const Eigen::Vector3d node_position =
+      optimization_problem_->node_data().at(node_id).global_pose.translation();
+  for (const SubmapId& submap_id : submap_index_.FindWithinRadius(
+           node_position,
+           options_.constraint_builder_options().max_constraint_distance() +
+               kSearchRadiusPadding)) {
+    if (local_search_trajectory_ids.count(submap_id.trajectory_id) == 0) {
+      continue;
+    }
+    const auto it = data_.submap_data.find(submap_id);
+    if (it != data_.submap_data.end() &&
+        it->data.state == SubmapState::kFinished) {
+      CHECK_EQ(it->data.node_ids.count(node_id), 0);
+      submap_ids.push_back(submap_id);
+    }
+  }
+  std::sort(submap_ids.begin(), submap_ids.end());
+  return submap_ids;
+}
+
+void PoseGraph3D::UpdateSubmapIndex() {
+  const auto& submap_data = optimization_problem_->submap_data();
+  // New submaps are appended to their trajectory, so only the end of each
+  // trajectory has to be checked.
+  for (const int trajectory_id : submap_data.trajectory_ids()) {
+    const auto begin = submap_data.BeginOfTrajectory(trajectory_id);
+    const auto end = submap_data.EndOfTrajectory(trajectory_id);
+    auto it = end;
+    while (it != begin && !submap_index_.Contains(std::prev(it)->id)) {
+      --it;
+    }
+    for (; it != end; ++it) {
+      submap_index_.Insert(it->id, it->data.global_pose.translation());
+    }
+  }
+  if (submap_index_.size() != submap_data.size()) {
+    // Submaps were added elsewhere, e.g. when loading a state.
+    submap_index_.Clear();
+    for (auto it = submap_data.begin(); it != submap_data.end(); ++it) {
+      submap_index_.Insert(it->id, it->data.global_pose.translation());
+    }
+  }
+}
+
 WorkItem::Result PoseGraph3D::ComputeConstraintsForNode(
     const NodeId& node_id,
     std::vector<std::shared_ptr<const Submap3D>> insertion_submaps,
-    const bool newly_finished_submap) {
+    const bool newly_finished_submap, const bool search_for_constraints) {
   std::vector<SubmapId> submap_ids;
   std::vector<SubmapId> finished_submap_ids;
   std::set<NodeId> newly_finished_submap_node_ids;
@@ -348,11 +487,8 @@ WorkItem::Result PoseGraph3D::ComputeConstraintsForNode(
     // trajectories scheduled for deletion.
     // TODO(danielsievers): Add a member variable and avoid having to copy
     // them out here.
-    for (const auto& submap_id_data : data_.submap_data) {
-      if (submap_id_data.data.state == SubmapState::kFinished) {
-        CHECK_EQ(submap_id_data.data.node_ids.count(node_id), 0);
-        finished_submap_ids.emplace_back(submap_id_data.id);
-      }
+    if (search_for_constraints) {
+      finished_submap_ids = GetSubmapsForConstraintSearch(node_id);
     }
     if (newly_finished_submap) {
       const SubmapId newly_finished_submap_id = submap_ids.front();
@@ -368,6 +504,8 @@ WorkItem::Result PoseGraph3D::ComputeConstraintsForNode(
     ComputeConstraint(node_id, submap_id);
   }
 
+  // This search is never shed: old nodes are not matched against this
+  // submap again, so its loop closures would be lost for good.
   if (newly_finished_submap) {
     const SubmapId newly_finished_submap_id = submap_ids.front();
     // We have a new completed submap, so we look into adding constraints for
@@ -429,6 +567,144 @@ void PoseGraph3D::DeleteTrajectoriesIfNeeded() {
   }
 }
 
+void PoseGraph3D::EvictColdData() {
+  if (cold_storage_ == nullptr) return;
+
+  // Distances are measured to the latest node of each active trajectory, or of
+  // all trajectories if none is active.
+  std::vector<Eigen::Vector3d> active_positions;
+  std::vector<Eigen::Vector3d> latest_positions;
+  for (const int trajectory_id : data_.trajectory_nodes.trajectory_ids()) {
+    const auto end = data_.trajectory_nodes.EndOfTrajectory(trajectory_id);
+    if (data_.trajectory_nodes.BeginOfTrajectory(trajectory_id) == end) {
+      continue;
+    }
+    const Eigen::Vector3d position =
+        std::prev(end)->data.global_pose.translation();
+    latest_positions.push_back(position);
+    if (data_.trajectories_state.count(trajectory_id) != 0 &&
+        data_.trajectories_state.at(trajectory_id).state ==
+            TrajectoryState::ACTIVE) {
+      active_positions.push_back(position);
+    }
+  }
+  const std::vector<Eigen::Vector3d>& reference_positions =
+      active_positions.empty() ? latest_positions : active_positions;
+  const auto distance_to_reference = [&reference_positions](
+                                         const Eigen::Vector3d& position) {
+    double distance = std::numeric_limits<double>::max();
+    for (const Eigen::Vector3d& reference_position : reference_positions) {
+      distance = std::min(distance, (position - reference_position).norm());
+    }
+    return distance;
+  };
+
+  std::vector<std::pair<double, SubmapId>> submap_candidates;
+  for (const auto& submap_id_data : data_.submap_data) {
+    const SubmapId& submap_id = submap_id_data.id;
+    const InternalSubmapData& submap_data = submap_id_data.data;
+    if (submap_data.state != SubmapState::kFinished ||
+        !submap_data.submap->insertion_finished() ||
+        !data_.global_submap_poses_3d.Contains(submap_id) ||
+        cold_storage_->IsEvicted(submap_id)) {
+      continue;
+    }
+    if (!cold_storage_->IsTracked(submap_id)) {
+      cold_storage_->AddResident(
+          submap_id, submap_data.submap->ToProto(true /* include_grid_data */)
+                         .ByteSizeLong());
+    }
+    submap_candidates.emplace_back(
+        distance_to_reference(data_.global_submap_poses_3d.at(submap_id)
+                                  .global_pose.translation()),
+        submap_id);
+  }
+  std::vector<std::pair<double, NodeId>> node_candidates;
+  for (const auto& node_id_data : data_.trajectory_nodes) {
+    const auto& constant_data = node_id_data.data.constant_data;
+    if (constant_data == nullptr || cold_storage_->IsEvicted(node_id_data.id)) {
+      continue;
+    }
+    if (!cold_storage_->IsTracked(node_id_data.id)) {
+      cold_storage_->AddResident(node_id_data.id,
+                                 EstimatePointCloudBytes(*constant_data));
+    }
+    node_candidates.emplace_back(
+        distance_to_reference(node_id_data.data.global_pose.translation()),
+        node_id_data.id);
+  }
+
+  std::vector<SubmapId> submaps_to_evict;
+  std::vector<NodeId> nodes_to_evict;
+  cold_storage_->SelectForEviction(std::move(submap_candidates),
+                                   std::move(node_candidates),
+                                   &submaps_to_evict, &nodes_to_evict);
+  // Data loaded back for constraint search still has its copy on disk.
+  for (const SubmapId& submap_id : submaps_to_evict) {
+    std::shared_ptr<const Submap>& submap =
+        data_.submap_data.at(submap_id).submap;
+    if (!cold_storage_->IsOnDisk(submap_id)) {
+      cold_storage_->Write(submap_id,
+                           submap->ToProto(true /* include_grid_data */));
+    }
+    cold_storage_->Evict(submap_id);
+    submap = std::make_shared<const Submap3D>(
+        submap->ToProto(false /* include_grid_data */).submap_3d());
+    constraint_builder_.DeleteScanMatcher(submap_id);
+  }
+  for (const NodeId& node_id : nodes_to_evict) {
+    std::shared_ptr<const TrajectoryNode::Data>& constant_data =
+        data_.trajectory_nodes.at(node_id).constant_data;
+    if (!cold_storage_->IsOnDisk(node_id)) {
+      cold_storage_->Write(node_id, mapping::ToProto(*constant_data));
+    }
+    cold_storage_->Evict(node_id);
+    constant_data = WithoutPointClouds(*constant_data);
+  }
+  if (!submaps_to_evict.empty() || !nodes_to_evict.empty()) {
+    VLOG(1) << "Evicted " << submaps_to_evict.size() << " submaps and "
+            << nodes_to_evict.size() << " nodes, "
+            << cold_storage_->resident_bytes() << " bytes resident, "
+            << cold_storage_->evicted_bytes() << " bytes on disk.";
+  }
+}
+
+void PoseGraph3D::LoadColdData(const NodeId& node_id,
+                               const SubmapId& submap_id) {
+  std::unique_ptr<io::ProtoStreamReader> node_reader;
+  std::unique_ptr<io::ProtoStreamReader> submap_reader;
+  {
+    absl::MutexLock locker(&mutex_);
+    if (cold_storage_->IsEvicted(node_id)) {
+      node_reader = cold_storage_->Open(node_id);
+    }
+    if (cold_storage_->IsEvicted(submap_id)) {
+      submap_reader = cold_storage_->Open(submap_id);
+    }
+  }
+
+  std::shared_ptr<const TrajectoryNode::Data> constant_data;
+  if (node_reader != nullptr) {
+    constant_data = std::make_shared<const TrajectoryNode::Data>(
+        FromProto(ColdStorage::ReadNode(node_reader.get())));
+  }
+  std::shared_ptr<const Submap3D> submap;
+  if (submap_reader != nullptr) {
+    submap = std::make_shared<const Submap3D>(
+        ColdStorage::ReadSubmap(submap_reader.get()).submap_3d());
+  }
+
+  absl::MutexLock locker(&mutex_);
+  if (constant_data != nullptr) {
+    data_.trajectory_nodes.at(node_id).constant_data = std::move(constant_data);
+    cold_storage_->MakeResident(node_id);
+  }
+  if (submap != nullptr) {
+    data_.submap_data.at(submap_id).submap = std::move(submap);
+    cold_storage_->MakeResident(submap_id);
+  }
+}
+
 void PoseGraph3D::HandleWorkQueue(
     const constraints::ConstraintBuilder3D::Result& result) {
   {
@@ -479,6 +755,7 @@ void PoseGraph3D::HandleWorkQueue(
                          return trimmer->IsFinished();
                        }),
         trimmers_.end());
+    EvictColdData();
 
     num_nodes_since_last_loop_closure_ = 0;
 
@@ -508,6 +785,7 @@ void PoseGraph3D::HandleWorkQueue(
 void PoseGraph3D::DrainWorkQueue() {
   bool process_work_queue = true;
   size_t work_queue_size;
+  int num_shed_work_items = 0;
   while (process_work_queue) {
     std::function<WorkItem::Result()> work_item;
     {
@@ -516,14 +794,21 @@ void PoseGraph3D::DrainWorkQueue() {
         work_queue_.reset();
         return;
       }
-      work_item = work_queue_->front().task;
-      work_queue_->pop_front();
+      bool shed;
+      work_item = work_queue_->Pop(&shed);
+      if (shed) {
+        ++num_shed_work_items;
+        kShedConstraintSearchesMetric->Increment();
+      }
       work_queue_size = work_queue_->size();
-      kWorkQueueSizeMetric->Set(work_queue_size);
+      UpdateWorkQueueMetrics(std::chrono::steady_clock::now());
     }
     process_work_queue = work_item() == WorkItem::Result::kDoNotRunOptimization;
   }
   LOG(INFO) << "Remaining work items in queue: " << work_queue_size;
+  LOG_IF(WARNING, num_shed_work_items > 0)
+      << "Work queue over capacity, shed the constraint search of "
+      << num_shed_work_items << " nodes.";
   // We have to optimize again.
   constraint_builder_.WhenDone(
       [this](const constraints::ConstraintBuilder3D::Result& result) {
@@ -864,9 +1149,14 @@ void PoseGraph3D::RunOptimization() {
   // data_.frozen_trajectories and data_.landmark_nodes when executing the
   // Solve. Solve is time consuming, so not taking the mutex before Solve to
   // avoid blocking foreground processing.
-  optimization_problem_->Solve(data_.constraints, GetTrajectoryStates(),
-                               data_.landmark_nodes);
+  {
+    metrics::ScopedStageTimer timer(metrics::Stage::kOptimization);
+    optimization_problem_->Solve(data_.constraints, GetTrajectoryStates(),
+                                 data_.landmark_nodes);
+  }
   absl::MutexLock locker(&mutex_);
+  submap_index_.Clear();
+  UpdateSubmapIndex();
 
   const auto& submap_data = optimization_problem_->submap_data();
   const auto& node_data = optimization_problem_->node_data();
@@ -940,6 +1230,55 @@ MapById<NodeId, TrajectoryNode> PoseGraph3D::GetTrajectoryNodes() const {
   return data_.trajectory_nodes;
 }
 
+void PoseGraph3D::ForEachSubmapData(
+    const std::function<void(const SubmapId&, const SubmapData&)>& visitor)
+    const {
+  std::vector<SubmapId> submap_ids;
+  {
+    absl::MutexLock locker(&mutex_);
+    for (const auto& submap_id_data : data_.submap_data) {
+      submap_ids.push_back(submap_id_data.id);
+    }
+  }
+  for (const SubmapId& submap_id : submap_ids) {
+    const SubmapData submap_data = GetSubmapData(submap_id);
+    // Skip submaps trimmed in the meantime.
+    if (submap_data.submap == nullptr) continue;
+    visitor(submap_id, submap_data);
+  }
+}
+
+void PoseGraph3D::ForEachTrajectoryNode(
+    const std::function<void(const NodeId&, const TrajectoryNode&)>& visitor)
+    const {
+  std::vector<NodeId> node_ids;
+  {
+    absl::MutexLock locker(&mutex_);
+    for (const auto& node_id_data : data_.trajectory_nodes) {
+      node_ids.push_back(node_id_data.id);
+    }
+  }
+  for (const NodeId& node_id : node_ids) {
+    TrajectoryNode node;
+    std::unique_ptr<io::ProtoStreamReader> reader;
+    {
+      absl::MutexLock locker(&mutex_);
+      const auto it = data_.trajectory_nodes.find(node_id);
+      // Skip nodes trimmed in the meantime.
+      if (it == data_.trajectory_nodes.end()) continue;
+      node = it->data;
+      if (cold_storage_ != nullptr && cold_storage_->IsEvicted(node_id)) {
+        reader = cold_storage_->Open(node_id);
+      }
+    }
+    if (reader != nullptr) {
+      node.constant_data = std::make_shared<const TrajectoryNode::Data>(
+          FromProto(ColdStorage::ReadNode(reader.get())));
+    }
+    visitor(node_id, node);
+  }
+}
+
 MapById<NodeId, TrajectoryNodePose> PoseGraph3D::GetTrajectoryNodePoses()
     const {
   MapById<NodeId, TrajectoryNodePose> node_poses;
@@ -1069,8 +1408,21 @@ std::vector<std::vector<int>> PoseGraph3D::GetConnectedTrajectories() const {
 
 PoseGraphInterface::SubmapData PoseGraph3D::GetSubmapData(
     const SubmapId& submap_id) const {
-  absl::MutexLock locker(&mutex_);
-  return GetSubmapDataUnderLock(submap_id);
+  SubmapData submap_data;
+  std::unique_ptr<io::ProtoStreamReader> reader;
+  {
+    absl::MutexLock locker(&mutex_);
+    submap_data = GetSubmapDataUnderLock(submap_id);
+    if (cold_storage_ != nullptr && cold_storage_->IsEvicted(submap_id)) {
+      reader = cold_storage_->Open(submap_id);
+    }
+  }
+  // The evicted submap is loaded for the caller only and stays evicted.
+  if (reader != nullptr) {
+    submap_data.submap = std::make_shared<const Submap3D>(
+        ColdStorage::ReadSubmap(reader.get()).submap_3d());
+  }
+  return submap_data;
 }
 
 MapById<SubmapId, PoseGraphInterface::SubmapData>
@@ -1172,6 +1524,20 @@ PoseGraph3D::TrimmingHandle::GetTrajectoryNodes() const {
   return parent_->data_.trajectory_nodes;
 }
 
+std::shared_ptr<const Submap> PoseGraph3D::TrimmingHandle::GetFullSubmap(
+    const SubmapId& submap_id) const {
+  const std::shared_ptr<const Submap>& submap =
+      parent_->data_.submap_data.at(submap_id).submap;
+  if (parent_->cold_storage_ == nullptr ||
+      !parent_->cold_storage_->IsEvicted(submap_id)) {
+    return submap;
+  }
+  // Trimmers run with 'mutex_' held, so this reads from disk under it.
+  return std::make_shared<const Submap3D>(
+      ColdStorage::ReadSubmap(parent_->cold_storage_->Open(submap_id).get())
+          .submap_3d());
+}
+
 const std::vector<PoseGraphInterface::Constraint>&
 PoseGraph3D::TrimmingHandle::GetConstraints() const {
   return parent_->data_.constraints;
@@ -1261,6 +1627,10 @@ void PoseGraph3D::TrimmingHandle::TrimSubmap(const SubmapId& submap_id) {
   CHECK(parent_->data_.submap_data.at(submap_id).state ==
         SubmapState::kFinished);
   parent_->data_.submap_data.Trim(submap_id);
+  parent_->submap_index_.Remove(submap_id);
+  if (parent_->cold_storage_ != nullptr) {
+    parent_->cold_storage_->Erase(submap_id);
+  }
   parent_->constraint_builder_.DeleteScanMatcher(submap_id);
   parent_->optimization_problem_->TrimSubmap(submap_id);
 
@@ -1276,6 +1646,9 @@ void PoseGraph3D::TrimmingHandle::TrimSubmap(const SubmapId& submap_id) {
   // problem.
   for (const NodeId& node_id : nodes_to_remove) {
     parent_->data_.trajectory_nodes.Trim(node_id);
+    if (parent_->cold_storage_ != nullptr) {
+      parent_->cold_storage_->Erase(node_id);
+    }
     parent_->optimization_problem_->TrimTrajectoryNode(node_id);
   }
 }
@@ -1305,6 +1678,11 @@ void PoseGraph3D::RegisterMetrics(metrics::FamilyFactory* family_factory) {
       family_factory->NewGaugeFamily("mapping_3d_pose_graph_work_queue_size",
                                      "Number of items in the work queue");
   kWorkQueueSizeMetric = queue_size->Add({});
+  auto* shed = family_factory->NewCounterFamily(
+      "mapping_3d_pose_graph_shed_constraint_searches",
+      "Number of nodes whose constraint search was shed since the work "
+      "queue was over capacity");
+  kShedConstraintSearchesMetric = shed->Add({});
   auto* constraints = family_factory->NewGaugeFamily(
       "mapping_3d_pose_graph_constraints",
       "Current number of constraints in the pose graph");
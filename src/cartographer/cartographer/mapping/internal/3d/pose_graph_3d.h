@@ -33,10 +33,12 @@
 #include "cartographer/common/thread_pool.h"
 #include "cartographer/common/time.h"
 #include "cartographer/mapping/3d/submap_3d.h"
+#include "cartographer/mapping/internal/cold_storage.h"
 #include "cartographer/mapping/internal/constraints/constraint_builder_3d.h"
 #include "cartographer/mapping/internal/optimization/optimization_problem_3d.h"
 #include "cartographer/mapping/internal/trajectory_connectivity_state.h"
 #include "cartographer/mapping/internal/pose_graph_data.h"
+#include "cartographer/mapping/internal/submap_spatial_index.h"
 #include "cartographer/mapping/internal/work_queue.h"
 #include "cartographer/mapping/pose_graph.h"
 #include "cartographer/mapping/pose_graph_trimmer.h"
@@ -124,6 +126,12 @@ class PoseGraph3D : public PoseGraph {
       LOCKS_EXCLUDED(mutex_) override;
   MapById<NodeId, TrajectoryNode> GetTrajectoryNodes() const override
       LOCKS_EXCLUDED(mutex_);
+  void ForEachSubmapData(
+      const std::function<void(const SubmapId&, const SubmapData&)>& visitor)
+      const override LOCKS_EXCLUDED(mutex_);
+  void ForEachTrajectoryNode(
+      const std::function<void(const NodeId&, const TrajectoryNode&)>& visitor)
+      const override LOCKS_EXCLUDED(mutex_);
   MapById<NodeId, TrajectoryNodePose> GetTrajectoryNodePoses() const override
       LOCKS_EXCLUDED(mutex_);
   std::map<int, TrajectoryState> GetTrajectoryStates() const override
@@ -167,10 +175,17 @@ class PoseGraph3D : public PoseGraph {
   MapById<SubmapId, SubmapData> GetSubmapDataUnderLock() const
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
-  // Handles a new work item.
-  void AddWorkItem(const std::function<WorkItem::Result()>& work_item)
+  // Handles a new work item. If given, 'shed_work_item' runs instead of
+  // 'work_item' when the work queue is over capacity.
+  void AddWorkItem(
+      const std::function<WorkItem::Result()>& work_item,
+      const std::function<WorkItem::Result()>& shed_work_item = nullptr)
       LOCKS_EXCLUDED(mutex_) LOCKS_EXCLUDED(work_queue_mutex_);
 
+  // Exports the depth of the work queue and the age of its oldest item.
+  void UpdateWorkQueueMetrics(std::chrono::steady_clock::time_point now)
+      EXCLUSIVE_LOCKS_REQUIRED(work_queue_mutex_);
+
   // Adds connectivity and sampler for a trajectory if it does not exist.
   void AddTrajectoryIfNeeded(int trajectory_id)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
@@ -190,19 +205,44 @@ class PoseGraph3D : public PoseGraph {
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   // Adds constraints for a node, and starts scan matching in the background.
+  // If 'search_for_constraints' is false, i.e. the search was shed, the node
+  // is not matched against older submaps. A newly finished submap is still
+  // matched against all older nodes.
   WorkItem::Result ComputeConstraintsForNode(
       const NodeId& node_id,
       std::vector<std::shared_ptr<const Submap3D>> insertion_submaps,
-      bool newly_finished_submap) LOCKS_EXCLUDED(mutex_);
+      bool newly_finished_submap, bool search_for_constraints)
+      LOCKS_EXCLUDED(mutex_);
 
   // Computes constraints for a node and submap pair.
   void ComputeConstraint(const NodeId& node_id, const SubmapId& submap_id)
       LOCKS_EXCLUDED(mutex_);
 
+  // Returns the finished submaps, in order, for which 'ComputeConstraint()'
+  // may add a constraint with 'node_id'. Submaps which can only be matched in
+  // a local search window beyond 'max_constraint_distance' are left out.
+  std::vector<SubmapId> GetSubmapsForConstraintSearch(const NodeId& node_id)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Adds submaps of 'optimization_problem_' missing from 'submap_index_'.
+  void UpdateSubmapIndex() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   // Deletes trajectories waiting for deletion. Must not be called during
   // constraint search.
   void DeleteTrajectoriesIfNeeded() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  // Moves submaps and node point clouds far from the active trajectories to
+  // 'cold_storage_' until the memory budget is met. Must not be called during
+  // constraint search.
+  void EvictColdData() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Loads the node and submap back into 'data_' if they have been evicted.
+  // They count against the memory budget until 'EvictColdData' evicts them
+  // again. Disk IO happens without holding 'mutex_'. Must only be called
+  // during constraint search, when nothing else evicts or trims.
+  void LoadColdData(const NodeId& node_id, const SubmapId& submap_id)
+      LOCKS_EXCLUDED(mutex_);
+
   // Runs the optimization, executes the trimmers and processes the work queue.
   void HandleWorkQueue(const constraints::ConstraintBuilder3D::Result& result)
       LOCKS_EXCLUDED(mutex_) LOCKS_EXCLUDED(work_queue_mutex_);
@@ -268,6 +308,13 @@ class PoseGraph3D : public PoseGraph {
 
   PoseGraphData data_ GUARDED_BY(mutex_);
 
+  // Global positions of the submaps in 'optimization_problem_', rebuilt after
+  // each optimization.
+  SubmapSpatialIndex submap_index_ GUARDED_BY(mutex_);
+
+  // Only set if a memory budget is configured.
+  std::unique_ptr<ColdStorage> cold_storage_ GUARDED_BY(mutex_);
+
   // Allows querying and manipulating the pose graph by the 'trimmers_'. The
   // 'mutex_' of the pose graph is held while this class is used.
   class TrimmingHandle : public Trimmable {
@@ -281,6 +328,9 @@ class PoseGraph3D : public PoseGraph {
         EXCLUSIVE_LOCKS_REQUIRED(parent_->mutex_);
     const MapById<NodeId, TrajectoryNode>& GetTrajectoryNodes() const override
         EXCLUSIVE_LOCKS_REQUIRED(parent_->mutex_);
+    std::shared_ptr<const Submap> GetFullSubmap(
+        const SubmapId& submap_id) const override
+        EXCLUSIVE_LOCKS_REQUIRED(parent_->mutex_);
     const std::vector<Constraint>& GetConstraints() const override
         EXCLUSIVE_LOCKS_REQUIRED(parent_->mutex_);
     void TrimSubmap(const SubmapId& submap_id)
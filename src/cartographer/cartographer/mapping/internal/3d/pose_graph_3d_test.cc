@@ -16,6 +16,9 @@
 
 #include "cartographer/mapping/internal/3d/pose_graph_3d.h"
 
+#include <vector>
+
+#include "cartographer/mapping/3d/hybrid_grid.h"
 #include "cartographer/mapping/internal/testing/test_helpers.h"
 #include "cartographer/mapping/proto/serialization.pb.h"
 #include "cartographer/transform/rigid_transform.h"
@@ -376,6 +379,155 @@ TEST_F(PoseGraph3DTest, EvenSubmapTrimmerOnFrozenTrajectory) {
   }
 }
 
+// Returns a finished submap with a known cell in both hybrid grids.
+proto::Submap CreateSubmap3DWithGrids(const int trajectory_id,
+                                      const int submap_index) {
+  proto::Submap proto =
+      testing::CreateFakeSubmap3D(trajectory_id, submap_index);
+  HybridGrid high_resolution_hybrid_grid(0.1f);
+  high_resolution_hybrid_grid.SetProbability(Eigen::Array3i(1, 2, 3), 0.7f);
+  HybridGrid low_resolution_hybrid_grid(0.5f);
+  low_resolution_hybrid_grid.SetProbability(Eigen::Array3i(1, 2, 3), 0.7f);
+  auto* const submap_3d = proto.mutable_submap_3d();
+  *submap_3d->mutable_high_resolution_hybrid_grid() =
+      high_resolution_hybrid_grid.ToProto();
+  *submap_3d->mutable_low_resolution_hybrid_grid() =
+      low_resolution_hybrid_grid.ToProto();
+  submap_3d->add_rotational_scan_matcher_histogram(1.f);
+  return proto;
+}
+
+// Returns the constant data of a node with point clouds for loop closure.
+TrajectoryNode::Data CreateNodeDataWithPointClouds() {
+  sensor::PointCloud point_cloud;
+  for (int i = 0; i != 10; ++i) {
+    point_cloud.push_back({Eigen::Vector3f(0.1f * i, 0.2f, 0.3f)});
+  }
+  Eigen::VectorXf histogram(1);
+  histogram << 1.f;
+  return TrajectoryNode::Data{common::FromUniversal(42),
+                              Eigen::Quaterniond::Identity(),
+                              {},
+                              point_cloud,
+                              point_cloud,
+                              histogram,
+                              Rigid3d::Identity()};
+}
+
+// Checks that evicted submaps are loaded for trimmers, then trims them all.
+class FullSubmapCheckingTrimmer : public PoseGraphTrimmer {
+ public:
+  explicit FullSubmapCheckingTrimmer(int trajectory_id)
+      : trajectory_id_(trajectory_id) {}
+
+  void Trim(Trimmable *pose_graph) override {
+    for (const auto &submap_id : pose_graph->GetSubmapIds(trajectory_id_)) {
+      const auto submap = std::static_pointer_cast<const Submap3D>(
+          pose_graph->GetFullSubmap(submap_id));
+      EXPECT_TRUE(submap->has_hybrid_grids()) << submap_id;
+      pose_graph->TrimSubmap(submap_id);
+    }
+    finished_ = true;
+  }
+
+  bool IsFinished() override { return finished_; }
+
+ private:
+  const int trajectory_id_;
+  bool finished_ = false;
+};
+
+TEST_F(PoseGraph3DTest, EvictsQueriesAndTrimsUnderMemoryBudget) {
+  pose_graph_options_.mutable_memory_budget()->set_memory_budget_in_mb(1e-6);
+  pose_graph_options_.mutable_memory_budget()->set_directory(
+      ::testing::TempDir());
+  pose_graph_options_.set_global_sampling_ratio(1.);
+  BuildPoseGraphWithFakeOptimization();
+  const int trajectory_id = 0;
+  const int num_submaps = 3;
+  for (int i = 0; i < num_submaps; ++i) {
+    const proto::Submap submap = CreateSubmap3DWithGrids(trajectory_id, i);
+    pose_graph_->AddSubmapFromProto(Rigid3d::Identity(), submap);
+    proto::Node node = testing::CreateFakeNode(trajectory_id, i);
+    *node.mutable_node_data() = ToProto(CreateNodeDataWithPointClouds());
+    pose_graph_->AddNodeFromProto(Rigid3d::Identity(), node);
+    proto::PoseGraph proto;
+    auto constraint = testing::CreateFakeConstraint(node, submap);
+    constraint.set_tag(proto::PoseGraph::Constraint::INTRA_SUBMAP);
+    testing::AddToProtoGraph(constraint, &proto);
+    pose_graph_->AddSerializedConstraints(FromProto(proto.constraint()));
+  }
+  // Nothing fits into the budget.
+  pose_graph_->RunFinalOptimization();
+  const SubmapId submap_id{trajectory_id, 0};
+  for (const auto &submap_id_data : pose_graph_->GetAllSubmapData()) {
+    EXPECT_FALSE(std::static_pointer_cast<const Submap3D>(
+                     submap_id_data.data.submap)
+                     ->has_hybrid_grids())
+        << submap_id_data.id;
+  }
+  for (const auto &node_id_data : pose_graph_->GetTrajectoryNodes()) {
+    EXPECT_TRUE(node_id_data.data.constant_data->high_resolution_point_cloud
+                    .empty())
+        << node_id_data.id;
+  }
+
+  // Queries load the evicted data again.
+  const auto submap = std::static_pointer_cast<const Submap3D>(
+      pose_graph_->GetSubmapData(submap_id).submap);
+  ASSERT_TRUE(submap->has_hybrid_grids());
+  EXPECT_TRUE(
+      submap->high_resolution_hybrid_grid().IsKnown(Eigen::Array3i(1, 2, 3)));
+  int num_visited_submaps = 0;
+  pose_graph_->ForEachSubmapData(
+      [&num_visited_submaps](const SubmapId &id,
+                             const PoseGraphInterface::SubmapData &data) {
+        EXPECT_TRUE(std::static_pointer_cast<const Submap3D>(data.submap)
+                        ->has_hybrid_grids())
+            << id;
+        ++num_visited_submaps;
+      });
+  EXPECT_EQ(num_visited_submaps, num_submaps);
+  int num_visited_nodes = 0;
+  pose_graph_->ForEachTrajectoryNode(
+      [&num_visited_nodes](const NodeId &id, const TrajectoryNode &node) {
+        EXPECT_EQ(node.constant_data->high_resolution_point_cloud.size(), 10u)
+            << id;
+        ++num_visited_nodes;
+      });
+  EXPECT_EQ(num_visited_nodes, num_submaps);
+
+  // The global constraint search of a node of another trajectory loads the
+  // evicted submaps it is matched against.
+  const int other_trajectory_id = 1;
+  pose_graph_->AddNode(
+      std::make_shared<const TrajectoryNode::Data>(
+          CreateNodeDataWithPointClouds()),
+      other_trajectory_id,
+      {std::make_shared<const Submap3D>(0.1f, 0.5f, Rigid3d::Identity(),
+                                        Eigen::VectorXf::Ones(1))});
+  pose_graph_->WaitForAllComputations();
+  const auto all_submap_data = pose_graph_->GetAllSubmapData();
+  for (const auto &submap_id_data : all_submap_data.trajectory(trajectory_id)) {
+    EXPECT_TRUE(std::static_pointer_cast<const Submap3D>(
+                    submap_id_data.data.submap)
+                    ->has_hybrid_grids())
+        << submap_id_data.id;
+  }
+
+  // Trimmers see full submaps even though they were evicted again.
+  pose_graph_->RunFinalOptimization();
+  EXPECT_FALSE(std::static_pointer_cast<const Submap3D>(
+                   pose_graph_->GetAllSubmapData().at(submap_id).submap)
+                   ->has_hybrid_grids());
+  pose_graph_->AddTrimmer(
+      absl::make_unique<FullSubmapCheckingTrimmer>(trajectory_id));
+  pose_graph_->RunFinalOptimization();
+  EXPECT_EQ(
+      pose_graph_->GetAllSubmapData().SizeOfTrajectoryOrZero(trajectory_id),
+      0);
+}
+
 }  // namespace
 }  // namespace mapping
 }  // namespace cartographer
@@ -73,6 +73,8 @@ proto::CeresScanMatcherOptions3D CreateCeresScanMatcherOptions3D(
       parameter_dictionary->GetDouble("rotation_weight"));
   options.set_only_optimize_yaw(
       parameter_dictionary->GetBool("only_optimize_yaw"));
+  options.set_cache_interpolation_voxels(
+      parameter_dictionary->GetBool("cache_interpolation_voxels"));
   *options.mutable_ceres_solver_options() =
       common::CreateCeresSolverOptionsProto(
           parameter_dictionary->GetDictionary("ceres_solver_options").get());
@@ -116,6 +118,8 @@ void CeresScanMatcher3D::Match(
 
   CHECK_EQ(options_.occupied_space_weight_size(),
            point_clouds_and_hybrid_grids.size());
+  const transform::Rigid3d* const cached_voxels_pose =
+      options_.cache_interpolation_voxels() ? &initial_pose_estimate : nullptr;
   // 遍历高分辨率地图与低分辨率地图
   for (size_t i = 0; i != point_clouds_and_hybrid_grids.size(); ++i) {
     CHECK_GT(options_.occupied_space_weight(i), 0.);
@@ -128,7 +132,7 @@ void CeresScanMatcher3D::Match(
         OccupiedSpaceCostFunction3D::CreateAutoDiffCostFunction(
             options_.occupied_space_weight(i) /
                 std::sqrt(static_cast<double>(point_cloud.size())),
-            point_cloud, hybrid_grid),
+            point_cloud, hybrid_grid, cached_voxels_pose),
         nullptr /* loss function */, ceres_pose.translation(),
         ceres_pose.rotation());
 
@@ -144,7 +148,7 @@ void CeresScanMatcher3D::Match(
               options_.intensity_cost_function_options(i).weight() /
                   std::sqrt(static_cast<double>(point_cloud.size())),
               options_.intensity_cost_function_options(i).intensity_threshold(),
-              point_cloud, intensity_hybrid_grid),
+              point_cloud, intensity_hybrid_grid, cached_voxels_pose),
           new ceres::HuberLoss(
               options_.intensity_cost_function_options(i).huber_scale()),
           ceres_pose.translation(), ceres_pose.rotation());
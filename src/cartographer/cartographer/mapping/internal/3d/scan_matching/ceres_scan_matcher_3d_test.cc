@@ -67,6 +67,7 @@ class CeresScanMatcher3DTest : public ::testing::Test {
           translation_weight = 0.01,
           rotation_weight = 0.1,
           only_optimize_yaw = false,
+          cache_interpolation_voxels = true,
           ceres_solver_options = {
             use_nonmonotonic_steps = true,
             max_num_iterations = 10,
@@ -10,13 +10,15 @@ namespace scan_matching {
 ceres::CostFunction* IntensityCostFunction3D::CreateAutoDiffCostFunction(
     const double scaling_factor, const float intensity_threshold,
     const sensor::PointCloud& point_cloud,
-    const IntensityHybridGrid& hybrid_grid) {
+    const IntensityHybridGrid& hybrid_grid,
+    const transform::Rigid3d* const initial_pose_estimate) {
   CHECK(!point_cloud.intensities().empty());
   return new ceres::AutoDiffCostFunction<
       IntensityCostFunction3D, ceres::DYNAMIC /* residuals */,
       3 /* translation variables */, 4 /* rotation variables */>(
       new IntensityCostFunction3D(scaling_factor, intensity_threshold,
-                                  point_cloud, hybrid_grid),
+                                  point_cloud, hybrid_grid,
+                                  initial_pose_estimate),
       point_cloud.size());
 }
 
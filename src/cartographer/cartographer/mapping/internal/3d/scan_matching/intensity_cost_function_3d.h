@@ -17,6 +17,8 @@
 #ifndef CARTOGRAPHER_MAPPING_INTERNAL_3D_SCAN_MATCHING_INTENSITY_COST_FUNCTION_3D_H_
 #define CARTOGRAPHER_MAPPING_INTERNAL_3D_SCAN_MATCHING_INTENSITY_COST_FUNCTION_3D_H_
 
+#include <vector>
+
 #include "Eigen/Core"
 #include "cartographer/mapping/3d/hybrid_grid.h"
 #include "cartographer/mapping/internal/3d/scan_matching/interpolated_grid.h"
@@ -34,12 +36,16 @@ namespace scan_matching {
 // for which different intensity has been observed, i.e. at voxels with different
 // values. Only points up to a certain threshold are evaluated which is intended
 // to ignore data from retroreflections.
+//
+// If 'initial_pose_estimate' is given, the voxels around the points at this
+// pose are looked up once, see OccupiedSpaceCostFunction3D.
 class IntensityCostFunction3D {
  public:
   static ceres::CostFunction* CreateAutoDiffCostFunction(
       const double scaling_factor, const float intensity_threshold,
       const sensor::PointCloud& point_cloud,
-      const IntensityHybridGrid& hybrid_grid);
+      const IntensityHybridGrid& hybrid_grid,
+      const transform::Rigid3d* initial_pose_estimate = nullptr);
 
   template <typename T>
   bool operator()(const T* const translation, const T* const rotation,
@@ -55,11 +61,17 @@ class IntensityCostFunction3D {
   IntensityCostFunction3D(const double scaling_factor,
                           const float intensity_threshold,
                           const sensor::PointCloud& point_cloud,
-                          const IntensityHybridGrid& hybrid_grid)
+                          const IntensityHybridGrid& hybrid_grid,
+                          const transform::Rigid3d* initial_pose_estimate)
       : scaling_factor_(scaling_factor),
         intensity_threshold_(intensity_threshold),
         point_cloud_(point_cloud),
-        interpolated_grid_(hybrid_grid) {}
+        interpolated_grid_(hybrid_grid) {
+    if (initial_pose_estimate != nullptr) {
+      cached_voxels_ = interpolated_grid_.GetInterpolationVoxels(
+          point_cloud, initial_pose_estimate->cast<float>());
+    }
+  }
 
   IntensityCostFunction3D(const IntensityCostFunction3D&) = delete;
   IntensityCostFunction3D& operator=(const IntensityCostFunction3D&) = delete;
@@ -76,8 +88,9 @@ class IntensityCostFunction3D {
 
         const Eigen::Matrix<T, 3, 1> world = transform * point;
         const T interpolated_intensity =
-            interpolated_grid_.GetInterpolatedValue(world[0], world[1],
-                                                    world[2]);
+            interpolated_grid_.GetInterpolatedValue(
+                world[0], world[1], world[2],
+                cached_voxels_.empty() ? nullptr : &cached_voxels_[i]);
         residual[i] = scaling_factor_ * (interpolated_intensity - intensity);
       }
     }
@@ -89,6 +102,7 @@ class IntensityCostFunction3D {
   const float intensity_threshold_;
   const sensor::PointCloud& point_cloud_;
   const InterpolatedIntensityGrid interpolated_grid_;
+  std::vector<InterpolationVoxels> cached_voxels_;
 };
 
 }  // namespace scan_matching
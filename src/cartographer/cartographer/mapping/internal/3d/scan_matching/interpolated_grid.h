@@ -17,14 +17,27 @@
 #ifndef CARTOGRAPHER_MAPPING_INTERNAL_3D_SCAN_MATCHING_INTERPOLATED_GRID_H_
 #define CARTOGRAPHER_MAPPING_INTERNAL_3D_SCAN_MATCHING_INTERPOLATED_GRID_H_
 
+#include <array>
 #include <cmath>
+#include <vector>
 
 #include "cartographer/mapping/3d/hybrid_grid.h"
+#include "cartographer/sensor/point_cloud.h"
+#include "cartographer/transform/rigid_transform.h"
 
 namespace cartographer {
 namespace mapping {
 namespace scan_matching {
 
+// The 8 voxels between whose centers a value is interpolated.
+struct InterpolationVoxels {
+  // Index of the voxel with the lowest coordinates.
+  Eigen::Array3i lower_index;
+  // Values ordered by x, then y, then z index offset, i.e. q111, q112, q121,
+  // q122, q211, q212, q221, q222.
+  std::array<float, 8> values;
+};
+
 // Interpolates between HybridGrid voxels. We use the tricubic
 // interpolation which interpolates the values and has vanishing derivative at
 // these points.
@@ -50,26 +63,32 @@ class InterpolatedGrid {
   // the values, and have vanishing derivative at the interval boundaries.
   template <typename T>
   T GetInterpolatedValue(const T& x, const T& y, const T& z) const {
+    return GetInterpolatedValue(x, y, z, nullptr /* cached_voxels */);
+  }
+
+  // Like above, but takes the voxel values from 'cached_voxels' instead of the
+  // HybridGrid if (x, y, z) is interpolated between the same voxels. The
+  // result is the same as without 'cached_voxels', which may be nullptr.
+  template <typename T>
+  T GetInterpolatedValue(const T& x, const T& y, const T& z,
+                         const InterpolationVoxels* cached_voxels) const {
     double x1, y1, z1, x2, y2, z2;
     ComputeInterpolationDataPoints(x, y, z, &x1, &y1, &z1, &x2, &y2, &z2);
 
     const Eigen::Array3i index1 =
         hybrid_grid_.GetCellIndex(Eigen::Vector3f(x1, y1, z1));
-    const double q111 = GetValue(hybrid_grid_, index1);
-    const double q112 =
-        GetValue(hybrid_grid_, index1 + Eigen::Array3i(0, 0, 1));
-    const double q121 =
-        GetValue(hybrid_grid_, index1 + Eigen::Array3i(0, 1, 0));
-    const double q122 =
-        GetValue(hybrid_grid_, index1 + Eigen::Array3i(0, 1, 1));
-    const double q211 =
-        GetValue(hybrid_grid_, index1 + Eigen::Array3i(1, 0, 0));
-    const double q212 =
-        GetValue(hybrid_grid_, index1 + Eigen::Array3i(1, 0, 1));
-    const double q221 =
-        GetValue(hybrid_grid_, index1 + Eigen::Array3i(1, 1, 0));
-    const double q222 =
-        GetValue(hybrid_grid_, index1 + Eigen::Array3i(1, 1, 1));
+    const std::array<float, 8> values =
+        cached_voxels != nullptr && (cached_voxels->lower_index == index1).all()
+            ? cached_voxels->values
+            : GetValues(index1);
+    const double q111 = values[0];
+    const double q112 = values[1];
+    const double q121 = values[2];
+    const double q122 = values[3];
+    const double q211 = values[4];
+    const double q212 = values[5];
+    const double q221 = values[6];
+    const double q222 = values[7];
 
     const T normalized_x = (x - x1) / (x2 - x1);
     const T normalized_y = (y - y1) / (y2 - y1);
@@ -103,7 +122,39 @@ class InterpolatedGrid {
            q1;
   }
 
+  // Looks up the voxels used to interpolate at each point of 'point_cloud'
+  // transformed by 'pose'. As long as the points stay close to these
+  // positions, passing the result to GetInterpolatedValue() saves the lookups
+  // in the HybridGrid.
+  std::vector<InterpolationVoxels> GetInterpolationVoxels(
+      const sensor::PointCloud& point_cloud,
+      const transform::Rigid3f& pose) const {
+    std::vector<InterpolationVoxels> result;
+    result.reserve(point_cloud.size());
+    for (const sensor::RangefinderPoint& point : point_cloud) {
+      const Eigen::Vector3f world = pose * point.position;
+      const Eigen::Array3i lower_index = hybrid_grid_.GetCellIndex(
+          CenterOfLowerVoxel(static_cast<double>(world.x()),
+                             static_cast<double>(world.y()),
+                             static_cast<double>(world.z())));
+      result.push_back(
+          InterpolationVoxels{lower_index, GetValues(lower_index)});
+    }
+    return result;
+  }
+
  private:
+  std::array<float, 8> GetValues(const Eigen::Array3i& index1) const {
+    return {{GetValue(hybrid_grid_, index1),
+             GetValue(hybrid_grid_, index1 + Eigen::Array3i(0, 0, 1)),
+             GetValue(hybrid_grid_, index1 + Eigen::Array3i(0, 1, 0)),
+             GetValue(hybrid_grid_, index1 + Eigen::Array3i(0, 1, 1)),
+             GetValue(hybrid_grid_, index1 + Eigen::Array3i(1, 0, 0)),
+             GetValue(hybrid_grid_, index1 + Eigen::Array3i(1, 0, 1)),
+             GetValue(hybrid_grid_, index1 + Eigen::Array3i(1, 1, 0)),
+             GetValue(hybrid_grid_, index1 + Eigen::Array3i(1, 1, 1))}};
+  }
+
   template <typename T>
   void ComputeInterpolationDataPoints(const T& x, const T& y, const T& z,
                                       double* x1, double* y1, double* z1,
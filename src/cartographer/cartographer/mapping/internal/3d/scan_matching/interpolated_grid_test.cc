@@ -16,6 +16,9 @@
 
 #include "cartographer/mapping/internal/3d/scan_matching/interpolated_grid.h"
 
+#include <cmath>
+#include <vector>
+
 #include "Eigen/Core"
 #include "cartographer/mapping/3d/hybrid_grid.h"
 #include "gtest/gtest.h"
@@ -84,6 +87,32 @@ TEST_F(InterpolatedGridTest, MonotonicBehaviorBetweenGridPointsInX) {
   }
 }
 
+TEST_F(InterpolatedGridTest, CachedVoxelsGiveSameValues) {
+  sensor::PointCloud point_cloud;
+  for (double x = -7.; x < -3.; x += 0.037) {
+    point_cloud.push_back({Eigen::Vector3f(x, 2.f + 0.3f * std::sin(x),
+                                           0.02f * x + 0.5f)});
+  }
+  const transform::Rigid3f pose(Eigen::Vector3f(0.01f, -0.02f, 0.03f),
+                                Eigen::Quaternionf::Identity());
+  const std::vector<InterpolationVoxels> cached_voxels =
+      interpolated_grid_.GetInterpolationVoxels(point_cloud, pose);
+  ASSERT_EQ(point_cloud.size(), cached_voxels.size());
+  // Points which moved to other voxels fall back to the grid.
+  for (const Eigen::Vector3f& offset :
+       {Eigen::Vector3f::Zero().eval(), Eigen::Vector3f(0.01f, 0.f, -0.01f),
+        Eigen::Vector3f(0.15f, -0.2f, 0.1f)}) {
+    for (size_t i = 0; i < point_cloud.size(); ++i) {
+      const Eigen::Vector3d world =
+          (pose * point_cloud[i].position + offset).cast<double>();
+      EXPECT_EQ(interpolated_grid_.GetInterpolatedValue(world.x(), world.y(),
+                                                        world.z()),
+                interpolated_grid_.GetInterpolatedValue(
+                    world.x(), world.y(), world.z(), &cached_voxels[i]));
+    }
+  }
+}
+
 }  // namespace
 }  // namespace scan_matching
 }  // namespace mapping
@@ -17,6 +17,8 @@
 #ifndef CARTOGRAPHER_MAPPING_INTERNAL_3D_SCAN_MATCHING_OCCUPIED_SPACE_COST_FUNCTION_3D_H_
 #define CARTOGRAPHER_MAPPING_INTERNAL_3D_SCAN_MATCHING_OCCUPIED_SPACE_COST_FUNCTION_3D_H_
 
+#include <vector>
+
 #include "Eigen/Core"
 #include "cartographer/mapping/3d/hybrid_grid.h"
 #include "cartographer/mapping/internal/3d/scan_matching/interpolated_grid.h"
@@ -31,16 +33,21 @@ namespace scan_matching {
 // Computes a cost for matching the 'point_cloud' to the 'hybrid_grid' with a
 // 'translation' and 'rotation'. The cost increases when points fall into less
 // occupied space, i.e. at voxels with lower values.
+//
+// If 'initial_pose_estimate' is given, the voxels around the points at this
+// pose are looked up once, so that evaluations close to it mostly do not need
+// to access the 'hybrid_grid'.
 class OccupiedSpaceCostFunction3D {
  public:
   static ceres::CostFunction* CreateAutoDiffCostFunction(
       const double scaling_factor, const sensor::PointCloud& point_cloud,
-      const mapping::HybridGrid& hybrid_grid) {
+      const mapping::HybridGrid& hybrid_grid,
+      const transform::Rigid3d* const initial_pose_estimate = nullptr) {
     return new ceres::AutoDiffCostFunction<
         OccupiedSpaceCostFunction3D, ceres::DYNAMIC /* residuals */,
         3 /* translation variables */, 4 /* rotation variables */>(
         new OccupiedSpaceCostFunction3D(scaling_factor, point_cloud,
-                                        hybrid_grid),
+                                        hybrid_grid, initial_pose_estimate),
         point_cloud.size());
   }
 
@@ -57,10 +64,16 @@ class OccupiedSpaceCostFunction3D {
  private:
   OccupiedSpaceCostFunction3D(const double scaling_factor,
                               const sensor::PointCloud& point_cloud,
-                              const mapping::HybridGrid& hybrid_grid)
+                              const mapping::HybridGrid& hybrid_grid,
+                              const transform::Rigid3d* initial_pose_estimate)
       : scaling_factor_(scaling_factor),
         point_cloud_(point_cloud),
-        interpolated_grid_(hybrid_grid) {}
+        interpolated_grid_(hybrid_grid) {
+    if (initial_pose_estimate != nullptr) {
+      cached_voxels_ = interpolated_grid_.GetInterpolationVoxels(
+          point_cloud, initial_pose_estimate->cast<float>());
+    }
+  }
 
   OccupiedSpaceCostFunction3D(const OccupiedSpaceCostFunction3D&) = delete;
   OccupiedSpaceCostFunction3D& operator=(const OccupiedSpaceCostFunction3D&) =
@@ -72,8 +85,9 @@ class OccupiedSpaceCostFunction3D {
     for (size_t i = 0; i < point_cloud_.size(); ++i) {
       const Eigen::Matrix<T, 3, 1> world =
           transform * point_cloud_[i].position.cast<T>();
-      const T probability =
-          interpolated_grid_.GetInterpolatedValue(world[0], world[1], world[2]);
+      const T probability = interpolated_grid_.GetInterpolatedValue(
+          world[0], world[1], world[2],
+          cached_voxels_.empty() ? nullptr : &cached_voxels_[i]);
       residual[i] = scaling_factor_ * (1. - probability);
     }
     return true;
@@ -82,6 +96,7 @@ class OccupiedSpaceCostFunction3D {
   const double scaling_factor_;
   const sensor::PointCloud& point_cloud_;
   const InterpolatedProbabilityGrid interpolated_grid_;
+  std::vector<InterpolationVoxels> cached_voxels_;
 };
 
 }  // namespace scan_matching
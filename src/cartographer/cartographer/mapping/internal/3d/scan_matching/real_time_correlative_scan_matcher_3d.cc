@@ -16,21 +16,70 @@
 
 #include "cartographer/mapping/internal/3d/scan_matching/real_time_correlative_scan_matcher_3d.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include "Eigen/Geometry"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/blocking_counter.h"
 #include "cartographer/common/math.h"
+#include "cartographer/common/task.h"
 #include "cartographer/transform/transform.h"
 #include "glog/logging.h"
 
 namespace cartographer {
 namespace mapping {
 namespace scan_matching {
+namespace {
+
+// Offset of a candidate in multiples of the linear and angular step sizes in
+// the order x, y, z, rx, ry, rz.
+using CandidateIndex = Eigen::Matrix<int, 6, 1>;
+
+transform::Rigid3f ToTransform(const CandidateIndex& index,
+                               const float linear_step_size,
+                               const float angular_step_size) {
+  return transform::Rigid3f(
+      Eigen::Vector3f(index[0], index[1], index[2]) * linear_step_size,
+      transform::AngleAxisVectorToRotationQuaternion(Eigen::Vector3f(
+          index[3] * angular_step_size, index[4] * angular_step_size,
+          index[5] * angular_step_size)));
+}
+
+// Calls 'function' for each index between 'min' and 'max', inclusive.
+template <typename FunctionType>
+void ForEachIndexInBox(const CandidateIndex& min, const CandidateIndex& max,
+                       const FunctionType& function) {
+  if ((min.array() > max.array()).any()) {
+    return;
+  }
+  CandidateIndex index = min;
+  for (;;) {
+    function(index);
+    int dimension = 0;
+    while (dimension != index.size() && index[dimension] == max[dimension]) {
+      index[dimension] = min[dimension];
+      ++dimension;
+    }
+    if (dimension == index.size()) {
+      return;
+    }
+    ++index[dimension];
+  }
+}
+
+int FloorDivide(const int dividend, const int divisor) {
+  return static_cast<int>(std::floor(static_cast<double>(dividend) / divisor));
+}
+
+}  // namespace
 
 RealTimeCorrelativeScanMatcher3D::RealTimeCorrelativeScanMatcher3D(
     const proto::RealTimeCorrelativeScanMatcherOptions& options)
     : options_(options) {}
 
+RealTimeCorrelativeScanMatcher3D::~RealTimeCorrelativeScanMatcher3D() {}
+
 /**
  * @brief 通过暴力搜索方法对先验位姿进行校准
  * 
@@ -45,31 +94,121 @@ float RealTimeCorrelativeScanMatcher3D::Match(
     const sensor::PointCloud& point_cloud, const HybridGrid& hybrid_grid,
     transform::Rigid3d* pose_estimate) const {
   CHECK(pose_estimate != nullptr);
-  float best_score = -1.f;
-  // 生成所有候选解，并遍历所有的候选解
-  for (const transform::Rigid3f& transform : GenerateExhaustiveSearchTransforms(
-           hybrid_grid.resolution(), point_cloud)) {
-    // 将初始位姿乘以transform得到候选解的位姿
-    const transform::Rigid3f candidate =
-        initial_pose_estimate.cast<float>() * transform;
-    // 为候选解打分
-    const float score = ScoreCandidate(
-        hybrid_grid, sensor::TransformPointCloud(point_cloud, candidate),
-        transform);
-    // 只保存最高分
-    if (score > best_score) {
-      best_score = score;
-      *pose_estimate = candidate.cast<double>();
-    }
+  // 生成所有候选解
+  const std::vector<transform::Rigid3f> transforms =
+      GenerateExhaustiveSearchTransforms(hybrid_grid.resolution(), point_cloud);
+  // 为候选解打分
+  const std::vector<float> scores =
+      ScoreCandidates(hybrid_grid, point_cloud,
+                      initial_pose_estimate.cast<float>(), transforms);
+  // 只保存最高分
+  const size_t best_index =
+      std::max_element(scores.begin(), scores.end()) - scores.begin();
+  // 将初始位姿乘以transform得到候选解的位姿
+  *pose_estimate =
+      (initial_pose_estimate.cast<float>() * transforms.at(best_index))
+          .cast<double>();
+  return scores[best_index];
+}
+
+float RealTimeCorrelativeScanMatcher3D::Match(
+    const transform::Rigid3d& initial_pose_estimate,
+    const sensor::PointCloud& point_cloud, const HybridGrid& hybrid_grid,
+    const sensor::PointCloud& low_resolution_point_cloud,
+    const HybridGrid& low_resolution_hybrid_grid,
+    transform::Rigid3d* pose_estimate) const {
+  if (options_.num_refined_low_resolution_candidates() == 0) {
+    return Match(initial_pose_estimate, point_cloud, hybrid_grid,
+                 pose_estimate);
+  }
+  CHECK(pose_estimate != nullptr);
+  const SearchWindow window =
+      ComputeSearchWindow(hybrid_grid.resolution(), point_cloud);
+  const SearchWindow low_resolution_window =
+      ComputeSearchWindow(low_resolution_hybrid_grid.resolution(), point_cloud);
+
+  // Each low resolution candidate stands for a block of 'block_size' high
+  // resolution candidates in each dimension. Every high resolution candidate
+  // belongs to exactly one block.
+  CandidateIndex block_size;
+  block_size.head<3>().setConstant(
+      std::max(1, common::RoundToInt(low_resolution_window.linear_step_size /
+                                     window.linear_step_size)));
+  block_size.tail<3>().setConstant(
+      std::max(1, common::RoundToInt(low_resolution_window.angular_step_size /
+                                     window.angular_step_size)));
+  CandidateIndex max_index;
+  max_index.head<3>().setConstant(window.linear_window_size);
+  max_index.tail<3>().setConstant(window.angular_window_size);
+  const CandidateIndex min_index = -max_index;
+  const CandidateIndex half_block_size = block_size / 2;
+  CandidateIndex min_block_index;
+  CandidateIndex max_block_index;
+  for (int i = 0; i != block_size.size(); ++i) {
+    min_block_index[i] =
+        FloorDivide(min_index[i] + half_block_size[i], block_size[i]);
+    max_block_index[i] =
+        FloorDivide(max_index[i] + half_block_size[i], block_size[i]);
   }
-  return best_score;
+
+  // Score the centers of the blocks at low resolution.
+  std::vector<CandidateIndex> block_indices;
+  std::vector<transform::Rigid3f> low_resolution_transforms;
+  ForEachIndexInBox(min_block_index, max_block_index,
+                    [&](const CandidateIndex& block_index) {
+                      block_indices.push_back(block_index);
+                      low_resolution_transforms.push_back(ToTransform(
+                          block_index.cwiseProduct(block_size),
+                          window.linear_step_size, window.angular_step_size));
+                    });
+  const std::vector<float> low_resolution_scores = ScoreCandidates(
+      low_resolution_hybrid_grid, low_resolution_point_cloud,
+      initial_pose_estimate.cast<float>(), low_resolution_transforms);
+  std::vector<size_t> best_blocks(block_indices.size());
+  for (size_t i = 0; i != best_blocks.size(); ++i) {
+    best_blocks[i] = i;
+  }
+  const size_t num_refined_blocks = std::min<size_t>(
+      options_.num_refined_low_resolution_candidates(), best_blocks.size());
+  std::partial_sort(best_blocks.begin(),
+                    best_blocks.begin() + num_refined_blocks, best_blocks.end(),
+                    [&low_resolution_scores](const size_t lhs,
+                                             const size_t rhs) {
+                      return low_resolution_scores[lhs] >
+                             low_resolution_scores[rhs];
+                    });
+
+  // Score the high resolution candidates in the best blocks.
+  std::vector<transform::Rigid3f> transforms;
+  for (size_t i = 0; i != num_refined_blocks; ++i) {
+    const CandidateIndex block_min_index =
+        (block_indices[best_blocks[i]].cwiseProduct(block_size) -
+         half_block_size)
+            .cwiseMax(min_index);
+    const CandidateIndex block_max_index =
+        (block_indices[best_blocks[i]].cwiseProduct(block_size) -
+         half_block_size + block_size - CandidateIndex::Ones())
+            .cwiseMin(max_index);
+    ForEachIndexInBox(
+        block_min_index, block_max_index, [&](const CandidateIndex& index) {
+          transforms.push_back(ToTransform(index, window.linear_step_size,
+                                           window.angular_step_size));
+        });
+  }
+  const std::vector<float> scores =
+      ScoreCandidates(hybrid_grid, point_cloud,
+                      initial_pose_estimate.cast<float>(), transforms);
+  const size_t best_index =
+      std::max_element(scores.begin(), scores.end()) - scores.begin();
+  *pose_estimate =
+      (initial_pose_estimate.cast<float>() * transforms.at(best_index))
+          .cast<double>();
+  return scores[best_index];
 }
 
-// 生成所有可能解的位姿: xyz三个方向的平移与分别绕xyz的旋转
-std::vector<transform::Rigid3f>
-RealTimeCorrelativeScanMatcher3D::GenerateExhaustiveSearchTransforms(
+RealTimeCorrelativeScanMatcher3D::SearchWindow
+RealTimeCorrelativeScanMatcher3D::ComputeSearchWindow(
     const float resolution, const sensor::PointCloud& point_cloud) const {
-  std::vector<transform::Rigid3f> result;
   // xyz方向的搜索范围
   const int linear_window_size =
       common::RoundToInt(options_.linear_search_window() / resolution);
@@ -89,6 +228,19 @@ RealTimeCorrelativeScanMatcher3D::GenerateExhaustiveSearchTransforms(
   // 角度搜索范围
   const int angular_window_size =
       common::RoundToInt(options_.angular_search_window() / angular_step_size);
+  return SearchWindow{resolution, linear_window_size, angular_step_size,
+                      angular_window_size};
+}
+
+// 生成所有可能解的位姿: xyz三个方向的平移与分别绕xyz的旋转
+std::vector<transform::Rigid3f>
+RealTimeCorrelativeScanMatcher3D::GenerateExhaustiveSearchTransforms(
+    const float resolution, const sensor::PointCloud& point_cloud) const {
+  std::vector<transform::Rigid3f> result;
+  const SearchWindow window = ComputeSearchWindow(resolution, point_cloud);
+  const int linear_window_size = window.linear_window_size;
+  const float angular_step_size = window.angular_step_size;
+  const int angular_window_size = window.angular_window_size;
   // 生成所有可能的候选解
   for (int z = -linear_window_size; z <= linear_window_size; ++z) {
     for (int y = -linear_window_size; y <= linear_window_size; ++y) {
@@ -113,6 +265,52 @@ RealTimeCorrelativeScanMatcher3D::GenerateExhaustiveSearchTransforms(
   return result;
 }
 
+std::vector<float> RealTimeCorrelativeScanMatcher3D::ScoreCandidates(
+    const HybridGrid& hybrid_grid, const sensor::PointCloud& point_cloud,
+    const transform::Rigid3f& initial_pose_estimate,
+    const std::vector<transform::Rigid3f>& transforms) const {
+  std::vector<float> scores(transforms.size());
+  const auto score_candidates = [&](const size_t begin, const size_t end) {
+    for (size_t i = begin; i != end; ++i) {
+      scores[i] = ScoreCandidate(
+          hybrid_grid,
+          sensor::TransformPointCloud(point_cloud,
+                                      initial_pose_estimate * transforms[i]),
+          transforms[i]);
+    }
+  };
+  const size_t num_chunks = options_.num_threads();
+  common::ThreadPool* const thread_pool = GetThreadPool();
+  if (thread_pool == nullptr || transforms.size() < num_chunks) {
+    score_candidates(0, transforms.size());
+    return scores;
+  }
+  // The calling thread scores the first chunk.
+  absl::BlockingCounter chunks_remaining(num_chunks - 1);
+  for (size_t chunk = 1; chunk != num_chunks; ++chunk) {
+    auto task = absl::make_unique<common::Task>();
+    task->SetWorkItem([&score_candidates, &transforms, &chunks_remaining,
+                       chunk, num_chunks]() {
+      score_candidates(transforms.size() * chunk / num_chunks,
+                       transforms.size() * (chunk + 1) / num_chunks);
+      chunks_remaining.DecrementCount();
+    });
+    thread_pool->Schedule(std::move(task));
+  }
+  score_candidates(0, transforms.size() / num_chunks);
+  chunks_remaining.Wait();
+  return scores;
+}
+
+common::ThreadPool* RealTimeCorrelativeScanMatcher3D::GetThreadPool() const {
+  if (options_.num_threads() <= 1) return nullptr;
+  absl::call_once(thread_pool_once_, [this]() {
+    thread_pool_ =
+        absl::make_unique<common::ThreadPool>(options_.num_threads() - 1);
+  });
+  return thread_pool_.get();
+}
+
 // 对候选解进行打分
 float RealTimeCorrelativeScanMatcher3D::ScoreCandidate(
     const HybridGrid& hybrid_grid,
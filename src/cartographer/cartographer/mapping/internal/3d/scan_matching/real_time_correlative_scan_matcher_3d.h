@@ -17,9 +17,12 @@
 #ifndef CARTOGRAPHER_MAPPING_INTERNAL_3D_SCAN_MATCHING_REAL_TIME_CORRELATIVE_SCAN_MATCHER_3D_H_
 #define CARTOGRAPHER_MAPPING_INTERNAL_3D_SCAN_MATCHING_REAL_TIME_CORRELATIVE_SCAN_MATCHER_3D_H_
 
+#include <memory>
 #include <vector>
 
 #include "Eigen/Core"
+#include "absl/base/call_once.h"
+#include "cartographer/common/thread_pool.h"
 #include "cartographer/mapping/3d/hybrid_grid.h"
 #include "cartographer/mapping/proto/scan_matching/real_time_correlative_scan_matcher_options.pb.h"
 #include "cartographer/sensor/point_cloud.h"
@@ -29,12 +32,13 @@ namespace mapping {
 namespace scan_matching {
 
 // A voxel accurate scan matcher, exhaustively evaluating the scan matching
-// search space.
+// search space, optionally pruned using a low resolution grid.
 class RealTimeCorrelativeScanMatcher3D {
  public:
   explicit RealTimeCorrelativeScanMatcher3D(
       const scan_matching::proto::RealTimeCorrelativeScanMatcherOptions&
           options);
+  ~RealTimeCorrelativeScanMatcher3D();
 
   RealTimeCorrelativeScanMatcher3D(const RealTimeCorrelativeScanMatcher3D&) =
       delete;
@@ -49,14 +53,50 @@ class RealTimeCorrelativeScanMatcher3D {
               const HybridGrid& hybrid_grid,
               transform::Rigid3d* pose_estimate) const;
 
+  // Like above, but if 'num_refined_low_resolution_candidates' is positive,
+  // the search window is first searched by matching
+  // 'low_resolution_point_cloud' against 'low_resolution_hybrid_grid'. Only the
+  // high resolution candidates close to the best low resolution candidates are
+  // evaluated. Since low resolution scores do not bound the high resolution
+  // scores, the result may differ from the exhaustive search.
+  float Match(const transform::Rigid3d& initial_pose_estimate,
+              const sensor::PointCloud& point_cloud,
+              const HybridGrid& hybrid_grid,
+              const sensor::PointCloud& low_resolution_point_cloud,
+              const HybridGrid& low_resolution_hybrid_grid,
+              transform::Rigid3d* pose_estimate) const;
+
  private:
+  // Step sizes and number of steps in each direction of the search window.
+  struct SearchWindow {
+    float linear_step_size;
+    int linear_window_size;
+    float angular_step_size;
+    int angular_window_size;
+  };
+
+  SearchWindow ComputeSearchWindow(float resolution,
+                                   const sensor::PointCloud& point_cloud) const;
   std::vector<transform::Rigid3f> GenerateExhaustiveSearchTransforms(
       float resolution, const sensor::PointCloud& point_cloud) const;
+  // Scores 'initial_pose_estimate' * 'transforms' in parallel if configured.
+  std::vector<float> ScoreCandidates(
+      const HybridGrid& hybrid_grid, const sensor::PointCloud& point_cloud,
+      const transform::Rigid3f& initial_pose_estimate,
+      const std::vector<transform::Rigid3f>& transforms) const;
   float ScoreCandidate(const HybridGrid& hybrid_grid,
                        const sensor::PointCloud& transformed_point_cloud,
                        const transform::Rigid3f& transform) const;
 
+  // Returns nullptr if 'num_threads' is at most 1. Otherwise creates the pool
+  // on first use, so that a matcher which is never used, e.g. because online
+  // correlative scan matching is disabled, does not start threads.
+  common::ThreadPool* GetThreadPool() const;
+
   const proto::RealTimeCorrelativeScanMatcherOptions options_;
+  // The calling thread scores candidates as well.
+  mutable absl::once_flag thread_pool_once_;
+  mutable std::unique_ptr<common::ThreadPool> thread_pool_;
 };
 
 }  // namespace scan_matching
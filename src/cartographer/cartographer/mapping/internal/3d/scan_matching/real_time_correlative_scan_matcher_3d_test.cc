@@ -19,6 +19,7 @@
 #include <memory>
 
 #include "Eigen/Core"
+#include "absl/memory/memory.h"
 #include "cartographer/common/internal/testing/lua_parameter_dictionary_test_helpers.h"
 #include "cartographer/mapping/3d/hybrid_grid.h"
 #include "cartographer/mapping/internal/scan_matching/real_time_correlative_scan_matcher.h"
@@ -37,6 +38,7 @@ class RealTimeCorrelativeScanMatcher3DTest : public ::testing::Test {
  protected:
   RealTimeCorrelativeScanMatcher3DTest()
       : hybrid_grid_(0.1f),
+        low_resolution_hybrid_grid_(0.3f),
         expected_pose_(Eigen::Vector3d(-1., 0., 0.),
                        Eigen::Quaterniond::Identity()) {
     for (const Eigen::Vector3f& point :
@@ -47,6 +49,10 @@ class RealTimeCorrelativeScanMatcher3DTest : public ::testing::Test {
       point_cloud_.push_back({point});
       hybrid_grid_.SetProbability(
           hybrid_grid_.GetCellIndex(expected_pose_.cast<float>() * point), 1.);
+      low_resolution_hybrid_grid_.SetProbability(
+          low_resolution_hybrid_grid_.GetCellIndex(
+              expected_pose_.cast<float>() * point),
+          1.);
     }
 
     auto parameter_dictionary = common::MakeDictionary(R"text(
@@ -60,6 +66,20 @@ class RealTimeCorrelativeScanMatcher3DTest : public ::testing::Test {
         new RealTimeCorrelativeScanMatcher3D(
             CreateRealTimeCorrelativeScanMatcherOptions(
                 parameter_dictionary.get())));
+
+    auto pruning_parameter_dictionary = common::MakeDictionary(R"text(
+        return {
+          linear_search_window = 0.3,
+          angular_search_window = math.rad(1.),
+          translation_delta_cost_weight = 1e-1,
+          rotation_delta_cost_weight = 1.,
+          num_refined_low_resolution_candidates = 3,
+          num_threads = 4,
+        })text");
+    pruning_real_time_correlative_scan_matcher_ =
+        absl::make_unique<RealTimeCorrelativeScanMatcher3D>(
+            CreateRealTimeCorrelativeScanMatcherOptions(
+                pruning_parameter_dictionary.get()));
   }
 
   void TestFromInitialPose(const transform::Rigid3d& initial_pose) {
@@ -69,13 +89,24 @@ class RealTimeCorrelativeScanMatcher3DTest : public ::testing::Test {
         initial_pose, point_cloud_, hybrid_grid_, &pose);
     LOG(INFO) << "Score: " << score;
     EXPECT_THAT(pose, transform::IsNearly(expected_pose_, 1e-3));
+
+    transform::Rigid3d pruned_pose;
+    const float pruned_score =
+        pruning_real_time_correlative_scan_matcher_->Match(
+            initial_pose, point_cloud_, hybrid_grid_, point_cloud_,
+            low_resolution_hybrid_grid_, &pruned_pose);
+    EXPECT_THAT(pruned_pose, transform::IsNearly(expected_pose_, 1e-3));
+    EXPECT_EQ(score, pruned_score);
   }
 
   HybridGrid hybrid_grid_;
+  HybridGrid low_resolution_hybrid_grid_;
   transform::Rigid3d expected_pose_;
   sensor::PointCloud point_cloud_;
   std::unique_ptr<RealTimeCorrelativeScanMatcher3D>
       real_time_correlative_scan_matcher_;
+  std::unique_ptr<RealTimeCorrelativeScanMatcher3D>
+      pruning_real_time_correlative_scan_matcher_;
 };
 
 TEST_F(RealTimeCorrelativeScanMatcher3DTest, PerfectEstimate) {
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping/internal/asynchronous_trajectory_builder.h"
+
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace mapping {
+
+AsynchronousTrajectoryBuilder::AsynchronousTrajectoryBuilder(
+    const int queue_size,
+    std::unique_ptr<TrajectoryBuilderInterface> wrapped_trajectory_builder)
+    : wrapped_trajectory_builder_(std::move(wrapped_trajectory_builder)),
+      queue_(queue_size) {
+  CHECK_GT(queue_size, 0);
+  thread_ = std::thread([this]() { ProcessQueue(); });
+}
+
+AsynchronousTrajectoryBuilder::~AsynchronousTrajectoryBuilder() {
+  {
+    absl::MutexLock locker(&mutex_);
+    shutting_down_ = true;
+  }
+  // A nullptr stops the background thread.
+  queue_.Push(nullptr);
+  thread_.join();
+}
+
+void AsynchronousTrajectoryBuilder::WaitUntilIdle() {
+  const auto predicate = [this]() EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return num_pending_data_ == 0;
+  };
+  absl::MutexLock locker(&mutex_);
+  mutex_.Await(absl::Condition(&predicate));
+}
+
+void AsynchronousTrajectoryBuilder::AddData(
+    std::unique_ptr<sensor::Data> data) {
+  CHECK(data != nullptr);
+  {
+    absl::MutexLock locker(&mutex_);
+    ++num_pending_data_;
+  }
+  queue_.Push(std::move(data));
+}
+
+void AsynchronousTrajectoryBuilder::ProcessQueue() {
+  for (;;) {
+    std::unique_ptr<sensor::Data> data = queue_.Pop();
+    if (data == nullptr) {
+      return;
+    }
+    bool shutting_down;
+    {
+      absl::MutexLock locker(&mutex_);
+      shutting_down = shutting_down_;
+    }
+    if (!shutting_down) {
+      absl::MutexLock locker(&processing_mutex_);
+      wrapped_trajectory_builder_->AddDispatchableData(std::move(data));
+    }
+    absl::MutexLock locker(&mutex_);
+    --num_pending_data_;
+  }
+}
+
+}  // namespace mapping
+}  // namespace cartographer
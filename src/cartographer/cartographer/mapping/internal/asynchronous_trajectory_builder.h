@@ -0,0 +1,116 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_MAPPING_INTERNAL_ASYNCHRONOUS_TRAJECTORY_BUILDER_H_
+#define CARTOGRAPHER_MAPPING_INTERNAL_ASYNCHRONOUS_TRAJECTORY_BUILDER_H_
+
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "absl/synchronization/mutex.h"
+#include "cartographer/common/internal/blocking_queue.h"
+#include "cartographer/common/port.h"
+#include "cartographer/mapping/internal/local_slam_result_data.h"
+#include "cartographer/mapping/trajectory_builder_interface.h"
+#include "cartographer/sensor/data.h"
+#include "cartographer/sensor/internal/dispatchable.h"
+
+namespace cartographer {
+namespace mapping {
+
+// Passes sensor data on to 'wrapped_trajectory_builder' on a dedicated
+// background thread, so that local SLAM of different trajectories runs in
+// parallel. The order of the data is preserved. At most 'queue_size' items are
+// queued, adding data blocks once the queue is full.
+class AsynchronousTrajectoryBuilder : public TrajectoryBuilderInterface {
+ public:
+  AsynchronousTrajectoryBuilder(
+      int queue_size,
+      std::unique_ptr<TrajectoryBuilderInterface> wrapped_trajectory_builder);
+
+  // Data which has not been passed on yet is dropped.
+  ~AsynchronousTrajectoryBuilder() override;
+
+  AsynchronousTrajectoryBuilder(const AsynchronousTrajectoryBuilder&) = delete;
+  AsynchronousTrajectoryBuilder& operator=(
+      const AsynchronousTrajectoryBuilder&) = delete;
+
+  void AddSensorData(
+      const std::string& sensor_id,
+      const sensor::TimedPointCloudData& timed_point_cloud_data) override {
+    AddData(sensor::MakeDispatchable(sensor_id, timed_point_cloud_data));
+  }
+
+  void AddSensorData(const std::string& sensor_id,
+                     const sensor::ImuData& imu_data) override {
+    AddData(sensor::MakeDispatchable(sensor_id, imu_data));
+  }
+
+  void AddSensorData(const std::string& sensor_id,
+                     const sensor::OdometryData& odometry_data) override {
+    AddData(sensor::MakeDispatchable(sensor_id, odometry_data));
+  }
+
+  void AddSensorData(
+      const std::string& sensor_id,
+      const sensor::FixedFramePoseData& fixed_frame_pose_data) override {
+    AddData(sensor::MakeDispatchable(sensor_id, fixed_frame_pose_data));
+  }
+
+  void AddSensorData(const std::string& sensor_id,
+                     const sensor::LandmarkData& landmark_data) override {
+    AddData(sensor::MakeDispatchable(sensor_id, landmark_data));
+  }
+
+  void AddDispatchableData(std::unique_ptr<sensor::Data> data) override {
+    AddData(std::move(data));
+  }
+
+  void AddLocalSlamResultData(std::unique_ptr<mapping::LocalSlamResultData>
+                                  local_slam_result_data) override {
+    AddData(std::move(local_slam_result_data));
+  }
+
+  // Blocks until all data added so far was passed on.
+  void WaitUntilIdle() LOCKS_EXCLUDED(mutex_);
+
+  // Held while data is passed on. Holding it keeps the wrapped trajectory
+  // builder from modifying its submaps, e.g. while they are serialized.
+  absl::Mutex* processing_mutex() LOCK_RETURNED(processing_mutex_) {
+    return &processing_mutex_;
+  }
+
+ private:
+  void AddData(std::unique_ptr<sensor::Data> data) LOCKS_EXCLUDED(mutex_);
+  void ProcessQueue();
+
+  std::unique_ptr<TrajectoryBuilderInterface> wrapped_trajectory_builder_;
+  common::BlockingQueue<std::unique_ptr<sensor::Data>> queue_;
+
+  absl::Mutex mutex_;
+  int64 num_pending_data_ GUARDED_BY(mutex_) = 0;
+  bool shutting_down_ GUARDED_BY(mutex_) = false;
+
+  absl::Mutex processing_mutex_;
+
+  std::thread thread_;
+};
+
+}  // namespace mapping
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_MAPPING_INTERNAL_ASYNCHRONOUS_TRAJECTORY_BUILDER_H_
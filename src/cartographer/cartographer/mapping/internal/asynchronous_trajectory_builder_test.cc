@@ -0,0 +1,120 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping/internal/asynchronous_trajectory_builder.h"
+
+#include <thread>
+
+#include "absl/memory/memory.h"
+#include "cartographer/common/time.h"
+#include "cartographer/mapping/internal/testing/mock_trajectory_builder.h"
+#include "cartographer/sensor/internal/dispatchable.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace mapping {
+namespace {
+
+using ::testing::_;
+using ::testing::Field;
+using ::testing::InSequence;
+using ::testing::Invoke;
+
+constexpr char kImuSensorId[] = "imu";
+constexpr char kOdometrySensorId[] = "odometry";
+constexpr char kRangeSensorId[] = "range";
+
+TEST(AsynchronousTrajectoryBuilderTest, PassesDataOnInOrder) {
+  auto mock_trajectory_builder =
+      absl::make_unique<testing::MockTrajectoryBuilder>();
+  std::thread::id processing_thread;
+  {
+    InSequence sequence;
+    for (int i = 0; i < 10; ++i) {
+      EXPECT_CALL(*mock_trajectory_builder,
+                  AddSensorData(kImuSensorId,
+                                ::testing::Matcher<const sensor::ImuData&>(
+                                    Field(&sensor::ImuData::time,
+                                          common::FromUniversal(2 * i)))))
+          .WillOnce(Invoke([&processing_thread](const std::string&,
+                                                const sensor::ImuData&) {
+            processing_thread = std::this_thread::get_id();
+          }));
+      EXPECT_CALL(
+          *mock_trajectory_builder,
+          AddSensorData(kOdometrySensorId,
+                        ::testing::Matcher<const sensor::OdometryData&>(
+                            Field(&sensor::OdometryData::time,
+                                  common::FromUniversal(2 * i + 1)))));
+    }
+  }
+  AsynchronousTrajectoryBuilder asynchronous_trajectory_builder(
+      3 /* queue_size */, std::move(mock_trajectory_builder));
+  for (int i = 0; i < 10; ++i) {
+    asynchronous_trajectory_builder.AddSensorData(
+        kImuSensorId,
+        sensor::ImuData{common::FromUniversal(2 * i), Eigen::Vector3d::Zero(),
+                        Eigen::Vector3d::Zero()});
+    asynchronous_trajectory_builder.AddSensorData(
+        kOdometrySensorId,
+        sensor::OdometryData{common::FromUniversal(2 * i + 1),
+                             transform::Rigid3d::Identity()});
+  }
+  asynchronous_trajectory_builder.WaitUntilIdle();
+  EXPECT_NE(std::this_thread::get_id(), processing_thread);
+}
+
+TEST(AsynchronousTrajectoryBuilderTest, WaitUntilIdleWithoutData) {
+  auto mock_trajectory_builder =
+      absl::make_unique<testing::MockTrajectoryBuilder>();
+  EXPECT_CALL(*mock_trajectory_builder,
+              AddSensorData(_, ::testing::Matcher<const sensor::ImuData&>(_)))
+      .Times(0);
+  AsynchronousTrajectoryBuilder asynchronous_trajectory_builder(
+      1 /* queue_size */, std::move(mock_trajectory_builder));
+  asynchronous_trajectory_builder.WaitUntilIdle();
+}
+
+TEST(AsynchronousTrajectoryBuilderTest, DoesNotCopyDispatchableData) {
+  auto mock_trajectory_builder =
+      absl::make_unique<testing::MockTrajectoryBuilder>();
+  const sensor::TimedRangefinderPoint* passed_on_points = nullptr;
+  EXPECT_CALL(*mock_trajectory_builder,
+              AddSensorData(
+                  kRangeSensorId,
+                  ::testing::Matcher<const sensor::TimedPointCloudData&>(_)))
+      .WillOnce(Invoke([&passed_on_points](
+                           const std::string&,
+                           const sensor::TimedPointCloudData& data) {
+        passed_on_points = data.ranges.data();
+      }));
+  AsynchronousTrajectoryBuilder asynchronous_trajectory_builder(
+      1 /* queue_size */, std::move(mock_trajectory_builder));
+  sensor::TimedPointCloudData timed_point_cloud_data{
+      common::FromUniversal(1), Eigen::Vector3f::Zero(), {}, {}};
+  timed_point_cloud_data.ranges.resize(100);
+  const sensor::TimedRangefinderPoint* const added_points =
+      timed_point_cloud_data.ranges.data();
+  asynchronous_trajectory_builder.AddDispatchableData(sensor::MakeDispatchable(
+      kRangeSensorId, std::move(timed_point_cloud_data)));
+  asynchronous_trajectory_builder.WaitUntilIdle();
+  EXPECT_EQ(added_points, passed_on_points);
+}
+
+}  // namespace
+}  // namespace mapping
+}  // namespace cartographer
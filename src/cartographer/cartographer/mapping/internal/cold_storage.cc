@@ -0,0 +1,311 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping/internal/cold_storage.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace mapping {
+
+namespace {
+
+std::string CreateTemporaryDirectory(const std::string& directory) {
+  std::string pattern = absl::StrCat(directory, "/cartographer_cold_XXXXXX");
+  CHECK(mkdtemp(&pattern[0]) != nullptr)
+      << "Could not create a directory in " << directory;
+  return pattern;
+}
+
+// Writes to a temporary file which then replaces 'filename', so that readers
+// which opened an earlier version of the file can finish reading it.
+void WriteProtoToFile(const std::string& filename,
+                      const google::protobuf::Message& proto) {
+  const std::string temporary_filename = filename + ".tmp";
+  io::ProtoStreamWriter writer(temporary_filename);
+  writer.WriteProto(proto);
+  CHECK(writer.Close()) << "Could not write " << temporary_filename;
+  CHECK_EQ(std::rename(temporary_filename.c_str(), filename.c_str()), 0)
+      << "Could not rename " << temporary_filename << " to " << filename;
+}
+
+template <typename ProtoType>
+ProtoType ReadProto(io::ProtoStreamReader* const reader) {
+  ProtoType proto;
+  CHECK(reader->ReadProto(&proto)) << "Could not read evicted data.";
+  return proto;
+}
+
+template <typename IdType, typename EntryType>
+const EntryType* FindOrNull(const std::map<IdType, EntryType>& entries,
+                            const IdType& id) {
+  const auto it = entries.find(id);
+  return it == entries.end() ? nullptr : &it->second;
+}
+
+}  // namespace
+
+ColdStorage::ColdStorage(const std::string& directory,
+                         const int64 memory_budget_in_bytes)
+    : directory_(CreateTemporaryDirectory(directory)),
+      memory_budget_in_bytes_(memory_budget_in_bytes) {
+  LOG(INFO) << "Evicting data above " << memory_budget_in_bytes_
+            << " bytes to " << directory_;
+}
+
+ColdStorage::~ColdStorage() {
+  for (const auto& entry : submaps_) {
+    if (entry.second.on_disk) std::remove(GetFilename(entry.first).c_str());
+  }
+  for (const auto& entry : nodes_) {
+    if (entry.second.on_disk) std::remove(GetFilename(entry.first).c_str());
+  }
+  rmdir(directory_.c_str());
+}
+
+bool ColdStorage::IsTracked(const SubmapId& submap_id) const {
+  return submaps_.count(submap_id) != 0;
+}
+
+bool ColdStorage::IsTracked(const NodeId& node_id) const {
+  return nodes_.count(node_id) != 0;
+}
+
+bool ColdStorage::IsEvicted(const SubmapId& submap_id) const {
+  const Entry* const entry = FindOrNull(submaps_, submap_id);
+  return entry != nullptr && entry->evicted;
+}
+
+bool ColdStorage::IsEvicted(const NodeId& node_id) const {
+  const Entry* const entry = FindOrNull(nodes_, node_id);
+  return entry != nullptr && entry->evicted;
+}
+
+bool ColdStorage::IsOnDisk(const SubmapId& submap_id) const {
+  const Entry* const entry = FindOrNull(submaps_, submap_id);
+  return entry != nullptr && entry->on_disk;
+}
+
+bool ColdStorage::IsOnDisk(const NodeId& node_id) const {
+  const Entry* const entry = FindOrNull(nodes_, node_id);
+  return entry != nullptr && entry->on_disk;
+}
+
+void ColdStorage::AddResident(const SubmapId& submap_id,
+                              const int64 num_bytes) {
+  AddResident(submap_id, num_bytes, &submaps_);
+}
+
+void ColdStorage::AddResident(const NodeId& node_id, const int64 num_bytes) {
+  AddResident(node_id, num_bytes, &nodes_);
+}
+
+void ColdStorage::SelectForEviction(
+    std::vector<std::pair<double, SubmapId>> submap_candidates,
+    std::vector<std::pair<double, NodeId>> node_candidates,
+    std::vector<SubmapId>* const submaps_to_evict,
+    std::vector<NodeId>* const nodes_to_evict) const {
+  submaps_to_evict->clear();
+  nodes_to_evict->clear();
+  int64 excess_bytes = resident_bytes_ - memory_budget_in_bytes_;
+  if (excess_bytes <= 0) return;
+
+  // Farthest first. Among equally far candidates, submaps go first since they
+  // are larger.
+  std::sort(submap_candidates.begin(), submap_candidates.end(),
+            std::greater<std::pair<double, SubmapId>>());
+  std::sort(node_candidates.begin(), node_candidates.end(),
+            std::greater<std::pair<double, NodeId>>());
+  auto submap_it = submap_candidates.begin();
+  auto node_it = node_candidates.begin();
+  while (excess_bytes > 0 && (submap_it != submap_candidates.end() ||
+                              node_it != node_candidates.end())) {
+    if (node_it == node_candidates.end() ||
+        (submap_it != submap_candidates.end() &&
+         submap_it->first >= node_it->first)) {
+      const Entry& entry = submaps_.at(submap_it->second);
+      CHECK(!entry.evicted);
+      excess_bytes -= entry.num_bytes;
+      submaps_to_evict->push_back(submap_it->second);
+      ++submap_it;
+    } else {
+      const Entry& entry = nodes_.at(node_it->second);
+      CHECK(!entry.evicted);
+      excess_bytes -= entry.num_bytes;
+      nodes_to_evict->push_back(node_it->second);
+      ++node_it;
+    }
+  }
+}
+
+void ColdStorage::Write(const SubmapId& submap_id,
+                        const proto::Submap& submap) {
+  Write(submap_id, submap, &submaps_);
+}
+
+void ColdStorage::Write(const NodeId& node_id,
+                        const proto::TrajectoryNodeData& node) {
+  Write(node_id, node, &nodes_);
+}
+
+void ColdStorage::Evict(const SubmapId& submap_id) {
+  Evict(submap_id, &submaps_);
+}
+
+void ColdStorage::Evict(const NodeId& node_id) { Evict(node_id, &nodes_); }
+
+std::unique_ptr<io::ProtoStreamReader> ColdStorage::Open(
+    const SubmapId& submap_id) const {
+  return Open(submap_id, submaps_);
+}
+
+std::unique_ptr<io::ProtoStreamReader> ColdStorage::Open(
+    const NodeId& node_id) const {
+  return Open(node_id, nodes_);
+}
+
+proto::Submap ColdStorage::ReadSubmap(io::ProtoStreamReader* const reader) {
+  return ReadProto<proto::Submap>(reader);
+}
+
+proto::TrajectoryNodeData ColdStorage::ReadNode(
+    io::ProtoStreamReader* const reader) {
+  return ReadProto<proto::TrajectoryNodeData>(reader);
+}
+
+void ColdStorage::MakeResident(const SubmapId& submap_id) {
+  MakeResident(submap_id, &submaps_);
+}
+
+void ColdStorage::MakeResident(const NodeId& node_id) {
+  MakeResident(node_id, &nodes_);
+}
+
+void ColdStorage::Erase(const SubmapId& submap_id) {
+  Erase(submap_id, &submaps_);
+}
+
+void ColdStorage::Erase(const NodeId& node_id) { Erase(node_id, &nodes_); }
+
+template <typename IdType>
+void ColdStorage::AddResident(const IdType& id, const int64 num_bytes,
+                              std::map<IdType, Entry>* const entries) {
+  const Entry entry{num_bytes, false /* evicted */, false /* on_disk */};
+  CHECK(entries->emplace(id, entry).second) << id;
+  resident_bytes_ += num_bytes;
+}
+
+template <typename IdType>
+void ColdStorage::Write(const IdType& id,
+                        const google::protobuf::Message& proto,
+                        std::map<IdType, Entry>* const entries) {
+  Entry& entry = entries->at(id);
+  WriteProtoToFile(GetFilename(id), proto);
+  entry.on_disk = true;
+}
+
+template <typename IdType>
+void ColdStorage::Evict(const IdType& id,
+                        std::map<IdType, Entry>* const entries) {
+  Entry& entry = entries->at(id);
+  CHECK(!entry.evicted) << id;
+  CHECK(entry.on_disk) << id;
+  entry.evicted = true;
+  resident_bytes_ -= entry.num_bytes;
+  evicted_bytes_ += entry.num_bytes;
+}
+
+template <typename IdType>
+std::unique_ptr<io::ProtoStreamReader> ColdStorage::Open(
+    const IdType& id, const std::map<IdType, Entry>& entries) const {
+  CHECK(entries.at(id).on_disk) << id;
+  return absl::make_unique<io::ProtoStreamReader>(GetFilename(id));
+}
+
+template <typename IdType>
+void ColdStorage::MakeResident(const IdType& id,
+                               std::map<IdType, Entry>* const entries) {
+  Entry& entry = entries->at(id);
+  CHECK(entry.evicted) << id;
+  entry.evicted = false;
+  resident_bytes_ += entry.num_bytes;
+  evicted_bytes_ -= entry.num_bytes;
+}
+
+template <typename IdType>
+void ColdStorage::Erase(const IdType& id,
+                        std::map<IdType, Entry>* const entries) {
+  const auto it = entries->find(id);
+  if (it == entries->end()) return;
+  if (it->second.on_disk) {
+    std::remove(GetFilename(id).c_str());
+  }
+  if (it->second.evicted) {
+    evicted_bytes_ -= it->second.num_bytes;
+  } else {
+    resident_bytes_ -= it->second.num_bytes;
+  }
+  entries->erase(it);
+}
+
+std::string ColdStorage::GetFilename(const SubmapId& submap_id) const {
+  return absl::StrCat(directory_, "/submap_", submap_id.trajectory_id, "_",
+                      submap_id.submap_index, ".pbstream");
+}
+
+std::string ColdStorage::GetFilename(const NodeId& node_id) const {
+  return absl::StrCat(directory_, "/node_", node_id.trajectory_id, "_",
+                      node_id.node_index, ".pbstream");
+}
+
+int64 EstimatePointCloudBytes(const TrajectoryNode::Data& constant_data) {
+  const auto point_cloud_bytes = [](const sensor::PointCloud& point_cloud) {
+    return static_cast<int64>(
+        point_cloud.size() * sizeof(sensor::PointCloud::PointType) +
+        point_cloud.intensities().size() * sizeof(float));
+  };
+  return point_cloud_bytes(
+             constant_data.filtered_gravity_aligned_point_cloud) +
+         point_cloud_bytes(constant_data.high_resolution_point_cloud) +
+         point_cloud_bytes(constant_data.low_resolution_point_cloud) +
+         static_cast<int64>(
+             constant_data.rotational_scan_matcher_histogram.size() *
+             sizeof(float));
+}
+
+std::shared_ptr<const TrajectoryNode::Data> WithoutPointClouds(
+    const TrajectoryNode::Data& constant_data) {
+  return std::make_shared<const TrajectoryNode::Data>(
+      TrajectoryNode::Data{constant_data.time,
+                           constant_data.gravity_alignment,
+                           {} /* filtered_gravity_aligned_point_cloud */,
+                           {} /* high_resolution_point_cloud */,
+                           {} /* low_resolution_point_cloud */,
+                           {} /* rotational_scan_matcher_histogram */,
+                           constant_data.local_pose});
+}
+
+}  // namespace mapping
+}  // namespace cartographer
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_MAPPING_INTERNAL_COLD_STORAGE_H_
+#define CARTOGRAPHER_MAPPING_INTERNAL_COLD_STORAGE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cartographer/common/port.h"
+#include "cartographer/io/proto_stream.h"
+#include "cartographer/mapping/id.h"
+#include "cartographer/mapping/proto/serialization.pb.h"
+#include "cartographer/mapping/proto/trajectory_node_data.pb.h"
+#include "cartographer/mapping/trajectory_node.h"
+
+namespace cartographer {
+namespace mapping {
+
+// Keeps the estimated memory used by submap grids and node point clouds
+// within a budget by moving them to files in a local directory. Only the
+// bookkeeping lives here; the pose graph decides what may be evicted and
+// replaces evicted data with lightweight copies.
+//
+// Only finished submaps and node data, which never change, are tracked. Their
+// copy on disk is therefore kept when they are made resident again, so that
+// evicting them once more does not write anything.
+class ColdStorage {
+ public:
+  // Creates a new subdirectory of 'directory' for the evicted data. It is
+  // removed again on destruction.
+  ColdStorage(const std::string& directory, int64 memory_budget_in_bytes);
+  ~ColdStorage();
+
+  ColdStorage(const ColdStorage&) = delete;
+  ColdStorage& operator=(const ColdStorage&) = delete;
+
+  // Whether the memory used by the submap or node is accounted for, either
+  // resident or evicted.
+  bool IsTracked(const SubmapId& submap_id) const;
+  bool IsTracked(const NodeId& node_id) const;
+  bool IsEvicted(const SubmapId& submap_id) const;
+  bool IsEvicted(const NodeId& node_id) const;
+  // Whether a tracked submap or node has a copy on disk. Evicted ones always
+  // have.
+  bool IsOnDisk(const SubmapId& submap_id) const;
+  bool IsOnDisk(const NodeId& node_id) const;
+
+  // Starts accounting for a resident submap or node of 'num_bytes'.
+  void AddResident(const SubmapId& submap_id, int64 num_bytes);
+  void AddResident(const NodeId& node_id, int64 num_bytes);
+
+  // Given candidates for eviction with their distance to the closest active
+  // trajectory, returns those to evict, farthest first, so that the remaining
+  // resident data fits into the budget. All candidates must be tracked and
+  // resident.
+  void SelectForEviction(
+      std::vector<std::pair<double, SubmapId>> submap_candidates,
+      std::vector<std::pair<double, NodeId>> node_candidates,
+      std::vector<SubmapId>* submaps_to_evict,
+      std::vector<NodeId>* nodes_to_evict) const;
+
+  // Writes the full data of a tracked submap or node to disk.
+  void Write(const SubmapId& submap_id, const proto::Submap& submap);
+  void Write(const NodeId& node_id, const proto::TrajectoryNodeData& node);
+
+  // Stops counting a tracked, resident submap or node with a copy on disk as
+  // resident.
+  void Evict(const SubmapId& submap_id);
+  void Evict(const NodeId& node_id);
+
+  // Opens the copy on disk of a submap or node. Only opening the file needs
+  // the lock guarding this class. Reading it with 'ReadSubmap' or 'ReadNode'
+  // does not, and still works after the submap or node has been erased, since
+  // files are never modified in place.
+  std::unique_ptr<io::ProtoStreamReader> Open(const SubmapId& submap_id) const;
+  std::unique_ptr<io::ProtoStreamReader> Open(const NodeId& node_id) const;
+  static proto::Submap ReadSubmap(io::ProtoStreamReader* reader);
+  static proto::TrajectoryNodeData ReadNode(io::ProtoStreamReader* reader);
+
+  // Counts an evicted submap or node as resident again after its data has
+  // been loaded back into memory.
+  void MakeResident(const SubmapId& submap_id);
+  void MakeResident(const NodeId& node_id);
+
+  // Stops tracking a trimmed submap or node. Does nothing if it is not
+  // tracked.
+  void Erase(const SubmapId& submap_id);
+  void Erase(const NodeId& node_id);
+
+  int64 resident_bytes() const { return resident_bytes_; }
+  int64 evicted_bytes() const { return evicted_bytes_; }
+
+ private:
+  struct Entry {
+    int64 num_bytes;
+    bool evicted;
+    bool on_disk;
+  };
+
+  template <typename IdType>
+  void AddResident(const IdType& id, int64 num_bytes,
+                   std::map<IdType, Entry>* entries);
+  template <typename IdType>
+  void Write(const IdType& id, const google::protobuf::Message& proto,
+             std::map<IdType, Entry>* entries);
+  template <typename IdType>
+  void Evict(const IdType& id, std::map<IdType, Entry>* entries);
+  template <typename IdType>
+  std::unique_ptr<io::ProtoStreamReader> Open(
+      const IdType& id, const std::map<IdType, Entry>& entries) const;
+  template <typename IdType>
+  void MakeResident(const IdType& id, std::map<IdType, Entry>* entries);
+  template <typename IdType>
+  void Erase(const IdType& id, std::map<IdType, Entry>* entries);
+
+  std::string GetFilename(const SubmapId& submap_id) const;
+  std::string GetFilename(const NodeId& node_id) const;
+
+  const std::string directory_;
+  const int64 memory_budget_in_bytes_;
+  std::map<SubmapId, Entry> submaps_;
+  std::map<NodeId, Entry> nodes_;
+  int64 resident_bytes_ = 0;
+  int64 evicted_bytes_ = 0;
+};
+
+// Estimates the memory used by the point clouds of 'constant_data'.
+int64 EstimatePointCloudBytes(const TrajectoryNode::Data& constant_data);
+
+// Returns a copy of 'constant_data' without point clouds, which is kept in
+// place of evicted node data.
+std::shared_ptr<const TrajectoryNode::Data> WithoutPointClouds(
+    const TrajectoryNode::Data& constant_data);
+
+}  // namespace mapping
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_MAPPING_INTERNAL_COLD_STORAGE_H_
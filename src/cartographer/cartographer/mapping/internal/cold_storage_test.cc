@@ -0,0 +1,138 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping/internal/cold_storage.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace mapping {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+TEST(ColdStorageTest, EvictsFarthestFirstUntilWithinBudget) {
+  ColdStorage cold_storage(::testing::TempDir(), 200);
+  const SubmapId near_submap{0, 0};
+  const SubmapId far_submap{0, 1};
+  const NodeId near_node{0, 0};
+  const NodeId far_node{0, 1};
+  cold_storage.AddResident(near_submap, 100);
+  cold_storage.AddResident(far_submap, 100);
+  cold_storage.AddResident(near_node, 50);
+  cold_storage.AddResident(far_node, 50);
+  EXPECT_EQ(cold_storage.resident_bytes(), 300);
+
+  std::vector<SubmapId> submaps_to_evict;
+  std::vector<NodeId> nodes_to_evict;
+  cold_storage.SelectForEviction({{1., near_submap}, {5., far_submap}},
+                                 {{2., near_node}, {10., far_node}},
+                                 &submaps_to_evict, &nodes_to_evict);
+  // Evicting the farthest node is not enough, the next farthest is a submap.
+  EXPECT_THAT(submaps_to_evict, ElementsAre(far_submap));
+  EXPECT_THAT(nodes_to_evict, ElementsAre(far_node));
+
+  cold_storage.AddResident(SubmapId{1, 0}, 10);
+  EXPECT_EQ(cold_storage.resident_bytes(), 310);
+  cold_storage.Erase(SubmapId{1, 0});
+  cold_storage.Erase(SubmapId{1, 1});
+  EXPECT_EQ(cold_storage.resident_bytes(), 300);
+  cold_storage.AddResident(NodeId{1, 0}, 0);
+  cold_storage.SelectForEviction({}, {}, &submaps_to_evict, &nodes_to_evict);
+  EXPECT_THAT(submaps_to_evict, IsEmpty());
+  EXPECT_THAT(nodes_to_evict, IsEmpty());
+}
+
+TEST(ColdStorageTest, RoundTripsThroughDisk) {
+  ColdStorage cold_storage(::testing::TempDir(), 0);
+  const SubmapId submap_id{2, 3};
+  const NodeId node_id{2, 7};
+  cold_storage.AddResident(submap_id, 1000);
+  cold_storage.AddResident(node_id, 100);
+  EXPECT_TRUE(cold_storage.IsTracked(submap_id));
+  EXPECT_FALSE(cold_storage.IsEvicted(submap_id));
+
+  proto::Submap submap;
+  submap.mutable_submap_2d()->set_num_range_data(42);
+  submap.mutable_submap_2d()->set_finished(true);
+  cold_storage.Write(submap_id, submap);
+  EXPECT_TRUE(cold_storage.IsOnDisk(submap_id));
+  EXPECT_FALSE(cold_storage.IsEvicted(submap_id));
+  cold_storage.Evict(submap_id);
+  proto::TrajectoryNodeData node;
+  node.set_timestamp(1234);
+  node.add_rotational_scan_matcher_histogram(0.5f);
+  cold_storage.Write(node_id, node);
+  cold_storage.Evict(node_id);
+  EXPECT_TRUE(cold_storage.IsEvicted(submap_id));
+  EXPECT_TRUE(cold_storage.IsEvicted(node_id));
+  EXPECT_EQ(cold_storage.resident_bytes(), 0);
+  EXPECT_EQ(cold_storage.evicted_bytes(), 1100);
+
+  const proto::Submap loaded_submap =
+      ColdStorage::ReadSubmap(cold_storage.Open(submap_id).get());
+  EXPECT_EQ(loaded_submap.submap_2d().num_range_data(), 42);
+  EXPECT_TRUE(loaded_submap.submap_2d().finished());
+  // A file opened before the node is erased can still be read.
+  const std::unique_ptr<io::ProtoStreamReader> node_reader =
+      cold_storage.Open(node_id);
+  cold_storage.Erase(node_id);
+  EXPECT_FALSE(cold_storage.IsTracked(node_id));
+  EXPECT_EQ(cold_storage.evicted_bytes(), 1000);
+  const proto::TrajectoryNodeData loaded_node =
+      ColdStorage::ReadNode(node_reader.get());
+  EXPECT_EQ(loaded_node.timestamp(), 1234);
+  ASSERT_EQ(loaded_node.rotational_scan_matcher_histogram_size(), 1);
+  EXPECT_EQ(loaded_node.rotational_scan_matcher_histogram(0), 0.5f);
+
+  // The copy on disk is kept, so evicting again does not need a write.
+  cold_storage.MakeResident(submap_id);
+  EXPECT_FALSE(cold_storage.IsEvicted(submap_id));
+  EXPECT_TRUE(cold_storage.IsOnDisk(submap_id));
+  EXPECT_EQ(cold_storage.resident_bytes(), 1000);
+  EXPECT_EQ(cold_storage.evicted_bytes(), 0);
+  cold_storage.Evict(submap_id);
+  EXPECT_EQ(cold_storage.resident_bytes(), 0);
+  EXPECT_EQ(ColdStorage::ReadSubmap(cold_storage.Open(submap_id).get())
+                .submap_2d()
+                .num_range_data(),
+            42);
+}
+
+TEST(ColdStorageTest, StripsPointClouds) {
+  TrajectoryNode::Data constant_data{
+      common::FromUniversal(1),
+      Eigen::Quaterniond::Identity(),
+      sensor::PointCloud(
+          {{Eigen::Vector3f::Zero()}, {Eigen::Vector3f::Ones()}}),
+      sensor::PointCloud({{Eigen::Vector3f::Zero()}}),
+      {},
+      Eigen::VectorXf::Zero(4),
+      transform::Rigid3d::Translation(Eigen::Vector3d(1., 2., 3.))};
+  EXPECT_EQ(EstimatePointCloudBytes(constant_data),
+            3 * sizeof(sensor::RangefinderPoint) + 4 * sizeof(float));
+  const auto stripped = WithoutPointClouds(constant_data);
+  EXPECT_EQ(EstimatePointCloudBytes(*stripped), 0);
+  EXPECT_EQ(stripped->time, constant_data.time);
+  EXPECT_TRUE(stripped->local_pose.translation().isApprox(
+      constant_data.local_pose.translation()));
+}
+
+}  // namespace
+}  // namespace mapping
+}  // namespace cartographer
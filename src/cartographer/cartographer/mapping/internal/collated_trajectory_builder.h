@@ -98,6 +98,10 @@ class CollatedTrajectoryBuilder : public TrajectoryBuilderInterface {
     wrapped_trajectory_builder_->AddSensorData(sensor_id, landmark_data);
   }
 
+  // Queues 'data' in the collator without copying it. Landmark and fixed frame
+  // pose data which is not collated is passed on directly.
+  void AddDispatchableData(std::unique_ptr<sensor::Data> data) override;
+
   // 将local slam 的结果也作为一种传感器数据进行处理
   void AddLocalSlamResultData(std::unique_ptr<mapping::LocalSlamResultData>
                                   local_slam_result_data) override {
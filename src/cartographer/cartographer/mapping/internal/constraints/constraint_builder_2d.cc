@@ -36,6 +36,7 @@
 #include "cartographer/metrics/counter.h"
 #include "cartographer/metrics/gauge.h"
 #include "cartographer/metrics/histogram.h"
+#include "cartographer/metrics/stage_timer.h"
 #include "cartographer/transform/transform.h"
 #include "glog/logging.h"
 
@@ -77,7 +78,7 @@ ConstraintBuilder2D::~ConstraintBuilder2D() {
   CHECK_EQ(finish_node_task_->GetState(), common::Task::NEW);
   CHECK_EQ(when_done_task_->GetState(), common::Task::NEW);
   CHECK_EQ(constraints_.size(), 0) << "WhenDone() was not called";
-  CHECK_EQ(num_started_nodes_, num_finished_nodes_);
+  CHECK_EQ(num_started_nodes_, num_finished_nodes_.load());
   CHECK(when_done_ == nullptr);
 }
 
@@ -117,7 +118,7 @@ void ConstraintBuilder2D::MaybeAddConstraint(
   // 在队列中新建一个指向Constraint数据的指针
   constraints_.emplace_back();
   kQueueLengthMetric->Set(constraints_.size());
-  auto* const constraint = &constraints_.back();
+  auto* const result = &constraints_.back();
   
   // 为子图新建一个匹配器
   const auto* scan_matcher =
@@ -128,7 +129,7 @@ void ConstraintBuilder2D::MaybeAddConstraint(
   constraint_task->SetWorkItem([=]() LOCKS_EXCLUDED(mutex_) {
     ComputeConstraint(submap_id, submap, node_id, false, /* match_full_submap */
                       constant_data, initial_relative_pose, *scan_matcher,
-                      constraint);
+                      result);
   });
 
   // 等匹配器之后初始化才能进行约束的计算
@@ -161,7 +162,7 @@ void ConstraintBuilder2D::MaybeAddGlobalConstraint(
 
   constraints_.emplace_back();
   kQueueLengthMetric->Set(constraints_.size());
-  auto* const constraint = &constraints_.back();
+  auto* const result = &constraints_.back();
   // 为子图新建一个匹配器
   const auto* scan_matcher =
       DispatchScanMatcherConstruction(submap_id, submap->grid());
@@ -170,7 +171,7 @@ void ConstraintBuilder2D::MaybeAddGlobalConstraint(
   constraint_task->SetWorkItem([=]() LOCKS_EXCLUDED(mutex_) {
     ComputeConstraint(submap_id, submap, node_id, true, /* match_full_submap */
                       constant_data, transform::Rigid2d::Identity(),
-                      *scan_matcher, constraint);
+                      *scan_matcher, result);
   });
   constraint_task->AddDependency(scan_matcher->creation_task_handle);
   auto constraint_task_handle =
@@ -184,10 +185,7 @@ void ConstraintBuilder2D::NotifyEndOfNode() {
   CHECK(finish_node_task_ != nullptr);
   
   // 生成个任务: 将num_finished_nodes_自加, 记录完成约束计算节点的总个数
-  finish_node_task_->SetWorkItem([this] {
-    absl::MutexLock locker(&mutex_);
-    ++num_finished_nodes_;
-  });
+  finish_node_task_->SetWorkItem([this] { ++num_finished_nodes_; });
 
   // 将这个任务传入线程池中等待执行, 由于之前添加了依赖, 所以finish_node_task_一定会比计算约束更晚完成
   auto finish_node_task_handle =
@@ -263,7 +261,7 @@ ConstraintBuilder2D::DispatchScanMatcherConstruction(const SubmapId& submap_id,
  * @param[in] constant_data 节点数据
  * @param[in] initial_relative_pose 约束的初值
  * @param[in] submap_scan_matcher 匹配器
- * @param[out] constraint 计算出的约束
+ * @param[out] result 计算出的约束
  */
 void ConstraintBuilder2D::ComputeConstraint(
     const SubmapId& submap_id, const Submap2D* const submap,
@@ -271,7 +269,8 @@ void ConstraintBuilder2D::ComputeConstraint(
     const TrajectoryNode::Data* const constant_data,
     const transform::Rigid2d& initial_relative_pose,
     const SubmapScanMatcher& submap_scan_matcher,
-    std::unique_ptr<ConstraintBuilder2D::Constraint>* constraint) {
+    ConstraintResult* const result) {
+  metrics::ScopedStageTimer timer(metrics::Stage::kConstraintSearch);
   CHECK(submap_scan_matcher.fast_correlative_scan_matcher);
 
   // Step:1 得到节点在local frame下的坐标
@@ -326,10 +325,7 @@ void ConstraintBuilder2D::ComputeConstraint(
     }
   }
   
-  {
-    absl::MutexLock locker(&mutex_);
-    score_histogram_.Add(score);
-  }
+  result->score = score;
 
   // Use the CSM estimate as both the initial and previous pose. This has the
   // effect that, in the absence of better information, we prefer the original
@@ -348,12 +344,12 @@ void ConstraintBuilder2D::ComputeConstraint(
       ComputeSubmapPose(*submap).inverse() * pose_estimate;
 
   // Step:5 返回计算后的约束
-  constraint->reset(new Constraint{submap_id,
-                                   node_id,
-                                   {transform::Embed3D(constraint_transform),
-                                    options_.loop_closure_translation_weight(),
-                                    options_.loop_closure_rotation_weight()},
-                                   Constraint::INTER_SUBMAP});
+  result->constraint = Constraint{submap_id,
+                                  node_id,
+                                  {transform::Embed3D(constraint_transform),
+                                   options_.loop_closure_translation_weight(),
+                                   options_.loop_closure_rotation_weight()},
+                                  Constraint::INTER_SUBMAP};
 
   // log相关
   if (options_.log_matches()) {
@@ -384,9 +380,13 @@ void ConstraintBuilder2D::RunWhenDoneCallback() {
     CHECK(when_done_ != nullptr);
 
     // 将计算完的约束进行保存
-    for (const std::unique_ptr<Constraint>& constraint : constraints_) {
-      if (constraint == nullptr) continue;
-      result.push_back(*constraint);
+    // Merging in the order the computations were added keeps the result
+    // independent of how the background tasks were scheduled.
+    result.reserve(constraints_.size());
+    for (const ConstraintResult& constraint_result : constraints_) {
+      if (!constraint_result.constraint.has_value()) continue;
+      result.push_back(*constraint_result.constraint);
+      score_histogram_.Add(constraint_result.score);
     }
 
     if (options_.log_matches()) {
@@ -408,8 +408,7 @@ void ConstraintBuilder2D::RunWhenDoneCallback() {
 
 // 获取完成约束计算节点的总个数
 int ConstraintBuilder2D::GetNumFinishedNodes() {
-  absl::MutexLock locker(&mutex_);
-  return num_finished_nodes_;
+  return num_finished_nodes_.load();
 }
 
 // 删除指定submap_id的匹配器
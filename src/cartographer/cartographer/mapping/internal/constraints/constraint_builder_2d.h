@@ -18,6 +18,7 @@
 #define CARTOGRAPHER_MAPPING_INTERNAL_CONSTRAINTS_CONSTRAINT_BUILDER_2D_H_
 
 #include <array>
+#include <atomic>
 #include <deque>
 #include <functional>
 #include <limits>
@@ -26,6 +27,7 @@
 
 #include "Eigen/Core"
 #include "Eigen/Geometry"
+#include "absl/types/optional.h"
 #include "absl/synchronization/mutex.h"
 #include "cartographer/common/fixed_ratio_sampler.h"
 #include "cartographer/common/histogram.h"
@@ -108,6 +110,15 @@ class ConstraintBuilder2D {
   static void RegisterMetrics(metrics::FamilyFactory* family_factory);
 
  private:
+  // Output of one constraint computation. Each is written by a single
+  // background task, so they need no locking, and they are merged in the
+  // order they were added once all computations are done.
+  struct ConstraintResult {
+    // Empty if the search found no match with an above-threshold score.
+    absl::optional<Constraint> constraint;
+    float score = 0.f;
+  };
+
   // FastCorrelativeScanMatcher2D的对象
   struct SubmapScanMatcher {
     const Grid2D* grid = nullptr;
@@ -124,14 +135,13 @@ class ConstraintBuilder2D {
 
   // Runs in a background thread and does computations for an additional
   // constraint, assuming 'submap' and 'compressed_point_cloud' do not change
-  // anymore. As output, it may create a new Constraint in 'constraint'.
+  // anymore. As output, it may create a new Constraint in 'result'.
   void ComputeConstraint(const SubmapId& submap_id, const Submap2D* submap,
                          const NodeId& node_id, bool match_full_submap,
                          const TrajectoryNode::Data* const constant_data,
                          const transform::Rigid2d& initial_relative_pose,
                          const SubmapScanMatcher& submap_scan_matcher,
-                         std::unique_ptr<Constraint>* constraint)
-      LOCKS_EXCLUDED(mutex_);
+                         ConstraintResult* result) LOCKS_EXCLUDED(mutex_);
 
   void RunWhenDoneCallback() LOCKS_EXCLUDED(mutex_);
 
@@ -143,23 +153,22 @@ class ConstraintBuilder2D {
   std::unique_ptr<std::function<void(const Result&)>> when_done_
       GUARDED_BY(mutex_);
 
-  // TODO(gaschler): Use atomics instead of mutex to access these counters.
   // Number of the node in reaction to which computations are currently
   // added. This is always the number of nodes seen so far, even when older
   // nodes are matched against a new submap.
   int num_started_nodes_ GUARDED_BY(mutex_) = 0;
 
-  int num_finished_nodes_ GUARDED_BY(mutex_) = 0;
+  // Incremented by background tasks without taking 'mutex_'.
+  std::atomic<int> num_finished_nodes_{0};
 
   std::unique_ptr<common::Task> finish_node_task_ GUARDED_BY(mutex_);
 
   std::unique_ptr<common::Task> when_done_task_ GUARDED_BY(mutex_);
 
   // Constraints currently being computed in the background. A deque is used to
-  // keep pointers valid when adding more entries. Constraint search results
-  // with below-threshold scores are also 'nullptr'.
+  // keep pointers valid when adding more entries.
   // 正在计算的约束的队列
-  std::deque<std::unique_ptr<Constraint>> constraints_ GUARDED_BY(mutex_);
+  std::deque<ConstraintResult> constraints_ GUARDED_BY(mutex_);
 
   // Map of dispatched or constructed scan matchers by 'submap_id'.
   std::map<SubmapId, SubmapScanMatcher> submap_scan_matchers_
@@ -168,7 +177,7 @@ class ConstraintBuilder2D {
 
   scan_matching::CeresScanMatcher2D ceres_scan_matcher_;
 
-  // Histogram of scan matcher scores.
+  // Histogram of scan matcher scores, updated when results are merged.
   common::Histogram score_histogram_ GUARDED_BY(mutex_);
 };
 
@@ -111,6 +111,47 @@ TEST_F(ConstraintBuilder2DTest, FindsConstraints) {
   }
 }
 
+TEST_F(ConstraintBuilder2DTest, ReturnsConstraintsInOrderOfAddition) {
+  TrajectoryNode::Data node_data;
+  node_data.filtered_gravity_aligned_point_cloud.push_back(
+      {Eigen::Vector3f(0.1, 0.2, 0.3)});
+  node_data.gravity_alignment = Eigen::Quaterniond::Identity();
+  node_data.local_pose = transform::Rigid3d::Identity();
+  MapLimits map_limits(1., Eigen::Vector2d(2., 3.), CellLimits(100, 110));
+  ValueConversionTables conversion_tables;
+  Submap2D submap(
+      Eigen::Vector2f(4.f, 5.f),
+      absl::make_unique<ProbabilityGrid>(map_limits, &conversion_tables),
+      &conversion_tables);
+  std::vector<NodeId> expected_node_ids;
+  for (int node_index = 5; node_index >= 0; --node_index) {
+    const NodeId node_id{0, node_index};
+    const SubmapId submap_id{0, node_index % 2};
+    if (node_index % 3 == 0) {
+      constraint_builder_->MaybeAddGlobalConstraint(submap_id, &submap,
+                                                    node_id, &node_data);
+    } else {
+      constraint_builder_->MaybeAddConstraint(submap_id, &submap, node_id,
+                                              &node_data,
+                                              transform::Rigid2d::Identity());
+    }
+    expected_node_ids.push_back(node_id);
+    constraint_builder_->NotifyEndOfNode();
+  }
+  std::vector<NodeId> node_ids;
+  constraint_builder_->WhenDone(
+      [&node_ids](const constraints::ConstraintBuilder2D::Result& result) {
+        for (const auto& constraint : result) {
+          node_ids.push_back(constraint.node_id);
+        }
+      });
+  thread_pool_.WaitUntilIdle();
+  EXPECT_EQ(node_ids, expected_node_ids);
+  EXPECT_EQ(constraint_builder_->GetNumFinishedNodes(), 6);
+  constraint_builder_->DeleteScanMatcher(SubmapId{0, 0});
+  constraint_builder_->DeleteScanMatcher(SubmapId{0, 1});
+}
+
 }  // namespace
 }  // namespace constraints
 }  // namespace mapping
@@ -36,6 +36,7 @@
 #include "cartographer/metrics/counter.h"
 #include "cartographer/metrics/gauge.h"
 #include "cartographer/metrics/histogram.h"
+#include "cartographer/metrics/stage_timer.h"
 #include "cartographer/transform/transform.h"
 #include "glog/logging.h"
 
@@ -72,7 +73,7 @@ ConstraintBuilder3D::~ConstraintBuilder3D() {
   CHECK_EQ(finish_node_task_->GetState(), common::Task::NEW);
   CHECK_EQ(when_done_task_->GetState(), common::Task::NEW);
   CHECK_EQ(constraints_.size(), 0) << "WhenDone() was not called";
-  CHECK_EQ(num_started_nodes_, num_finished_nodes_);
+  CHECK_EQ(num_started_nodes_, num_finished_nodes_.load());
   CHECK(when_done_ == nullptr);
 }
 
@@ -99,13 +100,13 @@ void ConstraintBuilder3D::MaybeAddConstraint(
   }
   constraints_.emplace_back();
   kQueueLengthMetric->Set(constraints_.size());
-  auto* const constraint = &constraints_.back();
+  auto* const result = &constraints_.back();
   const auto* scan_matcher = DispatchScanMatcherConstruction(submap_id, submap);
   auto constraint_task = absl::make_unique<common::Task>();
   constraint_task->SetWorkItem([=]() LOCKS_EXCLUDED(mutex_) {
     ComputeConstraint(submap_id, node_id, false, /* match_full_submap */
                       constant_data, global_node_pose, global_submap_pose,
-                      *scan_matcher, constraint);
+                      *scan_matcher, result);
   });
   constraint_task->AddDependency(scan_matcher->creation_task_handle);
   auto constraint_task_handle =
@@ -125,7 +126,7 @@ void ConstraintBuilder3D::MaybeAddGlobalConstraint(
   }
   constraints_.emplace_back();
   kQueueLengthMetric->Set(constraints_.size());
-  auto* const constraint = &constraints_.back();
+  auto* const result = &constraints_.back();
   const auto* scan_matcher = DispatchScanMatcherConstruction(submap_id, submap);
   auto constraint_task = absl::make_unique<common::Task>();
   constraint_task->SetWorkItem([=]() LOCKS_EXCLUDED(mutex_) {
@@ -133,7 +134,7 @@ void ConstraintBuilder3D::MaybeAddGlobalConstraint(
                       constant_data,
                       transform::Rigid3d::Rotation(global_node_rotation),
                       transform::Rigid3d::Rotation(global_submap_rotation),
-                      *scan_matcher, constraint);
+                      *scan_matcher, result);
   });
   constraint_task->AddDependency(scan_matcher->creation_task_handle);
   auto constraint_task_handle =
@@ -144,10 +145,7 @@ void ConstraintBuilder3D::MaybeAddGlobalConstraint(
 void ConstraintBuilder3D::NotifyEndOfNode() {
   absl::MutexLock locker(&mutex_);
   CHECK(finish_node_task_ != nullptr);
-  finish_node_task_->SetWorkItem([this] {
-    absl::MutexLock locker(&mutex_);
-    ++num_finished_nodes_;
-  });
+  finish_node_task_->SetWorkItem([this] { ++num_finished_nodes_; });
   auto finish_node_task_handle =
       thread_pool_->Schedule(std::move(finish_node_task_));
   finish_node_task_ = absl::make_unique<common::Task>();
@@ -203,7 +201,8 @@ void ConstraintBuilder3D::ComputeConstraint(
     const transform::Rigid3d& global_node_pose,
     const transform::Rigid3d& global_submap_pose,
     const SubmapScanMatcher& submap_scan_matcher,
-    std::unique_ptr<Constraint>* constraint) {
+    ConstraintResult* const result) {
+  metrics::ScopedStageTimer timer(metrics::Stage::kConstraintSearch);
   CHECK(submap_scan_matcher.fast_correlative_scan_matcher);
   // The 'constraint_transform' (submap i <- node j) is computed from:
   // - a 'high_resolution_point_cloud' in node j and
@@ -252,12 +251,9 @@ void ConstraintBuilder3D::ComputeConstraint(
       return;
     }
   }
-  {
-    absl::MutexLock locker(&mutex_);
-    score_histogram_.Add(match_result->score);
-    rotational_score_histogram_.Add(match_result->rotational_score);
-    low_resolution_score_histogram_.Add(match_result->low_resolution_score);
-  }
+  result->score = match_result->score;
+  result->rotational_score = match_result->rotational_score;
+  result->low_resolution_score = match_result->low_resolution_score;
 
   // Use the CSM estimate as both the initial and previous pose. This has the
   // effect that, in the absence of better information, we prefer the original
@@ -274,12 +270,12 @@ void ConstraintBuilder3D::ComputeConstraint(
                               /*intensity_hybrid_grid=*/nullptr}},
                             &constraint_transform, &unused_summary);
 
-  constraint->reset(new Constraint{
+  result->constraint = Constraint{
       submap_id,
       node_id,
       {constraint_transform, options_.loop_closure_translation_weight(),
        options_.loop_closure_rotation_weight()},
-      Constraint::INTER_SUBMAP});
+      Constraint::INTER_SUBMAP};
 
   if (options_.log_matches()) {
     std::ostringstream info;
@@ -310,9 +306,16 @@ void ConstraintBuilder3D::RunWhenDoneCallback() {
   {
     absl::MutexLock locker(&mutex_);
     CHECK(when_done_ != nullptr);
-    for (const std::unique_ptr<Constraint>& constraint : constraints_) {
-      if (constraint == nullptr) continue;
-      result.push_back(*constraint);
+    // Merging in the order the computations were added keeps the result
+    // independent of how the background tasks were scheduled.
+    result.reserve(constraints_.size());
+    for (const ConstraintResult& constraint_result : constraints_) {
+      if (!constraint_result.constraint.has_value()) continue;
+      result.push_back(*constraint_result.constraint);
+      score_histogram_.Add(constraint_result.score);
+      rotational_score_histogram_.Add(constraint_result.rotational_score);
+      low_resolution_score_histogram_.Add(
+          constraint_result.low_resolution_score);
     }
     if (options_.log_matches()) {
       LOG(INFO) << constraints_.size() << " computations resulted in "
@@ -333,8 +336,7 @@ void ConstraintBuilder3D::RunWhenDoneCallback() {
 }
 
 int ConstraintBuilder3D::GetNumFinishedNodes() {
-  absl::MutexLock locker(&mutex_);
-  return num_finished_nodes_;
+  return num_finished_nodes_.load();
 }
 
 void ConstraintBuilder3D::DeleteScanMatcher(const SubmapId& submap_id) {
@@ -20,6 +20,7 @@
 
 #include "absl/memory/memory.h"
 #include "cartographer/mapping/internal/3d/imu_integration.h"
+#include "cartographer/mapping/internal/3d/imu_preintegration.h"
 #include "cartographer/mapping/internal/3d/rotation_parameterization.h"
 #include "cartographer/mapping/internal/eigen_quaterniond_from_two_vectors.h"
 #include "cartographer/mapping/internal/optimization/ceres_pose.h"
@@ -85,6 +86,12 @@ common::Time ImuBasedPoseExtrapolator::GetLastExtrapolatedTime() const {
 void ImuBasedPoseExtrapolator::AddPose(const common::Time time,
                                        const transform::Rigid3d& pose) {
   timed_pose_queue_.push_back(TimestampedTransform{time, pose});
+  pose_queue_cost_functions_.emplace_back();
+  pose_queue_cost_functions_.back().pose.reset(
+      optimization::SpaCostFunction3D::CreateAutoDiffCostFunction(
+          PoseGraphInterface::Constraint::Pose{
+              pose, options_.pose_translation_weight(),
+              options_.pose_rotation_weight()}));
   while (timed_pose_queue_.size() > 3 &&
          timed_pose_queue_[1].time <=
              time - common::FromSeconds(options_.pose_queue_duration())) {
@@ -93,6 +100,10 @@ void ImuBasedPoseExtrapolator::AddPose(const common::Time time,
       previous_solution_.pop_front();
     }
     timed_pose_queue_.pop_front();
+    pose_queue_cost_functions_.pop_front();
+    // The IMU cost functions of the first pose refer to the pose before it.
+    pose_queue_cost_functions_.front().imu_rotation.reset();
+    pose_queue_cost_functions_.front().imu_acceleration.reset();
   }
   TrimImuData();
 }
@@ -130,7 +141,16 @@ ImuBasedPoseExtrapolator::ExtrapolatePosesWithGravity(
         timed_pose_queue_.back().transform.rotation()};
   }
 
+  // Owns the cost functions which involve the extrapolated node. All others
+  // are owned by 'pose_queue_cost_functions_' and reused across calls.
+  std::vector<std::unique_ptr<ceres::CostFunction>> uncached_cost_functions;
+  const auto take_ownership = [&uncached_cost_functions](
+                                  ceres::CostFunction* const cost_function) {
+    uncached_cost_functions.emplace_back(cost_function);
+    return cost_function;
+  };
   ceres::Problem::Options problem_options;
+  problem_options.cost_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
   ceres::Problem problem(problem_options);
 
   // Track gravity alignment over time and use this as a frame here so that
@@ -205,16 +225,12 @@ ImuBasedPoseExtrapolator::ExtrapolatePosesWithGravity(
   node_times.push_back(time);
 
   // Add cost functions for node constraints.
+  CHECK_EQ(pose_queue_cost_functions_.size(), timed_pose_queue_.size());
   for (size_t i = 0; i < timed_pose_queue_.size(); i++) {
-    const auto& timed_pose = timed_pose_queue_[i];
     problem.AddResidualBlock(
-        optimization::SpaCostFunction3D::CreateAutoDiffCostFunction(
-            PoseGraphInterface::Constraint::Pose{
-                timed_pose.transform, options_.pose_translation_weight(),
-                options_.pose_rotation_weight()}),
-        nullptr /* loss function */, gravity_from_local.rotation(),
-        gravity_from_local.translation(), nodes.at(i).rotation(),
-        nodes.at(i).translation());
+        pose_queue_cost_functions_[i].pose.get(), nullptr /* loss function */,
+        gravity_from_local.rotation(), gravity_from_local.translation(),
+        nodes.at(i).rotation(), nodes.at(i).translation());
   }
 
   CHECK(!imu_data_.empty());
@@ -226,48 +242,80 @@ ImuBasedPoseExtrapolator::ExtrapolatePosesWithGravity(
                             new ceres::QuaternionParameterization());
   problem.SetParameterBlockConstant(imu_calibration.data());
 
-  auto imu_it = imu_data_.begin();
+  std::deque<sensor::ImuData>::const_iterator imu_it = imu_data_.cbegin();
   CHECK(imu_data_.size() == 1 ||
         std::next(imu_it)->time > timed_pose_queue_.front().time);
 
   transform::Rigid3d last_node_odometry;
   common::Time last_node_odometry_time;
 
+  // Only the last node is not in 'timed_pose_queue_'.
+  const size_t extrapolated_node_index = nodes.size() - 1;
   for (size_t i = 1; i < nodes.size(); i++) {
     const common::Time first_time = node_times[i - 1];
     const common::Time second_time = node_times[i];
 
-    auto imu_it2 = imu_it;
-    const IntegrateImuResult<double> result =
-        IntegrateImu(imu_data_, first_time, second_time, &imu_it);
-    if ((i + 1) < nodes.size()) {
-      const common::Time third_time = node_times[i + 1];
-      const common::Duration first_duration = second_time - first_time;
-      const common::Duration second_duration = third_time - second_time;
-      const common::Time first_center = first_time + first_duration / 2;
-      const common::Time second_center = second_time + second_duration / 2;
-      const IntegrateImuResult<double> result_to_first_center =
-          IntegrateImu(imu_data_, first_time, first_center, &imu_it2);
-      const IntegrateImuResult<double> result_center_to_center =
-          IntegrateImu(imu_data_, first_center, second_center, &imu_it2);
-      // 'delta_velocity' is the change in velocity from the point in time
-      // halfway between the first and second poses to halfway between
-      // second and third pose. It is computed from IMU data and still
-      // contains a delta due to gravity. The orientation of this vector is
-      // in the IMU frame at the second pose.
-      const Eigen::Vector3d delta_velocity =
-          (result.delta_rotation.inverse() *
-           result_to_first_center.delta_rotation) *
-          result_center_to_center.delta_velocity;
+    // IMU data before the newest pose is complete, so cost functions between
+    // nodes of 'timed_pose_queue_' do not change until the pose is removed.
+    PoseQueueCostFunctions* const cached =
+        i < extrapolated_node_index ? &pose_queue_cost_functions_[i] : nullptr;
+    const bool has_acceleration = (i + 1) < nodes.size();
+    const bool cache_acceleration = (i + 1) < extrapolated_node_index;
+    ceres::CostFunction* rotation_cost_function =
+        cached != nullptr ? cached->imu_rotation.get() : nullptr;
+    ceres::CostFunction* acceleration_cost_function =
+        cache_acceleration ? cached->imu_acceleration.get() : nullptr;
+    if (rotation_cost_function != nullptr &&
+        (!has_acceleration || acceleration_cost_function != nullptr)) {
+      AdvanceImuIterator(second_time, &imu_it);
+    } else {
+      const ImuPreintegrationBetweenNodes preintegration =
+          PreintegrateImuBetweenNodes(imu_data_, first_time, second_time,
+                                      &imu_it);
+      if (rotation_cost_function == nullptr) {
+        rotation_cost_function =
+            RotationCostFunction3D::CreateAutoDiffCostFunction(
+                options_.imu_rotation_weight(),
+                preintegration.delta_rotation());
+        if (cached != nullptr) {
+          cached->imu_rotation.reset(rotation_cost_function);
+        } else {
+          take_ownership(rotation_cost_function);
+        }
+      }
+      if (has_acceleration && acceleration_cost_function == nullptr) {
+        const common::Time third_time = node_times[i + 1];
+        const common::Duration first_duration = second_time - first_time;
+        const common::Duration second_duration = third_time - second_time;
+        auto next_imu_it = imu_it;
+        // 'delta_velocity' is the change in velocity from the point in time
+        // halfway between the first and second poses to halfway between
+        // second and third pose. It is computed from IMU data and still
+        // contains a delta due to gravity. The orientation of this vector is
+        // in the IMU frame at the second pose.
+        const Eigen::Vector3d delta_velocity =
+            ComputeDeltaVelocityBetweenCenters(
+                preintegration,
+                PreintegrateImuBetweenNodes(imu_data_, second_time, third_time,
+                                            &next_imu_it));
+        acceleration_cost_function =
+            AccelerationCostFunction3D::CreateAutoDiffCostFunction(
+                options_.imu_acceleration_weight(), delta_velocity,
+                common::ToSeconds(first_duration),
+                common::ToSeconds(second_duration));
+        if (cache_acceleration) {
+          cached->imu_acceleration.reset(acceleration_cost_function);
+        } else {
+          take_ownership(acceleration_cost_function);
+        }
+      }
+    }
+    if (has_acceleration) {
       problem.AddResidualBlock(
-          AccelerationCostFunction3D::CreateAutoDiffCostFunction(
-              options_.imu_acceleration_weight(), delta_velocity,
-              common::ToSeconds(first_duration),
-              common::ToSeconds(second_duration)),
-          nullptr /* loss function */, nodes.at(i).rotation(),
-          nodes.at(i - 1).translation(), nodes.at(i).translation(),
-          nodes.at(i + 1).translation(), &gravity_constant,
-          imu_calibration.data());
+          acceleration_cost_function, nullptr /* loss function */,
+          nodes.at(i).rotation(), nodes.at(i - 1).translation(),
+          nodes.at(i).translation(), nodes.at(i + 1).translation(),
+          &gravity_constant, imu_calibration.data());
       // TODO(danielsievers): Fix gravity in CostFunction.
       if (fix_gravity) {
         problem.SetParameterBlockConstant(&gravity_constant);
@@ -276,11 +324,10 @@ ImuBasedPoseExtrapolator::ExtrapolatePosesWithGravity(
         problem.SetParameterLowerBound(&gravity_constant, 0, 0.0);
       }
     }
-    problem.AddResidualBlock(
-        RotationCostFunction3D::CreateAutoDiffCostFunction(
-            options_.imu_rotation_weight(), result.delta_rotation),
-        nullptr /* loss function */, nodes.at(i - 1).rotation(),
-        nodes.at(i).rotation(), imu_calibration.data());
+    problem.AddResidualBlock(rotation_cost_function,
+                             nullptr /* loss function */,
+                             nodes.at(i - 1).rotation(),
+                             nodes.at(i).rotation(), imu_calibration.data());
 
     // Add a relative pose constraint based on the odometry (if available).
     if (HasOdometryDataForTime(first_time) &&
@@ -299,10 +346,11 @@ ImuBasedPoseExtrapolator::ExtrapolatePosesWithGravity(
                                         current_node_odometry);
 
       problem.AddResidualBlock(
-          optimization::SpaCostFunction3D::CreateAutoDiffCostFunction(
-              PoseGraphInterface::Constraint::Pose{
-                  relative_odometry, options_.odometry_translation_weight(),
-                  options_.odometry_rotation_weight()}),
+          take_ownership(
+              optimization::SpaCostFunction3D::CreateAutoDiffCostFunction(
+                  PoseGraphInterface::Constraint::Pose{
+                      relative_odometry, options_.odometry_translation_weight(),
+                      options_.odometry_rotation_weight()})),
           nullptr /* loss function */, nodes.at(i - 1).rotation(),
           nodes.at(i - 1).translation(), nodes.at(i).rotation(),
           nodes.at(i).translation());
@@ -386,6 +434,17 @@ Eigen::Quaterniond ImuBasedPoseExtrapolator::EstimateGravityOrientation(
       .gravity_from_tracking;
 }
 
+void ImuBasedPoseExtrapolator::AdvanceImuIterator(
+    const common::Time time,
+    std::deque<sensor::ImuData>::const_iterator* const imu_it) const {
+  // Leaves the iterator where 'IntegrateImu()' would after integrating up to
+  // 'time'.
+  while (std::next(*imu_it) != imu_data_.end() &&
+         std::next(*imu_it)->time <= time) {
+    ++*imu_it;
+  }
+}
+
 template <typename T>
 void ImuBasedPoseExtrapolator::TrimDequeData(std::deque<T>* data) {
   while (data->size() > 1 && !timed_pose_queue_.empty() &&
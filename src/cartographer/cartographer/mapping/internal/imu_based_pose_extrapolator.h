@@ -26,11 +26,18 @@
 #include "cartographer/mapping/pose_extrapolator_interface.h"
 #include "cartographer/sensor/imu_data.h"
 #include "cartographer/transform/timestamped_transform.h"
+#include "ceres/ceres.h"
 
 namespace cartographer {
 namespace mapping {
 
 // Uses the linear acceleration and rotational velocities to estimate a pose.
+//
+// Each extrapolation solves a new problem over the poses within
+// 'pose_queue_duration'. Only the cost functions between these poses are
+// kept across calls. Poses leaving the window are dropped, not marginalized
+// into a prior, so this is a sliding window estimator and not a fixed-lag
+// smoother.
 class ImuBasedPoseExtrapolator : public PoseExtrapolatorInterface {
  public:
   explicit ImuBasedPoseExtrapolator(
@@ -60,6 +67,26 @@ class ImuBasedPoseExtrapolator : public PoseExtrapolatorInterface {
   Eigen::Quaterniond EstimateGravityOrientation(common::Time time) override;
 
  private:
+  friend class ImuBasedPoseExtrapolatorTest;
+
+  // Cost functions which only depend on the poses in 'timed_pose_queue_' and
+  // the IMU data between them. They are created once and reused by every
+  // extrapolation until their pose leaves the queue, so that the IMU data is
+  // not integrated again for each extrapolation.
+  struct PoseQueueCostFunctions {
+    // Ties the node to the pose it was added with.
+    std::unique_ptr<ceres::CostFunction> pose;
+    // IMU rotation from the previous pose. Created on first use.
+    std::unique_ptr<ceres::CostFunction> imu_rotation;
+    // IMU acceleration between the previous and the next pose. Created on
+    // first use once the next pose was added.
+    std::unique_ptr<ceres::CostFunction> imu_acceleration;
+  };
+
+  void AdvanceImuIterator(
+      common::Time time,
+      std::deque<sensor::ImuData>::const_iterator* imu_it) const;
+
   template <typename T>
   void TrimDequeData(std::deque<T>* data);
 
@@ -83,6 +110,8 @@ class ImuBasedPoseExtrapolator : public PoseExtrapolatorInterface {
   std::deque<::cartographer::transform::TimestampedTransform> timed_pose_queue_;
   std::deque<::cartographer::transform::TimestampedTransform>
       previous_solution_;
+  // Same size as 'timed_pose_queue_'.
+  std::deque<PoseQueueCostFunctions> pose_queue_cost_functions_;
 
   std::deque<sensor::ImuData> imu_data_;
   std::deque<sensor::OdometryData> odometry_data_;
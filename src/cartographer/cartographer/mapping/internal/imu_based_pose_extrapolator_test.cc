@@ -0,0 +1,138 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping/internal/imu_based_pose_extrapolator.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "cartographer/transform/rigid_transform_test_helpers.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace mapping {
+namespace {
+
+constexpr double kGravity = 9.806;
+constexpr double kImuPeriod = 0.005;
+constexpr int kNumImuDataPerPose = 20;
+constexpr double kPrecision = 1e-9;
+
+common::Time ToTime(const int imu_index) {
+  return common::FromUniversal(0) + common::FromSeconds(imu_index * kImuPeriod);
+}
+
+}  // namespace
+
+class ImuBasedPoseExtrapolatorTest : public ::testing::Test {
+ protected:
+  ImuBasedPoseExtrapolatorTest() {
+    options_.set_pose_queue_duration(0.5);
+    options_.set_gravity_constant(kGravity);
+    options_.set_pose_translation_weight(1.);
+    options_.set_pose_rotation_weight(1.);
+    options_.set_imu_acceleration_weight(1.);
+    options_.set_imu_rotation_weight(1.);
+    options_.set_odometry_translation_weight(1.);
+    options_.set_odometry_rotation_weight(1.);
+    options_.mutable_solver_options()->set_use_nonmonotonic_steps(false);
+    options_.mutable_solver_options()->set_max_num_iterations(10);
+    options_.mutable_solver_options()->set_num_threads(1);
+  }
+
+  // Drops the IMU cost functions cached between extrapolations, so that the
+  // next extrapolation builds its whole problem from the IMU data.
+  static void DropCachedImuCostFunctions(
+      ImuBasedPoseExtrapolator* const extrapolator) {
+    for (auto& cost_functions : extrapolator->pose_queue_cost_functions_) {
+      cost_functions.imu_rotation.reset();
+      cost_functions.imu_acceleration.reset();
+    }
+  }
+
+  // Turns around the z-axis while accelerating sideways.
+  static transform::Rigid3d GroundTruth(const int imu_index) {
+    const double t = imu_index * kImuPeriod;
+    return transform::Rigid3d(
+        Eigen::Vector3d(t + 0.1 * std::sin(t), 0.2 * t * t, 0.),
+        Eigen::Quaterniond(
+            Eigen::AngleAxisd(0.5 * t, Eigen::Vector3d::UnitZ())));
+  }
+
+  static sensor::ImuData CreateImuData(const int imu_index) {
+    const double t = imu_index * kImuPeriod;
+    const Eigen::Vector3d acceleration(-0.1 * std::sin(t), 0.4, kGravity);
+    return sensor::ImuData{ToTime(imu_index),
+                           GroundTruth(imu_index).rotation().inverse() *
+                               acceleration,
+                           Eigen::Vector3d(0., 0., 0.5)};
+  }
+
+  proto::ImuBasedPoseExtrapolatorOptions options_;
+};
+
+namespace {
+
+TEST_F(ImuBasedPoseExtrapolatorTest, CachedCostFunctionsGiveSameSolution) {
+  constexpr int kNumInitialPoses = 3;
+  std::vector<sensor::ImuData> initial_imu_data;
+  for (int j = 0; j <= kNumInitialPoses * kNumImuDataPerPose; ++j) {
+    initial_imu_data.push_back(CreateImuData(j));
+  }
+  std::vector<transform::TimestampedTransform> initial_poses;
+  for (int i = 1; i <= kNumInitialPoses; ++i) {
+    initial_poses.push_back(transform::TimestampedTransform{
+        ToTime(i * kNumImuDataPerPose), GroundTruth(i * kNumImuDataPerPose)});
+  }
+  const std::unique_ptr<PoseExtrapolatorInterface> cached =
+      ImuBasedPoseExtrapolator::InitializeWithImu(options_, initial_imu_data,
+                                                  initial_poses);
+  const std::unique_ptr<PoseExtrapolatorInterface> rebuilt =
+      ImuBasedPoseExtrapolator::InitializeWithImu(options_, initial_imu_data,
+                                                  initial_poses);
+
+  int imu_index = initial_imu_data.size();
+  // More poses than fit into the window, so that cached cost functions are
+  // also dropped when their pose leaves it.
+  for (int i = kNumInitialPoses; i < 20; ++i) {
+    const int pose_index = i * kNumImuDataPerPose;
+    if (i > kNumInitialPoses) {
+      cached->AddPose(ToTime(pose_index), GroundTruth(pose_index));
+      rebuilt->AddPose(ToTime(pose_index), GroundTruth(pose_index));
+    }
+    for (; imu_index < pose_index + kNumImuDataPerPose; ++imu_index) {
+      cached->AddImuData(CreateImuData(imu_index));
+      rebuilt->AddImuData(CreateImuData(imu_index));
+    }
+    // Extrapolates twice per pose, so that the second extrapolation reuses
+    // the cost functions of the first one.
+    for (const int extrapolation_index :
+         {pose_index + kNumImuDataPerPose / 4,
+          pose_index + kNumImuDataPerPose / 2}) {
+      DropCachedImuCostFunctions(
+          static_cast<ImuBasedPoseExtrapolator*>(rebuilt.get()));
+      const transform::Rigid3d expected =
+          rebuilt->ExtrapolatePose(ToTime(extrapolation_index));
+      EXPECT_THAT(cached->ExtrapolatePose(ToTime(extrapolation_index)),
+                  transform::IsNearly(expected, kPrecision));
+    }
+  }
+}
+
+}  // namespace
+}  // namespace mapping
+}  // namespace cartographer
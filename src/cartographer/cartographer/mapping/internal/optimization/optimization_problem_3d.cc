@@ -30,7 +30,7 @@
 #include "cartographer/common/internal/ceres_solver_options.h"
 #include "cartographer/common/math.h"
 #include "cartographer/common/time.h"
-#include "cartographer/mapping/internal/3d/imu_integration.h"
+#include "cartographer/mapping/internal/3d/imu_preintegration.h"
 #include "cartographer/mapping/internal/3d/rotation_parameterization.h"
 #include "cartographer/mapping/internal/optimization/ceres_pose.h"
 #include "cartographer/mapping/internal/optimization/cost_functions/acceleration_cost_function_3d.h"
@@ -225,6 +225,12 @@ void OptimizationProblem3D::InsertTrajectoryNode(const NodeId& node_id,
 }
 
 void OptimizationProblem3D::TrimTrajectoryNode(const NodeId& node_id) {
+  for (const NodeId& first_node_id :
+       {NodeId{node_id.trajectory_id, node_id.node_index - 1}, node_id}) {
+    if (imu_preintegration_.Contains(first_node_id)) {
+      imu_preintegration_.Trim(first_node_id);
+    }
+  }
   imu_data_.Trim(node_data_, node_id);
   odometry_data_.Trim(node_data_, node_id);
   fixed_frame_pose_data_.Trim(node_data_, node_id);
@@ -373,8 +379,34 @@ void OptimizationProblem3D::Solve(
       CHECK(imu_data.begin() != imu_data.end());
 
       auto imu_it = imu_data.begin();
+      // Returns the preintegrated IMU data between the node at 'node_it' and
+      // the next node. IMU data arrives in order, so the result is final and
+      // cached once there is IMU data after the next node.
+      const auto preintegrate_imu =
+          [&](const MapById<NodeId, NodeSpec3D>::ConstIterator& node_it) {
+            const auto cached = imu_preintegration_.find(node_it->id);
+            if (cached != imu_preintegration_.end()) {
+              return cached->data;
+            }
+            // Skip IMU data before the node.
+            while (std::next(imu_it) != imu_data.end() &&
+                   std::next(imu_it)->time <= node_it->data.time) {
+              ++imu_it;
+            }
+            auto end_imu_it = imu_it;
+            const ImuPreintegrationBetweenNodes result =
+                PreintegrateImuBetweenNodes(imu_data, node_it->data.time,
+                                            std::next(node_it)->data.time,
+                                            &end_imu_it);
+            if (std::next(end_imu_it) != imu_data.end()) {
+              imu_preintegration_.Insert(node_it->id, result);
+            }
+            return result;
+          };
+
       auto prev_node_it = node_it;
       for (++node_it; node_it != trajectory_end; ++node_it) {
+        const auto first_node_it = prev_node_it;
         const NodeId first_node_id = prev_node_it->id;
         const NodeSpec3D& first_node_data = prev_node_it->data;
         prev_node_it = node_it;
@@ -385,15 +417,8 @@ void OptimizationProblem3D::Solve(
           continue;
         }
 
-        // Skip IMU data before the node.
-        while (std::next(imu_it) != imu_data.end() &&
-               std::next(imu_it)->time <= first_node_data.time) {
-          ++imu_it;
-        }
-
-        auto imu_it2 = imu_it;
-        const IntegrateImuResult<double> result = IntegrateImu(
-            imu_data, first_node_data.time, second_node_data.time, &imu_it);
+        const ImuPreintegrationBetweenNodes preintegration =
+            preintegrate_imu(first_node_it);
         const auto next_node_it = std::next(node_it);
         const common::Time first_time = first_node_data.time;
         const common::Time second_time = second_node_data.time;
@@ -404,21 +429,14 @@ void OptimizationProblem3D::Solve(
           const NodeSpec3D& third_node_data = next_node_it->data;
           const common::Time third_time = third_node_data.time;
           const common::Duration second_duration = third_time - second_time;
-          const common::Time first_center = first_time + first_duration / 2;
-          const common::Time second_center = second_time + second_duration / 2;
-          const IntegrateImuResult<double> result_to_first_center =
-              IntegrateImu(imu_data, first_time, first_center, &imu_it2);
-          const IntegrateImuResult<double> result_center_to_center =
-              IntegrateImu(imu_data, first_center, second_center, &imu_it2);
           // 'delta_velocity' is the change in velocity from the point in time
           // halfway between the first and second poses to halfway between
           // second and third pose. It is computed from IMU data and still
           // contains a delta due to gravity. The orientation of this vector is
           // in the IMU frame at the second pose.
           const Eigen::Vector3d delta_velocity =
-              (result.delta_rotation.inverse() *
-               result_to_first_center.delta_rotation) *
-              result_center_to_center.delta_velocity;
+              ComputeDeltaVelocityBetweenCenters(preintegration,
+                                                 preintegrate_imu(node_it));
           problem.AddResidualBlock(
               AccelerationCostFunction3D::CreateAutoDiffCostFunction(
                   options_.acceleration_weight() /
@@ -436,7 +454,7 @@ void OptimizationProblem3D::Solve(
         problem.AddResidualBlock(
             RotationCostFunction3D::CreateAutoDiffCostFunction(
                 options_.rotation_weight() / common::ToSeconds(first_duration),
-                result.delta_rotation),
+                preintegration.delta_rotation()),
             nullptr /* loss function */, C_nodes.at(first_node_id).rotation(),
             C_nodes.at(second_node_id).rotation(),
             trajectory_data.imu_calibration.data());
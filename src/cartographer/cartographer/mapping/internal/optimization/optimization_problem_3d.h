@@ -28,6 +28,7 @@
 #include "cartographer/common/port.h"
 #include "cartographer/common/time.h"
 #include "cartographer/mapping/id.h"
+#include "cartographer/mapping/internal/3d/imu_preintegration.h"
 #include "cartographer/mapping/internal/optimization/optimization_problem_interface.h"
 #include "cartographer/mapping/pose_graph_interface.h"
 #include "cartographer/mapping/proto/pose_graph/optimization_problem_options.pb.h"
@@ -124,6 +125,9 @@ class OptimizationProblem3D
 
   optimization::proto::OptimizationProblemOptions options_;
   MapById<NodeId, NodeSpec3D> node_data_;
+  // Preintegrated IMU data between each node and the next one, by the id of
+  // the first node.
+  MapById<NodeId, ImuPreintegrationBetweenNodes> imu_preintegration_;
   MapById<SubmapId, SubmapSpec3D> submap_data_;
   std::map<std::string, transform::Rigid3d> landmark_data_;
   sensor::MapByTime<sensor::ImuData> imu_data_;
@@ -16,7 +16,9 @@
 
 #include "cartographer/mapping/internal/range_data_collator.h"
 
+#include <algorithm>
 #include <memory>
+#include <utility>
 
 #include "absl/memory/memory.h"
 #include "cartographer/mapping/internal/local_slam_result_data.h"
@@ -27,6 +29,38 @@ namespace mapping {
 
 constexpr float RangeDataCollator::kDefaultIntensityValue;
 
+namespace {
+
+// Keeps only a few buffers, enough for the results in use at a time.
+constexpr size_t kMaxFreeRanges = 2;
+
+std::map<std::string, size_t> IndexSensorIds(
+    const std::vector<std::string>& sensor_ids) {
+  std::map<std::string, size_t> sensor_id_to_index;
+  for (const std::string& sensor_id : sensor_ids) {
+    sensor_id_to_index.emplace(sensor_id, 0);
+  }
+  size_t index = 0;
+  for (auto& entry : sensor_id_to_index) {
+    entry.second = index++;
+  }
+  return sensor_id_to_index;
+}
+
+}  // namespace
+
+RangeDataCollator::RangeDataCollator(
+    const std::vector<std::string>& expected_range_sensor_ids)
+    : sensor_id_to_index_(IndexSensorIds(expected_range_sensor_ids)),
+      pending_data_(sensor_id_to_index_.size()) {}
+
+void RangeDataCollator::RecycleRanges(
+    std::vector<sensor::TimedPointCloudOriginData::RangeMeasurement> ranges) {
+  if (free_ranges_.size() < kMaxFreeRanges && ranges.capacity() > 0) {
+    free_ranges_.push_back(std::move(ranges));
+  }
+}
+
 /**
  * @brief 多个雷达数据的时间同步
  * 
@@ -37,7 +71,10 @@ constexpr float RangeDataCollator::kDefaultIntensityValue;
 sensor::TimedPointCloudOriginData RangeDataCollator::AddRangeData(
     const std::string& sensor_id,
     sensor::TimedPointCloudData timed_point_cloud_data) { // 第一次拷贝
-  CHECK_NE(expected_sensor_ids_.count(sensor_id), 0);
+  const auto sensor_index = sensor_id_to_index_.find(sensor_id);
+  CHECK(sensor_index != sensor_id_to_index_.end());
+  absl::optional<PendingData>& pending_data =
+      pending_data_[sensor_index->second];
 
   // 从sensor_bridge传过来的数据的intensities为空
   timed_point_cloud_data.intensities.resize(
@@ -45,25 +82,29 @@ sensor::TimedPointCloudOriginData RangeDataCollator::AddRangeData(
 
   // TODO(gaschler): These two cases can probably be one.
   // 如果同话题的点云, 还有没处理的, 就先处同步没处理的点云, 将当前点云保存
-  if (id_to_pending_data_.count(sensor_id) != 0) {
+  if (pending_data.has_value()) {
     // current_end_为上一次时间同步的结束时间
     // current_start_为本次时间同步的开始时间
     current_start_ = current_end_;
     // When we have two messages of the same sensor, move forward the older of
     // the two (do not send out current).
     // 本次时间同步的结束时间为这帧点云数据的结束时间
-    current_end_ = id_to_pending_data_.at(sensor_id).time;
+    current_end_ = pending_data->data.time;
     auto result = CropAndMerge();
     // 保存当前点云
-    id_to_pending_data_.emplace(sensor_id, std::move(timed_point_cloud_data));
+    if (!pending_data.has_value()) {
+      pending_data = PendingData{std::move(timed_point_cloud_data)};
+      ++num_pending_data_;
+    }
     return result;
   }
 
   // 先将当前点云添加到 等待时间同步的map中
-  id_to_pending_data_.emplace(sensor_id, std::move(timed_point_cloud_data));
+  pending_data = PendingData{std::move(timed_point_cloud_data)};
+  ++num_pending_data_;
 
   // 等到range数据的话题都到来之后再进行处理
-  if (expected_sensor_ids_.size() != id_to_pending_data_.size()) {
+  if (num_pending_data_ != pending_data_.size()) {
     return {};
   }
 
@@ -71,8 +112,8 @@ sensor::TimedPointCloudOriginData RangeDataCollator::AddRangeData(
   // We have messages from all sensors, move forward to oldest.
   common::Time oldest_timestamp = common::Time::max();
   // 找到所有传感器数据中最早的时间戳(点云最后一个点的时间)
-  for (const auto& pair : id_to_pending_data_) {
-    oldest_timestamp = std::min(oldest_timestamp, pair.second.time);
+  for (const auto& pending : pending_data_) {
+    oldest_timestamp = std::min(oldest_timestamp, pending->data.time);
   }
   // current_end_是本次时间同步的结束时间
   // 是待时间同步map中的 所有点云中最早的时间戳
@@ -82,96 +123,119 @@ sensor::TimedPointCloudOriginData RangeDataCollator::AddRangeData(
 
 // 对时间段内的数据进行截取与合并, 返回时间同步后的点云
 sensor::TimedPointCloudOriginData RangeDataCollator::CropAndMerge() {
+  // The points of one sensor to merge, with their times relative to
+  // 'current_end_' once 'time_correction' is added.
+  struct Overlap {
+    const sensor::TimedPointCloudData* data;
+    size_t begin;
+    size_t end;
+    size_t origin_index;
+    float time_correction;
+  };
+  std::vector<Overlap> overlaps;
+  overlaps.reserve(pending_data_.size());
+
   sensor::TimedPointCloudOriginData result{current_end_, {}, {}};
   bool warned_for_dropped_points = false;
+  size_t num_overlapping_points = 0;
   // 遍历所有的传感器话题
-  for (auto it = id_to_pending_data_.begin();
-       it != id_to_pending_data_.end();) {
-    // 获取数据的引用
-    sensor::TimedPointCloudData& data = it->second;
-    const sensor::TimedPointCloud& ranges = it->second.ranges;
-    const std::vector<float>& intensities = it->second.intensities;
+  for (auto& pending : pending_data_) {
+    if (!pending.has_value()) continue;
+    const sensor::TimedPointCloudData& data = pending->data;
+    const sensor::TimedPointCloud& ranges = data.ranges;
 
     // 找到点云中 最后一个时间戳小于current_start_的点的索引
-    auto overlap_begin = ranges.begin();
-    while (overlap_begin < ranges.end() &&
-           data.time + common::FromSeconds((*overlap_begin).time) <
+    size_t overlap_begin = pending->begin;
+    while (overlap_begin < ranges.size() &&
+           data.time + common::FromSeconds(ranges[overlap_begin].time) <
                current_start_) {
       ++overlap_begin;
     }
 
     // 找到点云中 最后一个时间戳小于等于current_end_的点的索引
-    auto overlap_end = overlap_begin;
-    while (overlap_end < ranges.end() &&
-           data.time + common::FromSeconds((*overlap_end).time) <=
+    size_t overlap_end = overlap_begin;
+    while (overlap_end < ranges.size() &&
+           data.time + common::FromSeconds(ranges[overlap_end].time) <=
                current_end_) {
       ++overlap_end;
     }
 
     // 丢弃点云中时间比起始时间早的点, 每执行一下CropAndMerge()打印一次log
-    if (ranges.begin() < overlap_begin && !warned_for_dropped_points) {
-      LOG(WARNING) << "Dropped " << std::distance(ranges.begin(), overlap_begin)
+    if (pending->begin < overlap_begin && !warned_for_dropped_points) {
+      LOG(WARNING) << "Dropped " << overlap_begin - pending->begin
                    << " earlier points.";
       warned_for_dropped_points = true;
     }
 
-    // Copy overlapping range.
     if (overlap_begin < overlap_end) {
-      // 获取下个点云的index, 即当前vector的个数
-      std::size_t origin_index = result.origins.size();
-      result.origins.push_back(data.origin);  // 插入原点坐标
-
-      // 获取此传感器时间与集合时间戳的误差, 
+      // 获取此传感器时间与集合时间戳的误差,
       const float time_correction =
           static_cast<float>(common::ToSeconds(data.time - current_end_));
+      overlaps.push_back(Overlap{&data, overlap_begin, overlap_end,
+                                 result.origins.size(), time_correction});
+      result.origins.push_back(data.origin);  // 插入原点坐标
+      num_overlapping_points += overlap_end - overlap_begin;
+    }
+    // Points before 'overlap_end' are passed on or dropped. The message is
+    // kept until the merged points are copied below.
+    pending->begin = overlap_end;
+  }
+
+  if (!free_ranges_.empty()) {
+    result.ranges = std::move(free_ranges_.back());
+    free_ranges_.pop_back();
+    result.ranges.clear();
+  }
+  result.ranges.reserve(num_overlapping_points);
+
+  // Each sensor's points are in time order, so a k-way merge by corrected
+  // time yields the same order as sorting all of them. The number of sensors
+  // is small, so the next point is found by looking at each of them.
+  bool sorted = true;
+  while (true) {
+    Overlap* next = nullptr;
+    float next_time = 0.f;
+    for (Overlap& overlap : overlaps) {
+      if (overlap.begin == overlap.end) continue;
+      const float time = overlap.data->ranges[overlap.begin].time +
+                         overlap.time_correction;
+      if (next == nullptr || time < next_time) {
+        next = &overlap;
+        next_time = time;
+      }
+    }
+    if (next == nullptr) break;
+    // current_end_ + point_time[3]_after == in_timestamp +
+    // point_time[3]_before
+    // 针对每个点时间戳进行修正, 让最后一个点的时间为0
+    sensor::TimedPointCloudOriginData::RangeMeasurement point{
+        next->data->ranges[next->begin], next->data->intensities[next->begin],
+        next->origin_index};
+    point.point_time.time += next->time_correction;
+    if (!result.ranges.empty() &&
+        point.point_time.time < result.ranges.back().point_time.time) {
+      sorted = false;
+    }
+    result.ranges.push_back(point);
+    ++next->begin;
+  }
+  // Only needed if a sensor's points were not in time order.
+  if (!sorted) {
+    std::sort(result.ranges.begin(), result.ranges.end(),
+              [](const sensor::TimedPointCloudOriginData::RangeMeasurement& a,
+                 const sensor::TimedPointCloudOriginData::RangeMeasurement& b) {
+                return a.point_time.time < b.point_time.time;
+              });
+  }
 
-      auto intensities_overlap_it =
-          intensities.begin() + (overlap_begin - ranges.begin());
-      // reserve() 在预留空间改变时, 会将之前的数据拷贝到新的内存中
-      result.ranges.reserve(result.ranges.size() +
-                            std::distance(overlap_begin, overlap_end));
-      
-      // 填充数据
-      for (auto overlap_it = overlap_begin; overlap_it != overlap_end;
-           ++overlap_it, ++intensities_overlap_it) {
-        sensor::TimedPointCloudOriginData::RangeMeasurement point{
-            *overlap_it, *intensities_overlap_it, origin_index};
-        // current_end_ + point_time[3]_after == in_timestamp +
-        // point_time[3]_before
-        // 针对每个点时间戳进行修正, 让最后一个点的时间为0
-        point.point_time.time += time_correction;  
-        result.ranges.push_back(point);
-      } // end for
-    } // end if
-
-    // Drop buffered points until overlap_end.
-    // 如果点云每个点都用了, 则可将这个数据进行删除
-    if (overlap_end == ranges.end()) {
-      it = id_to_pending_data_.erase(it);
-    } 
-    // 如果一个点都没用, 就先放这, 看下一个数据
-    else if (overlap_end == ranges.begin()) {
-      ++it;
-    } 
-    // 用了一部分的点
-    else {
-      const auto intensities_overlap_end =
-          intensities.begin() + (overlap_end - ranges.begin());
-      // 将用了的点删除, 这里的赋值是拷贝
-      data = sensor::TimedPointCloudData{
-          data.time, data.origin,
-          sensor::TimedPointCloud(overlap_end, ranges.end()),
-          std::vector<float>(intensities_overlap_end, intensities.end())};
-      ++it;
+  // Drop buffered points until overlap_end.
+  // 如果点云每个点都用了, 则可将这个数据进行删除
+  for (auto& pending : pending_data_) {
+    if (pending.has_value() && pending->begin == pending->data.ranges.size()) {
+      pending.reset();
+      --num_pending_data_;
     }
-  } // end for
-
-  // 对各传感器的点云 按照每个点的时间从小到大进行排序
-  std::sort(result.ranges.begin(), result.ranges.end(),
-            [](const sensor::TimedPointCloudOriginData::RangeMeasurement& a,
-               const sensor::TimedPointCloudOriginData::RangeMeasurement& b) {
-              return a.point_time.time < b.point_time.time;
-            });
+  }
   return result;
 }
 
@@ -17,9 +17,13 @@
 #ifndef CARTOGRAPHER_MAPPING_INTERNAL_RANGE_DATA_COLLATOR_H_
 #define CARTOGRAPHER_MAPPING_INTERNAL_RANGE_DATA_COLLATOR_H_
 
+#include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/types/optional.h"
 #include "cartographer/sensor/timed_point_cloud_data.h"
 
 namespace cartographer {
@@ -33,9 +37,7 @@ namespace mapping {
 class RangeDataCollator {
  public:
   explicit RangeDataCollator(
-      const std::vector<std::string>& expected_range_sensor_ids)
-      : expected_sensor_ids_(expected_range_sensor_ids.begin(),
-                             expected_range_sensor_ids.end()) {}
+      const std::vector<std::string>& expected_range_sensor_ids);
 
   // If timed_point_cloud_data has incomplete intensity data, we will fill the
   // missing intensities with kDefaultIntensityValue.
@@ -43,14 +45,31 @@ class RangeDataCollator {
       const std::string& sensor_id,
       sensor::TimedPointCloudData timed_point_cloud_data);
 
+  // Hands the 'ranges' of an earlier result back once they are no longer
+  // needed, so that later results reuse the buffer instead of allocating.
+  void RecycleRanges(
+      std::vector<sensor::TimedPointCloudOriginData::RangeMeasurement> ranges);
+
  private:
+  // A buffered message of which the points before 'begin' have already been
+  // passed on. Points are never copied out of 'data' until they are merged.
+  struct PendingData {
+    sensor::TimedPointCloudData data;
+    size_t begin = 0;
+  };
+
   sensor::TimedPointCloudOriginData CropAndMerge();
 
-  const std::set<std::string> expected_sensor_ids_;
+  // Expected sensor IDs, in order, and their index into 'pending_data_'.
+  const std::map<std::string, size_t> sensor_id_to_index_;
   // Store at most one message for each sensor.
-  std::map<std::string, sensor::TimedPointCloudData> id_to_pending_data_; // 待处理的数据
+  std::vector<absl::optional<PendingData>> pending_data_;  // 待处理的数据
+  size_t num_pending_data_ = 0;
   common::Time current_start_ = common::Time::min();
   common::Time current_end_ = common::Time::min();
+  // Buffers handed back by 'RecycleRanges()'.
+  std::vector<std::vector<sensor::TimedPointCloudOriginData::RangeMeasurement>>
+      free_ranges_;
 
   constexpr static float kDefaultIntensityValue = 0.f;
 };
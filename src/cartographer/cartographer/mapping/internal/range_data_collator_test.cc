@@ -156,6 +156,24 @@ TEST(RangeDataCollatorTest, TwoSensors) {
   EXPECT_TRUE(ArePointTimestampsSorted(output_3));
 }
 
+TEST(RangeDataCollatorTest, ReusesRecycledRanges) {
+  const std::string sensor_0 = "sensor_0";
+  const std::string sensor_1 = "sensor_1";
+  RangeDataCollator collator({sensor_0, sensor_1});
+  collator.AddRangeData(sensor_0, CreateFakeRangeData(200, 300, false));
+  auto output_0 =
+      collator.AddRangeData(sensor_1, CreateFakeRangeData(-1000, 310, false));
+  ASSERT_EQ(output_0.ranges.size(), 2 * kNumSamples - 1);
+  const auto* const buffer = output_0.ranges.data();
+  collator.RecycleRanges(std::move(output_0.ranges));
+  auto output_1 =
+      collator.AddRangeData(sensor_0, CreateFakeRangeData(300, 500, false));
+  ASSERT_EQ(output_1.ranges.size(), 2);
+  EXPECT_EQ(output_1.ranges.data(), buffer);
+  EXPECT_EQ(output_1.ranges.back().point_time.time, 0.f);
+  EXPECT_TRUE(ArePointTimestampsSorted(output_1));
+}
+
 TEST(RangeDataCollatorTest, ThreeSensors) {
   const std::string sensor_0 = "sensor_0";
   const std::string sensor_1 = "sensor_1";
@@ -16,8 +16,18 @@ CreateRealTimeCorrelativeScanMatcherOptions(
       parameter_dictionary->GetDouble("translation_delta_cost_weight"));
   options.set_rotation_delta_cost_weight(
       parameter_dictionary->GetDouble("rotation_delta_cost_weight"));
+  // The following options are only used in 3D.
+  options.set_num_refined_low_resolution_candidates(
+      parameter_dictionary->HasKey("num_refined_low_resolution_candidates")
+          ? parameter_dictionary->GetNonNegativeInt(
+                "num_refined_low_resolution_candidates")
+          : 0);
+  options.set_num_threads(parameter_dictionary->HasKey("num_threads")
+                              ? parameter_dictionary->GetInt("num_threads")
+                              : 1);
   CHECK_GE(options.translation_delta_cost_weight(), 0.);
   CHECK_GE(options.rotation_delta_cost_weight(), 0.);
+  CHECK_GT(options.num_threads(), 0);
   return options;
 }
 
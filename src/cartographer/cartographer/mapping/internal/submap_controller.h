@@ -17,6 +17,7 @@
 #ifndef CARTOGRAPHER_MAPPING_INTERNAL_SUBMAP_CONTROLLER_H
 #define CARTOGRAPHER_MAPPING_INTERNAL_SUBMAP_CONTROLLER_H
 
+#include "absl/synchronization/mutex.h"
 #include "cartographer/mapping/2d/submap_2d.h"
 #include "cartographer/mapping/3d/submap_3d.h"
 #include "cartographer/mapping/id.h"
@@ -26,11 +27,14 @@ namespace cartographer {
 namespace mapping {
 
 // 从proto::Submap格式生成mapping::Submap2D 格式的地图
+// Thread-safe, the submaps of different trajectories may be updated
+// concurrently.
 template <class SubmapType>
 class SubmapController {
  public:
-  std::shared_ptr<SubmapType> UpdateSubmap(
-      const mapping::proto::Submap& proto) {
+  std::shared_ptr<SubmapType> UpdateSubmap(const mapping::proto::Submap& proto)
+      LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock locker(&mutex_);
     mapping::SubmapId submap_id{proto.submap_id().trajectory_id(),
                                 proto.submap_id().submap_index()};
     std::shared_ptr<SubmapType> submap_ptr;
@@ -61,8 +65,9 @@ class SubmapController {
  private:
   std::shared_ptr<SubmapType> CreateSubmap(const mapping::proto::Submap& proto);
 
+  absl::Mutex mutex_;
   mapping::MapById<mapping::SubmapId, std::shared_ptr<SubmapType>>
-      unfinished_submaps_;
+      unfinished_submaps_ GUARDED_BY(mutex_);
 
   ValueConversionTables conversion_tables_;
 };
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping/internal/submap_spatial_index.h"
+
+#include <cmath>
+
+#include "cartographer/common/math.h"
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace mapping {
+
+SubmapSpatialIndex::SubmapSpatialIndex(const double cell_size)
+    : cell_size_(cell_size) {
+  CHECK_GT(cell_size_, 0.);
+}
+
+void SubmapSpatialIndex::Insert(const SubmapId& submap_id,
+                                const Eigen::Vector3d& position) {
+  const CellIndex cell_index = GetCellIndex(position);
+  CHECK(submap_cells_.emplace(submap_id, cell_index).second) << submap_id;
+  cells_[cell_index].emplace_back(submap_id, position);
+}
+
+void SubmapSpatialIndex::Remove(const SubmapId& submap_id) {
+  const auto it = submap_cells_.find(submap_id);
+  if (it == submap_cells_.end()) return;
+  const auto cell = cells_.find(it->second);
+  CHECK(cell != cells_.end());
+  auto& entries = cell->second;
+  for (auto entry = entries.begin(); entry != entries.end(); ++entry) {
+    if (entry->first == submap_id) {
+      entries.erase(entry);
+      break;
+    }
+  }
+  if (entries.empty()) cells_.erase(cell);
+  submap_cells_.erase(it);
+}
+
+void SubmapSpatialIndex::Clear() {
+  cells_.clear();
+  submap_cells_.clear();
+}
+
+bool SubmapSpatialIndex::Contains(const SubmapId& submap_id) const {
+  return submap_cells_.count(submap_id) != 0;
+}
+
+std::vector<SubmapId> SubmapSpatialIndex::FindWithinRadius(
+    const Eigen::Vector3d& position, const double radius) const {
+  std::vector<SubmapId> result;
+  const CellIndex min_cell =
+      GetCellIndex(position - Eigen::Vector3d::Constant(radius));
+  const CellIndex max_cell =
+      GetCellIndex(position + Eigen::Vector3d::Constant(radius));
+  const double squared_radius = common::Pow2(radius);
+  for (int64 x = std::get<0>(min_cell); x <= std::get<0>(max_cell); ++x) {
+    for (int64 y = std::get<1>(min_cell); y <= std::get<1>(max_cell); ++y) {
+      for (int64 z = std::get<2>(min_cell); z <= std::get<2>(max_cell); ++z) {
+        const auto cell = cells_.find(CellIndex{x, y, z});
+        if (cell == cells_.end()) continue;
+        for (const auto& entry : cell->second) {
+          if ((entry.second - position).squaredNorm() <= squared_radius) {
+            result.push_back(entry.first);
+          }
+        }
+      }
+    }
+  }
+  return result;
+}
+
+SubmapSpatialIndex::CellIndex SubmapSpatialIndex::GetCellIndex(
+    const Eigen::Vector3d& position) const {
+  return CellIndex{static_cast<int64>(std::floor(position.x() / cell_size_)),
+                   static_cast<int64>(std::floor(position.y() / cell_size_)),
+                   static_cast<int64>(std::floor(position.z() / cell_size_))};
+}
+
+}  // namespace mapping
+}  // namespace cartographer
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_MAPPING_INTERNAL_SUBMAP_SPATIAL_INDEX_H_
+#define CARTOGRAPHER_MAPPING_INTERNAL_SUBMAP_SPATIAL_INDEX_H_
+
+#include <map>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "Eigen/Core"
+#include "absl/container/flat_hash_map.h"
+#include "cartographer/common/port.h"
+#include "cartographer/mapping/id.h"
+
+namespace cartographer {
+namespace mapping {
+
+// Hashes submap positions into a grid of cubic cells, so that the submaps
+// near a position can be found without looking at every submap. For 2D, the
+// z coordinate is simply zero.
+class SubmapSpatialIndex {
+ public:
+  // Queries are fastest if 'cell_size' is about the query radius.
+  explicit SubmapSpatialIndex(double cell_size);
+
+  SubmapSpatialIndex(const SubmapSpatialIndex&) = delete;
+  SubmapSpatialIndex& operator=(const SubmapSpatialIndex&) = delete;
+
+  // Adds a submap which is not yet in the index.
+  void Insert(const SubmapId& submap_id, const Eigen::Vector3d& position);
+  // Removes a submap. Does nothing if it is not in the index.
+  void Remove(const SubmapId& submap_id);
+  void Clear();
+
+  bool Contains(const SubmapId& submap_id) const;
+  size_t size() const { return submap_cells_.size(); }
+
+  // Returns the submaps at most 'radius' away from 'position', in no
+  // particular order.
+  std::vector<SubmapId> FindWithinRadius(const Eigen::Vector3d& position,
+                                         double radius) const;
+
+ private:
+  using CellIndex = std::tuple<int64, int64, int64>;
+
+  CellIndex GetCellIndex(const Eigen::Vector3d& position) const;
+
+  const double cell_size_;
+  absl::flat_hash_map<CellIndex,
+                      std::vector<std::pair<SubmapId, Eigen::Vector3d>>>
+      cells_;
+  std::map<SubmapId, CellIndex> submap_cells_;
+};
+
+}  // namespace mapping
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_MAPPING_INTERNAL_SUBMAP_SPATIAL_INDEX_H_
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping/internal/submap_spatial_index.h"
+
+#include <algorithm>
+#include <random>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace mapping {
+namespace {
+
+using ::testing::IsEmpty;
+using ::testing::UnorderedElementsAre;
+
+TEST(SubmapSpatialIndexTest, FindsSubmapsWithinRadius) {
+  SubmapSpatialIndex index(10.);
+  index.Insert(SubmapId{0, 0}, Eigen::Vector3d(0., 0., 0.));
+  index.Insert(SubmapId{0, 1}, Eigen::Vector3d(9.9, 0., 0.));
+  index.Insert(SubmapId{0, 2}, Eigen::Vector3d(-15., 0., 0.));
+  index.Insert(SubmapId{1, 0}, Eigen::Vector3d(0., 0., 10.));
+  EXPECT_EQ(index.size(), 4);
+  EXPECT_THAT(index.FindWithinRadius(Eigen::Vector3d(-1., 0., 0.), 11.),
+              UnorderedElementsAre(SubmapId{0, 0}, SubmapId{0, 1},
+                                   SubmapId{1, 0}));
+  EXPECT_THAT(index.FindWithinRadius(Eigen::Vector3d(0., 0., 5.), 5.),
+              UnorderedElementsAre(SubmapId{0, 0}, SubmapId{1, 0}));
+  EXPECT_THAT(index.FindWithinRadius(Eigen::Vector3d(100., 0., 0.), 10.),
+              IsEmpty());
+
+  index.Remove(SubmapId{0, 0});
+  index.Remove(SubmapId{5, 5});
+  EXPECT_FALSE(index.Contains(SubmapId{0, 0}));
+  EXPECT_TRUE(index.Contains(SubmapId{0, 1}));
+  EXPECT_THAT(index.FindWithinRadius(Eigen::Vector3d(0., 0., 5.), 5.),
+              UnorderedElementsAre(SubmapId{1, 0}));
+  index.Clear();
+  EXPECT_EQ(index.size(), 0);
+}
+
+TEST(SubmapSpatialIndexTest, MatchesLinearSearch) {
+  std::mt19937 prng(42);
+  std::uniform_real_distribution<double> distribution(-200., 200.);
+  SubmapSpatialIndex index(15.);
+  std::vector<std::pair<SubmapId, Eigen::Vector3d>> submaps;
+  for (int i = 0; i < 1000; ++i) {
+    submaps.emplace_back(
+        SubmapId{i % 3, i},
+        Eigen::Vector3d(distribution(prng), distribution(prng), 0.));
+    index.Insert(submaps.back().first, submaps.back().second);
+  }
+  for (int i = 0; i < 100; ++i) {
+    const Eigen::Vector3d position(distribution(prng), distribution(prng),
+                                   0.);
+    std::vector<SubmapId> expected;
+    for (const auto& submap : submaps) {
+      if ((submap.second - position).norm() <= 15.) {
+        expected.push_back(submap.first);
+      }
+    }
+    std::vector<SubmapId> actual = index.FindWithinRadius(position, 15.);
+    std::sort(expected.begin(), expected.end());
+    std::sort(actual.begin(), actual.end());
+    EXPECT_EQ(expected, actual);
+  }
+}
+
+}  // namespace
+}  // namespace mapping
+}  // namespace cartographer
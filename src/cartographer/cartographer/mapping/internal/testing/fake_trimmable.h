@@ -63,6 +63,11 @@ class FakeTrimmable : public Trimmable {
     return submap_data_;
   }
 
+  std::shared_ptr<const Submap> GetFullSubmap(
+      const SubmapId& submap_id) const override {
+    return submap_data_.at(submap_id).submap;
+  }
+
   void set_trajectory_nodes(
       const MapById<NodeId, TrajectoryNode>& trajectory_nodes) {
     trajectory_nodes_ = trajectory_nodes;
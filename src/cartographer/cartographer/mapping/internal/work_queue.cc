@@ -0,0 +1,58 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping/internal/work_queue.h"
+
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace mapping {
+
+WorkQueue::WorkQueue(const size_t capacity, const double shed_ratio)
+    : capacity_(capacity) {
+  CHECK_GE(shed_ratio, 0.);
+  if (capacity_ > 0 && shed_ratio > 0.) {
+    shed_sampler_ = absl::make_unique<common::FixedRatioSampler>(shed_ratio);
+  }
+}
+
+void WorkQueue::Push(WorkItem work_item) {
+  CHECK(work_item.task != nullptr);
+  items_.push_back(std::move(work_item));
+}
+
+std::function<WorkItem::Result()> WorkQueue::Pop(bool* const shed) {
+  CHECK(!items_.empty());
+  const bool over_capacity =
+      shed_sampler_ != nullptr && items_.size() > capacity_;
+  WorkItem work_item = std::move(items_.front());
+  items_.pop_front();
+  *shed = over_capacity && work_item.shed_task != nullptr &&
+          shed_sampler_->Pulse();
+  return std::move(*shed ? work_item.shed_task : work_item.task);
+}
+
+std::chrono::steady_clock::duration WorkQueue::GetOldestAge(
+    const std::chrono::steady_clock::time_point now) const {
+  if (items_.empty()) return std::chrono::steady_clock::duration::zero();
+  return now - items_.front().time;
+}
+
+}  // namespace mapping
+}  // namespace cartographer
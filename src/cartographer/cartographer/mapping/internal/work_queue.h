@@ -20,6 +20,9 @@
 #include <chrono>
 #include <deque>
 #include <functional>
+#include <memory>
+
+#include "cartographer/common/fixed_ratio_sampler.h"
 
 namespace cartographer {
 namespace mapping {
@@ -34,10 +37,49 @@ struct WorkItem {
 
   // task为 一个函数的名字, 这个函数返回值类型为Result, 参数列表为(), 为空
   std::function<Result()> task;
+
+  // If set, 'task' does work of low priority, e.g. searching for loop
+  // closures, which may be shed when the queue falls behind. This cheaper
+  // task then runs instead and must still do everything later work items
+  // depend on.
+  std::function<Result()> shed_task;
 };
 
-// 双端队列
-using WorkQueue = std::deque<WorkItem>;
+// A FIFO queue of work items. Work items cannot be reordered since they
+// depend on the effects of earlier ones, e.g. nodes are added to the
+// optimization problem in order. Instead, while the queue holds more than
+// 'capacity' items, work items are handed out with their low priority part
+// shed, so that the queue drains faster. 'Push' never refuses an item, so
+// 'capacity' is not a hard bound on the queue size.
+class WorkQueue {
+ public:
+  // A 'capacity' of 0 means the queue is never over capacity. Of the work
+  // items with a 'shed_task' handed out while over capacity, the fraction
+  // 'shed_ratio' is shed.
+  WorkQueue(size_t capacity, double shed_ratio);
+
+  WorkQueue(const WorkQueue&) = delete;
+  WorkQueue& operator=(const WorkQueue&) = delete;
+
+  bool empty() const { return items_.empty(); }
+  size_t size() const { return items_.size(); }
+
+  void Push(WorkItem work_item);
+
+  // Removes the oldest work item and returns the task to run for it. Sets
+  // 'shed' to whether its low priority part was shed.
+  std::function<WorkItem::Result()> Pop(bool* shed);
+
+  // Age of the oldest work item, zero if the queue is empty.
+  std::chrono::steady_clock::duration GetOldestAge(
+      std::chrono::steady_clock::time_point now) const;
+
+ private:
+  const size_t capacity_;
+  // Null if nothing is ever shed.
+  std::unique_ptr<common::FixedRatioSampler> shed_sampler_;
+  std::deque<WorkItem> items_;
+};
 
 }  // namespace mapping
 }  // namespace cartographer
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/mapping/internal/work_queue.h"
+
+#include <string>
+#include <utility>
+
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace mapping {
+namespace {
+
+WorkItem CreateWorkItem(const std::chrono::steady_clock::time_point time,
+                        std::string* const log, const char name,
+                        const bool sheddable) {
+  WorkItem work_item;
+  work_item.time = time;
+  work_item.task = [log, name]() {
+    log->push_back(name);
+    return WorkItem::Result::kDoNotRunOptimization;
+  };
+  if (sheddable) {
+    work_item.shed_task = [log]() {
+      log->push_back('-');
+      return WorkItem::Result::kDoNotRunOptimization;
+    };
+  }
+  return work_item;
+}
+
+// Returns the log of the tasks run and the number of work items shed.
+std::pair<std::string, int> Drain(WorkQueue* const work_queue,
+                                  std::string* const log) {
+  int num_shed = 0;
+  while (!work_queue->empty()) {
+    bool shed;
+    work_queue->Pop(&shed)();
+    num_shed += shed;
+  }
+  return {*log, num_shed};
+}
+
+TEST(WorkQueueTest, RunsAllTasksInOrderWithinCapacity) {
+  const auto now = std::chrono::steady_clock::now();
+  WorkQueue work_queue(0 /* capacity */, 1. /* shed_ratio */);
+  std::string log;
+  for (const char name : std::string("abcde")) {
+    work_queue.Push(CreateWorkItem(now, &log, name, true /* sheddable */));
+  }
+  EXPECT_EQ(Drain(&work_queue, &log), std::make_pair(std::string("abcde"), 0));
+}
+
+TEST(WorkQueueTest, ShedsOnlySheddableTasksOverCapacity) {
+  const auto now = std::chrono::steady_clock::now();
+  WorkQueue work_queue(2 /* capacity */, 1. /* shed_ratio */);
+  std::string log;
+  work_queue.Push(CreateWorkItem(now, &log, 'a', true /* sheddable */));
+  work_queue.Push(CreateWorkItem(now, &log, 'b', false /* sheddable */));
+  work_queue.Push(CreateWorkItem(now, &log, 'c', true /* sheddable */));
+  work_queue.Push(CreateWorkItem(now, &log, 'd', true /* sheddable */));
+  work_queue.Push(CreateWorkItem(now, &log, 'e', true /* sheddable */));
+  // 'a' and 'c' are handed out with more than 2 work items queued.
+  EXPECT_EQ(Drain(&work_queue, &log), std::make_pair(std::string("-b-de"), 2));
+}
+
+TEST(WorkQueueTest, ShedsConfiguredRatio) {
+  const auto now = std::chrono::steady_clock::now();
+  WorkQueue work_queue(1 /* capacity */, 0.5 /* shed_ratio */);
+  std::string log;
+  for (const char name : std::string("abcde")) {
+    work_queue.Push(CreateWorkItem(now, &log, name, true /* sheddable */));
+  }
+  EXPECT_EQ(Drain(&work_queue, &log), std::make_pair(std::string("-b-de"), 2));
+}
+
+TEST(WorkQueueTest, ReportsAgeOfOldestItem) {
+  const auto now = std::chrono::steady_clock::now();
+  WorkQueue work_queue(0 /* capacity */, 0. /* shed_ratio */);
+  EXPECT_EQ(work_queue.GetOldestAge(now).count(), 0);
+  std::string log;
+  work_queue.Push(CreateWorkItem(now - std::chrono::seconds(3), &log, 'a',
+                                 false /* sheddable */));
+  work_queue.Push(CreateWorkItem(now - std::chrono::seconds(1), &log, 'b',
+                                 false /* sheddable */));
+  EXPECT_EQ(work_queue.GetOldestAge(now), std::chrono::seconds(3));
+  bool shed;
+  work_queue.Pop(&shed);
+  EXPECT_FALSE(shed);
+  EXPECT_EQ(work_queue.GetOldestAge(now), std::chrono::seconds(1));
+}
+
+}  // namespace
+}  // namespace mapping
+}  // namespace cartographer
@@ -27,6 +27,7 @@
 #include "cartographer/mapping/internal/2d/pose_graph_2d.h"
 #include "cartographer/mapping/internal/3d/local_trajectory_builder_3d.h"
 #include "cartographer/mapping/internal/3d/pose_graph_3d.h"
+#include "cartographer/mapping/internal/asynchronous_trajectory_builder.h"
 #include "cartographer/mapping/internal/collated_trajectory_builder.h"
 #include "cartographer/mapping/internal/global_trajectory_builder.h"
 #include "cartographer/mapping/internal/motion_filter.h"
@@ -181,10 +182,13 @@ int MapBuilder::AddTrajectoryBuilder(
         trajectory_options, sensor_collator_.get(), trajectory_id,
         expected_sensor_ids,
         // 将3D前端与3D位姿图打包在一起, 传入CollatedTrajectoryBuilder
-        CreateGlobalTrajectoryBuilder3D(
-            std::move(local_trajectory_builder), trajectory_id,
-            static_cast<PoseGraph3D*>(pose_graph_.get()),
-            local_slam_result_callback, pose_graph_odometry_motion_filter)));
+        MaybeMakeAsynchronous(
+            trajectory_id,
+            CreateGlobalTrajectoryBuilder3D(
+                std::move(local_trajectory_builder), trajectory_id,
+                static_cast<PoseGraph3D*>(pose_graph_.get()),
+                local_slam_result_callback,
+                pose_graph_odometry_motion_filter))));
   } 
   // 2d的轨迹
   else {
@@ -203,10 +207,13 @@ int MapBuilder::AddTrajectoryBuilder(
         trajectory_options, sensor_collator_.get(), trajectory_id,
         expected_sensor_ids,
         // 将2D前端与2D位姿图打包在一起, 传入CollatedTrajectoryBuilder
-        CreateGlobalTrajectoryBuilder2D(
-            std::move(local_trajectory_builder), trajectory_id,
-            static_cast<PoseGraph2D*>(pose_graph_.get()),
-            local_slam_result_callback, pose_graph_odometry_motion_filter)));
+        MaybeMakeAsynchronous(
+            trajectory_id,
+            CreateGlobalTrajectoryBuilder2D(
+                std::move(local_trajectory_builder), trajectory_id,
+                static_cast<PoseGraph2D*>(pose_graph_.get()),
+                local_slam_result_callback,
+                pose_graph_odometry_motion_filter))));
   }
 
   // 是否是纯定位模式, 如果是则只保存最近3个submap
@@ -255,9 +262,39 @@ int MapBuilder::AddTrajectoryForDeserialization(
 // 结束指定id的轨迹, 分别进行 传感器数据处理的结束 与 位姿图的结束
 void MapBuilder::FinishTrajectory(const int trajectory_id) {
   sensor_collator_->FinishTrajectory(trajectory_id);
+  // The remaining data has to reach the pose graph before the trajectory is
+  // marked as finished.
+  const auto it = asynchronous_trajectory_builders_.find(trajectory_id);
+  if (it != asynchronous_trajectory_builders_.end()) {
+    it->second->WaitUntilIdle();
+  }
   pose_graph_->FinishTrajectory(trajectory_id);
 }
 
+std::vector<std::unique_ptr<absl::MutexLock>>
+MapBuilder::LockAsynchronousTrajectoryBuilders() {
+  std::vector<std::unique_ptr<absl::MutexLock>> lockers;
+  for (const auto& entry : asynchronous_trajectory_builders_) {
+    lockers.push_back(
+        absl::make_unique<absl::MutexLock>(entry.second->processing_mutex()));
+  }
+  return lockers;
+}
+
+std::unique_ptr<TrajectoryBuilderInterface> MapBuilder::MaybeMakeAsynchronous(
+    const int trajectory_id,
+    std::unique_ptr<TrajectoryBuilderInterface> trajectory_builder) {
+  if (options_.local_slam_queue_size() == 0) {
+    return trajectory_builder;
+  }
+  auto asynchronous_trajectory_builder =
+      absl::make_unique<AsynchronousTrajectoryBuilder>(
+          options_.local_slam_queue_size(), std::move(trajectory_builder));
+  asynchronous_trajectory_builders_[trajectory_id] =
+      asynchronous_trajectory_builder.get();
+  return asynchronous_trajectory_builder;
+}
+
 // 返回压缩后的地图数据
 std::string MapBuilder::SubmapToProto(
     const SubmapId& submap_id, proto::SubmapQuery::Response* const response) {
@@ -270,6 +307,13 @@ std::string MapBuilder::SubmapToProto(
   }
 
   // 获取地图数据
+  std::unique_ptr<absl::MutexLock> locker;
+  const auto it = asynchronous_trajectory_builders_.find(
+      submap_id.trajectory_id);
+  if (it != asynchronous_trajectory_builders_.end()) {
+    locker =
+        absl::make_unique<absl::MutexLock>(it->second->processing_mutex());
+  }
   const auto submap_data = pose_graph_->GetSubmapData(submap_id);
   if (submap_data.submap == nullptr) {
     return "Requested submap " + std::to_string(submap_id.submap_index) +
@@ -285,6 +329,7 @@ std::string MapBuilder::SubmapToProto(
 // 调用 io::WritePbStream 保存所有数据, 没有使用
 void MapBuilder::SerializeState(bool include_unfinished_submaps,
                                 io::ProtoStreamWriterInterface* const writer) {
+  const auto lockers = LockAsynchronousTrajectoryBuilders();
   io::WritePbStream(*pose_graph_, all_trajectory_builder_options_, writer,
                     include_unfinished_submaps);
 }
@@ -292,6 +337,7 @@ void MapBuilder::SerializeState(bool include_unfinished_submaps,
 // 将数据进行压缩,并保存到文件中
 bool MapBuilder::SerializeStateToFile(bool include_unfinished_submaps,
                                       const std::string& filename) {
+  const auto lockers = LockAsynchronousTrajectoryBuilders();
   io::ProtoStreamWriter writer(filename);
   io::WritePbStream(*pose_graph_, all_trajectory_builder_options_, &writer,
                     include_unfinished_submaps);
@@ -17,8 +17,11 @@
 #ifndef CARTOGRAPHER_MAPPING_MAP_BUILDER_H_
 #define CARTOGRAPHER_MAPPING_MAP_BUILDER_H_
 
+#include <map>
 #include <memory>
+#include <vector>
 
+#include "absl/synchronization/mutex.h"
 #include "cartographer/common/thread_pool.h"
 #include "cartographer/mapping/map_builder_interface.h"
 #include "cartographer/mapping/pose_graph.h"
@@ -28,6 +31,8 @@
 namespace cartographer {
 namespace mapping {
 
+class AsynchronousTrajectoryBuilder;
+
 // Wires up the complete SLAM stack with TrajectoryBuilders (for local submaps)
 // and a PoseGraph for loop closure.
 // 包含前端(TrajectoryBuilders,scan to submap) 与 后端(用于查找回环的PoseGraph) 的完整的SLAM
@@ -85,6 +90,17 @@ class MapBuilder : public MapBuilderInterface {
   }
 
  private:
+  // Wraps 'trajectory_builder' so that it runs on its own thread if
+  // 'local_slam_queue_size' is positive.
+  std::unique_ptr<TrajectoryBuilderInterface> MaybeMakeAsynchronous(
+      int trajectory_id,
+      std::unique_ptr<TrajectoryBuilderInterface> trajectory_builder);
+
+  // Keeps local SLAM of all asynchronous trajectory builders from modifying
+  // submaps while the returned lockers exist.
+  std::vector<std::unique_ptr<absl::MutexLock>>
+  LockAsynchronousTrajectoryBuilders();
+
   const proto::MapBuilderOptions options_;
   common::ThreadPool thread_pool_; // 线程池
 
@@ -95,6 +111,10 @@ class MapBuilder : public MapBuilderInterface {
       trajectory_builders_;
   std::vector<proto::TrajectoryBuilderOptionsWithSensorIds>
       all_trajectory_builder_options_;
+  // Trajectory builders which run local SLAM on their own thread, owned by
+  // 'trajectory_builders_'.
+  std::map<int, AsynchronousTrajectoryBuilder *>
+      asynchronous_trajectory_builders_;
 };
 
 // 工厂函数
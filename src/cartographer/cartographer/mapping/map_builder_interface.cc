@@ -38,6 +38,8 @@ proto::MapBuilderOptions CreateMapBuilderOptions(
       parameter_dictionary->GetNonNegativeInt("num_background_threads"));
   options.set_collate_by_trajectory(
       parameter_dictionary->GetBool("collate_by_trajectory"));
+  options.set_local_slam_queue_size(
+      parameter_dictionary->GetNonNegativeInt("local_slam_queue_size"));
   *options.mutable_pose_graph_options() = CreatePoseGraphOptions(
       parameter_dictionary->GetDictionary("pose_graph").get());
   CHECK_NE(options.use_trajectory_builder_2d(),
@@ -85,6 +85,35 @@ void PopulateOverlappingSubmapsTrimmerOptions2D(
       options_dictionary->GetInt("min_added_submaps_count"));
 }
 
+void PopulateMemoryBudgetOptions(
+    proto::PoseGraphOptions* const pose_graph_options,
+    common::LuaParameterDictionary* const parameter_dictionary) {
+  constexpr char kDictionaryKey[] = "memory_budget";
+  if (!parameter_dictionary->HasKey(kDictionaryKey)) return;
+
+  auto options_dictionary = parameter_dictionary->GetDictionary(kDictionaryKey);
+  auto* options = pose_graph_options->mutable_memory_budget();
+  options->set_memory_budget_in_mb(
+      options_dictionary->GetDouble("memory_budget_in_mb"));
+  options->set_directory(options_dictionary->GetString("directory"));
+  CHECK_GT(options->memory_budget_in_mb(), 0.);
+  CHECK(!options->directory().empty());
+}
+
+void PopulateWorkQueueOptions(
+    proto::PoseGraphOptions* const pose_graph_options,
+    common::LuaParameterDictionary* const parameter_dictionary) {
+  constexpr char kDictionaryKey[] = "work_queue";
+  if (!parameter_dictionary->HasKey(kDictionaryKey)) return;
+
+  auto options_dictionary = parameter_dictionary->GetDictionary(kDictionaryKey);
+  auto* options = pose_graph_options->mutable_work_queue();
+  options->set_capacity(options_dictionary->GetNonNegativeInt("capacity"));
+  options->set_shed_ratio(options_dictionary->GetDouble("shed_ratio"));
+  CHECK_GE(options->shed_ratio(), 0.);
+  CHECK_LE(options->shed_ratio(), 1.);
+}
+
 proto::PoseGraphOptions CreatePoseGraphOptions(
     common::LuaParameterDictionary* const parameter_dictionary) {
   proto::PoseGraphOptions options;
@@ -111,6 +140,8 @@ proto::PoseGraphOptions CreatePoseGraphOptions(
       parameter_dictionary->GetDouble(
           "global_constraint_search_after_n_seconds"));
   PopulateOverlappingSubmapsTrimmerOptions2D(&options, parameter_dictionary);
+  PopulateMemoryBudgetOptions(&options, parameter_dictionary);
+  PopulateWorkQueueOptions(&options, parameter_dictionary);
   return options;
 }
 
@@ -132,6 +163,22 @@ proto::PoseGraph::Constraint ToProto(const PoseGraph::Constraint& constraint) {
   return constraint_proto;
 }
 
+void PoseGraph::ForEachSubmapData(
+    const std::function<void(const SubmapId&, const SubmapData&)>& visitor)
+    const {
+  for (const auto& submap_id_data : GetAllSubmapData()) {
+    visitor(submap_id_data.id, submap_id_data.data);
+  }
+}
+
+void PoseGraph::ForEachTrajectoryNode(
+    const std::function<void(const NodeId&, const TrajectoryNode&)>& visitor)
+    const {
+  for (const auto& node_id_data : GetTrajectoryNodes()) {
+    visitor(node_id_data.id, node_id_data.data);
+  }
+}
+
 proto::PoseGraph PoseGraph::ToProto(bool include_unfinished_submaps) const {
   proto::PoseGraph proto;
 
@@ -17,6 +17,7 @@
 #ifndef CARTOGRAPHER_MAPPING_POSE_GRAPH_H_
 #define CARTOGRAPHER_MAPPING_POSE_GRAPH_H_
 
+#include <functional>
 #include <memory>
 #include <set>
 #include <utility>
@@ -115,6 +116,19 @@ class PoseGraph : public PoseGraphInterface {
 
   proto::PoseGraph ToProto(bool include_unfinished_submaps) const override;
 
+  // Calls 'visitor' with the full data of every submap. Unlike
+  // 'GetAllSubmapData', evicted submaps are included with their grids. They
+  // are loaded one at a time, so that at most one of them is in memory.
+  virtual void ForEachSubmapData(
+      const std::function<void(const SubmapId&, const SubmapData&)>& visitor)
+      const;
+
+  // Calls 'visitor' with the full data of every trajectory node. Evicted point
+  // clouds are loaded one node at a time.
+  virtual void ForEachTrajectoryNode(
+      const std::function<void(const NodeId&, const TrajectoryNode&)>& visitor)
+      const;
+
   // Returns the IMU data.
   virtual sensor::MapByTime<sensor::ImuData> GetImuData() const = 0;
 
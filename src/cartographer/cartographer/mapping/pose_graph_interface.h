@@ -102,7 +102,9 @@ class PoseGraphInterface {
   // Waits for all computations to finish and computes optimized poses.
   virtual void RunFinalOptimization() = 0;
 
-  // Returns data for all submaps.
+  // Returns data for all submaps. Submaps evicted to meet the 'memory_budget'
+  // of the pose graph are returned without their grids, see
+  // 'PoseGraph::ForEachSubmapData'.
   virtual MapById<SubmapId, SubmapData> GetAllSubmapData() const = 0;
 
   // Returns the current optimized transform and submap itself for the given
@@ -119,7 +121,9 @@ class PoseGraphInterface {
   virtual transform::Rigid3d GetLocalToGlobalTransform(
       int trajectory_id) const = 0;
 
-  // Returns the current optimized trajectories.
+  // Returns the current optimized trajectories. Nodes evicted to meet the
+  // 'memory_budget' of the pose graph are returned without their point clouds,
+  // see 'PoseGraph::ForEachTrajectoryNode'.
   virtual MapById<NodeId, TrajectoryNode> GetTrajectoryNodes() const = 0;
 
   // Returns the current optimized trajectory poses.
@@ -36,6 +36,11 @@ class Trimmable {
   virtual MapById<SubmapId, PoseGraphInterface::SubmapData>
   GetOptimizedSubmapData() const = 0;
   virtual const MapById<NodeId, TrajectoryNode>& GetTrajectoryNodes() const = 0;
+  // Returns the submap including data the pose graph evicted to meet its
+  // memory budget, e.g. its grid. The loaded data is not kept in the pose
+  // graph, so callers should keep what they need instead of the submap.
+  virtual std::shared_ptr<const Submap> GetFullSubmap(
+      const SubmapId& submap_id) const = 0;
   virtual const std::vector<PoseGraphInterface::Constraint>& GetConstraints()
       const = 0;
 
@@ -27,6 +27,7 @@
 #include "cartographer/common/time.h"
 #include "cartographer/mapping/proto/trajectory_builder_options.pb.h"
 #include "cartographer/mapping/submaps.h"
+#include "cartographer/sensor/data.h"
 #include "cartographer/sensor/fixed_frame_pose_data.h"
 #include "cartographer/sensor/imu_data.h"
 #include "cartographer/sensor/landmark_data.h"
@@ -123,6 +124,12 @@ class TrajectoryBuilderInterface {
       const sensor::FixedFramePoseData& fixed_frame_pose) = 0;
   virtual void AddSensorData(const std::string& sensor_id,
                              const sensor::LandmarkData& landmark_data) = 0;
+  // Like 'AddSensorData()', but takes ownership of already dispatchable
+  // 'data'. Implementations which queue the data keep 'data' instead of
+  // copying it, e.g. the points of a 'sensor::TimedPointCloudData'.
+  virtual void AddDispatchableData(std::unique_ptr<sensor::Data> data) {
+    data->AddToTrajectoryBuilder(this);
+  }
   // Allows to directly add local SLAM results to the 'PoseGraph'. c++11 that it
   // is invalid to add local SLAM results for a trajectory that has a
   // 'LocalTrajectoryBuilder2D/3D'.
@@ -23,6 +23,7 @@
 #include "cartographer/mapping/internal/constraints/constraint_builder_2d.h"
 #include "cartographer/mapping/internal/constraints/constraint_builder_3d.h"
 #include "cartographer/mapping/internal/global_trajectory_builder.h"
+#include "cartographer/metrics/stage_timer.h"
 #include "cartographer/sensor/internal/trajectory_collator.h"
 
 namespace cartographer {
@@ -36,6 +37,7 @@ void RegisterAllMetrics(FamilyFactory* registry) {
   mapping::LocalTrajectoryBuilder3D::RegisterMetrics(registry);
   mapping::PoseGraph2D::RegisterMetrics(registry);
   mapping::PoseGraph3D::RegisterMetrics(registry);
+  RegisterStageMetrics(registry);
   sensor::TrajectoryCollator::RegisterMetrics(registry);
 }
 
@@ -0,0 +1,223 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/metrics/stage_timer.h"
+
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace metrics {
+
+namespace {
+
+constexpr int kNumStages = static_cast<int>(Stage::kNumStages);
+
+std::array<Histogram*, kNumStages>& StageLatencyMetrics() {
+  static std::array<Histogram*, kNumStages> metrics = []() {
+    std::array<Histogram*, kNumStages> result;
+    result.fill(Histogram::Null());
+    return result;
+  }();
+  return metrics;
+}
+
+struct TraceEvent {
+  Stage stage;
+  int thread_id;
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::duration duration;
+};
+
+// Collects trace events of all threads. The flag is checked without locking,
+// so that timed stages only take the mutex while tracing.
+class TraceRecorder {
+ public:
+  void Start(const int max_num_events) LOCKS_EXCLUDED(mutex_) {
+    CHECK_GT(max_num_events, 0);
+    absl::MutexLock locker(&mutex_);
+    events_.clear();
+    max_num_events_ = max_num_events;
+    num_dropped_events_ = 0;
+    tracing_.store(true, std::memory_order_relaxed);
+  }
+
+  void Stop() LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock locker(&mutex_);
+    tracing_.store(false, std::memory_order_relaxed);
+  }
+
+  bool tracing() const { return tracing_.load(std::memory_order_relaxed); }
+
+  void Add(const TraceEvent& event) LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock locker(&mutex_);
+    if (!tracing_.load(std::memory_order_relaxed)) {
+      return;
+    }
+    if (static_cast<int>(events_.size()) >= max_num_events_) {
+      ++num_dropped_events_;
+      return;
+    }
+    events_.push_back(event);
+  }
+
+  std::string ToChromeTraceJson() LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock locker(&mutex_);
+    if (num_dropped_events_ > 0) {
+      LOG(WARNING) << "Dropped " << num_dropped_events_
+                   << " trace events after reaching the limit of "
+                   << max_num_events_ << ".";
+    }
+    std::ostringstream json;
+    json.precision(3);
+    json << std::fixed << "{\"traceEvents\":[";
+    for (size_t i = 0; i < events_.size(); ++i) {
+      const TraceEvent& event = events_[i];
+      json << (i == 0 ? "" : ",") << "\n{\"name\":\""
+           << GetStageName(event.stage)
+           << "\",\"cat\":\"cartographer\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+           << event.thread_id << ",\"ts\":"
+           << ToMicroseconds(event.start.time_since_epoch())
+           << ",\"dur\":" << ToMicroseconds(event.duration) << "}";
+    }
+    json << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return json.str();
+  }
+
+ private:
+  static double ToMicroseconds(const std::chrono::steady_clock::duration d) {
+    return std::chrono::duration<double, std::micro>(d).count();
+  }
+
+  std::atomic<bool> tracing_{false};
+  absl::Mutex mutex_;
+  std::vector<TraceEvent> events_ GUARDED_BY(mutex_);
+  int max_num_events_ GUARDED_BY(mutex_) = 0;
+  int num_dropped_events_ GUARDED_BY(mutex_) = 0;
+};
+
+TraceRecorder& GetTraceRecorder() {
+  static TraceRecorder* const trace_recorder = new TraceRecorder;
+  return *trace_recorder;
+}
+
+// Innermost 'ScopedStageTimer' running on this thread.
+thread_local ScopedStageTimer* current_timer = nullptr;
+
+// Small, stable thread ids make traces easier to read than hashed
+// 'std::thread::id's.
+int GetTraceThreadId() {
+  static std::atomic<int> next_thread_id{0};
+  thread_local const int thread_id = next_thread_id.fetch_add(1);
+  return thread_id;
+}
+
+}  // namespace
+
+const char* GetStageName(const Stage stage) {
+  switch (stage) {
+    case Stage::kCollator:
+      return "collator";
+    case Stage::kVoxelFilter:
+      return "voxel_filter";
+    case Stage::kRealTimeCorrelativeScanMatcher:
+      return "real_time_correlative_scan_matcher";
+    case Stage::kCeresScanMatcher:
+      return "ceres_scan_matcher";
+    case Stage::kInsertIntoSubmap:
+      return "insert_into_submap";
+    case Stage::kConstraintSearch:
+      return "constraint_search";
+    case Stage::kOptimization:
+      return "optimization";
+    case Stage::kNumStages:
+      break;
+  }
+  LOG(FATAL) << "Unknown stage " << static_cast<int>(stage);
+  return "";
+}
+
+void RegisterStageMetrics(FamilyFactory* family_factory) {
+  auto* latency = family_factory->NewHistogramFamily(
+      "mapping_stage_latency",
+      "Wall time in seconds spent in stages of the SLAM pipeline",
+      Histogram::ScaledPowersOf(2, 1e-5, 100));
+  for (int i = 0; i < kNumStages; ++i) {
+    StageLatencyMetrics()[i] =
+        latency->Add({{"stage", GetStageName(static_cast<Stage>(i))}});
+  }
+}
+
+ScopedStageTimer::ScopedStageTimer(const Stage stage)
+    : stage_(stage),
+      start_(std::chrono::steady_clock::now()),
+      parent_(current_timer) {
+  current_timer = this;
+}
+
+ScopedStageTimer::~ScopedStageTimer() {
+  CHECK_EQ(current_timer, this);
+  current_timer = parent_;
+  const auto duration = std::chrono::steady_clock::now() - start_;
+  StageLatencyMetrics()[static_cast<int>(stage_)]->Observe(
+      std::chrono::duration<double>(duration - excluded_duration_).count());
+  TraceRecorder& trace_recorder = GetTraceRecorder();
+  if (trace_recorder.tracing()) {
+    trace_recorder.Add({stage_, GetTraceThreadId(), start_, duration});
+  }
+}
+
+ScopedStageTimerExclusion::ScopedStageTimerExclusion()
+    : timer_(current_timer), start_(std::chrono::steady_clock::now()) {}
+
+ScopedStageTimerExclusion::~ScopedStageTimerExclusion() {
+  if (timer_ != nullptr) {
+    timer_->excluded_duration_ += std::chrono::steady_clock::now() - start_;
+  }
+}
+
+void StartTracing(const int max_num_events) {
+  GetTraceRecorder().Start(max_num_events);
+}
+
+void StopTracing() { GetTraceRecorder().Stop(); }
+
+std::string GetChromeTraceJson() {
+  return GetTraceRecorder().ToChromeTraceJson();
+}
+
+bool WriteChromeTrace(const std::string& filename) {
+  StopTracing();
+  std::ofstream stream(filename);
+  stream << GetChromeTraceJson();
+  stream.close();
+  if (!stream) {
+    LOG(ERROR) << "Could not write trace to " << filename;
+    return false;
+  }
+  LOG(INFO) << "Wrote trace to " << filename;
+  return true;
+}
+
+}  // namespace metrics
+}  // namespace cartographer
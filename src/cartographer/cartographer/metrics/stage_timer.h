@@ -0,0 +1,106 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_METRICS_STAGE_TIMER_H_
+#define CARTOGRAPHER_METRICS_STAGE_TIMER_H_
+
+#include <chrono>
+#include <string>
+
+#include "cartographer/metrics/family_factory.h"
+
+namespace cartographer {
+namespace metrics {
+
+// Stages of the SLAM pipeline whose wall time is recorded.
+enum class Stage {
+  // Adding sensor data to the collator, excluding the dispatch of the data it
+  // releases.
+  kCollator = 0,
+  kVoxelFilter,
+  kRealTimeCorrelativeScanMatcher,
+  kCeresScanMatcher,
+  kInsertIntoSubmap,
+  kConstraintSearch,
+  kOptimization,
+  kNumStages
+};
+
+const char* GetStageName(Stage stage);
+
+// Registers one latency histogram per stage. Until this is called, timing
+// stages only costs reading the clock.
+void RegisterStageMetrics(FamilyFactory* family_factory);
+
+// Measures the wall time from construction to destruction and records it in
+// the latency histogram of 'stage' and, while tracing, as a trace event.
+class ScopedStageTimer {
+ public:
+  explicit ScopedStageTimer(Stage stage);
+  ~ScopedStageTimer();
+
+  ScopedStageTimer(const ScopedStageTimer&) = delete;
+  ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+ private:
+  friend class ScopedStageTimerExclusion;
+
+  const Stage stage_;
+  const std::chrono::steady_clock::time_point start_;
+  // Timer that was running on this thread when this one started.
+  ScopedStageTimer* const parent_;
+  std::chrono::steady_clock::duration excluded_duration_{0};
+};
+
+// Excludes the wall time from construction to destruction from the latency
+// histogram of the innermost timer running on this thread, if any. Used for
+// work a stage hands off synchronously, e.g. the collator calling into local
+// SLAM. The trace event still spans the whole stage, with the handed off
+// stages nested in it.
+class ScopedStageTimerExclusion {
+ public:
+  ScopedStageTimerExclusion();
+  ~ScopedStageTimerExclusion();
+
+  ScopedStageTimerExclusion(const ScopedStageTimerExclusion&) = delete;
+  ScopedStageTimerExclusion& operator=(const ScopedStageTimerExclusion&) =
+      delete;
+
+ private:
+  ScopedStageTimer* const timer_;
+  const std::chrono::steady_clock::time_point start_;
+};
+
+// Starts recording a trace event for every timed stage. Events of an earlier
+// trace are discarded. Once 'max_num_events' events are recorded, further
+// events are dropped.
+void StartTracing(int max_num_events = 1 << 20);
+
+// Stops recording trace events. Recorded events are kept.
+void StopTracing();
+
+// Returns the recorded events in the Chrome trace event format, which can be
+// loaded into chrome://tracing or Perfetto.
+std::string GetChromeTraceJson();
+
+// Stops tracing and writes the recorded events to 'filename' in the format of
+// 'GetChromeTraceJson'. Returns false if the file could not be written.
+bool WriteChromeTrace(const std::string& filename);
+
+}  // namespace metrics
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_METRICS_STAGE_TIMER_H_
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2018 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/metrics/stage_timer.h"
+
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/match.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace metrics {
+namespace {
+
+using ::testing::HasSubstr;
+using ::testing::Not;
+using ::testing::SizeIs;
+
+class RecordingHistogram : public Histogram {
+ public:
+  void Observe(double value) override { values.push_back(value); }
+
+  std::vector<double> values;
+};
+
+class RecordingHistogramFamily : public Family<Histogram> {
+ public:
+  Histogram* Add(const std::map<std::string, std::string>& labels) override {
+    auto& histogram = histograms[labels.at("stage")];
+    histogram = absl::make_unique<RecordingHistogram>();
+    return histogram.get();
+  }
+
+  std::map<std::string, std::unique_ptr<RecordingHistogram>> histograms;
+};
+
+class RecordingFamilyFactory : public FamilyFactory {
+ public:
+  Family<Counter>* NewCounterFamily(const std::string&,
+                                    const std::string&) override {
+    return Family<Counter>::Null();
+  }
+  Family<Gauge>* NewGaugeFamily(const std::string&,
+                                const std::string&) override {
+    return Family<Gauge>::Null();
+  }
+  Family<Histogram>* NewHistogramFamily(
+      const std::string&, const std::string&,
+      const Histogram::BucketBoundaries&) override {
+    return &histogram_family;
+  }
+
+  RecordingHistogramFamily histogram_family;
+};
+
+TEST(StageTimerTest, ObservesLatencyOfStage) {
+  // The registered histograms stay in use after the test, so the factory is
+  // never destroyed.
+  auto* const factory = new RecordingFamilyFactory;
+  RegisterStageMetrics(factory);
+  ASSERT_THAT(factory->histogram_family.histograms,
+              SizeIs(static_cast<int>(Stage::kNumStages)));
+  {
+    ScopedStageTimer timer(Stage::kVoxelFilter);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  const std::vector<double>& values =
+      factory->histogram_family.histograms.at("voxel_filter")->values;
+  ASSERT_THAT(values, SizeIs(1));
+  EXPECT_GE(values.front(), 2e-3);
+  EXPECT_TRUE(
+      factory->histogram_family.histograms.at("optimization")->values.empty());
+
+  {
+    ScopedStageTimer timer(Stage::kCollator);
+    ScopedStageTimerExclusion exclusion;
+    ScopedStageTimer nested_timer(Stage::kVoxelFilter);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  const std::vector<double>& collator_values =
+      factory->histogram_family.histograms.at("collator")->values;
+  ASSERT_THAT(collator_values, SizeIs(1));
+  EXPECT_LT(collator_values.front(), 25e-3);
+  ASSERT_THAT(values, SizeIs(2));
+  EXPECT_GE(values.back(), 50e-3);
+}
+
+TEST(StageTimerTest, WritesChromeTrace) {
+  { ScopedStageTimer timer(Stage::kCollator); }
+  StartTracing();
+  { ScopedStageTimer timer(Stage::kOptimization); }
+  std::thread([]() { ScopedStageTimer timer(Stage::kConstraintSearch); })
+      .join();
+  StopTracing();
+  { ScopedStageTimer timer(Stage::kInsertIntoSubmap); }
+
+  const std::string json = GetChromeTraceJson();
+  EXPECT_TRUE(absl::StartsWith(json, "{\"traceEvents\":["));
+  EXPECT_THAT(json, HasSubstr("\"name\":\"optimization\""));
+  EXPECT_THAT(json, HasSubstr("\"name\":\"constraint_search\""));
+  EXPECT_THAT(json, HasSubstr("\"ph\":\"X\""));
+  EXPECT_THAT(json, Not(HasSubstr("collator")));
+  EXPECT_THAT(json, Not(HasSubstr("insert_into_submap")));
+}
+
+TEST(StageTimerTest, WritesChromeTraceToFile) {
+  StartTracing();
+  { ScopedStageTimer timer(Stage::kOptimization); }
+  const std::string filename = ::testing::TempDir() + "/stage_timer_trace.json";
+  ASSERT_TRUE(WriteChromeTrace(filename));
+  std::ifstream stream(filename);
+  const std::string json((std::istreambuf_iterator<char>(stream)),
+                         std::istreambuf_iterator<char>());
+  EXPECT_EQ(json, GetChromeTraceJson());
+  EXPECT_THAT(json, HasSubstr("\"name\":\"optimization\""));
+  EXPECT_FALSE(WriteChromeTrace(filename + "/not_a_directory/trace.json"));
+}
+
+TEST(StageTimerTest, DropsEventsAboveLimit) {
+  StartTracing(2 /* max_num_events */);
+  for (int i = 0; i < 5; ++i) {
+    ScopedStageTimer timer(Stage::kCeresScanMatcher);
+  }
+  StopTracing();
+  const std::string json = GetChromeTraceJson();
+  int num_events = 0;
+  for (size_t position = json.find("\"ph\""); position != std::string::npos;
+       position = json.find("\"ph\"", position + 1)) {
+    ++num_events;
+  }
+  EXPECT_EQ(num_events, 2);
+}
+
+}  // namespace
+}  // namespace metrics
+}  // namespace cartographer
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2016 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/sensor/columnar_point_cloud.h"
+
+#include <utility>
+
+#include "glog/logging.h"
+
+namespace cartographer {
+namespace sensor {
+
+namespace {
+
+using Column = ColumnarPointCloud::Column;
+
+Eigen::Map<const Eigen::ArrayXf, Eigen::AlignedMax> AsArray(
+    const Column& column) {
+  return Eigen::Map<const Eigen::ArrayXf, Eigen::AlignedMax>(column.data(),
+                                                             column.size());
+}
+
+Eigen::Map<Eigen::ArrayXf, Eigen::AlignedMax> AsArray(Column* const column) {
+  return Eigen::Map<Eigen::ArrayXf, Eigen::AlignedMax>(column->data(),
+                                                       column->size());
+}
+
+template <class PointType>
+void AppendCoordinates(const std::vector<PointType>& points, Column* const x,
+                       Column* const y, Column* const z) {
+  x->reserve(points.size());
+  y->reserve(points.size());
+  z->reserve(points.size());
+  for (const PointType& point : points) {
+    x->push_back(point.position.x());
+    y->push_back(point.position.y());
+    z->push_back(point.position.z());
+  }
+}
+
+}  // namespace
+
+ColumnarPointCloud::ColumnarPointCloud(Column x, Column y, Column z,
+                                       Column time, Column intensity)
+    : x_(std::move(x)),
+      y_(std::move(y)),
+      z_(std::move(z)),
+      time_(std::move(time)),
+      intensity_(std::move(intensity)) {
+  CHECK_EQ(x_.size(), y_.size());
+  CHECK_EQ(x_.size(), z_.size());
+  if (!time_.empty()) CHECK_EQ(x_.size(), time_.size());
+  if (!intensity_.empty()) CHECK_EQ(x_.size(), intensity_.size());
+}
+
+ColumnarPointCloud::ColumnarPointCloud(const PointCloud& point_cloud)
+    : intensity_(point_cloud.intensities().begin(),
+                 point_cloud.intensities().end()) {
+  AppendCoordinates(point_cloud.points(), &x_, &y_, &z_);
+}
+
+ColumnarPointCloud::ColumnarPointCloud(const TimedPointCloud& point_cloud) {
+  AppendCoordinates(point_cloud, &x_, &y_, &z_);
+  time_.reserve(point_cloud.size());
+  for (const TimedRangefinderPoint& point : point_cloud) {
+    time_.push_back(point.time);
+  }
+}
+
+ColumnarPointCloud::ColumnarPointCloud(
+    const PointCloudWithIntensities& point_cloud)
+    : ColumnarPointCloud(point_cloud.points) {
+  if (!point_cloud.intensities.empty()) {
+    CHECK_EQ(point_cloud.points.size(), point_cloud.intensities.size());
+    intensity_.assign(point_cloud.intensities.begin(),
+                      point_cloud.intensities.end());
+  }
+}
+
+PointCloud ColumnarPointCloud::ToPointCloud() const {
+  std::vector<RangefinderPoint> points;
+  points.reserve(size());
+  for (size_t i = 0; i < size(); ++i) {
+    points.push_back({Eigen::Vector3f(x_[i], y_[i], z_[i])});
+  }
+  return PointCloud(std::move(points),
+                    std::vector<float>(intensity_.begin(), intensity_.end()));
+}
+
+TimedPointCloud ColumnarPointCloud::ToTimedPointCloud() const {
+  TimedPointCloud points;
+  points.reserve(size());
+  for (size_t i = 0; i < size(); ++i) {
+    points.push_back({Eigen::Vector3f(x_[i], y_[i], z_[i]),
+                      has_time() ? time_[i] : 0.f});
+  }
+  return points;
+}
+
+ColumnarPointCloud TransformPointCloud(const ColumnarPointCloud& point_cloud,
+                                       const transform::Rigid3f& transform) {
+  const Eigen::Matrix3f rotation = transform.rotation().toRotationMatrix();
+  const Eigen::Vector3f& translation = transform.translation();
+  const auto x = AsArray(point_cloud.x());
+  const auto y = AsArray(point_cloud.y());
+  const auto z = AsArray(point_cloud.z());
+  Column result_x(point_cloud.size());
+  Column result_y(point_cloud.size());
+  Column result_z(point_cloud.size());
+  AsArray(&result_x) = rotation(0, 0) * x + rotation(0, 1) * y +
+                       rotation(0, 2) * z + translation.x();
+  AsArray(&result_y) = rotation(1, 0) * x + rotation(1, 1) * y +
+                       rotation(1, 2) * z + translation.y();
+  AsArray(&result_z) = rotation(2, 0) * x + rotation(2, 1) * y +
+                       rotation(2, 2) * z + translation.z();
+  return ColumnarPointCloud(std::move(result_x), std::move(result_y),
+                            std::move(result_z), point_cloud.time(),
+                            point_cloud.intensity());
+}
+
+ColumnarPointCloud CropPointCloud(const ColumnarPointCloud& point_cloud,
+                                  const float min_z, const float max_z) {
+  const size_t size = point_cloud.size();
+  Column x(size);
+  Column y(size);
+  Column z(size);
+  Column time(point_cloud.has_time() ? size : 0);
+  Column intensity(point_cloud.has_intensity() ? size : 0);
+  // Every point is written and only kept by advancing 'num_kept', which
+  // avoids a hard to predict branch per point.
+  size_t num_kept = 0;
+  for (size_t i = 0; i < size; ++i) {
+    const float point_z = point_cloud.z()[i];
+    x[num_kept] = point_cloud.x()[i];
+    y[num_kept] = point_cloud.y()[i];
+    z[num_kept] = point_z;
+    if (!time.empty()) time[num_kept] = point_cloud.time()[i];
+    if (!intensity.empty()) intensity[num_kept] = point_cloud.intensity()[i];
+    num_kept += (min_z <= point_z && point_z <= max_z) ? 1 : 0;
+  }
+  x.resize(num_kept);
+  y.resize(num_kept);
+  z.resize(num_kept);
+  if (!time.empty()) time.resize(num_kept);
+  if (!intensity.empty()) intensity.resize(num_kept);
+  return ColumnarPointCloud(std::move(x), std::move(y), std::move(z),
+                            std::move(time), std::move(intensity));
+}
+
+}  // namespace sensor
+}  // namespace cartographer
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2016 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CARTOGRAPHER_SENSOR_COLUMNAR_POINT_CLOUD_H_
+#define CARTOGRAPHER_SENSOR_COLUMNAR_POINT_CLOUD_H_
+
+#include <vector>
+
+#include "Eigen/Core"
+#include "cartographer/sensor/point_cloud.h"
+#include "cartographer/transform/rigid_transform.h"
+
+namespace cartographer {
+namespace sensor {
+
+// Point cloud with one aligned array per coordinate, i.e. a structure of
+// arrays, so that operations on all points are vectorized by Eigen. The
+// 'time' and 'intensity' columns are empty if there is no such data.
+// Converts from and to the point-wise representations used elsewhere.
+class ColumnarPointCloud {
+ public:
+  using Column = std::vector<float, Eigen::aligned_allocator<float>>;
+
+  ColumnarPointCloud() = default;
+  // 'time' and 'intensity' must either be empty or of the same size as the
+  // coordinate columns.
+  ColumnarPointCloud(Column x, Column y, Column z, Column time,
+                     Column intensity);
+  explicit ColumnarPointCloud(const PointCloud& point_cloud);
+  explicit ColumnarPointCloud(const TimedPointCloud& point_cloud);
+  explicit ColumnarPointCloud(const PointCloudWithIntensities& point_cloud);
+
+  size_t size() const { return x_.size(); }
+  bool empty() const { return x_.empty(); }
+  bool has_time() const { return !time_.empty(); }
+  bool has_intensity() const { return !intensity_.empty(); }
+
+  const Column& x() const { return x_; }
+  const Column& y() const { return y_; }
+  const Column& z() const { return z_; }
+  const Column& time() const { return time_; }
+  const Column& intensity() const { return intensity_; }
+
+  // Converts back. Without a 'time' column, all points have time 0.
+  PointCloud ToPointCloud() const;
+  TimedPointCloud ToTimedPointCloud() const;
+
+ private:
+  Column x_;
+  Column y_;
+  Column z_;
+  Column time_;
+  Column intensity_;
+};
+
+// Transforms 'point_cloud' according to 'transform'.
+ColumnarPointCloud TransformPointCloud(const ColumnarPointCloud& point_cloud,
+                                       const transform::Rigid3f& transform);
+
+// Returns a new point cloud without points that fall outside the region
+// defined by 'min_z' and 'max_z'.
+ColumnarPointCloud CropPointCloud(const ColumnarPointCloud& point_cloud,
+                                  float min_z, float max_z);
+
+}  // namespace sensor
+}  // namespace cartographer
+
+#endif  // CARTOGRAPHER_SENSOR_COLUMNAR_POINT_CLOUD_H_
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2016 The Cartographer Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cartographer/sensor/columnar_point_cloud.h"
+
+#include <cmath>
+
+#include "cartographer/transform/transform.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace cartographer {
+namespace sensor {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+TEST(ColumnarPointCloudTest, ConvertsToAndFromPointCloud) {
+  const PointCloud point_cloud({{{0.f, 1.f, 2.f}}, {{3.f, 4.f, 5.f}}},
+                               {6.f, 7.f});
+  const ColumnarPointCloud columnar_point_cloud(point_cloud);
+  EXPECT_EQ(columnar_point_cloud.size(), 2);
+  EXPECT_FALSE(columnar_point_cloud.has_time());
+  EXPECT_TRUE(columnar_point_cloud.has_intensity());
+  EXPECT_THAT(columnar_point_cloud.x(), ElementsAre(0.f, 3.f));
+  EXPECT_THAT(columnar_point_cloud.z(), ElementsAre(2.f, 5.f));
+  const PointCloud converted = columnar_point_cloud.ToPointCloud();
+  EXPECT_EQ(converted.points(), point_cloud.points());
+  EXPECT_EQ(converted.intensities(), point_cloud.intensities());
+
+  const TimedPointCloud timed_point_cloud = {{{0.f, 1.f, 2.f}, -0.5f},
+                                             {{3.f, 4.f, 5.f}, 0.f}};
+  const ColumnarPointCloud columnar_timed_point_cloud(timed_point_cloud);
+  EXPECT_THAT(columnar_timed_point_cloud.time(), ElementsAre(-0.5f, 0.f));
+  EXPECT_THAT(columnar_timed_point_cloud.intensity(), IsEmpty());
+  EXPECT_EQ(columnar_timed_point_cloud.ToTimedPointCloud(), timed_point_cloud);
+}
+
+TEST(ColumnarPointCloudTest, TransformPointCloud) {
+  TimedPointCloud timed_point_cloud;
+  for (int i = 0; i < 101; ++i) {
+    timed_point_cloud.push_back(
+        {{0.1f * i, std::sin(0.1f * i), -0.2f * i}, 0.01f * i});
+  }
+  const transform::Rigid3f transform(
+      Eigen::Vector3f(1.f, -2.f, 3.f),
+      Eigen::Quaternionf(Eigen::AngleAxisf(0.3f, Eigen::Vector3f::UnitZ()) *
+                         Eigen::AngleAxisf(-0.2f, Eigen::Vector3f::UnitX())));
+  const TimedPointCloud expected =
+      TransformTimedPointCloud(timed_point_cloud, transform);
+  const TimedPointCloud result =
+      TransformPointCloud(ColumnarPointCloud(timed_point_cloud), transform)
+          .ToTimedPointCloud();
+  ASSERT_EQ(result.size(), expected.size());
+  for (size_t i = 0; i < result.size(); ++i) {
+    EXPECT_TRUE(result[i].position.isApprox(expected[i].position, 1e-5f));
+    EXPECT_EQ(result[i].time, expected[i].time);
+  }
+}
+
+TEST(ColumnarPointCloudTest, CropPointCloud) {
+  const PointCloud point_cloud(
+      {{{0.f, 0.f, -1.f}}, {{1.f, 0.f, 0.5f}}, {{2.f, 0.f, 2.f}},
+       {{3.f, 0.f, 1.f}}},
+      {0.f, 1.f, 2.f, 3.f});
+  const ColumnarPointCloud result =
+      CropPointCloud(ColumnarPointCloud(point_cloud), 0.f, 1.f);
+  EXPECT_THAT(result.x(), ElementsAre(1.f, 3.f));
+  EXPECT_THAT(result.z(), ElementsAre(0.5f, 1.f));
+  EXPECT_THAT(result.intensity(), ElementsAre(1.f, 3.f));
+  EXPECT_FALSE(result.has_time());
+}
+
+}  // namespace
+}  // namespace sensor
+}  // namespace cartographer
@@ -17,6 +17,10 @@
 #ifndef CARTOGRAPHER_SENSOR_INTERNAL_DISPATCHABLE_H_
 #define CARTOGRAPHER_SENSOR_INTERNAL_DISPATCHABLE_H_
 
+#include <memory>
+#include <string>
+#include <utility>
+
 #include "cartographer/mapping/trajectory_builder_interface.h"
 #include "cartographer/sensor/data.h"
 
@@ -26,8 +30,8 @@ namespace sensor {
 template <typename DataType>
 class Dispatchable : public Data {
  public:
-  Dispatchable(const std::string &sensor_id, const DataType &data)
-      : Data(sensor_id), data_(data) {}
+  Dispatchable(const std::string &sensor_id, DataType data)
+      : Data(sensor_id), data_(std::move(data)) {}
 
   common::Time GetTime() const override { return data_.time; }
 
@@ -51,10 +55,11 @@ class Dispatchable : public Data {
 
 
 // 根据传入的data的数据类型,自动推断DataType, 实现一个函数处理不同类型的传感器数据
+// Temporaries, e.g. the result of 'FromProto()', are moved instead of copied.
 template <typename DataType>
 std::unique_ptr<Dispatchable<DataType>> MakeDispatchable(
-    const std::string &sensor_id, const DataType &data) {
-  return absl::make_unique<Dispatchable<DataType>>(sensor_id, data);
+    const std::string &sensor_id, DataType data) {
+  return absl::make_unique<Dispatchable<DataType>>(sensor_id, std::move(data));
 }
 
 }  // namespace sensor
@@ -16,6 +16,7 @@
 
 #include "cartographer/sensor/internal/trajectory_collator.h"
 
+#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 
 namespace cartographer {
@@ -29,36 +30,59 @@ void TrajectoryCollator::AddTrajectory(
     const int trajectory_id,
     const absl::flat_hash_set<std::string>& expected_sensor_ids,
     const Callback& callback) {
-  CHECK_EQ(trajectory_to_queue_.count(trajectory_id), 0);
-  for (const auto& sensor_id : expected_sensor_ids) {
-    const auto queue_key = QueueKey{trajectory_id, sensor_id};
-    trajectory_to_queue_[trajectory_id].AddQueue(
-        queue_key, 
-        [callback, sensor_id](std::unique_ptr<Data> data) {
-          callback(sensor_id, std::move(data));
-        } );
-    trajectory_to_queue_keys_[trajectory_id].push_back(queue_key);
+  auto trajectory_queue = absl::make_unique<TrajectoryQueue>();
+  {
+    absl::MutexLock locker(&trajectory_queue->mutex);
+    for (const auto& sensor_id : expected_sensor_ids) {
+      const auto queue_key = QueueKey{trajectory_id, sensor_id};
+      trajectory_queue->queue.AddQueue(
+          queue_key,
+          [callback, sensor_id](std::unique_ptr<Data> data) {
+            callback(sensor_id, std::move(data));
+          });
+      trajectory_queue->queue_keys.push_back(queue_key);
+    }
   }
+  absl::MutexLock locker(&mutex_);
+  CHECK_EQ(trajectory_to_queue_.count(trajectory_id), 0);
+  trajectory_to_queue_[trajectory_id] = std::move(trajectory_queue);
 }
 
 void TrajectoryCollator::FinishTrajectory(const int trajectory_id) {
-  for (const auto& queue_key : trajectory_to_queue_keys_[trajectory_id]) {
-    trajectory_to_queue_.at(trajectory_id).MarkQueueAsFinished(queue_key);
+  TrajectoryQueue* const trajectory_queue = GetTrajectoryQueue(trajectory_id);
+  if (trajectory_queue == nullptr) {
+    return;
+  }
+  absl::MutexLock locker(&trajectory_queue->mutex);
+  for (const auto& queue_key : trajectory_queue->queue_keys) {
+    trajectory_queue->queue.MarkQueueAsFinished(queue_key);
   }
 }
 
 void TrajectoryCollator::AddSensorData(const int trajectory_id,
                                        std::unique_ptr<Data> data) {
   QueueKey queue_key{trajectory_id, data->GetSensorId()};
-  auto* metric = GetOrCreateSensorMetric(data->GetSensorId(), trajectory_id);
-  metric->Increment();
-  trajectory_to_queue_.at(trajectory_id)
-      .Add(std::move(queue_key), std::move(data));
+  TrajectoryQueue* trajectory_queue;
+  {
+    absl::MutexLock locker(&mutex_);
+    GetOrCreateSensorMetric(data->GetSensorId(), trajectory_id)->Increment();
+    trajectory_queue = trajectory_to_queue_.at(trajectory_id).get();
+  }
+  absl::MutexLock locker(&trajectory_queue->mutex);
+  trajectory_queue->queue.Add(std::move(queue_key), std::move(data));
 }
 
 void TrajectoryCollator::Flush() {
-  for (auto& it : trajectory_to_queue_) {
-    it.second.Flush();
+  std::vector<TrajectoryQueue*> trajectory_queues;
+  {
+    absl::MutexLock locker(&mutex_);
+    for (auto& entry : trajectory_to_queue_) {
+      trajectory_queues.push_back(entry.second.get());
+    }
+  }
+  for (TrajectoryQueue* const trajectory_queue : trajectory_queues) {
+    absl::MutexLock locker(&trajectory_queue->mutex);
+    trajectory_queue->queue.Flush();
   }
 }
 
@@ -72,6 +96,13 @@ void TrajectoryCollator::RegisterMetrics(
       "collator_input_total", "Sensor data received");
 }
 
+TrajectoryCollator::TrajectoryQueue* TrajectoryCollator::GetTrajectoryQueue(
+    const int trajectory_id) {
+  absl::MutexLock locker(&mutex_);
+  const auto it = trajectory_to_queue_.find(trajectory_id);
+  return it != trajectory_to_queue_.end() ? it->second.get() : nullptr;
+}
+
 metrics::Counter* TrajectoryCollator::GetOrCreateSensorMetric(
     const std::string& sensor_id, int trajectory_id) {
   const std::string trajectory_id_str = absl::StrCat(trajectory_id);
@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
 #include "cartographer/metrics/counter.h"
 #include "cartographer/metrics/family_factory.h"
 #include "cartographer/sensor/collator_interface.h"
@@ -40,6 +41,10 @@ namespace sensor {
 // 与“ Collator”相反, 它不等待其他轨迹.
 // 与“ Collator”（其输出是确定性的）相反, 未对数据分派的顺序进行排序, 
 // 因此非确定性的输入序列将导致非确定性的输出
+//
+// Data of different trajectories may be added concurrently. Each trajectory
+// has its own lock and the callbacks of a trajectory are invoked while holding
+// it, so they never run concurrently with each other.
 
 class TrajectoryCollator : public CollatorInterface {
  public:
@@ -64,19 +69,32 @@ class TrajectoryCollator : public CollatorInterface {
   static void RegisterMetrics(metrics::FamilyFactory* family_factory);
 
  private:
+  struct TrajectoryQueue {
+    absl::Mutex mutex;
+    OrderedMultiQueue queue GUARDED_BY(mutex);
+    std::vector<QueueKey> queue_keys GUARDED_BY(mutex);
+  };
+
+  // Returns the queue of 'trajectory_id', which stays valid for the lifetime
+  // of the collator, or nullptr if the trajectory was never added.
+  TrajectoryQueue* GetTrajectoryQueue(int trajectory_id)
+      LOCKS_EXCLUDED(mutex_);
   metrics::Counter* GetOrCreateSensorMetric(const std::string& sensor_id,
-                                            int trajectory_id);
+                                            int trajectory_id)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   static cartographer::metrics::Family<metrics::Counter>*
       collator_metrics_family_;
 
-  // Holds individual counters for each trajectory/sensor pair.
-  absl::flat_hash_map<std::string, metrics::Counter*> metrics_map_;
+  // Only guards the maps, the queues are guarded by their own mutex.
+  absl::Mutex mutex_;
 
-  absl::flat_hash_map<int, OrderedMultiQueue> trajectory_to_queue_;
+  // Holds individual counters for each trajectory/sensor pair.
+  absl::flat_hash_map<std::string, metrics::Counter*> metrics_map_
+      GUARDED_BY(mutex_);
 
-  // Map of trajectory ID to all associated QueueKeys.
-  absl::flat_hash_map<int, std::vector<QueueKey>> trajectory_to_queue_keys_;
+  absl::flat_hash_map<int, std::unique_ptr<TrajectoryQueue>>
+      trajectory_to_queue_ GUARDED_BY(mutex_);
 };
 
 }  // namespace sensor
@@ -16,8 +16,11 @@
 
 #include "cartographer/sensor/internal/trajectory_collator.h"
 
+#include <algorithm>
 #include <array>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "cartographer/common/time.h"
@@ -116,6 +119,48 @@ TEST(TrajectoryCollator, OrderingMultipleTrajectories) {
   ASSERT_EQ(input_data.size(), received.size());
 }
 
+TEST(TrajectoryCollator, AddsDataOfTrajectoriesConcurrently) {
+  constexpr int kNumTrajectories = 4;
+  constexpr int kNumDataPerSensor = 1000;
+  const std::array<std::string, 2> kSensorId = {{"my_points", "some_imu"}};
+
+  TrajectoryCollator collator;
+  std::array<std::vector<common::Time>, kNumTrajectories> received;
+  for (int trajectory_id = 0; trajectory_id < kNumTrajectories;
+       ++trajectory_id) {
+    collator.AddTrajectory(
+        trajectory_id,
+        absl::flat_hash_set<std::string>(kSensorId.begin(), kSensorId.end()),
+        [&received, trajectory_id](const std::string& sensor_id,
+                                   std::unique_ptr<Data> data) {
+          received[trajectory_id].push_back(data->GetTime());
+        });
+  }
+
+  std::vector<std::thread> threads;
+  for (int trajectory_id = 0; trajectory_id < kNumTrajectories;
+       ++trajectory_id) {
+    threads.emplace_back([&collator, &kSensorId, trajectory_id]() {
+      for (int i = 0; i < kNumDataPerSensor; ++i) {
+        CollatorInput::CreateTimedPointCloudData(trajectory_id, kSensorId[0],
+                                                 2 * i)
+            .MoveToCollator(&collator);
+        CollatorInput::CreateImuData(trajectory_id, kSensorId[1], 2 * i + 1)
+            .MoveToCollator(&collator);
+      }
+      collator.FinishTrajectory(trajectory_id);
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (const std::vector<common::Time>& times : received) {
+    ASSERT_EQ(2 * kNumDataPerSensor, times.size());
+    EXPECT_TRUE(std::is_sorted(times.begin(), times.end()));
+  }
+}
+
 }  // namespace
 }  // namespace sensor
 }  // namespace cartographer
@@ -16,6 +16,7 @@
 
 #include "cartographer/sensor/internal/voxel_filter.h"
 
+#include <algorithm>
 #include <cmath>
 #include <random>
 #include <utility>
@@ -101,20 +102,19 @@ VoxelKeyType GetVoxelCellIndex(const Eigen::Vector3f& point,
 }
 
 // 进行体素滤波, 标记体素滤波后的点
-template <class T, class PointFunction>
-std::vector<bool> RandomizedVoxelFilterIndices(
-    const std::vector<T>& point_cloud, const float resolution,
-    PointFunction&& point_function) {
+// 'key_function' returns the voxel key of the point with the given index.
+template <class KeyFunction>
+std::vector<bool> RandomizedVoxelFilterIndicesByKey(
+    const size_t num_points, KeyFunction&& key_function) {
   // According to https://en.wikipedia.org/wiki/Reservoir_sampling
   std::minstd_rand0 generator;
   // std::pair<int, int>的第一个元素保存该voxel内部的点的个数, 第二个元素保存该voxel中选择的那一个点的序号
   absl::flat_hash_map<VoxelKeyType, std::pair<int, int>>
       voxel_count_and_point_index;
   // 遍历所有的点, 计算
-  for (size_t i = 0; i < point_cloud.size(); i++) {
+  for (size_t i = 0; i < num_points; i++) {
     // 获取VoxelKeyType对应的value的引用
-    auto& voxel = voxel_count_and_point_index[GetVoxelCellIndex(
-        point_function(point_cloud[i]), resolution)];
+    auto& voxel = voxel_count_and_point_index[key_function(i)];
     voxel.first++;
     // 如果这个体素格子只有1个点, 那这个体素格子里的点的索引就是i
     if (voxel.first == 1) {
@@ -131,13 +131,46 @@ std::vector<bool> RandomizedVoxelFilterIndices(
   }
 
   // 为体素滤波之后的点做标记
-  std::vector<bool> points_used(point_cloud.size(), false);
+  std::vector<bool> points_used(num_points, false);
   for (const auto& voxel_and_index : voxel_count_and_point_index) {
     points_used[voxel_and_index.second.second] = true;
   }
   return points_used;
 }
 
+template <class T, class PointFunction>
+std::vector<bool> RandomizedVoxelFilterIndices(
+    const std::vector<T>& point_cloud, const float resolution,
+    PointFunction&& point_function) {
+  return RandomizedVoxelFilterIndicesByKey(
+      point_cloud.size(), [&](const size_t i) {
+        return GetVoxelCellIndex(point_function(point_cloud[i]), resolution);
+      });
+}
+
+// Computes the voxel index of one coordinate for all points at once, which
+// Eigen vectorizes. Rounds like 'GetVoxelCellIndex'.
+Eigen::ArrayXi GetVoxelCellIndices(const ColumnarPointCloud::Column& column,
+                                   const float resolution) {
+  return (Eigen::Map<const Eigen::ArrayXf, Eigen::AlignedMax>(column.data(),
+                                                              column.size()) /
+          resolution)
+      .round()
+      .cast<int>();
+}
+
+ColumnarPointCloud::Column FilterColumn(
+    const ColumnarPointCloud::Column& column,
+    const std::vector<bool>& points_used, const size_t num_used) {
+  ColumnarPointCloud::Column result;
+  if (column.empty()) return result;
+  result.reserve(num_used);
+  for (size_t i = 0; i < column.size(); ++i) {
+    if (points_used[i]) result.push_back(column[i]);
+  }
+  return result;
+}
+
 template <class T, class PointFunction>
 std::vector<T> RandomizedVoxelFilter(const std::vector<T>& point_cloud,
                                      const float resolution,
@@ -189,6 +222,29 @@ PointCloud VoxelFilter(const PointCloud& point_cloud, const float resolution) {
                     std::move(filtered_intensities));
 }
 
+ColumnarPointCloud VoxelFilter(const ColumnarPointCloud& point_cloud,
+                               const float resolution) {
+  const Eigen::ArrayXi x = GetVoxelCellIndices(point_cloud.x(), resolution);
+  const Eigen::ArrayXi y = GetVoxelCellIndices(point_cloud.y(), resolution);
+  const Eigen::ArrayXi z = GetVoxelCellIndices(point_cloud.z(), resolution);
+  // Same keys and random choices as for the other point cloud types.
+  const std::vector<bool> points_used = RandomizedVoxelFilterIndicesByKey(
+      point_cloud.size(), [&x, &y, &z](const size_t i) {
+        const uint64_t key_x = x[i];
+        const uint64_t key_y = y[i];
+        const uint64_t key_z = z[i];
+        return (key_x << 42) + (key_y << 21) + key_z;
+      });
+  const size_t num_used =
+      std::count(points_used.begin(), points_used.end(), true);
+  return ColumnarPointCloud(
+      FilterColumn(point_cloud.x(), points_used, num_used),
+      FilterColumn(point_cloud.y(), points_used, num_used),
+      FilterColumn(point_cloud.z(), points_used, num_used),
+      FilterColumn(point_cloud.time(), points_used, num_used),
+      FilterColumn(point_cloud.intensity(), points_used, num_used));
+}
+
 TimedPointCloud VoxelFilter(const TimedPointCloud& timed_point_cloud,
                             const float resolution) {
   return RandomizedVoxelFilter(
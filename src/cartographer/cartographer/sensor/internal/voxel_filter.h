@@ -20,6 +20,7 @@
 #include <bitset>
 
 #include "cartographer/common/lua_parameter_dictionary.h"
+#include "cartographer/sensor/columnar_point_cloud.h"
 #include "cartographer/sensor/point_cloud.h"
 #include "cartographer/sensor/proto/adaptive_voxel_filter_options.pb.h"
 #include "cartographer/sensor/timed_point_cloud_data.h"
@@ -30,6 +31,8 @@ namespace sensor {
 std::vector<RangefinderPoint> VoxelFilter(
     const std::vector<RangefinderPoint>& points, const float resolution);
 PointCloud VoxelFilter(const PointCloud& point_cloud, const float resolution);
+ColumnarPointCloud VoxelFilter(const ColumnarPointCloud& point_cloud,
+                               const float resolution);
 TimedPointCloud VoxelFilter(const TimedPointCloud& timed_point_cloud,
                             const float resolution);
 std::vector<sensor::TimedPointCloudOriginData::RangeMeasurement> VoxelFilter(
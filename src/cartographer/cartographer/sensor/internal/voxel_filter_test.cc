@@ -81,6 +81,22 @@ TEST(VoxelFilterTest, IgnoresTime) {
   EXPECT_THAT(timed_point_cloud, Contains(result[0]));
 }
 
+TEST(VoxelFilterTest, ColumnarSelectsSamePoints) {
+  std::vector<RangefinderPoint> points;
+  std::vector<float> intensities;
+  for (int i = 0; i < 1000; ++i) {
+    const float value = 0.01f * i;
+    points.push_back({{std::sin(value) * 3.f, -value, std::cos(value)}});
+    intensities.push_back(value);
+  }
+  const PointCloud point_cloud(points, intensities);
+  const PointCloud expected = VoxelFilter(point_cloud, 0.3f);
+  const PointCloud result =
+      VoxelFilter(ColumnarPointCloud(point_cloud), 0.3f).ToPointCloud();
+  EXPECT_EQ(result.points(), expected.points());
+  EXPECT_EQ(result.intensities(), expected.intensities());
+}
+
 }  // namespace
 }  // namespace sensor
 }  // namespace cartographer
@@ -20,4 +20,5 @@ MAP_BUILDER = {
   num_background_threads = 4,
   pose_graph = POSE_GRAPH,
   collate_by_trajectory = false,
+  local_slam_queue_size = 0,
 }
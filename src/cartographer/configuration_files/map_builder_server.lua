@@ -18,11 +18,20 @@ MAP_BUILDER_SERVER = {
   map_builder = MAP_BUILDER,
   num_event_threads = 4,
   num_grpc_threads = 4,
+  num_slam_threads = 4,
   server_address = "0.0.0.0:50051",
   uplink_server_address = "",
   upload_batch_size = 100,
+  upload_max_batch_bytes = 1024 * 1024,
+  upload_max_batch_delay_seconds = 0.5,
+  upload_queue_max_bytes = 256 * 1024 * 1024,
   enable_ssl_encryption = false,
   enable_google_auth = false,
 }
 
+-- Collating each trajectory on its own lets the SLAM threads dispatch data of
+-- different trajectories in parallel without the server-wide lock.
 MAP_BUILDER.collate_by_trajectory = true
+-- Run local SLAM of each trajectory on its own thread, so that the SLAM
+-- threads only collate and dispatch sensor data.
+MAP_BUILDER.local_slam_queue_size = 100
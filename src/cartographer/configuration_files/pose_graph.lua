@@ -38,6 +38,7 @@ POSE_GRAPH = {
       occupied_space_weight = 20.,
       translation_weight = 10.,
       rotation_weight = 1.,
+      use_analytical_derivatives = false,
       ceres_solver_options = {
         use_nonmonotonic_steps = true,
         max_num_iterations = 10,
@@ -63,6 +64,7 @@ POSE_GRAPH = {
       translation_weight = 10.,
       rotation_weight = 1.,
       only_optimize_yaw = false,
+      cache_interpolation_voxels = true,
       ceres_solver_options = {
         use_nonmonotonic_steps = false,
         max_num_iterations = 10,
@@ -113,4 +115,14 @@ POSE_GRAPH = {
   --    min_covered_area = 2,
   --    min_added_submaps_count = 5,
   --  },
+
+  --  memory_budget = {
+  --    memory_budget_in_mb = 2048.,
+  --    directory = "/tmp",
+  --  },
+
+  --  work_queue = {
+  --    capacity = 100,
+  --    shed_ratio = 1.,
+  --  },
 }
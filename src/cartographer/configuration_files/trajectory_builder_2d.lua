@@ -52,6 +52,7 @@ TRAJECTORY_BUILDER_2D = {
     occupied_space_weight = 1.,
     translation_weight = 10.,
     rotation_weight = 40.,
+    use_analytical_derivatives = false,
     ceres_solver_options = {
       use_nonmonotonic_steps = false,
       max_num_iterations = 20,
@@ -40,6 +40,8 @@ TRAJECTORY_BUILDER_3D = {
     angular_search_window = math.rad(1.),
     translation_delta_cost_weight = 1e-1,
     rotation_delta_cost_weight = 1e-1,
+    num_refined_low_resolution_candidates = 4,
+    num_threads = 4,
   },
 
   ceres_scan_matcher = {
@@ -54,6 +56,7 @@ TRAJECTORY_BUILDER_3D = {
     translation_weight = 5.,
     rotation_weight = 4e2,
     only_optimize_yaw = false,
+    cache_interpolation_voxels = true,
     ceres_solver_options = {
       use_nonmonotonic_steps = false,
       max_num_iterations = 12,
@@ -113,4 +116,8 @@ TRAJECTORY_BUILDER_3D = {
   -- parameter in ceres_scan_matcher has to be set up as well or otherwise
   -- CeresScanMatcher will CHECK-fail.
   use_intensities = false,
+
+  -- Extrapolates the pose at this many times per scan and interpolates in
+  -- between, instead of extrapolating for every point.
+  -- num_deskew_knots = 16,
 }
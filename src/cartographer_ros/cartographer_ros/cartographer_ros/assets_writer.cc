@@ -173,9 +173,21 @@ void AssetsWriter::Run(const std::string& configuration_directory,
   const auto lua_parameter_dictionary =
       LoadLuaDictionary(configuration_directory, configuration_basename);
 
+  carto::io::PointsProcessorPipelineBuilder::ExecutionOptions
+      execution_options;
+  if (lua_parameter_dictionary->HasKey("pipeline_queue_size")) {
+    execution_options.queue_size =
+        lua_parameter_dictionary->GetNonNegativeInt("pipeline_queue_size");
+  }
+  if (lua_parameter_dictionary->HasKey("num_threads_per_stateless_stage")) {
+    execution_options.num_threads_per_stateless_stage =
+        lua_parameter_dictionary->GetNonNegativeInt(
+            "num_threads_per_stateless_stage");
+  }
   std::vector<std::unique_ptr<carto::io::PointsProcessor>> pipeline =
       point_pipeline_builder_->CreatePipeline(
-          lua_parameter_dictionary->GetDictionary("pipeline").get());
+          lua_parameter_dictionary->GetDictionary("pipeline").get(),
+          execution_options);
   const std::string tracking_frame =
       lua_parameter_dictionary->GetString("tracking_frame");
 
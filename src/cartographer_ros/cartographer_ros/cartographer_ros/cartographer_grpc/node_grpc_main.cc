@@ -52,6 +52,9 @@ DEFINE_bool(upload_load_state_file, false,
             "server instead of loading it from the server file system.");
 DEFINE_string(client_id, "",
               "Cartographer client ID to use when connecting to the server.");
+DEFINE_bool(compress_point_clouds, false,
+            "Upload point clouds quantized to 1 mm and compressed to save "
+            "bandwidth. Bandwidth and encoding time are logged.");
 
 namespace cartographer_ros {
 namespace {
@@ -66,7 +69,7 @@ void Run() {
       LoadOptions(FLAGS_configuration_directory, FLAGS_configuration_basename);
 
   auto map_builder = absl::make_unique<::cartographer::cloud::MapBuilderStub>(
-      FLAGS_server_address, FLAGS_client_id);
+      FLAGS_server_address, FLAGS_client_id, FLAGS_compress_point_clouds);
 
   if (!FLAGS_load_state_filename.empty() && !FLAGS_upload_load_state_file) {
     map_builder->LoadStateFromFile(FLAGS_load_state_filename,
@@ -16,6 +16,7 @@
 
 #include "absl/memory/memory.h"
 #include "cartographer/mapping/map_builder.h"
+#include "cartographer/metrics/stage_timer.h"
 #include "cartographer_ros/node.h"
 #include "cartographer_ros/node_options.h"
 #include "cartographer_ros/ros_log_sink.h"
@@ -51,6 +52,10 @@ DEFINE_bool(
 DEFINE_string(
     save_state_filename, "",
     "If non-empty, serialize state and write it to disk before shutting down.");
+DEFINE_string(chrome_trace_filename, "",
+              "If non-empty, records the wall time of the SLAM pipeline "
+              "stages and writes it as a Chrome trace (chrome://tracing or "
+              "Perfetto) to this file before shutting down.");
 
 namespace cartographer_ros {
 namespace {
@@ -85,6 +90,10 @@ void Run() {
   Node node(node_options, std::move(map_builder), &tf_buffer,
             FLAGS_collect_metrics);
 
+  if (!FLAGS_chrome_trace_filename.empty()) {
+    ::cartographer::metrics::StartTracing();
+  }
+
   // 如果加载了pbstream文件, 就执行这个函数
   if (!FLAGS_load_state_filename.empty()) {
     node.LoadState(FLAGS_load_state_filename, FLAGS_load_frozen_state);
@@ -103,6 +112,10 @@ void Run() {
   // 当所有的轨迹结束时, 再执行一次全局优化
   node.RunFinalOptimization();
 
+  if (!FLAGS_chrome_trace_filename.empty()) {
+    ::cartographer::metrics::WriteChromeTrace(FLAGS_chrome_trace_filename);
+  }
+
   // 如果save_state_filename非空, 就保存pbstream文件
   if (!FLAGS_save_state_filename.empty()) {
     node.SerializeState(FLAGS_save_state_filename,
@@ -24,8 +24,10 @@
 #include <time.h>
 
 #include <chrono>
+#include <map>
 
 #include "absl/strings/str_split.h"
+#include "cartographer/metrics/stage_timer.h"
 #include "cartographer_ros/node.h"
 #include "cartographer_ros/playable_bag.h"
 #include "cartographer_ros/urdf_reader.h"
@@ -74,6 +76,14 @@ DEFINE_bool(keep_running, false,
 DEFINE_double(skip_seconds, 0,
               "Optional amount of seconds to skip from the beginning "
               "(i.e. when the earliest bag starts.). ");
+DEFINE_bool(parallel_local_slam, false,
+            "Run local SLAM of each trajectory on its own thread. Global SLAM "
+            "stays shared between all trajectories. Only useful if several "
+            "bags are processed.");
+DEFINE_string(chrome_trace_filename, "",
+              "If non-empty, records the wall time of the SLAM pipeline "
+              "stages and writes it as a Chrome trace (chrome://tracing or "
+              "Perfetto) to this file before shutting down.");
 
 namespace cartographer_ros {
 
@@ -86,6 +96,41 @@ constexpr int kSingleThreaded = 1;
 // the assumption of higher frequency tf this should ensure that tf can
 // always interpolate.
 const ::ros::Duration kDelay = ::ros::Duration(1.0);
+// Queue size used for 'parallel_local_slam' if the configuration does not set
+// 'local_slam_queue_size'.
+constexpr int kParallelLocalSlamQueueSize = 100;
+
+namespace {
+
+// Playback statistics of a single bag.
+struct BagStatistics {
+  ::ros::Time first_message_time;
+  ::ros::Time last_message_time;
+  std::chrono::steady_clock::time_point first_message_wall_time;
+  std::chrono::steady_clock::time_point finish_wall_time;
+};
+
+// Logs how much faster than real time each bag was processed.
+void LogSpeedups(const std::vector<std::string>& bag_filenames,
+                 const std::map<int, BagStatistics>& bag_statistics) {
+  for (const auto& entry : bag_statistics) {
+    const BagStatistics& statistics = entry.second;
+    const double bag_seconds =
+        (statistics.last_message_time - statistics.first_message_time)
+            .toSec();
+    const double wall_clock_seconds =
+        std::chrono::duration_cast<std::chrono::duration<double>>(
+            statistics.finish_wall_time - statistics.first_message_wall_time)
+            .count();
+    LOG(INFO) << "Processed " << bag_seconds << " s of bag "
+              << bag_filenames.at(entry.first) << " in " << wall_clock_seconds
+              << " s wall clock time, speedup factor: "
+              << (wall_clock_seconds > 0. ? bag_seconds / wall_clock_seconds
+                                          : 0.);
+  }
+}
+
+}  // namespace
 
 void RunOfflineNode(const MapBuilderFactory& map_builder_factory) {
   CHECK(!FLAGS_configuration_directory.empty())
@@ -122,6 +167,12 @@ void RunOfflineNode(const MapBuilderFactory& map_builder_factory) {
   // remaining sensor data that cannot be transformed due to missing transforms.
   node_options.lookup_transform_timeout_sec = 0.;
 
+  if (FLAGS_parallel_local_slam &&
+      node_options.map_builder_options.local_slam_queue_size() == 0) {
+    node_options.map_builder_options.set_local_slam_queue_size(
+        kParallelLocalSlamQueueSize);
+  }
+
   auto map_builder = map_builder_factory(node_options.map_builder_options);
 
   const std::chrono::time_point<std::chrono::steady_clock> start_time =
@@ -144,6 +195,9 @@ void RunOfflineNode(const MapBuilderFactory& map_builder_factory) {
 
   Node node(node_options, std::move(map_builder), &tf_buffer,
             FLAGS_collect_metrics);
+  if (!FLAGS_chrome_trace_filename.empty()) {
+    ::cartographer::metrics::StartTracing();
+  }
   if (!FLAGS_load_state_filename.empty()) {
     node.LoadState(FLAGS_load_state_filename, FLAGS_load_frozen_state);
   }
@@ -269,6 +323,7 @@ void RunOfflineNode(const MapBuilderFactory& map_builder_factory) {
   }
 
   std::unordered_map<int, int> bag_index_to_trajectory_id;
+  std::map<int, BagStatistics> bag_statistics;
   const ros::Time begin_time =
       // If no bags were loaded, we cannot peek the time of first message.
       playable_bag_multiplexer.IsMessageAvailable()
@@ -288,6 +343,13 @@ void RunOfflineNode(const MapBuilderFactory& map_builder_factory) {
       continue;
     }
 
+    if (bag_statistics.count(bag_index) == 0) {
+      bag_statistics[bag_index].first_message_time = msg.getTime();
+      bag_statistics[bag_index].first_message_wall_time =
+          std::chrono::steady_clock::now();
+    }
+    bag_statistics[bag_index].last_message_time = msg.getTime();
+
     int trajectory_id;
     // Lazily add trajectories only when the first message arrives in order
     // to avoid blocking the sensor queue.
@@ -349,14 +411,20 @@ void RunOfflineNode(const MapBuilderFactory& map_builder_factory) {
 
     if (is_last_message_in_bag) {
       node.FinishTrajectory(trajectory_id);
+      bag_statistics[bag_index].finish_wall_time =
+          std::chrono::steady_clock::now();
     }
   }
+  LogSpeedups(bag_filenames, bag_statistics);
 
   // Ensure the clock is republished after the bag has been finished, during the
   // final optimization, serialization, and optional indefinite spinning at the
   // end.
   clock_republish_timer.start();
   node.RunFinalOptimization();
+  if (!FLAGS_chrome_trace_filename.empty()) {
+    ::cartographer::metrics::WriteChromeTrace(FLAGS_chrome_trace_filename);
+  }
 
   const std::chrono::time_point<std::chrono::steady_clock> end_time =
       std::chrono::steady_clock::now();
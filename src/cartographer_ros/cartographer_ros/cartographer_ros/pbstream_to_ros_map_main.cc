@@ -17,6 +17,7 @@
 #include <map>
 #include <string>
 
+#include "cartographer/common/thread_pool.h"
 #include "cartographer/io/proto_stream.h"
 #include "cartographer/io/proto_stream_deserializer.h"
 #include "cartographer/io/submap_painter.h"
@@ -31,12 +32,18 @@ DEFINE_string(pbstream_filename, "",
               "Filename of a pbstream to draw a map from.");
 DEFINE_string(map_filestem, "map", "Stem of the output files.");
 DEFINE_double(resolution, 0.05, "Resolution of a grid cell in the drawn map.");
+DEFINE_int32(num_threads, 4,
+             "Number of threads used to paint the map image. If 1, the map is "
+             "painted sequentially.");
 
 namespace cartographer_ros {
 namespace {
 
+// Edge length in pixels of the tiles painted in parallel.
+constexpr int kTileSize = 256;
+
 void Run(const std::string& pbstream_filename, const std::string& map_filestem,
-         const double resolution) {
+         const double resolution, const int num_threads) {
   ::cartographer::io::ProtoStreamReader reader(pbstream_filename);
   ::cartographer::io::ProtoStreamDeserializer deserializer(&reader);
 
@@ -49,8 +56,16 @@ void Run(const std::string& pbstream_filename, const std::string& map_filestem,
   CHECK(reader.eof());
 
   LOG(INFO) << "Generating combined map image from submap slices.";
-  auto result =
-      ::cartographer::io::PaintSubmapSlices(submap_slices, resolution);
+  ::cartographer::io::PaintSubmapSlicesResult result =
+      [&submap_slices, resolution, num_threads]() {
+        if (num_threads <= 1) {
+          return ::cartographer::io::PaintSubmapSlices(submap_slices,
+                                                       resolution);
+        }
+        ::cartographer::common::ThreadPool thread_pool(num_threads);
+        return ::cartographer::io::PaintSubmapSlices(
+            submap_slices, resolution, kTileSize, &thread_pool);
+      }();
 
   ::cartographer::io::StreamFileWriter pgm_writer(map_filestem + ".pgm");
 
@@ -77,5 +92,5 @@ int main(int argc, char** argv) {
   CHECK(!FLAGS_map_filestem.empty()) << "-map_filestem is missing.";
 
   ::cartographer_ros::Run(FLAGS_pbstream_filename, FLAGS_map_filestem,
-                          FLAGS_resolution);
+                          FLAGS_resolution, FLAGS_num_threads);
 }